@@ -46,7 +46,8 @@ string fullHelpMessage(void) {
     "\n"
     "\tThis tool assigns the frames of a trajectory to the closest bin based\n"
     "on the fiducial structures given.  See Lyman & Zuckerman,\n"
-    "J Phys Chem B (2007) 111:12876-12882 for more details.\n"
+    "J Phys Chem B (2007) 111:12876-12882 for more details.  An optional\n"
+    "last argument gives the number of threads to use (0 = all available).\n"
     "\n"
     "EXAMPLES\n"
     "\n"
@@ -67,8 +68,8 @@ string fullHelpMessage(void) {
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
-  if (argc != 6) {
-    cerr << "Usage - " << argv[0] << " model trajectory range selection fiducials.dcd >assignments.asc\n";
+  if (argc != 6 && argc != 7) {
+    cerr << "Usage - " << argv[0] << " model trajectory range selection fiducials.dcd [threads] >assignments.asc\n";
     fullHelpMessage();
     exit(-1);
   }
@@ -84,6 +85,7 @@ int main(int argc, char *argv[]) {
   ref_model.resetAtomIndices();
   
   pTraj fiducials = createTrajectory(argv[k++], ref_model);
+  uint nthreads = (argc == 7) ? parseStringAs<uint>(argv[k++]) : 1;
 
   vecUint frames;
   if (range == "all")
@@ -97,7 +99,7 @@ int main(int argc, char *argv[]) {
   readTrajectory(refs, ref_model, fiducials);
   cerr << "Read in " << refs.size() << " fiducials.\n";
   cerr << "Assigning...\n";
-  vecUint assigned = assignStructures(subset, traj, frames, refs);
+  vecUint assigned = assignStructures(subset, traj, frames, refs, nthreads);
   cout << "# " << hdr << endl;
   copy(assigned.begin(), assigned.end(), ostream_iterator<uint>(cout, "\n"));
 
@@ -34,6 +34,7 @@
 
 #include "ConvergenceOptions.hpp"
 #include "bcomlib.hpp"
+#include "resample-lib.hpp"
 
 
 using namespace std;
@@ -62,6 +63,7 @@ uint nsteps = 25;
 bool local_average;
 bool use_zscore;
 uint ntries;
+uint nthreads;
 vector<uint> blocksizes;
 uint seed;
 string gold_standard_trajectory_name;
@@ -117,6 +119,11 @@ string fullHelpMessage() {
     "\t\tTo make such a concatoned trajectory see the tools\n"
     "\t\tmerge-traj and subsetter.\n"
     "\n"
+    "bcom -s 'name==\"CA\"' --threads 0 model.pdb traj.dcd > bcom_output\n"
+    "\tComputes the PCA of the blocks in parallel using all available\n"
+    "\tcores.  Z-scores use random shuffles, so --threads is ignored\n"
+    "\twhen --zscore is on.\n"
+    "\n"
     "SEE ALSO\n"
     "\n"
     "  Packages/Convergence/boot_bcom - \n"
@@ -147,7 +154,8 @@ public:
       ("zscore,Z", po::value<bool>(&use_zscore)->default_value(false), "Use Z-score rather than covariance overlap")
       ("ntries,N", po::value<uint>(&ntries)->default_value(20), "Number of tries for Z-score")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -161,12 +169,13 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s'")
+    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s', threads=%d")
       % blocks_spec
       % use_zscore
       % ntries
       % local_average
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % nthreads;
     return(oss.str());
   }
 
@@ -191,46 +200,43 @@ struct Datum {
 
 
 
-vGroup subgroup(const vGroup& A, const uint a, const uint b) {
-  vGroup B;
-
-  for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
-
-  return(B);
-}
+// Z-score of the covariance overlap between a block and the full PCA
+// (this draws from the random number generator, so must be run
+// serially)
+struct BlockZScore {
+  BlockZScore(const RealMatrix& s, const RealMatrix& U) : sref(s), Uref(U) { }
 
+  double operator()(const ResamplingEngine& engine, const FrameList& frames) const {
+    boost::tuple<RealMatrix, RealMatrix> pca_result = engine.pca(frames);
+    RealMatrix s = boost::get<0>(pca_result);
+    RealMatrix U = boost::get<1>(pca_result);
 
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
+    if (length_normalize)
+      for (uint j=0; j<s.rows(); ++j)
+        s[j] /= frames.size();
 
-template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
+    boost::tuple<double, double, double> result = zCovarianceOverlap(sref, Uref, s, U, ntries);
+    return(boost::get<0>(result));
+  }
 
+  RealMatrix sref, Uref;
+};
 
-  TimeSeries<double> coverlaps;
 
-  for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
-    boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
-    RealMatrix s = boost::get<0>(pca_result);
-    RealMatrix U = boost::get<1>(pca_result);
+// Breaks the ensemble up into blocks and computes the PCA for each
+// block and the statistics for the covariance overlaps...
 
-    // Scale the singular values by block-size
-    if (length_normalize)
-      for (uint j=0; j<s.rows(); ++j)
-        s[j] /= blocksize;
+Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const ResamplingEngine& engine, const uint blocksize) {
 
-    double val;
-    if (use_zscore) {
-      boost::tuple<double, double, double> result = zCovarianceOverlap(sa, Ua, s, U, ntries);
-      val = boost::get<0>(result);
-    } else
-      val = covarianceOverlap(sa, Ua, s, U);
+  FrameLists blocks = ResamplingEngine::contiguousBlocks(engine.frames(), blocksize);
 
-    coverlaps.push_back(val);
-  }
+  vector<double> values;
+  if (use_zscore)
+    values = engine.apply(blocks, BlockZScore(sa, Ua));
+  else
+    values = engine.apply(blocks, BlockCoverlap(sa, Ua, length_normalize));
 
+  TimeSeries<double> coverlaps(values);
   return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
 }
 
@@ -330,8 +336,12 @@ int main(int argc, char *argv[]) {
   slayer.attach(&watcher);
   slayer.start();
 
+  // The ensemble is already aligned, so only its coordinates are needed
+  ResamplingEngine engine(ensemble, policy.avg, local_average);
+  engine.threads(use_zscore ? 1 : nthreads);
+
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, policy);
+    Datum result = blocker(UA, Us, engine, *i);
     cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
     slayer.update();
   }
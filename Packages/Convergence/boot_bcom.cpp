@@ -31,6 +31,7 @@
 #include <loos.hpp>
 #include "ConvergenceOptions.hpp"
 #include "bcomlib.hpp"
+#include "resample-lib.hpp"
 
 using namespace std;
 using namespace loos;
@@ -57,6 +58,7 @@ uint nsteps = 25;
 vector<uint> blocksizes;
 bool local_average;
 uint nreps;
+uint nthreads;
 string gold_standard_trajectory_name;
 
 
@@ -126,6 +128,13 @@ string fullHelpMessage() {
     "\twill be used in the averaging.  The number of steps says\n"
     "\tthat a maximum of 10 different block lengths will be used\n"
     "\tin the calculation.\n"
+    "\n"
+    "boot_bcom -s 'name==\"CA\"' --reps=1000 --threads=0 model.pdb traj.dcd\n"
+    "\tUses 1000 replicates for each block size, spread over all\n"
+    "\tavailable cores.  The random blocks are picked before the\n"
+    "\treplicates are run, so for a given --seed the result does not\n"
+    "\tdepend on the number of threads.\n"
+    "\n"
     "SEE ALSO\n"
     "\n"
     "  Packages/Convergence/bcom - \n"
@@ -155,7 +164,8 @@ public:
       ("steps", po::value<uint>(&nsteps)->default_value(25), "Max number of blocks for auto-ranging")
       ("reps", po::value<uint>(&nreps)->default_value(20), "Number of replicates for bootstrap")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
 
   }
@@ -169,11 +179,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s'")
+    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s', threads=%d")
       % blocks_spec
       % local_average
       % nreps
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % nthreads;
     return(oss.str());
   }
 
@@ -194,20 +205,6 @@ struct Datum {
 // @endcond
 
 
-// Randomly pick frames
-vector<uint> pickFrames(const uint nframes, const uint blocksize) {
-  
-  boost::uniform_int<uint> imap(0,nframes-1);
-  boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > rng(rng_singleton(), imap);
-  vector<uint> picks;
-
-  for (uint i=0; i<blocksize; ++i)
-    picks.push_back(rng());
-
-  return(picks);
-}
-
-
 void dumpPicks(const vector<uint>& picks) {
   cerr << "Picks:\n";
   for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
@@ -215,47 +212,21 @@ void dumpPicks(const vector<uint>& picks) {
 }
 
 
-// Extract a subgroup of the vector<AtomicGroup> given the indices in picks...
-vGroup subgroup(const vGroup& A, const vector<uint>& picks) {
-  vGroup B;
-  
-  for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
-    B.push_back(A[*ci]);
-
-  return(B);
-}
-
 
+// Computes the PCA for each bootstrap replicate and the statistics
+// for the covariance overlaps...
 
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
+Datum blocker(const ResamplingEngine& engine, const BlockCoverlap& coverlap, const uint blocksize, uint repeats) {
 
-template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy) {
+  FrameLists blocks = ResamplingEngine::bootstrapBlocks(engine.frames(), blocksize, repeats);
 
-
-  
-  TimeSeries<double> coverlaps;
-
-  for (uint i=0; i<repeats; ++i) {
-    vector<uint> picks = pickFrames(ensemble.size(), blocksize);
-    
-    if (debug) {
-      cerr << "***Block " << blocksize << ", replica " << i << ", picks " << picks.size() << endl;
-      dumpPicks(picks);
+  if (debug)
+    for (uint i=0; i<blocks.size(); ++i) {
+      cerr << "***Block " << blocksize << ", replica " << i << ", picks " << blocks[i].size() << endl;
+      dumpPicks(blocks[i]);
     }
-    
-    vGroup subset = subgroup(ensemble, picks);
-    boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
-    RealMatrix s = boost::get<0>(pca_result);
-    RealMatrix U = boost::get<1>(pca_result);
 
-    if (length_normalize)
-      for (uint j=0; j<s.rows(); ++j)
-        s[j] /= blocksize;
-
-    coverlaps.push_back(covarianceOverlap(sa, Ua, s, U));
-  }
+  TimeSeries<double> coverlaps(engine.apply(blocks, coverlap));
 
   return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
 
@@ -356,8 +327,13 @@ int main(int argc, char *argv[]) {
   slayer.start();
 
 
+  // The ensemble is already aligned, so only its coordinates are needed
+  ResamplingEngine engine(ensemble, policy.avg, local_average);
+  engine.threads(nthreads);
+  BlockCoverlap coverlap(Us, UA, length_normalize);
+
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, nreps, policy);
+    Datum result = blocker(engine, coverlap, *i, nreps);
     cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
     slayer.update();
   }
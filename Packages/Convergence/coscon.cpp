@@ -37,6 +37,7 @@
 
 
 #include "bcomlib.hpp"
+#include "resample-lib.hpp"
 
 using namespace std;
 using namespace loos;
@@ -152,6 +153,7 @@ bool local_average;
 vector<uint> blocksizes;
 string model_name, traj_name, selection;
 uint principal_component;
+uint nthreads;
 
 
 // @cond TOOLS_INTERAL
@@ -162,7 +164,8 @@ public:
     o.add_options()
       ("pc", po::value<uint>(&principal_component)->default_value(0), "Which principal component to use")
       ("blocks", po::value<string>(&blocks_spec), "Block sizes (MATLAB style range)")
-      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global");
+      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -180,10 +183,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, pc=%d")
+    oss << boost::format("blocks='%s', local=%d, pc=%d, threads=%d")
       % blocks_spec
       % local_average
-      % principal_component;
+      % principal_component
+      % nthreads;
     return(oss.str());
   }
 
@@ -197,33 +201,13 @@ public:
 
 
 
-vGroup subgroup(const vGroup& A, const uint a, const uint b) {
-  vGroup B;
-
-  for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
-
-  return(B);
-}
-
-
-
 // Breaks the ensemble up into blocks and computes the RSV for each
 // block and the statistics for the cosine content...
 
-template<class ExtractPolicy>
-Datum blocker(const uint pc, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
-
-
-  TimeSeries<double> cosines;
+Datum blocker(const uint pc, const ResamplingEngine& engine, const uint blocksize) {
 
-  for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
-    RealMatrix V = rsv(subset, policy);
-
-    double val = cosineContent(V, pc);
-    cosines.push_back(val);
-  }
+  FrameLists blocks = ResamplingEngine::contiguousBlocks(engine.frames(), blocksize);
+  TimeSeries<double> cosines(engine.apply(blocks, BlockCosineContent(pc)));
 
   return( Datum(cosines.average(), cosines.variance(), cosines.size()) );
 }
@@ -272,7 +256,8 @@ int main(int argc, char *argv[]) {
   // First, read in and align trajectory
   boost::tuple<std::vector<XForm>, greal, int> ares = iterativeAlignment(ensemble);
   AtomicGroup avg = averageStructure(ensemble);
-  NoAlignPolicy policy(avg, local_average);
+  ResamplingEngine engine(ensemble, avg, local_average);
+  engine.threads(nthreads);
 
 
   // Now iterate over all requested block sizes
@@ -284,7 +269,7 @@ int main(int argc, char *argv[]) {
   slayer.start();
 
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(principal_component, ensemble, *i, policy);
+    Datum result = blocker(principal_component, engine, *i);
     cout << *i << "\t" << result.avg_cosine << "\t" << result.var_cosine << "\t" << result.nblocks << endl;
     slayer.update();
   }
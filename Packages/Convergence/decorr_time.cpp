@@ -49,6 +49,7 @@ uint verbosity;
 
 uint nreps = 5;
 double frac;
+uint nthreads;
 
 vecUint trange;
 vecUint nrange;
@@ -76,7 +77,8 @@ string fullHelpMessage(void) {
     "trajectory has 1 frame/ns, then the t-range is specified in ns.  If your trajectory\n"
     "has one frame every 100 ps, then the t-range is specified in 100 ps units (i.e. frames).\n"
     "This whole procedure is repeated multiple times for each sample size, n.  The number of\n"
-    "repeats is given by the --reps option (default of 5).\n"
+    "repeats is given by the --reps option (default of 5).  Assigning frames to bins can use\n"
+    "several threads (--threads).\n"
     "\tThe output is an ASCII matrix where the first column is the step-size t. Each subsequent\n"
     "set of two-columns corresponds to a different sample size or n-value.  The first column\n"
     "in each set is the scaled variance (eq 3), averaged over each replica.  The second column\n"
@@ -115,7 +117,8 @@ public:
     o.add_options()
       ("nrange", po::value<string>(&nrange_spec)->default_value("2,4,10"), "Range of N to use")
       ("frac", po::value<double>(&frac)->default_value(0.05), "Bin fraction")
-      ("reps", po::value<uint>(&nreps)->default_value(5), "# of repetitions to use for each N");
+      ("reps", po::value<uint>(&nreps)->default_value(5), "# of repetitions to use for each N")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   bool postConditions(po::variables_map& vm) {
@@ -125,10 +128,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("nrange='%s', frac=%f, reps=%f")
+    oss << boost::format("nrange='%s', frac=%f, reps=%f, threads=%d")
       % nrange_spec
       % frac
-      % nreps;
+      % nreps
+      % nthreads;
     return(oss.str());
   }
 
@@ -334,7 +338,7 @@ int main(int argc, char *argv[]) {
 
     boost::tuple<vecGroup, vecUint> fids = pickFiducials(subset, traj, indices, frac);
     vecGroup fiducials = boost::get<0>(fids);
-    vecUint assignments = assignStructures(subset, traj, indices, fiducials);
+    vecUint assignments = assignStructures(subset, traj, indices, fiducials, nthreads);
     uint S = fiducials.size();
     
     DoubleMatrix M(trange.size(), nrange.size() + 1);
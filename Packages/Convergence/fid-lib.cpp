@@ -49,27 +49,120 @@ vecUint findFreeFrames(const vecInt& map) {
 
 
 
-vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames, const vecGroup& refs) {
-  vecUint assignments(frames.size(), 0);
-  uint j = 0;
+vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames, const vecGroup& refs,
+                         const uint nthreads) {
+  FiducialAssigner assigner(refs, nthreads);
+  return(assigner.assign(model, traj, frames));
+}
 
-  for (vecUint::const_iterator frame = frames.begin(); frame != frames.end(); ++frame) {
-    traj->readFrame(*frame);
-    traj->updateGroupCoords(model);
 
-    double mind = numeric_limits<double>::max();
-    uint mini = refs.size() + 1;
-    
-    for (uint i = 0; i < refs.size(); ++i) {
-      model.alignOnto(refs[i]);
-      double d = model.rmsd(refs[i]);
-      if (d < mind) {
-        mind = d;
-        mini = i;
-      }
+
+FiducialAssigner::FiducialAssigner(const vecGroup& refs, const uint nthreads) {
+  threads(nthreads);
+
+  for (vecGroup::const_iterator i = refs.begin(); i != refs.end(); ++i) {
+    if (i->size() != refs[0].size())
+      throw(LOOSError("Fiducials must all be the same size"));
+    _refs.push_back(i->coordsAsVector());
+    alignment::centerAtOrigin(_refs.back());
+  }
+
+  uint n = _refs.size();
+  _dists.assign(n * n, 0.0);
+  for (uint j=0; j<n; ++j)
+    for (uint i=j+1; i<n; ++i)
+      _dists[j*n + i] = _dists[i*n + j] = alignment::centeredRMSD(_refs[j], _refs[i]);
+}
+
+
+void FiducialAssigner::threads(const uint n) {
+  _nthreads = n ? n : boost::thread::hardware_concurrency();
+  if (_nthreads < 1)
+    _nthreads = 1;
+}
+
+
+uint FiducialAssigner::nearest(const Coords& x, const uint guess) const {
+  uint n = _refs.size();
+  if (n == 0)
+    return(1);
+
+  uint mini = guess < n ? guess : 0;
+  double mind = alignment::centeredRMSD(x, _refs[mini]);
+
+  for (uint i=0; i<n; ++i) {
+    if (i == mini || _dists[mini*n + i] > 2.0 * mind)
+      continue;
+    double d = alignment::centeredRMSD(x, _refs[i]);
+    if (d < mind || (d == mind && i < mini)) {
+      mind = d;
+      mini = i;
+    }
+  }
+
+  return(mini);
+}
+
+
+uint FiducialAssigner::nearest(const AtomicGroup& structure) const {
+  if (!_refs.empty() && structure.size() * 3 != _refs[0].size())
+    throw(LOOSError("Structure does not match the fiducials in FiducialAssigner"));
+
+  Coords x = structure.coordsAsVector();
+  alignment::centerAtOrigin(x);
+  return(nearest(x, 0));
+}
+
+
+void FiducialAssigner::Worker::operator()() {
+  uint guess = 0;
+  try {
+    for (uint i=begin; i<end; ++i)
+      guess = (*results)[i] = assigner->nearest((*crds)[i], guess);
+  }
+  catch (std::exception& e) {
+    *error = e.what();
+  }
+}
+
+
+vecUint FiducialAssigner::assign(AtomicGroup& model, pTraj& traj, const vecUint& frames) const {
+  if (!_refs.empty() && model.size() * 3 != _refs[0].size())
+    throw(LOOSError("Model does not match the fiducials in FiducialAssigner"));
+
+  vecUint assignments(frames.size(), 0);
+  uint blocksize = 16 * _nthreads;
+  std::vector<Coords> block(blocksize);
+  vecUint results(blocksize);
+
+  // The trajectory is read serially, a block at a time, and the
+  // frames in the block are then assigned in parallel
+  for (uint k=0; k<frames.size(); k += blocksize) {
+    uint n = min(blocksize, static_cast<uint>(frames.size()) - k);
+    for (uint i=0; i<n; ++i) {
+      traj->readFrame(frames[k+i]);
+      traj->updateGroupCoords(model);
+      block[i] = model.coordsAsVector();
+      alignment::centerAtOrigin(block[i]);
+    }
+
+    uint nthreads = min(_nthreads, n);
+    uint chunk = (n + nthreads - 1) / nthreads;
+    std::vector<std::string> errors(nthreads);
+    if (nthreads == 1) {
+      Worker worker(this, &block, &results, 0, n, &errors[0]);
+      worker();
+    } else {
+      boost::thread_group threads;
+      for (uint t=0; t<nthreads; ++t)
+        threads.create_thread(Worker(this, &block, &results, t * chunk, min(n, (t+1) * chunk), &errors[t]));
+      threads.join_all();
     }
+    for (uint t=0; t<nthreads; ++t)
+      if (!errors[t].empty())
+        throw(LOOSError(errors[t]));
 
-    assignments[j++] = mini;
+    copy(results.begin(), results.begin() + n, assignments.begin() + k);
   }
 
   return(assignments);
@@ -33,6 +33,7 @@
 
 
 #include <loos.hpp>
+#include <boost/thread/thread.hpp>
 
 
 typedef std::vector<int>                   vecInt;
@@ -48,7 +49,63 @@ vecUint findFreeFrames(const vecInt& map);
 
 // Given a set of reference structures and a trajectory, classify the trajectory
 // based on which reference structure is closest to each trajectory frame
-vecUint assignStructures(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const vecGroup& refs);
+// (0 threads = all available)
+vecUint assignStructures(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const vecGroup& refs,
+                         const uint nthreads = 1);
+
+
+// Finds the closest fiducial (by RMSD after optimal superposition) to
+// each of a set of structures.
+//
+// The fiducials are centered once, and the fiducial-fiducial
+// distances are precomputed.  Since the RMSD is a metric, once a
+// frame is a distance d from fiducial a, any fiducial b with
+// d(a,b) > 2d must be further away than a and can be skipped.  The
+// search starts from the previous frame's fiducial, which is usually
+// close, so most of the fiducials are never compared.  The result is
+// the same as comparing against every fiducial (ties going to the
+// lowest index).
+//
+// Frames are read in blocks, and each block is split across threads.
+class FiducialAssigner {
+public:
+  FiducialAssigner(const vecGroup& refs, const uint nthreads = 1);
+
+  // Number of threads used by assign() (0 = all available)
+  void threads(const uint n);
+  uint threads() const { return(_nthreads); }
+
+  uint size() const { return(_refs.size()); }
+
+  // Index of the closest fiducial to a structure
+  uint nearest(const loos::AtomicGroup& structure) const;
+
+  // Assignments for the requested trajectory frames
+  vecUint assign(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames) const;
+
+private:
+  typedef loos::alignment::vecDouble     Coords;
+
+  struct Worker {
+    Worker(const FiducialAssigner* a, const std::vector<Coords>* c, vecUint* r, const uint b, const uint e, std::string* err)
+      : assigner(a), crds(c), results(r), begin(b), end(e), error(err) { }
+
+    void operator()();
+
+    const FiducialAssigner* assigner;
+    const std::vector<Coords>* crds;
+    vecUint* results;
+    uint begin, end;
+    std::string* error;
+  };
+
+  uint nearest(const Coords& x, const uint guess) const;
+
+  std::vector<Coords> _refs;
+  vecDouble _dists;
+  uint _nthreads;
+};
+
 
 // Given a vector that contains indices into a trajectory, will trim off the
 // end so the # of frames is an even multiple of the requested bin size (via frac)
@@ -101,6 +101,11 @@ int main(int argc, char *argv[]) {
   string range(argv[opti++]);
   string selection(argv[opti++]);
   AtomicGroup subset = selectAtoms(model, selection);
+
+  // Frames are revisited in random order for every fiducial, so keep
+  // the decoded subset around rather than re-reading the trajectory
+  traj = pTraj(new CachedTrajectory(traj, subset));
+
   string outname(argv[opti++]);
   double cutoff = strtod(argv[opti++], 0);
 
@@ -132,7 +137,7 @@ int main(int argc, char *argv[]) {
     uint pick = possible_frames[static_cast<uint>(floor(possible_frames.size() * rng()))];
 
     traj->readFrame(frames[pick]);
-    traj->updateGroupCoords(model);
+    traj->updateGroupCoords(subset);
 
     AtomicGroup fiducial = subset.copy();
     fiducial.centerAtOrigin();
@@ -150,7 +155,7 @@ int main(int argc, char *argv[]) {
       if (assignments[i] >= 0 || i == pick)
         continue;
       traj->readFrame(frames[i]);
-      traj->updateGroupCoords(model);
+      traj->updateGroupCoords(subset);
       subset.centerAtOrigin();
       subset.alignOnto(fiducial);
       double d = subset.rmsd(fiducial);
@@ -0,0 +1,253 @@
+/*
+  resample-lib
+
+  Block and bootstrap resampling of a trajectory for the
+  convergence tools
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "resample-lib.hpp"
+#include "bcomlib.hpp"
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace Convergence {
+
+
+  ResamplingEngine::ResamplingEngine(const vector<AtomicGroup>& ensemble, const bool local_average)
+    : _nthreads(1), _local_average(local_average)
+  {
+    extract(ensemble);
+
+    // Same accumulation order as averageStructure()
+    _avg.assign(_nrows, 0.0);
+    for (uint i=0; i<_nframes; ++i) {
+      const double* p = &(_crds[static_cast<ulong>(i) * _nrows]);
+      for (uint j=0; j<_nrows; ++j)
+        _avg[j] += p[j];
+    }
+    for (uint j=0; j<_nrows; ++j)
+      _avg[j] /= _nframes;
+  }
+
+
+  ResamplingEngine::ResamplingEngine(const vector<AtomicGroup>& ensemble, const AtomicGroup& avg, const bool local_average)
+    : _nthreads(1), _local_average(local_average)
+  {
+    extract(ensemble);
+    if (avg.size() * 3 != _nrows)
+      throw(LOOSError("Average structure does not match the ensemble in ResamplingEngine"));
+
+    _avg.resize(_nrows);
+    for (uint i=0; i<avg.size(); ++i)
+      for (uint k=0; k<3; ++k)
+        _avg[3*i+k] = avg[i]->coords()[k];
+  }
+
+
+  void ResamplingEngine::extract(const vector<AtomicGroup>& ensemble) {
+    if (ensemble.empty())
+      throw(LOOSError("Cannot resample an empty ensemble"));
+
+    _nframes = ensemble.size();
+    _nrows = 3 * ensemble[0].size();
+    _crds.resize(static_cast<ulong>(_nframes) * _nrows);
+
+    double* p = &(_crds[0]);
+    for (uint i=0; i<_nframes; ++i) {
+      if (ensemble[i].size() * 3 != _nrows)
+        throw(LOOSError("Ensemble structures must all be the same size"));
+      for (uint j=0; j<ensemble[i].size(); ++j) {
+        const GCoord& c = ensemble[i][j]->coords();
+        *(p++) = c[0];
+        *(p++) = c[1];
+        *(p++) = c[2];
+      }
+    }
+  }
+
+
+  void ResamplingEngine::threads(const uint n) {
+    _nthreads = n ? n : boost::thread::hardware_concurrency();
+    if (_nthreads < 1)
+      _nthreads = 1;
+  }
+
+
+  // Matches extractCoords() followed by subtractStructure() (including
+  // the conversion of the average to float before subtracting)
+  RealMatrix ResamplingEngine::coords(const FrameList& frames) const {
+    uint n = frames.size();
+    if (n == 0)
+      throw(LOOSError("Cannot resample an empty block of frames"));
+    for (uint i=0; i<n; ++i)
+      if (frames[i] >= _nframes)
+        throw(LOOSError("Frame index out of range in ResamplingEngine"));
+
+    RealMatrix M(_nrows, n);
+
+    vector<double> lavg;
+    const vector<double>* avg = &_avg;
+    if (_local_average) {
+      lavg.assign(_nrows, 0.0);
+      for (uint i=0; i<n; ++i) {
+        const double* p = &(_crds[static_cast<ulong>(frames[i]) * _nrows]);
+        for (uint j=0; j<_nrows; ++j)
+          lavg[j] += p[j];
+      }
+      for (uint j=0; j<_nrows; ++j)
+        lavg[j] /= n;
+      avg = &lavg;
+    }
+
+    vector<float> favg(avg->begin(), avg->end());
+    for (uint i=0; i<n; ++i) {
+      const double* p = &(_crds[static_cast<ulong>(frames[i]) * _nrows]);
+      float* q = M.get() + static_cast<ulong>(i) * _nrows;
+      for (uint j=0; j<_nrows; ++j) {
+        q[j] = p[j];
+        q[j] -= favg[j];
+      }
+    }
+
+    return(M);
+  }
+
+
+  // Eigendecomposition of C (in place), with eigenvalues in W, both
+  // sorted in descending order
+  void ResamplingEngine::eigen(RealMatrix& C, RealMatrix& W) const {
+    char jobz = 'V';
+    char uplo = 'L';
+    f77int n = C.rows();
+    f77int lda = n;
+    float dummy;
+    f77int lwork = -1;
+    f77int info;
+    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), &dummy, &lwork, &info);
+    if (info != 0)
+      throw(NumericalError("ssyev failed in ResamplingEngine", info));
+
+    lwork = static_cast<f77int>(dummy);
+    vector<float> work(lwork+1);
+
+    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), &(work[0]), &lwork, &info);
+    if (info != 0)
+      throw(NumericalError("ssyev failed in ResamplingEngine", info));
+
+    Math::reverseColumns(C);
+    Math::reverseRows(W);
+  }
+
+
+  boost::tuple<RealMatrix, RealMatrix> ResamplingEngine::pca(const FrameList& frames) const {
+    RealMatrix M = coords(frames);
+    RealMatrix C = Math::MMMultiply(M, M, false, true);
+    RealMatrix W(C.rows(), 1);
+    eigen(C, W);
+
+    // Zap negative eigenvalues...
+    for (uint j=0; j<W.rows(); ++j)
+      if (W[j] < 0.0)
+        W[j] = 0.0;
+
+    return(boost::tuple<RealMatrix, RealMatrix>(W, C));
+  }
+
+
+  RealMatrix ResamplingEngine::rsv(const FrameList& frames) const {
+    RealMatrix M = coords(frames);
+    RealMatrix C = Math::MMMultiply(M, M, false, true);
+    RealMatrix W(C.rows(), 1);
+    eigen(C, W);
+
+    // Correctly scale the eigenvalues
+    for (uint j=0; j<W.rows(); ++j)
+      W[j] = W[j] < 0 ? 0.0 : sqrt(W[j]);
+
+    // Multiply eigenvectors by inverse eigenvalues
+    for (uint i=0; i<C.cols(); ++i) {
+      double konst = (W[i] > 0.0) ? (1.0/W[i]) : 0.0;
+
+      for (uint j=0; j<C.rows(); ++j)
+        C(j, i) *= konst;
+    }
+
+    RealMatrix Vt = Math::MMMultiply(C, M, true, false);
+    return(Math::transpose(Vt));
+  }
+
+
+  FrameLists ResamplingEngine::contiguousBlocks(const uint nframes, const uint blocksize) {
+    FrameLists blocks;
+    for (uint i=0; i + blocksize < nframes; i += blocksize) {
+      FrameList block(blocksize);
+      for (uint j=0; j<blocksize; ++j)
+        block[j] = i + j;
+      blocks.push_back(block);
+    }
+    return(blocks);
+  }
+
+
+  FrameLists ResamplingEngine::bootstrapBlocks(const uint nframes, const uint blocksize, const uint nreps) {
+    boost::uniform_int<uint> imap(0,nframes-1);
+    boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > rng(rng_singleton(), imap);
+
+    FrameLists blocks(nreps, FrameList(blocksize));
+    for (uint i=0; i<nreps; ++i)
+      for (uint j=0; j<blocksize; ++j)
+        blocks[i][j] = rng();
+
+    return(blocks);
+  }
+
+
+
+  double BlockCoverlap::operator()(const ResamplingEngine& engine, const FrameList& frames) const {
+    boost::tuple<RealMatrix, RealMatrix> pca_result = engine.pca(frames);
+    RealMatrix s = boost::get<0>(pca_result);
+    RealMatrix U = boost::get<1>(pca_result);
+
+    if (length_normalize)
+      for (uint j=0; j<s.rows(); ++j)
+        s[j] /= frames.size();
+
+    return(covarianceOverlap(sref, Uref, s, U));
+  }
+
+
+  double BlockCosineContent::operator()(const ResamplingEngine& engine, const FrameList& frames) const {
+    RealMatrix V = engine.rsv(frames);
+    return(cosineContent(V, pc));
+  }
+
+
+}
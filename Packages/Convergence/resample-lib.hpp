@@ -0,0 +1,215 @@
+/*
+  resample-lib
+
+  Block and bootstrap resampling of a trajectory for the
+  convergence tools
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// @cond PACKAGES_INTERNAL
+
+#if !defined(LOOS_RESAMPLELIB_HPP)
+#define LOOS_RESAMPLELIB_HPP
+
+
+#include <loos.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+namespace Convergence {
+
+  typedef std::vector<uint>            FrameList;
+  typedef std::vector<FrameList>       FrameLists;
+
+
+  //! Computes the PCA (or RSVs) of many subsets of one ensemble
+  /**
+   * The block and bootstrap tools used to build a new
+   * vector<AtomicGroup> for every block or replicate, then extract
+   * its coordinates.  Here the coordinates of the (already aligned)
+   * ensemble are copied once into a single array, with each frame
+   * stored contiguously, and a block is just a list of frame indices
+   * into it.
+   *
+   * pca() and rsv() give the same results as the pca() and rsv()
+   * functions in bcomlib.hpp using a NoAlignPolicy, and are safe to
+   * call from several threads at once.  apply() evaluates a functor
+   * over a list of blocks using threads() worker threads, returning
+   * the results in block order.
+   */
+  class ResamplingEngine {
+  public:
+    //! Use the ensemble average (or the block average if local_average is set)
+    ResamplingEngine(const std::vector<loos::AtomicGroup>& ensemble, const bool local_average);
+
+    //! Use \a avg (or the block average if local_average is set)
+    ResamplingEngine(const std::vector<loos::AtomicGroup>& ensemble, const loos::AtomicGroup& avg, const bool local_average);
+
+    uint frames() const { return(_nframes); }
+
+    //! Length of a frame's coordinate vector (3 * atoms)
+    uint rows() const { return(_nrows); }
+
+    //! Number of threads used by apply() (0 = all available)
+    void threads(const uint n);
+    uint threads() const { return(_nthreads); }
+
+    //! Average-subtracted coordinates for the frames (each a column)
+    loos::RealMatrix coords(const FrameList& frames) const;
+
+    //! Eigenvalues and eigenvectors of the block covariance
+    boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(const FrameList& frames) const;
+
+    //! Right singular vectors of the block
+    loos::RealMatrix rsv(const FrameList& frames) const;
+
+
+    //! Non-overlapping contiguous blocks, as used by bcom and coscon
+    static FrameLists contiguousBlocks(const uint nframes, const uint blocksize);
+
+    //! Random blocks of frames (with replacement)
+    /**
+     * The picks are drawn from the LOOS random number generator in
+     * order, replicate by replicate, before any work is done.  The
+     * blocks (and so the results) depend only on the seed, not on the
+     * number of threads.
+     */
+    static FrameLists bootstrapBlocks(const uint nframes, const uint blocksize, const uint nreps);
+
+
+    //! Evaluates f(*this, block) for each block in parallel
+    template<class Func>
+    std::vector<double> apply(const FrameLists& blocks, const Func& f) const {
+      std::vector<double> results(blocks.size());
+      uint nthreads = std::min(_nthreads, static_cast<uint>(blocks.size()));
+
+      if (nthreads <= 1) {
+        for (uint i=0; i<blocks.size(); ++i)
+          results[i] = f(*this, blocks[i]);
+        return(results);
+      }
+
+      Queue<Func> queue(this, &blocks, &f, &results);
+      boost::thread_group threads;
+      for (uint i=0; i<nthreads; ++i)
+        threads.create_thread(Worker<Func>(&queue));
+      threads.join_all();
+
+      if (!queue.error.empty())
+        throw(loos::LOOSError(queue.error));
+      return(results);
+    }
+
+  private:
+
+    // Blocks are handed out one at a time, since the cost of each
+    // varies with its size
+    template<class Func>
+    struct Queue {
+      Queue(const ResamplingEngine* e, const FrameLists* b, const Func* f, std::vector<double>* r)
+        : engine(e), blocks(b), func(f), results(r), next(0) { }
+
+      bool pop(uint& i) {
+        boost::mutex::scoped_lock lock(mtx);
+        if (next >= blocks->size() || !error.empty())
+          return(false);
+        i = next++;
+        return(true);
+      }
+
+      void fail(const std::string& msg) {
+        boost::mutex::scoped_lock lock(mtx);
+        if (error.empty())
+          error = msg;
+      }
+
+      const ResamplingEngine* engine;
+      const FrameLists* blocks;
+      const Func* func;
+      std::vector<double>* results;
+      uint next;
+      std::string error;
+      boost::mutex mtx;
+    };
+
+    template<class Func>
+    struct Worker {
+      Worker(Queue<Func>* q) : queue(q) { }
+
+      void operator()() {
+        uint i;
+        try {
+          while (queue->pop(i))
+            (*(queue->results))[i] = (*(queue->func))(*(queue->engine), (*(queue->blocks))[i]);
+        }
+        catch (std::exception& e) {
+          queue->fail(e.what());
+        }
+      }
+
+      Queue<Func>* queue;
+    };
+
+
+    void extract(const std::vector<loos::AtomicGroup>& ensemble);
+    void eigen(loos::RealMatrix& C, loos::RealMatrix& W) const;
+
+    uint _nframes, _nrows, _nthreads;
+    bool _local_average;
+    std::vector<double> _crds;
+    std::vector<double> _avg;
+  };
+
+
+
+  //! Covariance overlap between a block's PCA and a reference PCA
+  struct BlockCoverlap {
+    BlockCoverlap(const loos::RealMatrix& s, const loos::RealMatrix& U, const bool normalize)
+      : sref(s), Uref(U), length_normalize(normalize) { }
+
+    double operator()(const ResamplingEngine& engine, const FrameList& frames) const;
+
+    loos::RealMatrix sref, Uref;
+    bool length_normalize;
+  };
+
+
+  //! Cosine content of one principal component of a block
+  struct BlockCosineContent {
+    BlockCosineContent(const uint n) : pc(n) { }
+
+    double operator()(const ResamplingEngine& engine, const FrameList& frames) const;
+
+    uint pc;
+  };
+
+}
+
+
+#endif
+
+
+// @endcond
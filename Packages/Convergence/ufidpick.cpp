@@ -87,6 +87,7 @@ int main(int argc, char *argv[]) {
   string range(argv[opti++]);
   string selection(argv[opti++]);
   AtomicGroup subset = selectAtoms(model, selection);
+  traj = pTraj(new CachedTrajectory(traj, subset));
   string outname(argv[opti++]);
   double cutoff = strtod(argv[opti++], 0);
 
@@ -31,42 +31,48 @@ int main(int argc, char *argv[]) {
 
   if (max_t == 0)
     max_t = n/10;
+  if (max_t > n)
+    max_t = n;
 
   cerr << boost::format("Water matrix is %d x %d\n") % m % n;
 
+  // Pack the matrix down to one bit per water per frame
+  OccupancyMatrix O = OccupancyMatrix::fromMatrix(M);
+  M.reset();
+
   cout << "# " << hdr << endl;
   cout << "# tau\tavg\tstdev\tsterr\n";
   
   cerr << "Processing- ";
-  
 
-  for (uint tau=0; tau<max_t; ++tau) {
-    vector<double> survivals;
-    if (tau % 100 == 0)
+  // Accumulate the per-water survival statistics for every tau at once
+  vector<double> sum(max_t, 0.0), sum2(max_t, 0.0);
+  vector<uint> nwaters(max_t, 0);
+  vector<ulong> inside, pairs;
+
+  for (uint j=0; j<m; ++j) {
+    if (j % 1000 == 0)
       cerr << '.';
-    
-    for (uint j=0; j<m; ++j) {
-      uint inside = 0;
-      uint pairs = 0;
-      
-      for (uint t=0; t<n-tau-1; ++t)
-	if (M(j, t))
-	{
-	  ++pairs;
-	  if (M(j, t+tau))
-	    ++inside;
-	}
-      if (pairs)
-	survivals.push_back(static_cast<double>(inside) / (pairs));
-    }
-    dTimeSeries ts(survivals);
-    cout << tau << '\t' << ts.average() << '\t' << ts.stdev() << '\t' << ts.sterr() << endl;
+
+    inside.assign(max_t, 0);
+    pairs.assign(max_t, 0);
+    intermittentSurvival(O, j, max_t, inside, pairs);
+
+    for (uint tau=0; tau<max_t; ++tau)
+      if (pairs[tau]) {
+        double s = static_cast<double>(inside[tau]) / pairs[tau];
+        sum[tau] += s;
+        sum2[tau] += s*s;
+        ++nwaters[tau];
+      }
+  }
+
+  for (uint tau=0; tau<max_t; ++tau) {
+    double avg = sum[tau] / nwaters[tau];
+    double stdev = sqrt(sum2[tau] / nwaters[tau] - avg*avg);
+    cout << tau << '\t' << avg << '\t' << stdev << '\t' << stdev / sqrt(static_cast<double>(nwaters[tau])) << endl;
   }
   
   cerr << " Done\n";
 
 }
-
-
-
-  
@@ -38,6 +38,11 @@ namespace ENM {
 
     void solve() {
 
+      if (sparse_) {
+        solveSparse();
+        return;
+      }
+
       if (verbosity_ > 2)
         std::cerr << "Building hessian...\n";
       buildHessian();
@@ -69,6 +74,8 @@ namespace ENM {
     //! Return the inverted hessian matrix
     loos::DoubleMatrix inverseHessian() {
 
+      if (sparse_)
+        throw(std::logic_error("ANM::inverseHessian() is not available for a sparse hessian"));
       if (rsv_.rows() == 0)
         throw(std::logic_error("ANM::inverseHessian() called before ANM::solve()"));
 
@@ -85,6 +92,34 @@ namespace ENM {
 
 
   private:
+
+    // Lowest modes only, with the rigid-body motions deflated
+    void solveSparse() {
+      if (verbosity_ > 2)
+        std::cerr << "Building sparse hessian...\n";
+      buildSparseHessian();
+
+      loos::Timer<> t;
+      if (verbosity_ > 1)
+        std::cerr << "Computing lowest modes with Lanczos...\n";
+      t.start();
+
+      loos::DoubleMatrix Z = rigidBodyModes(blocker_->nodeList());
+      uint k = sparseModeCount(sparse_hessian_.size());
+      if (k < Z.cols())
+        k = Z.cols();
+      boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> result = lanczosLowestModes(sparse_hessian_, k, Z, 1e-8, 0, verbosity_);
+
+      t.stop();
+      if (verbosity_ > 1)
+        std::cerr << "Lanczos took " << loos::timeAsString(t.elapsed()) << std::endl;
+
+      eigenvals_ = boost::get<0>(result);
+      eigenvecs_ = boost::get<1>(result);
+      rsv_ = loos::DoubleMatrix();
+    }
+
+
     loos::DoubleMatrix rsv_;
 
   };
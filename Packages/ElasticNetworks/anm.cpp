@@ -84,6 +84,11 @@ bool debug;
 string spring_desc;
 string bound_spring_desc;
 
+bool sparse;
+double cutoff;
+uint nmodes;
+uint nthreads;
+
 string fullHelpMessage() {
 
   string s = 
@@ -108,6 +113,18 @@ string fullHelpMessage() {
     "\tfoo_Hi.asc  - Pseudo-inverse of H\n"
     "\n"
     "\n"
+    "* Large Systems *\n"
+    "For large structures, the dense hessian and its SVD become too\n"
+    "expensive.  The --sparse option builds a sparse hessian that only\n"
+    "includes contacts within --cutoff (by default, the cutoff of the\n"
+    "spring function, which must then have one) and computes only the\n"
+    "lowest --modes eigenpairs (including the 6 rigid-body modes) using\n"
+    "Lanczos iteration.  The hessian may be built and applied with\n"
+    "multiple threads (--threads).  Springs that do not go to zero with\n"
+    "distance are truncated at the cutoff.  In sparse mode, neither the\n"
+    "hessian nor its pseudo-inverse are written.\n"
+    "\n"
+    "\n"
     "* Spring Constant Control *\n"
     "Contacts between beads in an ANM are connected by a single potential\n"
     "which is described by a hookean spring.  The stiffness of each connection\n"
@@ -164,12 +181,17 @@ public:
     o.add_options()
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("spring,S", po::value<string>(&spring_desc)->default_value("distance"),"Spring function to use")
-      ("bound", po::value<string>(&bound_spring_desc), "Bound spring");
+      ("bound", po::value<string>(&bound_spring_desc), "Bound spring")
+      ("sparse", po::value<bool>(&sparse)->default_value(false), "Use a sparse hessian and only compute the lowest modes")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for the sparse hessian (0 = use spring cutoff)")
+      ("modes", po::value<uint>(&nmodes)->default_value(56), "Number of modes to compute with --sparse (including zero modes)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use with --sparse");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("debug=%d, spring='%s', bound='%s'") % debug % spring_desc % bound_spring_desc;
+    oss << boost::format("debug=%d, spring='%s', bound='%s', sparse=%d, cutoff=%f, modes=%d, threads=%d")
+      % debug % spring_desc % bound_spring_desc % sparse % cutoff % nmodes % nthreads;
     return(oss.str());
   }
 };
@@ -254,6 +276,10 @@ int main(int argc, char *argv[]) {
   anm.prefix(prefix);
   anm.meta(header);
   anm.verbosity(verbosity);
+  anm.sparse(sparse);
+  anm.cutoff(cutoff);
+  anm.modes(nmodes);
+  anm.threads(nthreads);
 
   anm.solve();
 
@@ -262,7 +288,8 @@ int main(int argc, char *argv[]) {
   writeAsciiMatrix(prefix + "_U.asc", anm.eigenvectors(), header, false);
   writeAsciiMatrix(prefix + "_s.asc", anm.eigenvalues(), header, false);
 
-  writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
+  if (!sparse)
+    writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
 
   for (vector<SuperBlock*>::iterator i = blocks.begin(); i != blocks.end(); ++i)
     delete *i;
@@ -117,5 +117,21 @@ namespace ENM {
   }
 
 
+  void ElasticNetworkModel::buildSparseHessian() {
+    sparse_hessian_ = ENM::buildSparseHessian(blocker_, cutoff_, nthreads_);
+    hessian_ = DoubleMatrix();
+
+    if (verbosity_ > 1)
+      cerr << boost::format("Sparse hessian has %d blocks for %d nodes\n")
+        % sparse_hessian_.storedBlocks() % sparse_hessian_.nodes();
+  }
+
+
+  uint ElasticNetworkModel::sparseModeCount(const uint n) const {
+    uint k = (nmodes_ == 0) ? default_sparse_modes + 6 : nmodes_;
+    return(k > n ? n : k);
+  }
+
+
 
 };
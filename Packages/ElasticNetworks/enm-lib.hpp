@@ -31,6 +31,7 @@
 
 #include <loos.hpp>
 #include "hessian.hpp"
+#include "sparse-hessian.hpp"
 
 //! Namespace to encapsulate Elastic Network Model routines
 namespace ENM {
@@ -72,7 +73,8 @@ namespace ENM {
      constructed, i.e. what nodes are used and how the spring function
      between them is calculated.
     */
-    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0) { }
+    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0),
+                                                  sparse_(false), cutoff_(0.0), nmodes_(0), nthreads_(1) { }
     virtual ~ElasticNetworkModel() { }
 
     // Should we allow this?
@@ -97,6 +99,28 @@ namespace ENM {
     void verbosity(const int i) { verbosity_ = i; }
     int verbosity() const { return(verbosity_); }
 
+    //! Use a sparse hessian and Lanczos rather than a dense SVD
+    /**
+     * For large systems, the dense 3N x 3N hessian is both too big to
+     * store and too expensive to decompose.  In sparse mode, only node
+     * pairs within cutoff() are stored and only the lowest modes()
+     * eigenpairs are computed.  The dense hessian() is left empty.
+     */
+    void sparse(const bool b) { sparse_ = b; }
+    bool sparse() const { return(sparse_); }
+
+    //! Cutoff for the sparse hessian (0 means use the spring function's cutoff)
+    void cutoff(const double d) { cutoff_ = d; }
+    double cutoff() const { return(cutoff_); }
+
+    //! Number of modes to compute in sparse mode (0 means a default)
+    void modes(const uint n) { nmodes_ = n; }
+    uint modes() const { return(nmodes_); }
+
+    //! Number of threads to use when building and applying a sparse hessian
+    void threads(const uint n) { nthreads_ = (n == 0) ? 1 : n; }
+    uint threads() const { return(nthreads_); }
+
     // -----------------------------------------------------
     //! Forwards to contained superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
@@ -120,6 +144,9 @@ namespace ENM {
     //! Accessors for eigenpairs and hessian
     const loos::DoubleMatrix& hessian() const { return(hessian_); }
 
+    //! The sparse hessian (only built in sparse mode)
+    const SparseHessian& sparseHessian() const { return(sparse_hessian_); }
+
 
 
   protected:
@@ -131,6 +158,12 @@ namespace ENM {
      * Uses the contained SuperBlock to build a hessian
      */
     void buildHessian();
+
+    //! Construct the sparse hessian using the contained SuperBlock
+    void buildSparseHessian();
+
+    //! Number of modes to compute in sparse mode, given the total available
+    uint sparseModeCount(const uint n) const;
   
 
   protected:
@@ -148,6 +181,15 @@ namespace ENM {
     loos::DoubleMatrix eigenvals_;
 
     loos::DoubleMatrix hessian_;
+
+    bool sparse_;
+    double cutoff_;
+    uint nmodes_;
+    uint nthreads_;
+    SparseHessian sparse_hessian_;
+
+    //! Default number of non-trivial modes computed in sparse mode
+    static const uint default_sparse_modes = 50;
   
   };
 
@@ -58,6 +58,8 @@
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 
+#include "sparse-hessian.hpp"
+
 using namespace std;
 using namespace loos;
 namespace po = boost::program_options;
@@ -71,6 +73,9 @@ string selection;
 string model_name;
 string prefix;
 double cutoff;
+bool sparse;
+uint nmodes;
+uint nthreads;
 
 void fullHelp() {
   //string msg = 
@@ -97,6 +102,9 @@ void fullHelp() {
     "Notes:\n"
     "- The default selection (if none is specified) is to pick CA's\n"
     "- The output is ASCII format suitable for use with Matlab/Octave/Gnuplot\n"
+    "- For large systems, --sparse builds a sparse Kirchoff matrix (using\n"
+    "  --threads threads) and computes only the lowest --modes eigenpairs\n"
+    "  with Lanczos iteration.  Only foo_U.asc and foo_s.asc are written.\n"
     //
     "\n"
     "EXAMPLES\n"
@@ -128,7 +136,10 @@ void parseOptions(int argc, char *argv[]) {
       ("help", "Produce this help message")
       ("fullhelp", "Get extended help")
       ("selection,s", po::value<string>(&selection)->default_value("name == 'CA'"), "Which atoms to use for the network")
-      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact");
+      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact")
+      ("sparse", po::value<bool>(&sparse)->default_value(false), "Use a sparse Kirchoff matrix and only compute the lowest modes")
+      ("modes", po::value<uint>(&nmodes)->default_value(51), "Number of modes to compute with --sparse (including the zero modes)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use with --sparse");
 
     po::options_description hidden("Hidden options");
     hidden.add_options()
@@ -201,6 +212,31 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, selection);
 
   cout << boost::format("Selected %d atoms from %s\n") % subset.size() % model_name;
+
+  if (sparse) {
+    Timer<WallTimer> timer;
+    cerr << "Computing sparse Kirchoff matrix - ";
+    timer.start();
+    ENM::SparseHessian K = ENM::buildSparseKirchoff(subset, cutoff, normalization, nthreads);
+    timer.stop();
+    cerr << "done.\n" << timer << endl;
+
+    // Each connected component of the network has its own zero mode
+    uint n = subset.size();
+    DoubleMatrix Z = ENM::kirchoffNullspace(K);
+    if (Z.cols() > 1)
+      cerr << boost::format("Warning- the network has %d disconnected pieces\n") % Z.cols();
+
+    uint k = nmodes > n ? n : nmodes;
+    if (k < Z.cols())
+      k = Z.cols();
+    boost::tuple<DoubleMatrix, DoubleMatrix> result = ENM::lanczosLowestModes(K, k, Z);
+
+    writeAsciiMatrix(prefix + "_U.asc", boost::get<1>(result), header);
+    writeAsciiMatrix(prefix + "_s.asc", boost::get<0>(result), header);
+    exit(0);
+  }
+
   Timer<WallTimer> timer;
   cerr << "Computing Kirchoff matrix - ";
   timer.start();
@@ -89,6 +89,20 @@ namespace ENM {
       return(blockImpl(j, i, springs));
     }
 
+    //! Writes the superblock for the two nodes into a 9-element (column-major) array
+    virtual void block(const uint j, const uint i, double* B) {
+      blockImpl(j, i, springs, B);
+    }
+
+    //! Distance beyond which superblocks are always zero (0 means no cutoff)
+    virtual double cutoff() const { return(springs == 0 ? 0.0 : springs->cutoff()); }
+
+    //! Pairs of nodes (j < i) that must be included regardless of distance
+    virtual void boundPairs(std::vector< std::pair<uint, uint> >& /* pairs */) const { }
+
+    //! The nodes the Hessian is built from
+    const loos::AtomicGroup& nodeList() const { return(nodes); }
+
 
   protected:
 
@@ -118,6 +132,25 @@ namespace ENM {
       return(B);
     }
 
+    //! Non-allocating implementation of the SuperBlock calculation
+    void blockImpl(const uint j, const uint i, SpringFunction* fptr, double* B) {
+      if (i >= size() || j >= size())
+        throw(std::runtime_error("Invalid index in Hessian SuperBlock"));
+
+      if (fptr == 0)
+        throw(std::runtime_error("No spring function defined for hessian!"));
+
+      loos::GCoord u = nodes[j]->coords();
+      loos::GCoord v = nodes[i]->coords();
+      loos::GCoord d = v - u;
+
+      double K[9];
+      fptr->constant(u, v, d, K);
+      for (uint y=0; y<3; ++y)
+        for (uint x=0; x<3; ++x)
+          B[y*3 + x] = d[x]*d[y] * K[y*3 + x];
+    }
+
 
     SpringFunction* springs;
     loos::AtomicGroup nodes;
@@ -204,6 +237,24 @@ namespace ENM {
         return(decorated->block(j, i));
     }
 
+    void block(const uint j, const uint i, double* B) {
+      if (connectivity(j, i))
+        blockImpl(j, i, bound_spring, B);
+      else
+        decorated->block(j, i, B);
+    }
+
+    double cutoff() const { return(decorated->cutoff()); }
+
+    //! Connected nodes are bound no matter how far apart they are
+    void boundPairs(std::vector< std::pair<uint, uint> >& pairs) const {
+      for (uint i=1; i<connectivity.cols(); ++i)
+        for (uint j=0; j<i; ++j)
+          if (connectivity(j, i))
+            pairs.push_back(std::pair<uint, uint>(j, i));
+      decorated->boundPairs(pairs);
+    }
+
     //! Assign parameters and propagate to the decorated superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
       SpringFunction::Params u = bound_spring->setParams(v);
@@ -0,0 +1,620 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2009 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <boost/thread/thread.hpp>
+
+#include "sparse-hessian.hpp"
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace ENM {
+
+  namespace {
+
+    // Builds the rows [begin, end) of either a Hessian (when blocker
+    // is set) or a Kirchoff matrix.  Each worker only writes to its own
+    // rows, so no locking is needed.
+    struct RowBuilder {
+      RowBuilder(const NeighborGrid& g, const AtomicGroup& n, SuperBlock* b, const vector< vector<uint> >& bp,
+                 const double r, const double norm,
+                 vector< vector<uint> >& c, vector< vector<double> >& v,
+                 const uint b0, const uint b1)
+        : grid(g), nodes(n), blocker(b), bound(bp), radius(r), normalization(norm),
+          cols(c), vals(v), begin(b0), end(b1) { }
+
+      void operator()() {
+        vector<uint> list;
+        double B[9];
+
+        for (uint i=begin; i<end; ++i) {
+          list.clear();
+          grid.neighbors(nodes[i]->coords(), 0.0, radius, list);
+          if (!bound.empty())
+            list.insert(list.end(), bound[i].begin(), bound[i].end());
+          list.push_back(i);
+          sort(list.begin(), list.end());
+          list.erase(unique(list.begin(), list.end()), list.end());
+
+          vector<uint>& row = cols[i];
+          vector<double>& blocks = vals[i];
+          row = list;
+
+          if (blocker == 0) {
+            blocks.assign(row.size(), -normalization);
+            uint k = find(row.begin(), row.end(), i) - row.begin();
+            blocks[k] = normalization * (row.size() - 1);
+            continue;
+          }
+
+          blocks.assign(row.size() * 9, 0.0);
+          double diag[9] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+          uint diag_idx = 0;
+          for (uint k=0; k<row.size(); ++k) {
+            uint j = row[k];
+            if (j == i) {
+              diag_idx = k;
+              continue;
+            }
+            if (j < i)
+              blocker->block(j, i, B);
+            else
+              blocker->block(i, j, B);
+            for (uint l=0; l<9; ++l) {
+              blocks[k*9 + l] = -B[l];
+              diag[l] += B[l];
+            }
+          }
+          for (uint l=0; l<9; ++l)
+            blocks[diag_idx*9 + l] = diag[l];
+        }
+      }
+
+      const NeighborGrid& grid;
+      const AtomicGroup& nodes;
+      SuperBlock* blocker;
+      const vector< vector<uint> >& bound;
+      double radius, normalization;
+      vector< vector<uint> >& cols;
+      vector< vector<double> >& vals;
+      uint begin, end;
+    };
+
+
+
+    struct RowMultiplier {
+      RowMultiplier(const SparseHessian& h, const double* xx, double* yy, const uint b0, const uint b1)
+        : H(h), x(xx), y(yy), begin(b0), end(b1) { }
+
+      void operator()() { H.applyRows(x, y, begin, end); }
+
+      const SparseHessian& H;
+      const double* x;
+      double* y;
+      uint begin, end;
+    };
+
+
+
+    void buildRows(const NeighborGrid& grid, const AtomicGroup& nodes, SuperBlock* blocker, const vector< vector<uint> >& bound,
+                   const double cutoff, const double normalization, const uint n, const uint nthreads,
+                   vector< vector<uint> >& cols, vector< vector<double> >& vals) {
+      cols.resize(n);
+      vals.resize(n);
+
+      uint np = (nthreads == 0) ? 1 : nthreads;
+      if (np > n)
+        np = n;
+      uint chunk = (n + np - 1) / np;
+
+      boost::thread_group threads;
+      for (uint t=0; t<np; ++t) {
+        uint b = t * chunk;
+        uint e = (b + chunk > n) ? n : b + chunk;
+        RowBuilder worker(grid, nodes, blocker, bound, cutoff, normalization, cols, vals, b, e);
+        if (np == 1)
+          worker();
+        else
+          threads.create_thread(worker);
+      }
+      threads.join_all();
+    }
+
+
+
+    double dot(const vector<double>& a, const vector<double>& b) {
+      double s = 0.0;
+      for (uint i=0; i<a.size(); ++i)
+        s += a[i] * b[i];
+      return(s);
+    }
+
+    void axpy(const double alpha, const vector<double>& x, vector<double>& y) {
+      for (uint i=0; i<x.size(); ++i)
+        y[i] += alpha * x[i];
+    }
+
+    // Removes the components of v along the columns of Z
+    void project(const DoubleMatrix& Z, vector<double>& v) {
+      uint n = v.size();
+      for (uint j=0; j<Z.cols(); ++j) {
+        const double* z = Z.get() + j * n;
+        double s = 0.0;
+        for (uint i=0; i<n; ++i)
+          s += z[i] * v[i];
+        for (uint i=0; i<n; ++i)
+          v[i] -= s * z[i];
+      }
+    }
+
+
+    // Eigendecomposition of the symmetric tridiagonal matrix given by
+    // the diagonal a and off-diagonal b (eigenvalues are ascending)
+    void tridiagonalEigen(const vector<double>& a, const vector<double>& b, DoubleMatrix& W, DoubleMatrix& S) {
+      f77int m = a.size();
+      S = DoubleMatrix(m, m);
+      for (f77int i=0; i<m; ++i) {
+        S(i, i) = a[i];
+        if (i+1 < m)
+          S(i, i+1) = S(i+1, i) = b[i];
+      }
+      W = DoubleMatrix(m, 1);
+
+      char jobz = 'V', uplo = 'U';
+      f77int lda = m, lwork = -1, info;
+      double prework;
+      dsyev_(&jobz, &uplo, &m, S.get(), &lda, W.get(), &prework, &lwork, &info);
+      if (info != 0)
+        throw(NumericalError("Unable to size work array for tridiagonal eigensolve", info));
+
+      lwork = static_cast<f77int>(prework);
+      vector<double> work(lwork);
+      dsyev_(&jobz, &uplo, &m, S.get(), &lda, W.get(), &(work[0]), &lwork, &info);
+      if (info != 0)
+        throw(NumericalError("Tridiagonal eigensolve failed", info));
+    }
+
+
+    struct RitzPair {
+      double value;
+      vector<double> vec;
+      bool converged;
+    };
+
+
+    // Removes the components of v along the nullspace and locked vectors
+    void deflate(const DoubleMatrix& Z, const vector< vector<double> >& locked, vector<double>& v) {
+      project(Z, v);
+      for (uint i=0; i<locked.size(); ++i)
+        axpy(-dot(v, locked[i]), locked[i], v);
+    }
+
+
+    // A single fully-reorthogonalized Lanczos sequence from a random
+    // start, orthogonal to Z and the locked vectors.  The lowest \a
+    // wanted Ritz pairs (fewer if an invariant subspace is found
+    // first) are returned in ascending order.  Returns the largest
+    // Ritz value magnitude (at least 1), used to scale tolerances.
+    double lanczosRun(const LinearOperator& A, const DoubleMatrix& Z, const vector< vector<double> >& locked,
+                      const uint wanted, const double tol, const uint limit, const int verbosity,
+                      vector<RitzPair>& pairs) {
+      uint n = A.size();
+      vector< vector<double> > V;
+      vector<double> alpha, beta;
+      DoubleMatrix theta, S;
+      double scale = 1.0;
+      double b = 0.0;
+
+      boost::uniform_real<> rmap(-1.0, 1.0);
+      boost::variate_generator< base_generator_type&, boost::uniform_real<> > rng(rng_singleton(), rmap);
+
+      vector<double> v(n);
+      for (uint i=0; i<n; ++i)
+        v[i] = rng();
+      for (uint pass = 0; pass < 2; ++pass)
+        deflate(Z, locked, v);
+      double s = sqrt(dot(v, v));
+      for (uint i=0; i<n; ++i)
+        v[i] /= s;
+      V.push_back(v);
+
+      vector<double> w(n);
+      uint next_check = 2 * wanted + 20;
+      if (next_check > limit)
+        next_check = limit;
+
+      for (uint j=0; ; ++j) {
+        A.apply(&(V[j][0]), &(w[0]));
+        double a = dot(w, V[j]);
+        axpy(-a, V[j], w);
+        if (j > 0)
+          axpy(-beta[j-1], V[j-1], w);
+
+        // Full reorthogonalization (twice is enough)
+        for (uint pass = 0; pass < 2; ++pass) {
+          deflate(Z, locked, w);
+          for (uint i=0; i<=j; ++i)
+            axpy(-dot(w, V[i]), V[i], w);
+        }
+
+        alpha.push_back(a);
+        b = sqrt(dot(w, w));
+        uint m = j + 1;
+        bool invariant = (b <= 1e-12 * (fabs(a) > 1.0 ? fabs(a) : 1.0));
+
+        if (m >= next_check || m >= limit || invariant) {
+          tridiagonalEigen(alpha, beta, theta, S);
+
+          scale = fabs(theta[0]) > fabs(theta[m-1]) ? fabs(theta[0]) : fabs(theta[m-1]);
+          if (scale < 1.0)
+            scale = 1.0;
+
+          bool converged = (m >= wanted) || invariant;
+          for (uint i=0; i<wanted && i<m; ++i)
+            if (b * fabs(S(m-1, i)) > tol * scale)
+              converged = false;
+
+          if (verbosity > 1)
+            cerr << boost::format("Lanczos: %d vectors, lowest Ritz value %g, %s\n")
+              % m % theta[0] % (converged ? "converged" : (invariant ? "invariant subspace" : "not converged"));
+
+          if (converged || invariant || m >= limit)
+            break;
+
+          next_check = m + (m / 4 > 20 ? m / 4 : 20);
+          if (next_check > limit)
+            next_check = limit;
+        }
+
+        beta.push_back(b);
+        for (uint i=0; i<n; ++i)
+          w[i] /= b;
+        V.push_back(w);
+      }
+
+      uint m = alpha.size();
+      uint r = wanted < m ? wanted : m;
+      pairs.resize(r);
+      for (uint j=0; j<r; ++j) {
+        pairs[j].value = theta[j];
+        pairs[j].converged = (b * fabs(S(m-1, j)) <= tol * scale);
+        pairs[j].vec.assign(n, 0.0);
+        for (uint l=0; l<m; ++l)
+          axpy(S(l, j), V[l], pairs[j].vec);
+      }
+
+      return(scale);
+    }
+
+  }
+
+
+
+  void SparseHessian::applyRows(const double* x, double* y, const uint begin, const uint end) const {
+    uint bs2 = bs_ * bs_;
+
+    for (uint i=begin; i<end; ++i) {
+      double* yi = y + i * bs_;
+      for (uint a=0; a<bs_; ++a)
+        yi[a] = 0.0;
+
+      for (ulong k=row_ptr_[i]; k<row_ptr_[i+1]; ++k) {
+        const double* B = &(vals_[k * bs2]);
+        const double* xj = x + cols_[k] * bs_;
+        for (uint b=0; b<bs_; ++b)
+          for (uint a=0; a<bs_; ++a)
+            yi[a] += B[b*bs_ + a] * xj[b];
+      }
+    }
+  }
+
+
+  void SparseHessian::apply(const double* x, double* y) const {
+    uint np = nthreads_ > nodes_ ? nodes_ : nthreads_;
+    if (np <= 1) {
+      applyRows(x, y, 0, nodes_);
+      return;
+    }
+
+    uint chunk = (nodes_ + np - 1) / np;
+    boost::thread_group threads;
+    for (uint t=0; t<np; ++t) {
+      uint b = t * chunk;
+      uint e = (b + chunk > nodes_) ? nodes_ : b + chunk;
+      threads.create_thread(RowMultiplier(*this, x, y, b, e));
+    }
+    threads.join_all();
+  }
+
+
+  DoubleMatrix SparseHessian::toDense() const {
+    DoubleMatrix H(size(), size());
+
+    for (uint i=0; i<nodes_; ++i)
+      for (ulong k=row_ptr_[i]; k<row_ptr_[i+1]; ++k)
+        for (uint b=0; b<bs_; ++b)
+          for (uint a=0; a<bs_; ++a)
+            H(i*bs_ + a, cols_[k]*bs_ + b) = vals_[k*bs_*bs_ + b*bs_ + a];
+
+    return(H);
+  }
+
+
+
+  uint SparseHessian::components(vector<uint>& labels) const {
+    const uint unset = static_cast<uint>(-1);
+    labels.assign(nodes_, unset);
+
+    uint n = 0;
+    vector<uint> stack;
+    for (uint i=0; i<nodes_; ++i) {
+      if (labels[i] != unset)
+        continue;
+      labels[i] = n;
+      stack.push_back(i);
+      while (!stack.empty()) {
+        uint j = stack.back();
+        stack.pop_back();
+        for (ulong k=row_ptr_[j]; k<row_ptr_[j+1]; ++k)
+          if (labels[cols_[k]] == unset) {
+            labels[cols_[k]] = n;
+            stack.push_back(cols_[k]);
+          }
+      }
+      ++n;
+    }
+
+    return(n);
+  }
+
+
+
+  SparseHessian buildSparseHessian(SuperBlock* blocker, const double cutoff, const uint nthreads) {
+    double radius = cutoff > 0.0 ? cutoff : blocker->cutoff();
+    if (radius <= 0.0)
+      throw(std::runtime_error("The spring function has no cutoff, so one must be given for a sparse hessian"));
+
+    const AtomicGroup& nodes = blocker->nodeList();
+    uint n = nodes.size();
+
+    // Bound pairs are included no matter how far apart they are
+    vector< pair<uint, uint> > pairs;
+    blocker->boundPairs(pairs);
+    vector< vector<uint> > bound;
+    if (!pairs.empty()) {
+      bound.resize(n);
+      for (vector< pair<uint, uint> >::const_iterator i = pairs.begin(); i != pairs.end(); ++i) {
+        bound[i->first].push_back(i->second);
+        bound[i->second].push_back(i->first);
+      }
+    }
+
+    NeighborGrid grid(nodes, radius);
+    vector< vector<uint> > cols;
+    vector< vector<double> > vals;
+    buildRows(grid, nodes, blocker, bound, radius, 0.0, n, nthreads, cols, vals);
+
+    SparseHessian H;
+    H.nodes_ = n;
+    H.bs_ = 3;
+    H.threads(nthreads);
+    H.row_ptr_.resize(n + 1);
+    H.row_ptr_[0] = 0;
+    for (uint i=0; i<n; ++i)
+      H.row_ptr_[i+1] = H.row_ptr_[i] + cols[i].size();
+
+    H.cols_.reserve(H.row_ptr_[n]);
+    H.vals_.reserve(H.row_ptr_[n] * 9);
+    for (uint i=0; i<n; ++i) {
+      H.cols_.insert(H.cols_.end(), cols[i].begin(), cols[i].end());
+      H.vals_.insert(H.vals_.end(), vals[i].begin(), vals[i].end());
+    }
+
+    return(H);
+  }
+
+
+
+  SparseHessian buildSparseKirchoff(const AtomicGroup& nodes, const double cutoff, const double normalization, const uint nthreads) {
+    uint n = nodes.size();
+
+    NeighborGrid grid(nodes, cutoff);
+    vector< vector<uint> > cols;
+    vector< vector<double> > vals;
+    vector< vector<uint> > bound;
+    buildRows(grid, nodes, 0, bound, cutoff, normalization, n, nthreads, cols, vals);
+
+    SparseHessian K;
+    K.nodes_ = n;
+    K.bs_ = 1;
+    K.threads(nthreads);
+    K.row_ptr_.resize(n + 1);
+    K.row_ptr_[0] = 0;
+    for (uint i=0; i<n; ++i)
+      K.row_ptr_[i+1] = K.row_ptr_[i] + cols[i].size();
+
+    for (uint i=0; i<n; ++i) {
+      K.cols_.insert(K.cols_.end(), cols[i].begin(), cols[i].end());
+      K.vals_.insert(K.vals_.end(), vals[i].begin(), vals[i].end());
+    }
+
+    return(K);
+  }
+
+
+
+  DoubleMatrix kirchoffNullspace(const SparseHessian& K) {
+    if (K.blockSize() != 1)
+      throw(std::runtime_error("kirchoffNullspace() requires a Kirchoff matrix"));
+
+    vector<uint> labels;
+    uint m = K.components(labels);
+    vector<uint> sizes(m, 0);
+    for (uint i=0; i<labels.size(); ++i)
+      ++sizes[labels[i]];
+
+    DoubleMatrix Z(labels.size(), m);
+    for (uint i=0; i<labels.size(); ++i)
+      Z(i, labels[i]) = 1.0 / sqrt(static_cast<double>(sizes[labels[i]]));
+
+    return(Z);
+  }
+
+
+
+  DoubleMatrix rigidBodyModes(const AtomicGroup& nodes) {
+    uint n = nodes.size();
+    GCoord c = nodes.centroid();
+
+    vector< vector<double> > modes;
+    for (uint k=0; k<6; ++k) {
+      vector<double> v(3*n, 0.0);
+      for (uint i=0; i<n; ++i) {
+        GCoord r = nodes[i]->coords() - c;
+        switch(k) {
+        case 0: v[3*i] = 1.0; break;
+        case 1: v[3*i+1] = 1.0; break;
+        case 2: v[3*i+2] = 1.0; break;
+        case 3: v[3*i+1] = -r.z(); v[3*i+2] = r.y(); break;
+        case 4: v[3*i] = r.z(); v[3*i+2] = -r.x(); break;
+        case 5: v[3*i] = -r.y(); v[3*i+1] = r.x(); break;
+        }
+      }
+
+      // Gram-Schmidt against the modes we already have
+      for (uint j=0; j<modes.size(); ++j)
+        axpy(-dot(v, modes[j]), modes[j], v);
+      double s = sqrt(dot(v, v));
+      if (s < 1e-8)
+        continue;
+      for (uint i=0; i<v.size(); ++i)
+        v[i] /= s;
+      modes.push_back(v);
+    }
+
+    DoubleMatrix Z(3*n, modes.size());
+    for (uint j=0; j<modes.size(); ++j)
+      for (uint i=0; i<3*n; ++i)
+        Z(i, j) = modes[j][i];
+
+    return(Z);
+  }
+
+
+
+  boost::tuple<DoubleMatrix, DoubleMatrix> lanczosLowestModes(const LinearOperator& A, const uint k,
+                                                              const DoubleMatrix& nullspace,
+                                                              const double tol,
+                                                              const uint maxiter,
+                                                              const int verbosity) {
+    uint n = A.size();
+    uint d = nullspace.cols();
+    if (d > 0 && nullspace.rows() != n)
+      throw(std::runtime_error("Nullspace has the wrong number of rows for the operator"));
+    if (k > n || k < d)
+      throw(std::runtime_error("Invalid number of modes requested from the Lanczos solver"));
+
+    uint wanted = k - d;
+
+    // The lowest modes found so far (ascending).  Each restart is
+    // deflated against these, so a restart finds any copies of a
+    // degenerate eigenvalue that earlier Krylov sequences could not
+    // hold.  Once a restart adds nothing below the highest kept mode,
+    // the kept modes are the lowest ones.
+    vector<RitzPair> kept;
+    bool converged = true;
+
+    while (wanted > 0) {
+      uint limit = n - d - kept.size();
+      if (limit == 0)
+        break;
+      if (maxiter > 0 && maxiter < limit)
+        limit = maxiter;
+
+      vector< vector<double> > locked;
+      for (uint i=0; i<kept.size(); ++i)
+        locked.push_back(kept[i].vec);
+
+      vector<RitzPair> found;
+      double scale = lanczosRun(A, nullspace, locked, wanted, tol, limit, verbosity, found);
+
+      bool added = false;
+      for (uint i=0; i<found.size(); ++i) {
+        if (!found[i].converged)
+          continue;
+        if (kept.size() == wanted && found[i].value >= kept.back().value - tol * scale)
+          break;
+        if (kept.size() == wanted)
+          kept.pop_back();
+        vector<RitzPair>::iterator j = kept.begin();
+        while (j != kept.end() && j->value <= found[i].value)
+          ++j;
+        kept.insert(j, found[i]);
+        added = true;
+      }
+
+      // Out of iterations, so fill in with the best we have...
+      if (!added && kept.size() < wanted) {
+        for (uint i=0; i<found.size() && kept.size() < wanted; ++i)
+          if (!found[i].converged)
+            kept.push_back(found[i]);
+        converged = false;
+        break;
+      }
+
+      if (!added)
+        break;
+      if (verbosity > 1)
+        cerr << "Lanczos: restarting, deflated against " << kept.size() << " modes\n";
+    }
+
+    if (kept.size() < wanted)
+      throw(NumericalError("Lanczos could not find the requested number of modes"));
+    if (!converged)
+      cerr << "Warning- Lanczos did not converge for all requested modes\n";
+
+
+    // Assemble the result, nullspace first...
+    DoubleMatrix eigvals(k, 1);
+    DoubleMatrix eigvecs(n, k);
+    vector<double> z(n), Az(n);
+
+    for (uint j=0; j<d; ++j) {
+      for (uint i=0; i<n; ++i)
+        z[i] = eigvecs(i, j) = nullspace(i, j);
+      A.apply(&(z[0]), &(Az[0]));
+      eigvals[j] = dot(z, Az);
+    }
+
+    for (uint j=0; j<wanted; ++j) {
+      eigvals[d + j] = kept[j].value;
+      for (uint i=0; i<n; ++i)
+        eigvecs(i, d + j) = kept[j].vec[i];
+    }
+
+    return(boost::tuple<DoubleMatrix, DoubleMatrix>(eigvals, eigvecs));
+  }
+
+};
@@ -0,0 +1,185 @@
+/*
+  Sparse hessian construction and iterative eigensolver for large
+  elastic network models
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2009 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** \addtogroup ENM
+ *@{
+ */
+
+
+#if !defined(LOOS_SPARSE_HESSIAN_HPP)
+#define LOOS_SPARSE_HESSIAN_HPP
+
+
+#include <loos.hpp>
+
+#include "hessian.hpp"
+
+namespace ENM {
+
+  //! Interface for a symmetric matrix that is only accessed through products
+  class LinearOperator {
+  public:
+    virtual ~LinearOperator() { }
+
+    //! Number of rows (and columns)
+    virtual uint size() const =0;
+
+    //! Computes y = A x, where x and y have size() elements
+    virtual void apply(const double* x, double* y) const =0;
+  };
+
+
+
+  //! Symmetric matrix stored as rows of dense blocks (block-CSR)
+  /**
+   * Large elastic networks with a finite cutoff have only a handful of
+   * neighbors per node, so the 3N x 3N Hessian (or N x N Kirchoff
+   * matrix) is overwhelmingly zero.  SparseHessian stores only the
+   * non-zero blocks for each node, including the diagonal block.  The
+   * blocks are stored column-major, like a DoubleMatrix.
+   *
+   * Products with a vector (apply()) are split across rows and may
+   * use multiple threads.
+   */
+  class SparseHessian : public LinearOperator {
+  public:
+    SparseHessian() : nodes_(0), bs_(3), nthreads_(1), row_ptr_(1, 0) { }
+
+    //! Number of rows in the full (expanded) matrix
+    uint size() const { return(nodes_ * bs_); }
+
+    //! Number of nodes (block rows)
+    uint nodes() const { return(nodes_); }
+
+    //! Size of each block (3 for a Hessian, 1 for a Kirchoff matrix)
+    uint blockSize() const { return(bs_); }
+
+    //! Number of stored blocks (including the diagonal)
+    ulong storedBlocks() const { return(cols_.size()); }
+
+    //! Number of threads used for apply()
+    void threads(const uint n) { nthreads_ = (n == 0) ? 1 : n; }
+    uint threads() const { return(nthreads_); }
+
+    void apply(const double* x, double* y) const;
+
+    //! Computes y = A x for block rows [begin, end) only
+    void applyRows(const double* x, double* y, const uint begin, const uint end) const;
+
+    //! Expand into a regular dense matrix (for debugging and small systems)
+    loos::DoubleMatrix toDense() const;
+
+    //! Label each node with its connected component, returning the number of components
+    /**
+     * Two nodes are connected when the block between them is stored.
+     */
+    uint components(std::vector<uint>& labels) const;
+
+    friend SparseHessian buildSparseHessian(SuperBlock*, const double, const uint);
+    friend SparseHessian buildSparseKirchoff(const loos::AtomicGroup&, const double, const double, const uint);
+
+  private:
+    uint nodes_;
+    uint bs_;
+    uint nthreads_;
+
+    std::vector<ulong> row_ptr_;
+    std::vector<uint> cols_;
+    std::vector<double> vals_;
+  };
+
+
+
+  //! Build a sparse Hessian using the contained SuperBlock
+  /**
+   * Nodes are binned into a cell list so only pairs within \a cutoff
+   * are visited.  If \a cutoff is 0, the cutoff from the SuperBlock's
+   * spring function is used (and it is an error if there is none).
+   * Spring functions that do not go to zero (e.g. HCA, exponential)
+   * are truncated at \a cutoff.  Pairs that a decorated SuperBlock
+   * binds together are always included.  Rows are divided among \a
+   * nthreads threads.
+   */
+  SparseHessian buildSparseHessian(SuperBlock* blocker, const double cutoff, const uint nthreads = 1);
+
+  //! Build a sparse GNM Kirchoff matrix for \a nodes using a contact \a cutoff
+  SparseHessian buildSparseKirchoff(const loos::AtomicGroup& nodes, const double cutoff, const double normalization = 1.0, const uint nthreads = 1);
+
+
+  //! Zero modes of a Kirchoff matrix
+  /**
+   * There is one zero mode for each connected component of the
+   * network (the normalized indicator vector of its nodes), so a
+   * network that the cutoff splits apart has more than just the
+   * uniform zero mode.  Returns an N x (number of components) matrix.
+   */
+  loos::DoubleMatrix kirchoffNullspace(const SparseHessian& K);
+
+
+  //! Orthonormal rigid-body motions (3 translations, 3 rotations) of a set of nodes
+  /**
+   * These are the trivial zero modes of an ANM Hessian (or of a VSA
+   * effective Hessian for the subsystem nodes).  Returns a 3N x 6
+   * matrix (fewer columns if the nodes are collinear).
+   */
+  loos::DoubleMatrix rigidBodyModes(const loos::AtomicGroup& nodes);
+
+
+  //! Find the lowest \a k eigenpairs of a symmetric operator using Lanczos iteration
+  /**
+   * Known zero modes (e.g. rigid-body motions) are passed as the
+   * orthonormal columns of \a nullspace (which may be empty).  These
+   * are projected out of the iteration and returned as the first
+   * modes, so the remaining k - nullspace.cols() modes come from the
+   * Krylov subspace.  The subspace is fully reorthogonalized and grown
+   * until the residuals of the wanted Ritz pairs fall below \a tol
+   * (relative to the largest Ritz value), or \a maxiter vectors have
+   * been built (0 means no limit other than the size of the operator).
+   *
+   * A single Krylov sequence holds at most one vector from each
+   * eigenspace, so the iteration is restarted, deflated against the
+   * modes found so far, until a restart finds nothing lower.  This
+   * picks up every copy of a degenerate eigenvalue.
+   *
+   * Returns a tuple of the eigenvalues (k x 1, ascending) and the
+   * corresponding eigenvectors (n x k).
+   */
+  boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> lanczosLowestModes(const LinearOperator& A, const uint k,
+                                                                          const loos::DoubleMatrix& nullspace,
+                                                                          const double tol = 1e-8,
+                                                                          const uint maxiter = 0,
+                                                                          const int verbosity = 0);
+
+};
+
+
+#endif
+
+
+/** @} */
@@ -96,6 +96,21 @@ namespace ENM {
     //! Actually compute the spring constant as a 3x3 matrix
     virtual loos::DoubleMatrix constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d)  =0;
 
+    //! Compute the spring constant into a 9-element (column-major) array
+    /**
+     * This avoids allocating a DoubleMatrix for every pair of nodes
+     * when building large Hessians.  The default simply copies the
+     * result of constant().
+     */
+    virtual void constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d, double* K) {
+      loos::DoubleMatrix B = constant(u, v, d);
+      for (uint i=0; i<9; ++i)
+        K[i] = B[i];
+    }
+
+    //! Distance beyond which the spring constant is always zero (0 means there is no cutoff)
+    virtual double cutoff() const { return(0.0); }
+
   protected:
 
     //! Check for negative spring-constants
@@ -143,6 +158,12 @@ namespace ENM {
       return(B);
     }
 
+    void constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d, double* K) {
+      double k = checkConstant(constantImpl(u, v, d));
+      for (uint i=0; i<9; ++i)
+        K[i] = k;
+    }
+
   private:
 
     //! Implementation of the spring constant calculation
@@ -184,6 +205,8 @@ namespace ENM {
 
     uint paramSize() const { return(1); }
 
+    double cutoff() const { return(sqrt(radius)); }
+
     double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
       double s = d.length2();
       if (s <= radius)
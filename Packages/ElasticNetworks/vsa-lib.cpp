@@ -30,6 +30,97 @@ using namespace loos;
 
 namespace ENM {
 
+  namespace {
+
+    // Product with the effective hessian, Hss - Hse * Hee^-1 * Hes,
+    // using the full sparse hessian.  The environment system is solved
+    // with conjugate gradients, warm-started from the previous solution.
+    class EffectiveHessian : public LinearOperator {
+    public:
+      EffectiveHessian(const SparseHessian& H, const uint l, const double tol)
+        : H_(H), l_(l), n_(H.size()), tol_(tol), z_(n_), y_(n_), w_(n_, 0.0),
+          r_(n_), p_(n_), q_(n_)
+      { }
+
+      uint size() const { return(l_); }
+
+      void apply(const double* x, double* y) const {
+        // [Hss x; Hes x]
+        for (uint i=0; i<l_; ++i)
+          z_[i] = x[i];
+        for (uint i=l_; i<n_; ++i)
+          z_[i] = 0.0;
+        H_.apply(&(z_[0]), &(y_[0]));
+
+        solveEnvironment();
+
+        // Hse w
+        for (uint i=0; i<l_; ++i)
+          z_[i] = 0.0;
+        for (uint i=l_; i<n_; ++i)
+          z_[i] = w_[i];
+        H_.apply(&(z_[0]), &(q_[0]));
+
+        for (uint i=0; i<l_; ++i)
+          y[i] = y_[i] - q_[i];
+      }
+
+    private:
+
+      // Hee * v for the environment part of v (the subsystem part of v is zero)
+      void applyEnvironment(const std::vector<double>& v, std::vector<double>& out) const {
+        H_.apply(&(v[0]), &(out[0]));
+        for (uint i=0; i<l_; ++i)
+          out[i] = 0.0;
+      }
+
+      double dotEnvironment(const std::vector<double>& a, const std::vector<double>& b) const {
+        double s = 0.0;
+        for (uint i=l_; i<n_; ++i)
+          s += a[i] * b[i];
+        return(s);
+      }
+
+      // Solves Hee w = Hes x, where Hes x is in the environment part of y_
+      void solveEnvironment() const {
+        double bnorm = sqrt(dotEnvironment(y_, y_));
+        if (bnorm == 0.0) {
+          std::fill(w_.begin(), w_.end(), 0.0);
+          return;
+        }
+
+        applyEnvironment(w_, q_);
+        for (uint i=l_; i<n_; ++i)
+          r_[i] = p_[i] = y_[i] - q_[i];
+        for (uint i=0; i<l_; ++i)
+          r_[i] = p_[i] = 0.0;
+
+        double rr = dotEnvironment(r_, r_);
+        uint maxiter = 10 * (n_ - l_);
+        for (uint iter = 0; iter < maxiter && sqrt(rr) > tol_ * bnorm; ++iter) {
+          applyEnvironment(p_, q_);
+          double alpha = rr / dotEnvironment(p_, q_);
+          for (uint i=l_; i<n_; ++i) {
+            w_[i] += alpha * p_[i];
+            r_[i] -= alpha * q_[i];
+          }
+          double rr_new = dotEnvironment(r_, r_);
+          double beta = rr_new / rr;
+          rr = rr_new;
+          for (uint i=l_; i<n_; ++i)
+            p_[i] = r_[i] + beta * p_[i];
+        }
+      }
+
+      const SparseHessian& H_;
+      uint l_, n_;
+      double tol_;
+      mutable std::vector<double> z_, y_, w_, r_, p_, q_;
+    };
+
+  }
+
+
   boost::tuple<DoubleMatrix, DoubleMatrix> VSA::eigenDecomp(DoubleMatrix& A, DoubleMatrix& B) {
 
     DoubleMatrix AA = A.copy();
@@ -141,8 +232,45 @@ namespace ENM {
 
 
 
+  void VSA::solveSparse() {
+    if (masses_.rows() != 0)
+      throw(std::logic_error("Sparse VSA only supports the mass-less model"));
+
+    if (verbosity_ > 1)
+      std::cerr << "Building sparse hessian...\n";
+    buildSparseHessian();
+
+    uint l = subset_size_ * 3;
+    EffectiveHessian Hssp(sparse_hessian_, l, 1e-10);
+
+    AtomicGroup nodes = blocker_->nodeList();
+    DoubleMatrix Z = rigidBodyModes(nodes.subset(0, subset_size_));
+    uint k = sparseModeCount(l);
+    if (k < Z.cols())
+      k = Z.cols();
+
+    Timer<> t;
+    if (verbosity_ > 0)
+      std::cerr << "Computing lowest modes of effective hessian with Lanczos...\n";
+    t.start();
+    boost::tuple<DoubleMatrix, DoubleMatrix> result = lanczosLowestModes(Hssp, k, Z, 1e-8, 0, verbosity_);
+    t.stop();
+    if (verbosity_ > 0)
+      std::cerr << "Lanczos took " << loos::timeAsString(t.elapsed()) << std::endl;
+
+    eigenvals_ = boost::get<0>(result);
+    eigenvecs_ = boost::get<1>(result);
+  }
+
+
+
   void VSA::solve() {
 
+    if (sparse_) {
+      solveSparse();
+      return;
+    }
+
     if (verbosity_ > 1)
       std::cerr << "Building hessian...\n";
     buildHessian();
@@ -55,6 +55,11 @@ namespace ENM {
    * passed SuperBlock instance represents the combined system,
    * i.e. subsystem and environment.  The first \a subn nodes are the
    * subsystem.
+   *
+   * In sparse mode, the effective hessian is never formed.  Instead,
+   * its product with a vector is computed from the sparse hessian,
+   * solving the environment block iteratively, and only the lowest
+   * modes are found.  Only the mass-less VSA is supported this way.
    */
   class VSA : public ElasticNetworkModel {
   public:
@@ -111,6 +116,7 @@ namespace ENM {
 
 
   private:
+    void solveSparse();
     boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> eigenDecomp(loos::DoubleMatrix& A, loos::DoubleMatrix& B);
     loos::DoubleMatrix massWeight(loos::DoubleMatrix& U, loos::DoubleMatrix& M);
 
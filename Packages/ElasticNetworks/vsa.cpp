@@ -67,6 +67,11 @@ string psf_file;
 string spring_desc;
 bool nomass;
 
+bool sparse;
+double cutoff;
+uint nmodes;
+uint nthreads;
+
 
 string fullHelpMessage() {
 
@@ -135,6 +140,15 @@ string fullHelpMessage() {
     "To disable masses (i.e. use unit masses for the subsystem and\n"
     "zero masses for the environment), use the \"--nomass 1\" option.\n"
     "\n\n"
+    "* Large Systems *\n\n"
+    "The --sparse option avoids building and inverting the dense\n"
+    "hessians.  A sparse hessian with contacts inside --cutoff is built\n"
+    "(using --threads threads), and the effective subsystem hessian is\n"
+    "applied implicitly by iteratively solving the environment block.\n"
+    "Only the lowest --modes eigenpairs (including the 6 rigid-body\n"
+    "modes) are computed using Lanczos iteration.  This is only\n"
+    "supported for the mass-less VSA (--nomass 1).\n"
+    "\n\n"
     "EXAMPLES \n\n"
     "\n"
     "vsa --occupancies 1 foo.pdb 'segid == \"TRAN\" && name == \"CA\"'\\\n"
@@ -172,17 +186,25 @@ public:
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("occupancies", po::value<bool>(&occupancies_are_masses)->default_value(false), "Atom masses are stored in the PDB occupancy field")
       ("nomass", po::value<bool>(&nomass)->default_value(false), "Disable mass as part of the VSA solution")
-      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments");
+      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments")
+      ("sparse", po::value<bool>(&sparse)->default_value(false), "Use a sparse hessian and only compute the lowest modes")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for the sparse hessian (0 = use spring cutoff)")
+      ("modes", po::value<uint>(&nmodes)->default_value(56), "Number of modes to compute with --sparse (including zero modes)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use with --sparse");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s'")
+    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s', sparse=%d, cutoff=%f, modes=%d, threads=%d")
       % psf_file
       % debug
       % occupancies_are_masses
       % nomass
-      % spring_desc;
+      % spring_desc
+      % sparse
+      % cutoff
+      % nmodes
+      % nthreads;
     return(oss.str());
   }
 
@@ -210,6 +232,11 @@ int main(int argc, char *argv[]) {
   if (!options.parse(argc, argv))
     exit(-1);
 
+  if (sparse && !nomass) {
+    cerr << "Error- sparse VSA requires --nomass 1\n";
+    exit(-1);
+  }
+
   // Extract values
   AtomicGroup model = mopts->model;
   verbosity = bopts->verbosity;
@@ -252,6 +279,10 @@ int main(int argc, char *argv[]) {
   vsa.meta(hdr);
   vsa.debugging(debug);
   vsa.verbosity(verbosity);
+  vsa.sparse(sparse);
+  vsa.cutoff(cutoff);
+  vsa.modes(nmodes);
+  vsa.threads(nthreads);
 
   if (!nomass) {
     DoubleMatrix M = getMasses(composite);
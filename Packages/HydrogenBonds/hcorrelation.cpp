@@ -290,43 +290,21 @@ int main(int argc, char *argv[]) {
         traj->readFrame(skip-1);
 
       BondMatrix bonds = j->findHydrogenBondsMatrix(acceptors, traj, model);
-      if (any_hydrogen) {
-        TimeSeries<double> ts;
-        for (uint j=0; j<bonds.rows(); ++j) {
-          double val = 0.0;
-          for (uint i=0; i<bonds.cols(); ++i)
-            if (bonds(j, i) != 0) {
-              val = 1.0;
-              break;
-            }
-          ts.push_back(val);
-        }
-        TimeSeries<double> tcorr = ts.correl(maxtime);
-        vecDouble vtmp;
-        copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-        correlations.push_back(vtmp);
-            
-      } else {
-        for (uint i=0; i<bonds.cols(); ++i) {
-          bool found = false;
-          for (uint j=0; j<bonds.rows(); ++j)
-            if (bonds(j, i) != 0) { 
-              found = true;
-              break;
-            }
-          
-          if (found) {
-            TimeSeries<double> ts;
-            for (uint j=0; j<bonds.rows(); ++j)
-              ts.push_back(bonds(j, i));
-            TimeSeries<double> tcorr = ts.correl(maxtime);
-            vecDouble vtmp;
-            copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-            correlations.push_back(vtmp);
-          }
-          
-        }
-        
+
+      // Pack each acceptor's bond time-series (or whether any acceptor
+      // is bound) into one bit per frame
+      uint nseries = any_hydrogen ? 1 : bonds.cols();
+      OccupancyMatrix occupancy(nseries, bonds.rows());
+      for (uint t=0; t<bonds.rows(); ++t)
+        for (uint i=0; i<bonds.cols(); ++i)
+          if (bonds(t, i) != 0)
+            occupancy.set(any_hydrogen ? 0 : i, t);
+
+      for (uint i=0; i<nseries; ++i) {
+        // Acceptors that never bind are skipped (but ANY always counts)
+        if (!any_hydrogen && occupancy.empty(i))
+          continue;
+        correlations.push_back(occupancyCorrelation(occupancy, i, maxtime));
       }
 
     }
@@ -0,0 +1,208 @@
+/*
+  multi_calc.cpp
+
+
+  C++ template for writing a tool that runs several calculations
+  over a trajectory in a single pass, using the AnalysisRunner
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+#include <fstream>
+
+using namespace std;
+using namespace loos;
+
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+
+// ----------------------------------------------------------------
+// ***EDIT***
+// Each analysis is an AnalysisModule.  Since all modules share one
+// command-line, option names are prefixed with the module name.
+// Modules may be run concurrently on the same frame, so they must
+// not modify the atoms they were given (copy them first if needed).
+
+
+// @cond TOOLS_INTERNAL
+
+// Radius of gyration of a selection
+class RgyrModule : public AnalysisModule {
+
+  struct Options : public opts::OptionsPackage {
+    Options() : selection("name == 'CA'"), output("rgyr.asc") { }
+
+    void addGeneric(po::options_description& o) {
+      o.add_options()
+        ("rgyr-selection", po::value<string>(&selection)->default_value(selection), "Atoms for radius of gyration")
+        ("rgyr-output", po::value<string>(&output)->default_value(output), "Output file for radius of gyration");
+    }
+
+    string print() const {
+      ostringstream oss;
+      oss << boost::format("rgyr-selection='%s', rgyr-output='%s'") % selection % output;
+      return(oss.str());
+    }
+
+    string selection, output;
+  };
+
+public:
+  string name() const { return("rgyr"); }
+  opts::OptionsPackage* options() { return(&_opts); }
+
+  void setup(AtomicGroup& model) {
+    _subset = selectAtoms(model, _opts.selection);
+    _ofs.open(_opts.output.c_str());
+    if (!_ofs)
+      throw(FileOpenError(_opts.output));
+    _ofs << "# frame rgyr\n";
+  }
+
+  AtomicGroup atoms() const { return(_subset); }
+
+  void frame(const uint index) {
+    _ofs << index << '\t' << _subset.radiusOfGyration() << endl;
+  }
+
+private:
+  Options _opts;
+  AtomicGroup _subset;
+  ofstream _ofs;
+};
+
+
+// RMSD to the first frame processed, after optimal superposition
+class RmsdModule : public AnalysisModule {
+
+  struct Options : public opts::OptionsPackage {
+    Options() : selection("name == 'CA'"), output("rmsd.asc") { }
+
+    void addGeneric(po::options_description& o) {
+      o.add_options()
+        ("rmsd-selection", po::value<string>(&selection)->default_value(selection), "Atoms for RMSD")
+        ("rmsd-output", po::value<string>(&output)->default_value(output), "Output file for RMSD");
+    }
+
+    string print() const {
+      ostringstream oss;
+      oss << boost::format("rmsd-selection='%s', rmsd-output='%s'") % selection % output;
+      return(oss.str());
+    }
+
+    string selection, output;
+  };
+
+public:
+  RmsdModule() : _first(true) { }
+
+  string name() const { return("rmsd"); }
+  opts::OptionsPackage* options() { return(&_opts); }
+
+  void setup(AtomicGroup& model) {
+    _subset = selectAtoms(model, _opts.selection);
+    _ofs.open(_opts.output.c_str());
+    if (!_ofs)
+      throw(FileOpenError(_opts.output));
+    _ofs << "# frame rmsd\n";
+  }
+
+  AtomicGroup atoms() const { return(_subset); }
+
+  void frame(const uint index) {
+    // Aligning would change the shared coordinates, so work on a copy
+    AtomicGroup current = _subset.copy();
+    if (_first) {
+      _reference = current;
+      _first = false;
+    }
+    current.alignOnto(_reference);
+    _ofs << index << '\t' << current.rmsd(_reference) << endl;
+  }
+
+private:
+  Options _opts;
+  AtomicGroup _subset, _reference;
+  bool _first;
+  ofstream _ofs;
+};
+
+
+
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : threads(0) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("threads", po::value<uint>(&threads)->default_value(threads), "Number of threads to use (0 = one per analysis)");
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("threads=%d") % threads;
+    return(oss.str());
+  }
+
+  uint threads;
+};
+// @endcond
+// ----------------------------------------------------------------
+
+
+
+int main(int argc, char *argv[]) {
+
+  string header = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions;
+  opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
+  ToolOptions* topts = new ToolOptions;
+
+  // ***EDIT***
+  // Register the analyses to run.  The runner owns the modules.
+  AnalysisRunner runner;
+  runner.add(new RgyrModule).add(new RmsdModule);
+
+  // The options for each module are added after the general ones
+  opts::AggregateOptions options;
+  options.add(bopts).add(tropts).add(topts);
+  runner.addOptions(options);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  AtomicGroup model = tropts->model;
+  pTraj traj = tropts->trajectory;
+
+  runner.threads(topts->threads);
+  runner.verbosity(bopts->verbosity);
+
+  // Every frame is read once and handed to all of the modules
+  runner.run(model, traj, tropts->frameList());
+}
@@ -0,0 +1,236 @@
+/*
+  voronoi_apl.cpp
+
+  Area per lipid (or per molecule) from a periodic 2D Voronoi
+  decomposition of a membrane slice
+*/
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include <boost/format.hpp>
+
+using namespace std;
+using namespace loos;
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+// @cond TOOLS_INTERNAL
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : zmin(0.0), zmax(100.0), by_segid(false), reimage(true), threads(1) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("group", po::value< vector<string> >(&groups), "Report areas for molecules in this selection (may be repeated)")
+      ("zmin", po::value<double>(&zmin)->default_value(zmin), "Minimum z of the slice")
+      ("zmax", po::value<double>(&zmax)->default_value(zmax), "Maximum z of the slice")
+      ("segid", po::value<bool>(&by_segid)->default_value(by_segid), "Split groups into molecules by segid rather than connectivity")
+      ("reimage", po::value<bool>(&reimage)->default_value(reimage), "Reimage atoms into the box before slicing")
+      ("threads", po::value<uint>(&threads)->default_value(threads), "Number of threads to use (0=all available)");
+  }
+
+  bool postConditions(po::variables_map& vm) {
+    if (zmin >= zmax) {
+      cerr << "Error- zmin must be less than zmax\n";
+      return(false);
+    }
+    return(true);
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("group='%s', zmin=%f, zmax=%f, segid=%d, reimage=%d, threads=%d")
+      % vectorAsStringWithCommas(groups)
+      % zmin
+      % zmax
+      % by_segid
+      % reimage
+      % threads;
+    return(oss.str());
+  }
+
+  vector<string> groups;
+  double zmin, zmax;
+  bool by_segid, reimage;
+  uint threads;
+};
+
+
+// @endcond
+
+
+string fullHelpMessage(void)
+{
+string s =
+    "\n"
+    "SYNOPSIS\n"
+    "\n"
+    "Compute the area per molecule in a membrane using a Voronoi decomposition\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "Atoms in the selection with z-coordinates between --zmin and --zmax are\n"
+    "projected onto the x-y plane and the plane is divided into periodic Voronoi\n"
+    "cells, one for each atom.  The area of a molecule is the sum of the areas of\n"
+    "its atoms' cells.  Each --group selection (taken from the atoms in the main\n"
+    "selection) is split into molecules, and for every frame the average area per\n"
+    "molecule of each group is written, along with the number of molecules found\n"
+    "in the slice.  Molecules with no atoms in the slice are skipped.  If no groups\n"
+    "are given, the main selection is used.\n"
+    "\n"
+    "This is the same decomposition as area_per_molecule.py in the Voronoi\n"
+    "package, but periodicity is handled directly so there is no padding to\n"
+    "choose, and the cells are computed in parallel with --threads.\n"
+    "\n"
+    "The slice is in absolute coordinates, so the membrane should be centered\n"
+    "at the origin (for example, with the recenter-trj or merge-traj tools).\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tvoronoi_apl --selection '!hydrogen && segid =~ \"^L\"' \\\n"
+    "\t  --group 'resname == \"POPC\"' --group 'resname == \"CHOL\"' \\\n"
+    "\t  --zmin 0 --zmax 30 model.psf traj.dcd\n"
+    "Computes the area per POPC and per cholesterol in the upper leaflet,\n"
+    "using all heavy atoms of the lipids for the decomposition.\n"
+    "\n"
+    "SEE ALSO\n"
+    "\tarea_per_lipid, area_per_molecule.py\n";
+
+return (s);
+}
+
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
+  opts::BasicSelection* sopts = new opts::BasicSelection("!hydrogen");
+  opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
+  ToolOptions* topts = new ToolOptions;
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(sopts).add(tropts).add(topts);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  AtomicGroup model = tropts->model;
+  pTraj traj = tropts->trajectory;
+  if (!traj->hasPeriodicBox()) {
+    cerr << "Error- trajectory has no periodicity.  Cannot compute Voronoi areas.\n";
+    exit(-2);
+  }
+
+  AtomicGroup sites = selectAtoms(model, sopts->selection);
+
+  vector<string> names = topts->groups;
+  if (names.empty())
+    names.push_back(sopts->selection);
+
+  map<const Atom*, uint> site_index;
+  for (uint i=0; i<sites.size(); ++i)
+    site_index[sites[i].get()] = i;
+
+  // Molecules for each group, as indices into the sites
+  vector< vector< vector<uint> > > molecules(names.size());
+  for (uint g=0; g<names.size(); ++g) {
+    AtomicGroup group = selectAtoms(sites, names[g]);
+    if (!topts->by_segid && !group.hasBonds()) {
+      cerr << "Error- the model has no connectivity.  Use --segid to split by segid instead.\n";
+      exit(-2);
+    }
+    vector<AtomicGroup> mols = topts->by_segid ? group.splitByUniqueSegid() : group.splitByMolecule();
+    for (vector<AtomicGroup>::iterator m = mols.begin(); m != mols.end(); ++m) {
+      vector<uint> idx;
+      for (AtomicGroup::iterator a = m->begin(); a != m->end(); ++a)
+        idx.push_back(site_index[a->get()]);
+      molecules[g].push_back(idx);
+    }
+  }
+
+  cout << "# " << hdr << endl;
+  cout << "# frame";
+  for (uint g=0; g<names.size(); ++g)
+    cout << boost::format("\tarea_%d\tn_%d") % g % g;
+  cout << endl;
+  for (uint g=0; g<names.size(); ++g)
+    cout << boost::format("# %d = '%s' (%d molecules)\n") % g % names[g] % molecules[g].size();
+
+  Voronoi2D voronoi;
+  voronoi.threads(topts->threads);
+  vector<int> slot(sites.size());
+  vector<double> sums(names.size(), 0.0);
+  vector<ulong> counts(names.size(), 0);
+
+  vector<uint> frames = tropts->frameList();
+  for (vector<uint>::const_iterator f = frames.begin(); f != frames.end(); ++f) {
+    traj->readFrame(*f);
+    traj->updateGroupCoords(model);
+    if (topts->reimage)
+      model.reimageByAtom();
+
+    AtomicGroup slice;
+    slice.periodicBox(model.periodicBox());
+    for (uint i=0; i<sites.size(); ++i) {
+      double z = sites[i]->coords().z();
+      if (z > topts->zmin && z < topts->zmax) {
+        slot[i] = slice.size();
+        slice.append(sites[i]);
+      } else
+        slot[i] = -1;
+    }
+
+    voronoi.compute(slice);
+
+    cout << *f;
+    for (uint g=0; g<names.size(); ++g) {
+      double total = 0.0;
+      uint n = 0;
+      for (uint m=0; m<molecules[g].size(); ++m) {
+        double area = 0.0;
+        bool found = false;
+        for (vector<uint>::const_iterator i = molecules[g][m].begin(); i != molecules[g][m].end(); ++i)
+          if (slot[*i] >= 0) {
+            area += voronoi.area(slot[*i]);
+            found = true;
+          }
+        if (found) {
+          total += area;
+          ++n;
+        }
+      }
+
+      double avg = n ? total / n : 0.0;
+      sums[g] += total;
+      counts[g] += n;
+      cout << '\t' << avg << '\t' << n;
+    }
+    cout << endl;
+  }
+
+  for (uint g=0; g<names.size(); ++g)
+    cout << boost::format("# average area %d = %f\n") % g % (counts[g] ? sums[g] / counts[g] : 0.0);
+}
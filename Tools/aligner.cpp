@@ -139,6 +139,7 @@ public:
                   reference_sel(""),
                   alignment_tol(1e-6),
                   maxiter(5000),
+                  nthreads(1),
                   xy_only(false),
                   no_ztrans(false)
                   { }
@@ -149,6 +150,7 @@ public:
             ("transform", po::value<string>(&transform_string)->default_value(transform_string), "Transform using this selection")
             ("maxiter", po::value<uint>(&maxiter)->default_value(maxiter), "Maximum number of iterations for alignment algorith")
             ("tolerance", po::value<double>(&alignment_tol)->default_value(alignment_tol), "Tolerance for alignment convergence")
+            ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use for iterative alignment (0=all available)")
             ("reference", po::value<string>(&reference_name), "Align to a reference structure (non-iterative")
             ("refsel", po::value<string>(&reference_sel), "Selection to align against in reference (default is same as --align)")
             ("xyonly", po::value<bool>(&xy_only)->default_value(xy_only), "Only align in x and y (i.e. rotations about Z, but translated in x,y,z)")
@@ -157,10 +159,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("align='%s',transform='%s',maxiter=%d,tolerance=%f,reference='%s',refsel='%s'")
+    oss << boost::format("align='%s',transform='%s',maxiter=%d,tolerance=%f,reference='%s',refsel='%s',threads=%d")
       % alignment_string % transform_string
       % maxiter % alignment_tol
-      % reference_name % reference_sel;
+      % reference_name % reference_sel
+      % nthreads;
     return(oss.str());
   }
 
@@ -168,6 +171,7 @@ public:
     string reference_name, reference_sel;
     double alignment_tol;
     uint maxiter;
+    uint nthreads;
     bool xy_only, no_ztrans;
 };
 
@@ -258,7 +262,7 @@ int main(int argc, char *argv[]) {
     if (topts->xy_only)
       zapZ(coords);
 
-    boost::tuple<vector<XForm>,greal, int> res = iterativeAlignment(coords, topts->alignment_tol, topts->maxiter);
+    boost::tuple<vector<XForm>,greal, int> res = iterativeAlignment(coords, topts->alignment_tol, topts->maxiter, topts->nthreads);
     greal final_rmsd = boost::get<1>(res);
     cerr << "Final RMSD between average structures is " << final_rmsd << endl;
     cerr << "Total iters = " << boost::get<2>(res) << endl;
@@ -30,6 +30,7 @@
 
 #include <loos.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
 #include <limits>
 
 using namespace std;
@@ -103,12 +104,14 @@ string fullHelpMessage() {
     "\tTo get a correct fractional contact value, you will need to ensure that\n"
     "anything that can make a contact is included in the target list.  Alternatively,\n"
     "use the fcontacts tool.\n"
-    "\tBy default, contact-time uses a distance filter to eliminate\n"
-    "target atoms that are too far to be considered when looking\n"
-    "at each probe atom.  The padding for the radius used to\n"
-    "exclude target atoms can be adjusted with the '--fastpad' option.\n"
-    "In the unlikely event the filter causes problems, it can\n"
-    "be disabled with '--fast=0'.\n";
+    "\tBy default, contact-time bins the target atoms into a grid of\n"
+    "cells (periodic when '--reimage' is on) each frame, so only target\n"
+    "atoms in cells next to a probe atom are considered.  This makes the\n"
+    "cost proportional to the number of atoms rather than the product of the\n"
+    "probe and target sizes.  The probe atoms can be divided among several\n"
+    "threads with the '--threads' option.  The grid can be disabled with\n"
+    "'--fast=0', which checks every probe-target pair.  With '--reimage',\n"
+    "the outer cutoff should be less than half the smallest box length.\n";
   
   return(s);
 }
@@ -127,7 +130,8 @@ public:
     normalize(true),
     max_norm(false),
     auto_self(false),
-    fast_filter(true)
+    fast_filter(true),
+    nthreads(1)
   { }
 
 
@@ -139,12 +143,13 @@ public:
       ("outer", po::value<double>(&outer_cutoff)->default_value(outer_cutoff), "Outer cutoff (ignore atoms further away than this)")
       ("reimage", po::value<bool>(&symmetry)->default_value(symmetry), "Consider symmetry when computing distances")
       ("autoself", po::value<bool>(&auto_self)->default_value(auto_self), "Automatically include self-to-self")
-      ("fast", po::value<bool>(&fast_filter)->default_value(fast_filter), "Use the fast-filter method")
-      ("fastpad", po::value<double>(&fast_pad)->default_value(fast_pad), "Padding for the fast-filter method");
+      ("fast", po::value<bool>(&fast_filter)->default_value(fast_filter), "Use a grid to find nearby atoms")
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use (0=all available)");
   }
 
   void addHidden(po::options_description& o) {
     o.add_options()
+      ("fastpad", po::value<double>(&fast_pad)->default_value(fast_pad), "Padding for the fast-filter method (no longer used)")
       ("probe", po::value<string>(&probe_selection), "Probe selection")
       ("target", po::value< vector<string> >(&target_selections), "Target selections");
   }
@@ -171,7 +176,7 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("inner=%f,outer=%f,rownorm=%d,colnorm=%d,reimage=%d,autoself=%d,fast=%d,fastpad=%f,probe='%s',targets=")
+    oss << boost::format("inner=%f,outer=%f,rownorm=%d,colnorm=%d,reimage=%d,autoself=%d,fast=%d,threads=%d,probe='%s',targets=")
       % inner_cutoff
       % outer_cutoff
       % normalize
@@ -179,7 +184,7 @@ public:
       % symmetry
       % auto_self
       % fast_filter
-      % fast_pad
+      % nthreads
       % probe_selection;
 
     for (uint i=0; i<target_selections.size(); ++i)
@@ -192,6 +197,7 @@ public:
   double inner_cutoff, outer_cutoff, fast_pad;
   string probe_selection;
   bool symmetry, normalize, max_norm, auto_self, fast_filter;
+  uint nthreads;
   vector<string> target_selections;
 };
 // @endcond
@@ -222,40 +228,6 @@ uint contacts(const AtomicGroup& target, const AtomicGroup& probe, const double
 }
 
 
-AtomicGroup pickNearbyAtoms(const AtomicGroup& target, const AtomicGroup& probe, const double radius, const bool symmetry) {
-
-  GCoord c = probe.centroid();
-  GCoord box = probe.periodicBox();
-  double maxrad = probe.radius() + radius;
-  maxrad *= maxrad;
-
-  
-  AtomicGroup nearby;
-  nearby.periodicBox(probe.periodicBox());
-  for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-    double d = symmetry ? c.distance2((*i)->coords(), box) : c.distance2((*i)->coords());
-    if (d <= maxrad)
-      nearby.append(*i);
-  }
-
-  return(nearby);
-}
-
-
-uint fastContacts(const AtomicGroup& target, const vGroup& probes, const double inner, const double outer, const double fast_pad, const bool symmetry) {
-  uint total_contacts = 0;
-
-  
-  for (vGroup::const_iterator i = probes.begin(); i != probes.end(); ++i) {
-    AtomicGroup new_target = pickNearbyAtoms(target, *i, outer+fast_pad, symmetry);
-    uint c = contacts(new_target, *i, inner, outer, symmetry);
-    total_contacts += c;
-  }
-
-  return(total_contacts);
-}
-
-
 // Given a vector of groups, compute the number of contacts between
 // unique pairs of groups, excluding the self-to-self
 //
@@ -274,6 +246,93 @@ uint autoSelfContacts(const vGroup& selves, const double inner_radius, const dou
 
 
 
+// Counts self-contacts with probe atoms later in the list that belong
+// to a different molecule, so each unique pair is counted once
+struct SelfVisitor {
+  SelfVisitor(const vector<int>& m) : molecule(m), atom(0), count(0) { }
+
+  void operator()(const uint j, const double) {
+    if (j > atom && molecule[j] != molecule[atom])
+      ++count;
+  }
+
+  const vector<int>& molecule;
+  uint atom;
+  ulong count;
+};
+
+
+// Grid-based contact counting for a block of probe atoms.  Each
+// thread gets its own block and its own row of counts (one per target
+// plus the self-contacts), which are summed after the threads finish.
+struct GridWorker {
+  GridWorker(const vector<NeighborGrid>& g, const NeighborGrid* s, const vector<int>& m,
+             const vector<GCoord>& p, const uint b, const uint e,
+             const double in, const double out, vector<ulong>& c)
+    : grids(g), self_grid(s), molecule(m), probe(p), begin(b), end(e),
+      inner(in), outer(out), counts(c) { }
+
+  void operator()() {
+    counts.assign(grids.size() + 1, 0);
+    for (uint t=0; t<grids.size(); ++t)
+      for (uint i=begin; i<end; ++i)
+        counts[t] += grids[t].count(probe[i], inner, outer);
+
+    if (self_grid) {
+      SelfVisitor v(molecule);
+      for (uint i=begin; i<end; ++i) {
+        v.atom = i;
+        self_grid->forEachNeighbor(probe[i], inner, outer, v);
+      }
+      counts[grids.size()] = v.count;
+    }
+  }
+
+  const vector<NeighborGrid>& grids;
+  const NeighborGrid* self_grid;
+  const vector<int>& molecule;
+  const vector<GCoord>& probe;
+  uint begin, end;
+  double inner, outer;
+  vector<ulong>& counts;
+};
+
+
+// Returns the contacts against each target, followed by the number of
+// self-contacts (if self_grid is non-null)
+vector<ulong> gridContacts(const vector<NeighborGrid>& grids, const NeighborGrid* self_grid,
+                           const vector<int>& molecule, const vector<GCoord>& probe,
+                           const double inner, const double outer, const uint nthreads) {
+
+  uint nblocks = nthreads > probe.size() ? probe.size() : nthreads;
+  if (nblocks == 0)
+    nblocks = 1;
+  vector< vector<ulong> > partials(nblocks);
+
+  if (nblocks == 1) {
+    GridWorker w(grids, self_grid, molecule, probe, 0, probe.size(), inner, outer, partials[0]);
+    w();
+  } else {
+    boost::thread_group threads;
+    uint block = (probe.size() + nblocks - 1) / nblocks;
+    for (uint i=0; i<nblocks; ++i) {
+      uint b = i * block;
+      uint e = (b + block > probe.size()) ? probe.size() : b + block;
+      threads.create_thread(GridWorker(grids, self_grid, molecule, probe, b, e, inner, outer, partials[i]));
+    }
+    threads.join_all();
+  }
+
+  vector<ulong> totals(grids.size() + 1, 0);
+  for (uint i=0; i<nblocks; ++i)
+    for (uint t=0; t<partials[i].size(); ++t)
+      totals[t] += partials[i][t];
+
+  return(totals);
+}
+
+
+
 
 // Normalize across a row of contacts against targets.
 // Skips the first col [expecting time to be stored there]
@@ -359,12 +418,28 @@ int main(int argc, char *argv[]) {
 
   // If comparing self, split apart molecules by unique segids
   vGroup myselves;
-  if (topts->auto_self || topts->fast_filter) {
-    if (topts->auto_self)
-      ++cols;
+  if (topts->auto_self) {
+    ++cols;
     myselves = probe.splitByUniqueSegid();
   }
 
+  // For the grid, each probe atom is tagged with the molecule it
+  // belongs to (for excluding self-to-self contacts)
+  vector<int> molecule(probe.size(), 0);
+  if (topts->auto_self) {
+    vector<int> owner(model.size(), -1);
+    for (uint j=0; j<myselves.size(); ++j)
+      for (AtomicGroup::const_iterator i = myselves[j].begin(); i != myselves[j].end(); ++i)
+        owner[(*i)->index()] = j;
+    for (uint i=0; i<probe.size(); ++i)
+      molecule[i] = owner[probe[i]->index()];
+  }
+
+  uint nthreads = topts->nthreads ? topts->nthreads : boost::thread::hardware_concurrency();
+  vector<NeighborGrid> grids;
+  NeighborGrid self_grid;
+  vector<GCoord> probe_crds(probe.size());
+
   uint t = 0;
   DoubleMatrix M(rows, cols);
 
@@ -386,19 +461,38 @@ int main(int argc, char *argv[]) {
     }
 
     M(t, 0) = t;
-    for (uint i=0; i<targets.size(); ++i) {
-      double d;
-      if (topts->fast_filter)
-        d = fastContacts(targets[i], myselves, topts->inner_cutoff, topts->outer_cutoff, topts->fast_pad, topts->symmetry);
-      else
-        d = contacts(targets[i], probe, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
-
-      M(t, i+1) = d;
+    if (topts->fast_filter) {
+      // Re-bin the targets (and probe, for self-contacts) with this frame's coords
+      if (grids.empty()) {
+        for (uint i=0; i<targets.size(); ++i)
+          grids.push_back(NeighborGrid(targets[i], topts->outer_cutoff, topts->symmetry));
+        if (topts->auto_self)
+          self_grid = NeighborGrid(probe, topts->outer_cutoff, topts->symmetry);
+      } else {
+        for (uint i=0; i<targets.size(); ++i)
+          grids[i].update(targets[i]);
+        if (topts->auto_self)
+          self_grid.update(probe);
+      }
+
+      for (uint i=0; i<probe.size(); ++i)
+        probe_crds[i] = probe[i]->coords();
+
+      vector<ulong> counts = gridContacts(grids, topts->auto_self ? &self_grid : 0, molecule, probe_crds,
+                                          topts->inner_cutoff, topts->outer_cutoff, nthreads);
+      for (uint i=0; i<targets.size(); ++i)
+        M(t, i+1) = counts[i];
+      if (topts->auto_self)
+        M(t, cols-1) = counts[targets.size()];
+
+    } else {
+      for (uint i=0; i<targets.size(); ++i)
+        M(t, i+1) = contacts(targets[i], probe, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+
+      if (topts->auto_self)
+        M(t, cols-1) = autoSelfContacts(myselves, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
     }
 
-    if (topts->auto_self)
-      M(t, cols-1) = autoSelfContacts(myselves, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
-
     ++t;
     if (bopts->verbosity)
       slayer.update();
@@ -82,7 +82,8 @@ struct ToolOptions : public opts::OptionsPackage
       ("skip", po::value<uint>(&skip)->default_value(0), "Skip these frames at the start of each trajectory")
       ("maxrad,R", po::value<double>(&maxrad)->default_value(30.0), "Maximum radius in membrane plane from lipopeptide")
       ("nbins,N", po::value<uint>(&nbins)->default_value(30), "Number of bins in histogram")
-      ("residue", po::value<bool>(&residue_split)->default_value(false), "Force split by residue");
+      ("residue", po::value<bool>(&residue_split)->default_value(false), "Force split by residue")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   
   }
 
@@ -118,9 +119,10 @@ struct ToolOptions : public opts::OptionsPackage
   string print() const 
   {
     ostringstream oss;
-    oss << boost::format("skip=%d, residue=%d, lipo='%s', lipid='%s', model='%s', traj='%s'")
+    oss << boost::format("skip=%d, residue=%d, threads=%d, lipo='%s', lipid='%s', model='%s', traj='%s'")
       % skip
       % residue_split
+      % nthreads
       % liposelection
       % membraneselection
       % model_name
@@ -138,6 +140,7 @@ struct ToolOptions : public opts::OptionsPackage
   vector<string> traj_names;
   double maxrad;
   uint nbins;
+  uint nthreads;
 };
 
 
@@ -229,88 +232,68 @@ private:
 
 // @endcond 
 
-// Only look at x,y-plane distance
-double centroidDistance(const AtomicGroup& a, const AtomicGroup& b) {
-  GCoord ac = a.centroid();
-  ac.z() = 0.0;
-
-  GCoord bc = b.centroid();
-  bc.z() = 0.0;
-  return(ac.distance(bc));
-}
-
-// Uses x,y-plane distance between centroids
-double minDistanceToSet(const AtomicGroup& a, const vecGroup& set) {
-
-  double mind = numeric_limits<double>::max();
-  for (vecGroup::const_iterator i = set.begin(); i != set.end(); ++i) {
-    double d = centroidDistance(a, *i);
-    if (d < mind)
-      mind = d;
-  }
-
-  return(mind);
-}
-
-
-
-
-// Note: hist is really an average binned on distance
+// Bins the order parameters for one leaflet by the x,y-plane distance
+// between each lipid and each lipopeptide in the same leaflet.  Lipids
+// are the first nlipids molecules in the engine results, followed by
+// the lipopeptides.
 void principalComponentsOrder(BinnedStatistics& phist,
                               BinnedStatistics& hist,
-                              const vecGroup& molecules,
-                              const vecGroup& lipopeptides) {
-  vecDouble orders;
+                              const OrderParameterEngine::FrameOrder& frame,
+                              const uint nlipids,
+                              const LeafletType leaflet) {
+
+  vector<GCoord> centers;
+  for (uint j=nlipids; j<frame.molecules.size(); ++j) {
+    GCoord c = frame.molecules[j].centroid;
+    if ((leaflet == UPPER && c.z() > 0) || (leaflet == LOWER && c.z() < 0)) {
+      c.z() = 0.0;
+      centers.push_back(c);
+    }
+  }
+  if (centers.empty())
+    return;
 
-  for (vecGroup::const_iterator i = molecules.begin(); i != molecules.end(); ++i) {
-    vector<GCoord> axes = i->principalAxes();
-    bool planar = false;
+  for (uint i=0; i<nlipids; ++i) {
+    const OrderParameterEngine::MoleculeOrder& lipid = frame.molecules[i];
+    GCoord lipid_center = lipid.centroid;
+    if (!((leaflet == UPPER && lipid_center.z() > 0) || (leaflet == LOWER && lipid_center.z() < 0)))
+      continue;
 
-    if (axes[3].z() < minp) {
-      if (nplanar == 0) {
-        PDB pdb = PDB::fromAtomicGroup(*i);
-        cerr << "Warning- PCA magnitudes out of bounds " << axes[3] << endl;
-        cerr << pdb;
-      }
+    bool planar = false;
+    if (lipid.smallest < minp) {
+      if (nplanar == 0)
+        cerr << "Warning- PCA magnitudes out of bounds for lipid " << i
+             << " at frame " << frame.frame << " (smallest = " << lipid.smallest << ")\n";
       planar = true;
       ++nplanar;
     }
 
-
-    double order1 = 0.5 - 1.5 * axes[1].z() * axes[1].z();
-    double order2 = 0.5 - 1.5 * axes[2].z() * axes[2].z();
-
-    GCoord lipid_center = i->centroid();
     lipid_center.z() = 0.0;
+    for (vector<GCoord>::const_iterator j = centers.begin(); j != centers.end(); ++j) {
+      double d = lipid_center.distance(*j);
+      phist.accumulate(d, lipid.first_axis);
 
-    for (vecGroup::const_iterator j = lipopeptides.begin(); j != lipopeptides.end(); ++j) {
-      GCoord c = j->centroid();
-      c.z() = 0.0;
-      double d = lipid_center.distance(c);
-      phist.accumulate(d, abs(axes[0].z()));
-      
-      hist.accumulate(d, order1);
+      hist.accumulate(d, lipid.order[0]);
       if (!planar)
-        hist.accumulate(d, order2);
+        hist.accumulate(d, lipid.order[1]);
     }
-    
   }
 }
 
 
-vecGroup filterByLeaflet(const vecGroup& ensemble, const LeafletType leaflet = UPPER) {
-  vecGroup side;
+struct FrameCollector {
+  FrameCollector(BinnedStatistics& p, BinnedStatistics& h, const uint n)
+    : phist(p), hist(h), nlipids(n) { }
 
-  for (vecGroup::const_iterator i = ensemble.begin(); i != ensemble.end(); ++i) {
-    GCoord c = i->centroid();
-    if (leaflet == UPPER && c.z() > 0)
-      side.push_back(*i);
-    else if (leaflet == LOWER && c.z() < 0)
-      side.push_back(*i);
+  void operator()(const OrderParameterEngine::FrameOrder& frame) {
+    principalComponentsOrder(phist, hist, frame, nlipids, UPPER);
+    principalComponentsOrder(phist, hist, frame, nlipids, LOWER);
   }
 
-  return(side);
-}
+  BinnedStatistics& phist;
+  BinnedStatistics& hist;
+  uint nlipids;
+};
 
 
 vecGroup extractSelections(const AtomicGroup& model, const string& selection, const bool force_residues) {
@@ -377,29 +360,27 @@ int main(int argc, char *argv[]) {
   BinnedStatistics lipid_hist(0.0, rmax, nbins);   // Track the fake hydrogen order parameters...
 
 
+  // Lipids go first, then the lipopeptides (which only need centroids)
+  OrderParameterEngine engine;
+  engine.reimageMolecules(false);
+  engine.threads(topts->nthreads);
+  for (vecGroup::const_iterator i = membrane.begin(); i != membrane.end(); ++i)
+    engine.addMolecule(*i);
+  for (vecGroup::const_iterator i = lipopeps.begin(); i != lipopeps.end(); ++i)
+    engine.addMolecule(*i);
+
+  FrameCollector collector(lipid_phist, lipid_hist, membrane.size());
+
+
   for (vector<string>::const_iterator ci = topts->traj_names.begin(); ci != topts->traj_names.end(); ++ci) {
     pTraj traj = createTrajectory(*ci, model);
     cerr << boost::format("Processing %s ...") % *ci;
     cerr.flush();
-    if (skip > 0)
-      traj->readFrame(skip-1);
-
-    while (traj->readFrame()) {
-      traj->updateGroupCoords(model);
+    vector<uint> frames;
+    for (uint t=skip; t<traj->nframes(); ++t)
+      frames.push_back(t);
 
-
-      vecGroup lip_leaf = filterByLeaflet(lipopeps, UPPER);
-      if (!lip_leaf.empty()) {
-          vecGroup lipid_leaf = filterByLeaflet(membrane, UPPER);
-          principalComponentsOrder(lipid_phist, lipid_hist, lipid_leaf, lip_leaf);
-      }
-
-      lip_leaf = filterByLeaflet(lipopeps, LOWER);
-      if (!lip_leaf.empty()) {
-          vecGroup lipid_leaf = filterByLeaflet(membrane, LOWER);
-          principalComponentsOrder(lipid_phist, lipid_hist, lipid_leaf, lip_leaf);
-      }
-    }
+    engine.process(traj, frames, collector);
 
     cerr << " done\n";
   }
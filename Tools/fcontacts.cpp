@@ -30,6 +30,7 @@
 
 #include <loos.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
 #include <limits>
 
 using namespace std;
@@ -90,6 +91,13 @@ string fullHelpMessage() {
         "This example considers ONLY heavy atoms.  Contacts are within 4 angstroms (the defaults)\n"
         "and for any atom with a segid matching the pattern PExx (e.g. PE00, PE01, PE02, ...).\n"
         "The fraction of contacts made with PCGL residues and bulk solvent are printed\n"
+        "\n"
+        "NOTES\n"
+        "\tThe atoms in the selection are binned into a grid of cells (periodic when\n"
+        "'--reimage' is on) each frame, so only atoms in cells next to a probe atom\n"
+        "are considered.  The probe molecules can be divided among several threads\n"
+        "with the '--threads' option.  With '--reimage', the outer cutoff should be\n"
+        "less than half the smallest box length.\n"
         ;
     
     return(s);
@@ -108,7 +116,8 @@ public:
         symmetry(true),
         auto_split(true),
         exclude_self(true),
-        report_stddev(false)
+        report_stddev(false),
+        nthreads(1)
         { }
 
 
@@ -120,7 +129,8 @@ public:
             ("split", po::value<bool>(&auto_split)->default_value(auto_split), "Automatically split probe selection")
             ("exclude", po::value<bool>(&exclude_self)->default_value(exclude_self), "Exclude self from contacts")
             ("pad", po::value<double>(&pad)->default_value(pad), "Padding for filtering nearby atoms")
-            ("stddev", po::value<bool>(&report_stddev)->default_value(report_stddev), "Include stddev in output");
+            ("stddev", po::value<bool>(&report_stddev)->default_value(report_stddev), "Include stddev in output")
+            ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use (0=all available)");
     }
 
     void addHidden(po::options_description& o) {
@@ -148,13 +158,14 @@ public:
 
     string print() const {
         ostringstream oss;
-        oss << boost::format("inner=%f,outer=%f,reimage=%d,autosplit=%d,pad=%f,stddev=%d,probe='%s',targets=")
+        oss << boost::format("inner=%f,outer=%f,reimage=%d,autosplit=%d,pad=%f,stddev=%d,threads=%d,probe='%s',targets=")
             % inner_cutoff
             % outer_cutoff
             % symmetry
             % auto_split
             % pad
             % report_stddev
+            % nthreads
             % probe_selection;
 
         for (uint i=0; i<target_selections.size(); ++i)
@@ -167,6 +178,7 @@ public:
     double inner_cutoff, outer_cutoff, pad;
     string probe_selection;
     bool symmetry, auto_split, exclude_self, report_stddev;
+    uint nthreads;
     vector<string> target_selections;
 };
 
@@ -190,90 +202,104 @@ typedef vector< vector<double> >      FContactsList;
 
 
 
-// Return a list of target atoms that are in contact with probe
-AtomicGroup contacts(const AtomicGroup& probe, const AtomicGroup& target, const double inner_radius, const double outer_radius, const bool symmetry) {
-  
-    double or2 = outer_radius * outer_radius;
-    double ir2 = inner_radius * inner_radius;
-
-    GCoord box = target.periodicBox();
-    AtomicGroup contacting_atoms;
-    
+// Counts contacts with atoms of the system that are not excluded for
+// the current probe molecule, tallying which targets they belong to
+struct ContactVisitor {
+    ContactVisitor(const vector<uint>& s, const vector< vector<uint> >& m, vector<ulong>& c)
+        : stamp(s), membership(m), counts(c), mark(0), total(0) { }
 
-    for (AtomicGroup::const_iterator j = probe.begin(); j != probe.end(); ++j) {
-        GCoord v = (*j)->coords();
-    
-        for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-            GCoord u = (*i)->coords();
-            double d = symmetry ? v.distance2(u, box) : v.distance2(u);
-            if (d >= ir2 && d <= or2)
-                contacting_atoms.append(*i);
-        }
+    void operator()(const uint k, const double) {
+        if (stamp[k] == mark)
+            return;
+        ++total;
+        for (vector<uint>::const_iterator i = membership[k].begin(); i != membership[k].end(); ++i)
+            ++counts[*i];
     }
 
-    return(contacting_atoms);
-}
-
-
-AtomicGroup pickNearbyAtoms(const AtomicGroup& probe, const AtomicGroup& target, const double radius, const bool symmetry) {
+    const vector<uint>& stamp;
+    const vector< vector<uint> >& membership;
+    vector<ulong>& counts;
+    uint mark;
+    ulong total;
+};
 
-    GCoord c = probe.centroid();
-    GCoord box = probe.periodicBox();
-    double maxrad = probe.radius() + radius;
-    maxrad *= maxrad;
 
-  
-    AtomicGroup nearby;
-    nearby.periodicBox(probe.periodicBox());
-    for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-        double d = symmetry ? c.distance2((*i)->coords(), box) : c.distance2((*i)->coords());
-        if (d <= maxrad)
-            nearby.append(*i);
+// Fractional contacts for a block of probe molecules.  Atoms are
+// referred to by their index into the system group (which the grid
+// was built from).
+struct FContactsWorker {
+    FContactsWorker(const NeighborGrid& g, const AtomicGroup& sys,
+                    const vector< vector<uint> >& p, const vector< vector<uint> >& x,
+                    const vector< vector<uint> >& m, const uint nt,
+                    const uint b, const uint e, const double in, const double out,
+                    FContactsList& f)
+        : grid(g), system(sys), probes(p), excludes(x), membership(m), ntargets(nt),
+          begin(b), end(e), inner(in), outer(out), fclist(f) { }
+
+    void operator()() {
+        // Excluded atoms for probe j are marked with j+1, so the marks
+        // never need to be cleared
+        vector<uint> stamp(system.size(), 0);
+        vector<ulong> counts(ntargets);
+        ContactVisitor visitor(stamp, membership, counts);
+
+        for (uint j=begin; j<end; ++j) {
+            for (vector<uint>::const_iterator i = excludes[j].begin(); i != excludes[j].end(); ++i)
+                stamp[*i] = j + 1;
+            visitor.mark = j + 1;
+            visitor.total = 0;
+            counts.assign(ntargets, 0);
+
+            for (vector<uint>::const_iterator i = probes[j].begin(); i != probes[j].end(); ++i)
+                grid.forEachNeighbor(system[*i]->coords(), inner, outer, visitor);
+
+            vector<double>& fracts = fclist[j];
+            fracts.assign(ntargets, 0.0);
+            if (visitor.total)
+                for (uint t=0; t<ntargets; ++t)
+                    fracts[t] = static_cast<double>(counts[t]) / visitor.total;
+        }
     }
 
-    return(nearby);
-}
-
-
-vector<double> fractionContactsToProbe(const AtomicGroup& probe,
-                                       const AtomicGroup& nearby,
-                                       const vGroup& targets,
-                                       const double inner_radius,
-                                       const double outer_radius,
-                                       const bool symmetry)
-{
-
-    // First, find which nearby atoms are actually in contact...
-    AtomicGroup nearby_contacts = contacts(probe, nearby, inner_radius, outer_radius, symmetry);
+    const NeighborGrid& grid;
+    const AtomicGroup& system;
+    const vector< vector<uint> >& probes;
+    const vector< vector<uint> >& excludes;
+    const vector< vector<uint> >& membership;
+    uint ntargets;
+    uint begin, end;
+    double inner, outer;
+    FContactsList& fclist;
+};
 
-    vector<double> fracts(targets.size(), 0.0);
-    for (uint i=0; i<targets.size(); ++i) {
-        AtomicGroup target_nearby = nearby_contacts.intersect(targets[i], IdEquals());
-        if (nearby_contacts.empty())
-            fracts[i] = 0.0;
-        else 
-            fracts[i] = static_cast<double>(target_nearby.size()) / nearby_contacts.size();
-    }
-    return(fracts);
-}
 
-        
-FContactsList fractionContacts(const AtomicGroup& system,
-                               const vGroup& probes,
-                               const vGroup& excludeds,
-                               const vGroup& targets,
+FContactsList fractionContacts(const NeighborGrid& grid,
+                               const AtomicGroup& system,
+                               const vector< vector<uint> >& probes,
+                               const vector< vector<uint> >& excludes,
+                               const vector< vector<uint> >& membership,
+                               const uint ntargets,
                                const double inner_radius,
                                const double outer_radius,
-                               const bool symmetry) 
+                               const uint nthreads)
 {
-
-    FContactsList fclist;
-    
-    for (uint j=0; j<probes.size(); ++j) {
-        AtomicGroup nearby = pickNearbyAtoms(probes[j], excludeds[j], outer_radius, symmetry);
-        vector<double> v = fractionContactsToProbe(probes[j], nearby, targets,
-                                                   inner_radius, outer_radius, symmetry);
-        fclist.push_back(v);
+    FContactsList fclist(probes.size());
+
+    uint nblocks = nthreads > probes.size() ? probes.size() : nthreads;
+    if (nblocks <= 1) {
+        FContactsWorker w(grid, system, probes, excludes, membership, ntargets, 0, probes.size(),
+                          inner_radius, outer_radius, fclist);
+        w();
+    } else {
+        boost::thread_group threads;
+        uint block = (probes.size() + nblocks - 1) / nblocks;
+        for (uint i=0; i<nblocks; ++i) {
+            uint b = i * block;
+            uint e = (b + block > probes.size()) ? probes.size() : b + block;
+            threads.create_thread(FContactsWorker(grid, system, probes, excludes, membership, ntargets,
+                                                  b, e, inner_radius, outer_radius, fclist));
+        }
+        threads.join_all();
     }
 
     return(fclist);
@@ -281,6 +307,22 @@ FContactsList fractionContacts(const AtomicGroup& system,
 
 
 
+// Converts groups into lists of indices into the system group
+vector< vector<uint> > systemIndices(const vGroup& groups, const vector<int>& position)
+{
+    vector< vector<uint> > indices(groups.size());
+    for (uint j=0; j<groups.size(); ++j)
+        for (AtomicGroup::const_iterator i = groups[j].begin(); i != groups[j].end(); ++i) {
+            int k = position[(*i)->index()];
+            if (k >= 0)
+                indices[j].push_back(k);
+        }
+
+    return(indices);
+}
+
+
+
 vector<double> average(const FContactsList& f) 
 {
     vector<double> avgs(f[0].size(), 0.0);
@@ -369,13 +411,24 @@ int main(int argc, char *argv[]) {
     } else
         excludes = myselves;
 
-    // This is system excluding requested probe atoms...
-    vGroup excludeds;
-    for (vGroup::iterator i = excludes.begin(); i != excludes.end(); ++i) {
-        AtomicGroup pruned = system;
-        pruned.remove(*i);
-        excludeds.push_back(pruned);
-    }
+    // Everything below refers to atoms by their position in the system
+    vector<int> position(model.size(), -1);
+    for (uint i=0; i<system.size(); ++i)
+        position[system[i]->index()] = i;
+
+    vector< vector<uint> > probe_indices = systemIndices(myselves, position);
+    vector< vector<uint> > exclude_indices = systemIndices(excludes, position);
+
+    // Which targets each system atom belongs to
+    vector< vector<uint> > membership(system.size());
+    vector< vector<uint> > target_indices = systemIndices(targets, position);
+    for (uint t=0; t<target_indices.size(); ++t)
+        for (vector<uint>::const_iterator i = target_indices[t].begin(); i != target_indices[t].end(); ++i)
+            membership[*i].push_back(t);
+
+    uint nthreads = topts->nthreads ? topts->nthreads : boost::thread::hardware_concurrency();
+    NeighborGrid grid;
+    bool first = true;
     
     
     // Size of the output matrix
@@ -408,7 +461,14 @@ int main(int argc, char *argv[]) {
 
         M(t, 0) = *frame;
 
-        FContactsList fcl = fractionContacts(system, myselves, excludeds, targets, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+        if (first) {
+            grid = NeighborGrid(system, topts->outer_cutoff, topts->symmetry);
+            first = false;
+        } else
+            grid.update(system);
+
+        FContactsList fcl = fractionContacts(grid, system, probe_indices, exclude_indices, membership, targets.size(),
+                                             topts->inner_cutoff, topts->outer_cutoff, nthreads);
         vector<double> avg = average(fcl);
         if (topts->report_stddev) {
             vector<double> stds = stddevs(fcl, avg);
@@ -135,5 +135,5 @@ int main(int argc, char *argv[]) {
   if (sopts->selection != "all")
     pdb.clearBonds();
   pdb.remarks().add(hdr);
-  cout << pdb;
+  PDBWriter(pdb).write(cout);
 }
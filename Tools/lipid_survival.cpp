@@ -158,23 +158,16 @@ int main(int argc, char *argv[]) {
   vGroup lipids = lipid.splitByMolecule();
 
 
-  vector < vector <double> > contacts;
-  // initialize vector of timeseries to store 
-  for (unsigned int i = 0; i < lipids.size(); i++)
-      {
+  // One bit per lipid per frame
+  OccupancyMatrix contacts(lipids.size(), traj->nframes());
 
-        vector <double> tmp (traj->nframes(), 0.0);
-        contacts.push_back(tmp);
-
-      }
-
-int frame_count = 0;
+uint frame_count = 0;
 while (traj->readFrame()) 
     {
     traj->updateGroupCoords(model);
     GCoord box = model.periodicBox();
     
-    for (uint j=0; j < contacts.size(); j++)
+    for (uint j=0; j < contacts.rows(); j++)
         {
         bool contact = false;
         if (topts->reimage) 
@@ -188,7 +181,7 @@ while (traj->readFrame())
     
         if (contact)
             {
-            contacts[j][frame_count] = 1.0;
+            contacts.set(j, frame_count);
             }
         }
       frame_count++;
@@ -197,42 +190,20 @@ while (traj->readFrame())
 /* Probability Calculations
  */
 
-// loop over dt
-//
-cout << "0\t1.00" << endl;
-for (unsigned int t = 1; t < topts->maxdt; t++)
-    {
-
-    double bound_tmp = 0.0;
-    double total_tmp = 0.0;
-    // loop over lipids
-    for (unsigned int i = 0; i < contacts.size(); i++)
-        {
-
-        // loop through values for that lipid's contacts
-        for (unsigned int j = 0; j < (contacts[i].size() - t); j++)
-            {
-            
-            // if current value is 1
-            if (contacts[i][j] == 1)
-                {
-                    if ((contacts[i][j+t]) == 1)
-                        {
-
-                        bound_tmp++;
+uint maxdt = topts->maxdt;
+if (maxdt > contacts.frames())
+    maxdt = contacts.frames();
 
-                        }
-
-                        total_tmp++;
-                }
-
-            }
-
-        }
-
-    double prob_tmp = bound_tmp/total_tmp;
+// Pool the counts over all lipids
+vector<ulong> bound(maxdt, 0);
+vector<ulong> total(maxdt, 0);
+for (uint i = 0; i < contacts.rows(); i++)
+    intermittentSurvival(contacts, i, maxdt, bound, total);
 
+cout << "0\t1.00" << endl;
+for (unsigned int t = 1; t < maxdt; t++)
+    {
+    double prob_tmp = static_cast<double>(bound[t]) / total[t];
     cout << t << "\t" << prob_tmp << endl;
     }
 } 
-
@@ -100,7 +100,8 @@ struct ToolOptions : public opts::OptionsPackage
     o.add_options()
       ("skip", po::value<uint>(&skip)->default_value(0), "Skip these frames at the start of each trajectory")
       ("residue", po::value<bool>(&residue_split)->default_value(false), "Force split by residue")
-      ("timeseries", po::value<bool>(&timeseries)->default_value(false), "Write out time-series of MOPS");
+      ("timeseries", po::value<bool>(&timeseries)->default_value(false), "Write out time-series of MOPS")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -135,11 +136,12 @@ struct ToolOptions : public opts::OptionsPackage
   string print() const 
   {
     ostringstream oss;
-    oss << boost::format("skip=%d, selection='%s', residue=%d, timeseries=%d, model='%s', traj='%s'")
+    oss << boost::format("skip=%d, selection='%s', residue=%d, timeseries=%d, threads=%d, model='%s', traj='%s'")
       % skip
       % selection
       % residue_split
       % timeseries
+      % nthreads
       % model_name
       % vectorAsStringWithCommas(traj_names);
     
@@ -150,6 +152,7 @@ struct ToolOptions : public opts::OptionsPackage
   uint skip;
   bool residue_split;
   bool timeseries;
+  uint nthreads;
   string selection;
   string model_name;
   vector<string> traj_names;
@@ -188,38 +191,44 @@ ulong calculateSize(AtomicGroup& model, const vString& names) {
 }
 
 
-// Note: hist is really an average binned on distance
-void principalComponentsOrder(dTimeSeries& order_parameters,
-                              const vGroup& residues) {
+// Collects the faux-hydrogen order parameters for each frame as they
+// come back from the OrderParameterEngine
+struct FrameCollector {
+  FrameCollector(dTimeSeries& s, const uint f, const uint t, const bool ts)
+    : suborder(s), file(f), frame(t), timeseries(ts) { }
 
-  for (vGroup::const_iterator i = residues.begin(); i != residues.end(); ++i) {
-    AtomicGroup residue = i->copy();
-    residue.centerAtOrigin();
-    residue.mergeImage();
-    vector<GCoord> axes = residue.principalAxes();
-    bool planar = false;
+  void operator()(const OrderParameterEngine::FrameOrder& result) {
+    dTimeSeries frameorder;
 
-    if (abs(axes[3].z()) < minp) {
-      if (nplanar == 0) {
-        PDB pdb = PDB::fromAtomicGroup(residue);
-        cerr << progname << ": Warning- PCA magnitudes out of bounds " << axes[3] << endl;
-        cerr << pdb;
-      }
-      planar = true;
-      ++nplanar;
-    }
+    for (uint i=0; i<result.molecules.size(); ++i) {
+      const OrderParameterEngine::MoleculeOrder& mol = result.molecules[i];
+      bool planar = false;
 
-    double order1 = 0.5 - 1.5 * axes[1].z() * axes[1].z();
-    double order2 = 0.5 - 1.5 * axes[2].z() * axes[2].z();
+      if (abs(mol.smallest) < minp) {
+        if (nplanar == 0)
+          cerr << progname << ": Warning- PCA magnitudes out of bounds for molecule " << i
+               << " at frame " << result.frame << " (smallest = " << mol.smallest << ")\n";
+        planar = true;
+        ++nplanar;
+      }
 
-    order_parameters.push_back(order1);
-    ++ntotal;
-    if (!planar) {
-      order_parameters.push_back(order2);
+      frameorder.push_back(mol.order[0]);
       ++ntotal;
+      if (!planar) {
+        frameorder.push_back(mol.order[1]);
+        ++ntotal;
+      }
     }
+
+    copy(frameorder.begin(), frameorder.end(), back_inserter(suborder));
+    if (timeseries)
+      cout << file << '\t' << frame++ << '\t' << frameorder.average() << '\t' << '\t' << frameorder.stdev() << endl;
   }
-}
+
+  dTimeSeries& suborder;
+  uint file, frame;
+  bool timeseries;
+};
 
 
 
@@ -285,6 +294,12 @@ int main(int argc, char *argv[]) {
   n -= traj_names.size() * skip;
 
 
+  // Each molecule is flattened into the engine once
+  OrderParameterEngine engine;
+  engine.threads(topts->nthreads);
+  for (vGroup::const_iterator i = subset.begin(); i != subset.end(); ++i)
+    engine.addMolecule(*i);
+
   dTimeSeries order;
 
   uint file = 0;
@@ -293,18 +308,12 @@ int main(int argc, char *argv[]) {
     dTimeSeries suborder;
 
     pTraj traj = createTrajectory(*i, model);
-    if (skip != 0)
-      traj->readFrame(skip-1);
-
-    uint t = skip;
-    while (traj->readFrame()) {
-      dTimeSeries frameorder;
-      traj->updateGroupCoords(model);
-      principalComponentsOrder(frameorder, subset);
-      copy(frameorder.begin(), frameorder.end(), back_inserter(suborder));
-      if (topts->timeseries)
-        cout << file << '\t' << t++ << '\t' << frameorder.average() << '\t' << '\t' << frameorder.stdev() << endl;
-    }
+    vector<uint> frames;
+    for (uint t=skip; t<traj->nframes(); ++t)
+      frames.push_back(t);
+
+    FrameCollector collector(suborder, file, skip, topts->timeseries);
+    engine.process(traj, frames, collector);
     if (topts->timeseries)
       cout << endl << endl;
     order.push_back(suborder.average());
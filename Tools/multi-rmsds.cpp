@@ -103,6 +103,14 @@ string fullHelpMessage(void) {
     "This example uses the backbone atoms, and skips the first 50 frames from each trajectory,\n"
     "and only takes every 10th subsequent frame from each trajectory.\n"
     "\n"
+    "\tmulti-rmsds --reference centroid1.pdb --reference centroid2.pdb --threads=8 \\\n"
+    "\t  --binary=rmsds.bin model.pdb sim1.dcd sim2.dcd sim3.dcd\n"
+    "Instead of the all-to-all matrix, this computes the RMSD between every frame and each\n"
+    "of the two reference structures (using the same selection), giving a matrix with one\n"
+    "row per frame and one column per reference.  The trajectories are read only once and\n"
+    "are not cached, so this works for any number of frames.  The matrix is written in\n"
+    "binary format as it is computed.\n"
+    "\n"
     "SEE ALSO\n"
     "\trmsds, rmsd2ref, rms-overlap\n"
     "\n";
@@ -121,18 +129,22 @@ public:
       ("noout,N", po::value<bool>(&noop)->default_value(false), "Do not output the matrix (i.e. only calc pair-wise RMSD stats)")
       ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
       ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix")
-      ("precision,p", po::value<uint>(&matrix_precision)->default_value(2), "Write out matrix coefficients with this many digits.");
+      ("precision,p", po::value<uint>(&matrix_precision)->default_value(2), "Write out matrix coefficients with this many digits.")
+      ("reference", po::value< vector<string> >(&references), "Compute RMSD of each frame against these structures instead of all-to-all (may be repeated)")
+      ("binary", po::value<string>(&binary_name), "Write the matrix in binary format to this file (instead of ASCII to stdout)");
   }
 
 
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("stats=%d,noout=%d,nthreads=%d,matrix_precision=%d")
+    oss << boost::format("stats=%d,noout=%d,nthreads=%d,matrix_precision=%d,reference='%s',binary='%s'")
       % stats
       % noop
       % nthreads
-      % matrix_precision;
+      % matrix_precision
+      % vectorAsStringWithCommas(references)
+      % binary_name;
 
     return(oss.str());
   }
@@ -142,6 +154,8 @@ public:
   bool noop;
   uint nthreads;
   uint matrix_precision;
+  vector<string> references;
+  string binary_name;
 };
 
 typedef vector<double>    vecDouble;
@@ -334,6 +348,48 @@ void showStatsHalf(const RealMatrix& R) {
 }
 
 
+// Collects the frame vs reference RMSDs from a MultiReferenceRMSD,
+// either into a matrix or straight out to a binary file
+
+class ReferenceSink {
+public:
+  ReferenceSink(const uint nframes, const uint nrefs, const string& binary_name, const string& header)
+    : _nrefs(nrefs), _row(0), _buf(nrefs)
+  {
+    if (binary_name.empty())
+      _M = RealMatrix(nframes, nrefs);
+    else
+      _writer = boost::shared_ptr< BinaryMatrixWriter<float, Math::RowMajor> >(new BinaryMatrixWriter<float, Math::RowMajor>(binary_name, nframes, nrefs, header));
+  }
+
+  void operator()(const double* rows, const uint n) {
+    for (uint i=0; i<n; ++i, ++_row) {
+      const double* r = rows + static_cast<ulong>(i) * _nrefs;
+      if (_writer) {
+        std::copy(r, r + _nrefs, _buf.begin());
+        _writer->write(&(_buf[0]), _nrefs);
+      } else
+        for (uint k=0; k<_nrefs; ++k)
+          _M(_row, k) = r[k];
+    }
+  }
+
+  void close() {
+    if (_writer)
+      _writer->close();
+  }
+
+  const RealMatrix& matrix() const { return(_M); }
+
+private:
+  uint _nrefs, _row;
+  vector<float> _buf;
+  RealMatrix _M;
+  boost::shared_ptr< BinaryMatrixWriter<float, Math::RowMajor> > _writer;
+};
+
+
+
 void centerTrajectory(alignment::vecMatrix& U) {
   for (uint i=0; i<U.size(); ++i)
     alignment::centerAtOrigin(U[i]);
@@ -390,6 +446,38 @@ int main(int argc, char *argv[]) {
   if (verbosity > 1)
     cerr << "Using " << nthreads << " threads\n";
 
+  // Streaming comparison against fixed references...
+  if (!topts->references.empty()) {
+    vector<AtomicGroup> references;
+    for (uint i=0; i<topts->references.size(); ++i) {
+      AtomicGroup ref = createSystem(topts->references[i]);
+      AtomicGroup ref_subset = selectAtoms(ref, sopts->selection);
+      if (ref_subset.size() != subset.size()) {
+        cerr << boost::format("Error- reference %s selection has %u atoms while trajectory selection has %u.\n") % topts->references[i] % ref_subset.size() % subset.size();
+        exit(-1);
+      }
+      references.push_back(ref_subset);
+    }
+
+    if (verbosity > 1)
+      cerr << "Calculating RMSD against " << references.size() << " references...\n";
+    MultiReferenceRMSD engine(references);
+    engine.threads(nthreads);
+    traj->setSelectionHint(subset);
+
+    string meta = header + "\n" + mtopts->trajectoryTable();
+    ReferenceSink sink(indices.size(), references.size(), topts->noop ? string() : topts->binary_name, meta);
+    engine.stream(subset, traj, indices, sink);
+    sink.close();
+
+    if (!topts->noop && topts->binary_name.empty()) {
+      cout << "# " << header << endl;
+      cout << mtopts->trajectoryTable();
+      cout << setprecision(topts->matrix_precision) << sink.matrix();
+    }
+    return(0);
+  }
+
   vMatrix T = readCoords(subset, traj, indices, verbosity > 1);
   used_memory += T.size() * T[0].size() * sizeof(vMatrix::value_type::value_type);   // Coords matrix
   used_memory += T.size() * T.size() * sizeof(RealMatrix::element_type);             // RMSDS matrix
@@ -412,9 +500,13 @@ int main(int argc, char *argv[]) {
 
 
   if (!topts->noop) {
-    cout << "# " << header << endl;
-    cout << mtopts->trajectoryTable();
-    cout << setprecision(topts->matrix_precision) << M;
+    if (!topts->binary_name.empty())
+      writeBinaryMatrix(topts->binary_name, M, header + "\n" + mtopts->trajectoryTable());
+    else {
+      cout << "# " << header << endl;
+      cout << mtopts->trajectoryTable();
+      cout << setprecision(topts->matrix_precision) << M;
+    }
   }
 
 }
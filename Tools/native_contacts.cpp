@@ -48,6 +48,7 @@ class ToolOptions : public opts::OptionsPackage
         bool use_reference;
         bool do_per_residue;
         bool exclude_consecutive;
+        uint nthreads;
 
         void addGeneric(po::options_description& o)
             {
@@ -58,6 +59,7 @@ class ToolOptions : public opts::OptionsPackage
      ("reference", po::value<string>(&reference), "Coordinate file to use as reference structure")
      ("per-residue", po::value<string>(&per_residue_filename), "Output per-residue native contact frequency to this file")
      ("exclude-consecutive", "Exclude consecutive residues")
+     ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
             ;
             }
 
@@ -113,6 +115,37 @@ class ToolOptions : public opts::OptionsPackage
             }
 
     };
+
+
+// Writes the fraction of native contacts (and optionally the state of
+// each contact) for each frame
+struct FrameWriter
+    {
+    FrameWriter(ofstream* o, const double c2, const uint n) :
+        output(o), cut2(c2), num_pairs(n), num_native_contacts(n), frame(0)
+        { }
+
+    void operator()(const double* d2, const uint num_contacts)
+        {
+        if (output)
+            {
+            for (uint i=0; i<num_pairs; ++i)
+                {
+                *output << (d2[i] <= cut2 ? "1\t" : "0\t");
+                }
+            *output << endl;
+            }
+        float fraction = num_contacts / num_native_contacts;
+        cout << frame << "\t" << fraction << endl;
+        frame++;
+        }
+
+    ofstream* output;
+    double cut2;
+    uint num_pairs;
+    float num_native_contacts;
+    int frame;
+    };
 // @endcond
 
 
@@ -187,6 +220,10 @@ string fullHelpMessage(void)
 "    If you supply the \"--per-residue FILENAME\", the program will output \n"
 "    the average fractional native contacts for each residue to FILENAME.\n"
 "    Residues with no native contacts will have a value of -1.\n"
+"\n"
+"    The residue centers and contact distances for each frame are\n"
+"    computed together, and blocks of frames can be processed in parallel\n"
+"    with the \"--threads\" option (0 uses all available cores).\n"
 "\n"
         ;
     return(s);
@@ -297,7 +334,6 @@ for (uint i=0; i<num_residues; i++)
 
 vector<vector<uint> > contacts;
 vector<uint>total_contacts_per_residue(num_residues);
-vector<uint>contacts_per_residue(num_residues);
 
 GCoord box = system.periodicBox();
 
@@ -346,7 +382,7 @@ for (uint i=0; i<num_residues-step; i++)
 float num_native_contacts = (float) contacts.size();
 cout << "# Total native contacts: " << num_native_contacts << endl;
 
-bool is_periodic;
+bool is_periodic = false;
 if (topts->use_periodicity && traj->hasPeriodicBox())
     {
     is_periodic = true;
@@ -358,48 +394,20 @@ else if (topts->use_periodicity && !(traj->hasPeriodicBox()))
     is_periodic = false;
     }
 
-// Loop over structures in the trajectory
-vector<vector<uint> >::iterator p;
-int frame = 0;
-while (traj->readFrame())
+// Loop over structures in the trajectory, evaluating all of the
+// native contacts for each frame at once
+ContactFractionEngine engine(residues, cutoff, is_periodic);
+engine.threads(topts->nthreads);
+for (uint i=0; i<contacts.size(); ++i)
     {
-    traj->updateGroupCoords(system);
-    box = system.periodicBox();
-
-    // Loop over contacts from the native structure
-    int num_contacts = 0;
-    for (p=contacts.begin(); p!= contacts.end(); p++)
-        {
-        uint r1 = p->at(0);
-        uint r2 = p->at(1);
-        GCoord c1 = residues[r1].centerOfMass();
-        GCoord c2 = residues[r2].centerOfMass();
-        GCoord diff = c2 - c1;
-        if (is_periodic)
-            {
-            diff.reimage(box);
-            }
-        if (diff.length2() <= cut2)
-            {
-            num_contacts++;
-            if (topts->do_output) output << "1\t";
-            if (topts->do_per_residue)
-                {
-                contacts_per_residue[r1]++;
-                contacts_per_residue[r2]++;
-                }
-            }
-        else
-            {
-            if (topts->do_output) output << "0\t";
-            }
-        }
-    float fraction = num_contacts / num_native_contacts;
-    cout << frame << "\t" << fraction << endl;
-    if (topts->do_output) output << endl;
-    frame++;
+    engine.addPair(contacts[i][0], contacts[i][1]);
     }
 
+FrameWriter writer(topts->do_output ? &output : 0, cut2, contacts.size());
+engine.process(system, traj, writer);
+int frame = engine.frames();
+vector<ulong> contacts_per_residue = engine.residueCounts();
+
 // Output total contacts per residue
 if (topts->do_per_residue)
     {
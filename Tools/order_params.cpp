@@ -56,6 +56,8 @@ bool block_average = false;
 string block_filename;
 int ba_first, ba_last;
 
+uint nthreads;
+
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -72,7 +74,8 @@ public:
       ("timeseries,T", po::value<string>(&timeseries_filename), "File name for outputing timeseries")
       ("block_average", po::value<string>(&block_filename),"File name for block averaging data")
       ("ba_first", po::value<int>(&ba_first), "Lower range of blocks to average over to calculate uncertainty")
-      ("ba_last", po::value<int>(&ba_last), "Upper range of blocks to average over to calculate uncertainty");
+      ("ba_last", po::value<int>(&ba_last), "Upper range of blocks to average over to calculate uncertainty")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   void addHidden(po::options_description& o)
@@ -169,14 +172,15 @@ public:
   string print() const {
     ostringstream oss;
 
-    oss << boost::format("axis_index=%d, one_res_lipid=%d, three_res_lipid=%d, dump_timeseries=%d, block_average=%d, ba_first=%d, ba_last=%d")
+    oss << boost::format("axis_index=%d, one_res_lipid=%d, three_res_lipid=%d, dump_timeseries=%d, block_average=%d, ba_first=%d, ba_last=%d, threads=%d")
       % axis_index
       % one_res_lipid
       % three_res_lipid
       % dump_timeseries
       % block_average
       % ba_first
-      % ba_last;
+      % ba_last
+      % nthreads;
     return(oss.str());
   }
 
@@ -184,6 +188,38 @@ public:
 
 };
 
+
+
+// Stores the average order parameter for each carbon position as
+// frames come back from the OrderParameterEngine, optionally writing
+// out the time series
+struct FrameCollector
+{
+  FrameCollector(vector<vector<float> >& v, ofstream& o, const bool d)
+    : values(v), outfile(o), dump(d), index(0)
+  { }
+
+  void operator()(const OrderParameterEngine::FrameOrder& frame)
+  {
+    if (dump)
+      outfile << index << "\t";
+    for (uint i=0; i<values.size(); i++)
+      {
+      values[i][index] = frame.bonds[i];
+      if (dump)
+        outfile << boost::format("%8.3f") % fabs(values[i][index]);
+      }
+    if (dump)
+      outfile << endl;
+    index++;
+  }
+
+  vector<vector<float> >& values;
+  ofstream& outfile;
+  bool dump;
+  int index;
+};
+
 // @endcond
 
 string fullHelpMessage(void)
@@ -319,6 +355,12 @@ string fullHelpMessage(void)
 "    fake psf file, be sure to give the \"--hydrogens\" option so that the\n"
 "    bonds to hydrogen are generated correctly.\n"
 "\n"
+"    Performance\n"
+"\n"
+"    All of the C-H pairs are flattened into a list once, and the trajectory\n"
+"    is read in blocks of frames.  The frames in each block can be split\n"
+"    between threads with the --threads option.\n"
+"\n"
 "    EXAMPLE\n"
 "\n"
 "    order_params namd.psf merged_1ns.dcd '(segid =~ \"L([0-9]+)\") && resname == \"PALM\"' 2 16 --block_average foo.dat --ba_first 2 --ba_last 5\n"
@@ -546,13 +588,11 @@ const int num_frames = framelist.size();
 // carbon position, and turn this into an average at the end.
 // This will let us do better uncertainty analysis.
 vector<vector<float> > values;
-vector<int> counts;
 values.resize(selections.size());
 for (uint i=0; i<values.size(); i++)
     {
     values[i].insert(values[i].begin(), num_frames, 0.0);
     }
-counts.insert(counts.begin(), selections.size(), 0);
 
 ofstream timeseries_outfile;
 if (dump_timeseries)
@@ -580,60 +620,27 @@ if (dump_timeseries)
 
     }
 
-// loop over frames in the trajectory
-int frame_index = 0;
-
-for (uint i=0; i<framelist.size(); ++i)
+// Flatten all of the C-H pairs, with each carbon position as a group
+OrderParameterEngine engine;
+engine.axis(axis_index);
+engine.threads(nthreads);
+for (unsigned int i=0; i<selections.size(); i++)
     {
-    traj->readFrame(framelist[i]);
-    traj->updateGroupCoords(system);
-
-
-    // loop over sets of selected carbons
-    for (unsigned int i=0; i<selections.size(); i++)
-        {
-        AtomicGroup *g = &(selections[i]);
-        for (uint j=0; j<g->size(); j++)
-            {
-            // get the carbon
-            pAtom carbon = g->getAtom(j);
-            // get the relevant hydrogens
-            AtomicGroup *hyds = &(hydrogen_list[i][j]);
-
-            AtomicGroup::Iterator iter(*hyds);
-            pAtom h;
-            while ( (h = iter()) )
-                {
-                GCoord v = carbon->coords() - h->coords();
-                double length = v.length();
-                double cos_val =  v[axis_index]/length;
-                double order = 0.5 - 1.5*cos_val*cos_val;
-                values[i][frame_index] += order;
-                counts[i]++;
-                }
-            }
-        }
-    // turn the sum into an average
-    if (dump_timeseries)
+    for (uint j=0; j<selections[i].size(); j++)
         {
-        timeseries_outfile << frame_index << "\t";
-        }
-    for (unsigned int i=0; i<selections.size(); i++)
-        {
-        values[i][frame_index] /= counts[i];
-        if (dump_timeseries)
+        AtomicGroup *hyds = &(hydrogen_list[i][j]);
+        for (uint k=0; k<hyds->size(); k++)
             {
-            timeseries_outfile << boost::format("%8.3f") % fabs(values[i][frame_index]);
+            engine.addBond(selections[i][j], (*hyds)[k], i);
             }
-        counts[i] = 0;
-        }
-    if (dump_timeseries)
-        {
-        timeseries_outfile << endl;
         }
-    frame_index++;
     }
 
+// loop over frames in the trajectory
+FrameCollector collector(values, timeseries_outfile, dump_timeseries);
+engine.process(traj, framelist, collector);
+int frame_index = collector.index;
+
 // Print header
 if (!block_average)
     {
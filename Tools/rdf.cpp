@@ -31,6 +31,7 @@
  */
 
 #include <loos.hpp>
+#include <boost/thread/thread.hpp>
 
 
 using namespace std;
@@ -45,6 +46,7 @@ string split_by, split_by2;
 double hist_min, hist_max;
 int num_bins;
 int skip;
+uint nthreads;
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -56,6 +58,7 @@ public:
     o.add_options()
       ("split-mode",po::value<string>(&split_by)->default_value("by-molecule"), "how to split the selections (by-residue, molecule, segment, none)")
       ("split-mode2",po::value<string>(&split_by2)->default_value("by-molecule"), "how to split the second selection (by-residue, molecule, segment, none)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
       ;
   }
 
@@ -93,14 +96,15 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%'")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%', threads=%d")
       % split_by
       % selection1
       % selection2
       % hist_min
       % hist_max
       % num_bins
-      % split_by2;
+      % split_by2
+      % nthreads;
     return(oss.str());
   }
 };
@@ -152,6 +156,11 @@ string s =
     "the tryptophan residues.  The program would use the center of mass of the\n"
     "carbon atoms to as the point from which to compute the RDF.\n"
     "\n"
+    "With --threads, the distances for blocks of frames are binned in\n"
+    "parallel.  Each thread keeps its own histogram, and these are summed\n"
+    "in a fixed order, so the results for a given number of threads are\n"
+    "reproducible.\n"
+    "\n"
     "See also atomic-rdf and xy_rdf.\n"
     ;
 
@@ -231,6 +240,68 @@ uint doSplit(const AtomicGroup &system, const string selection,
     }
 
 
+// @cond TOOLS_INTERNAL
+// Centers of the groups (and the weight and box) for one frame
+struct FrameCenters
+    {
+    double weight;
+    GCoord box;
+    vector<GCoord> c1, c2;
+    };
+
+
+// Bins the pair distances for one thread's share of a block of frames
+class PairBinner
+    {
+public:
+    PairBinner(const vector<FrameCenters>* frames,
+               const Math::Matrix<int, Math::RowMajor>* overlap,
+               HistogramAccumulator* acc,
+               const uint slot, const uint n)
+        : _frames(frames), _overlap(overlap), _acc(acc), _slot(slot), _n(n)
+        { }
+
+    void operator()()
+        {
+        double min2 = hist_min*hist_min;
+        double max2 = hist_max*hist_max;
+        WeightedHistogram& hist = _acc->slot(_slot);
+
+        pair<uint, uint> range = _acc->slotRange(_slot, _n);
+        for (uint f = range.first; f < range.second; ++f)
+            {
+            const FrameCenters& frame = (*_frames)[f];
+            for (uint j = 0; j < frame.c1.size(); j++)
+                {
+                const GCoord& p1 = frame.c1[j];
+                for (uint k = 0; k < frame.c2.size(); k++)
+                    {
+                    // skip "self" pairs -- in case selection1 and selection2 overlap
+                    if ((*_overlap)(j, k))
+                        {
+                        continue;
+                        }
+
+                    // Compute the distance squared, taking periodicity into account
+                    double d2 = p1.distance2(frame.c2[k], frame.box);
+                    if ( (d2 < max2) && (d2 > min2) )
+                        {
+                        hist.add(sqrt(d2), frame.weight);
+                        }
+                    }
+                }
+            }
+        }
+
+private:
+    const vector<FrameCenters>* _frames;
+    const Math::Matrix<int, Math::RowMajor>* _overlap;
+    HistogramAccumulator* _acc;
+    uint _slot, _n;
+    };
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 
@@ -295,14 +366,6 @@ vector<uint> framelist = tropts->frameList();
 traj->readFrame(framelist[0]);
 traj->updateGroupCoords(system);
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
 // Precompute the overlap between the two groups (this can be an
 // expensive operation, so it's better to have it outside the
 // while-loop)
@@ -324,51 +387,78 @@ for (uint j=0; j<g1_mols.size(); ++j)
     }
 
 
+// Frames are read a block at a time, and the binning for each block
+// is split across the threads
+if (nthreads == 0)
+    {
+    nthreads = boost::thread::hardware_concurrency();
+    }
+if (nthreads == 0)
+    {
+    nthreads = 1;
+    }
+HistogramAccumulator accumulator(WeightedHistogram(hist_min, hist_max, num_bins), nthreads);
+vector<FrameCenters> block(16 * nthreads);
+for (uint i=0; i<block.size(); ++i)
+    {
+    block[i].c1.resize(g1_mols.size());
+    block[i].c2.resize(g2_mols.size());
+    }
+
 // loop over the frames of the trajectory
 uint framecount = framelist.size();
 double volume = 0.0;
-for (uint index = 0; index<framecount; ++index)
+for (uint index = 0; index<framecount; )
     {
-    traj->readFrame(framelist[index]);
-    // update coordinates and periodic box
-    traj->updateGroupCoords(system);
-
-    double weight = 1.0;
-    if (wopts->has_weights)
+    uint n = 0;
+    for (; n < block.size() && index < framecount; ++n, ++index)
         {
-        weight = wopts->weights();
-        wopts->weights.accumulate();
-        }
+        traj->readFrame(framelist[index]);
+        // update coordinates and periodic box
+        traj->updateGroupCoords(system);
 
+        double weight = 1.0;
+        if (wopts->has_weights)
+            {
+            weight = wopts->weights.frameWeight(framelist[index]);
+            wopts->weights.accumulate(framelist[index]);
+            }
 
-    GCoord box = system.periodicBox();
-    volume += weight*(box.x() * box.y() * box.z());
+        GCoord box = system.periodicBox();
+        volume += weight*(box.x() * box.y() * box.z());
+
+        FrameCenters& frame = block[n];
+        frame.weight = weight;
+        frame.box = box;
+        for (uint j = 0; j < g1_mols.size(); j++)
+            {
+            frame.c1[j] = g1_mols[j].centerOfMass();
+            }
+        for (uint k = 0; k < g2_mols.size(); k++)
+            {
+            frame.c2[k] = g2_mols[k].centerOfMass();
+            }
+        }
 
     // compute the distribution of g2 around g1
-    for (unsigned int j = 0; j < g1_mols.size(); j++)
+    if (nthreads == 1)
+        {
+        PairBinner binner(&block, &group_overlap, &accumulator, 0, n);
+        binner();
+        }
+    else
         {
-        GCoord p1 = g1_mols[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_mols.size(); k++)
+        boost::thread_group threads;
+        for (uint t = 0; t < nthreads; ++t)
             {
-            // skip "self" pairs -- in case selection1 and selection2 overlap
-            if (group_overlap(j, k))
-                {
-                continue;
-                }
-            GCoord p2 = g2_mols[k].centerOfMass();
-
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]+=weight;
-                }
+            threads.create_thread(PairBinner(&block, &group_overlap, &accumulator, t, n));
             }
+        threads.join_all();
         }
     }
 
+WeightedHistogram hist = accumulator.reduce();
+
     if (wopts->has_weights)
         {
         volume /= wopts->weights.totalWeight();
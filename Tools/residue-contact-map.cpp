@@ -62,6 +62,15 @@ string fullHelpMessage(void) {
     "threshold given on the command line.  Alternatively, it can be defined as occuring when\n"
     "the distance between the centers of mass of the two residues is less than or equal\n"
     "to the threshold.\n"
+    "\tFor each frame, residues are only compared atom-by-atom when their bounding\n"
+    "spheres come within the threshold, so large systems are practical.  Frames can be\n"
+    "processed in parallel using --threads (0 uses all available cores).  By default,\n"
+    "distances do not consider periodicity.  Use --periodic to make residues whole and\n"
+    "use the minimum image between them.\n"
+    "\tThe --sparse option writes only the pairs of residues that were ever in contact,\n"
+    "one per line (as residue i, residue j, fraction), rather than the full matrix.  The\n"
+    "--stream option also writes every contact in every frame to a file, one per line\n"
+    "(as frame, residue i, residue j), for further processing.\n"
     "\n"
     "EXAMPLES\n"
     "\n"
@@ -75,6 +84,12 @@ string fullHelpMessage(void) {
     "This example defines a contact when the centers of mass between two residues is less than\n"
     "or equal two 6.5 Angstroms.  Only the first 100 residues are used.\n"
     "\n"
+    "\tresidue-contact-map --selection '!hydrogen' --threads 8 --periodic 1 --sparse 1 \\\n"
+    "\t  --stream contacts.txt model.pdb simulation.dcd 4.0 >contacts.asc\n"
+    "This example uses all heavy atoms, periodic boundaries, and 8 threads, writing the\n"
+    "non-zero contact fractions to contacts.asc and the contacts in each frame to\n"
+    "contacts.txt.\n"
+    "\n"
     "SEE ALSO\n"
     "\trmsds\n";
 
@@ -86,67 +101,56 @@ string fullHelpMessage(void) {
 class ToolOptions : public opts::OptionsPackage {
 public:
   ToolOptions() :
-    use_centers(false)
+    use_centers(false),
+    periodic(false),
+    sparse(false),
+    nthreads(1)
   { }
 
   void addGeneric(po::options_description& o) {
     o.add_options()
-      ("centers", po::value<bool>(&use_centers)->default_value(false), "Use center of mass of residues for distance");
+      ("centers", po::value<bool>(&use_centers)->default_value(false), "Use center of mass of residues for distance")
+      ("periodic", po::value<bool>(&periodic)->default_value(false), "Use periodic boundaries")
+      ("sparse", po::value<bool>(&sparse)->default_value(false), "Write only the pairs in contact (i, j, fraction)")
+      ("stream", po::value<string>(&stream_name), "Write the contacts in each frame to this file")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   string print() const {
     ostringstream oss;
 
-    oss << "centers=" << use_centers;
+    oss << boost::format("centers=%d,periodic=%d,sparse=%d,stream='%s',threads=%d")
+      % use_centers
+      % periodic
+      % sparse
+      % stream_name
+      % nthreads;
     return(oss.str());
   }
 
   bool use_centers;
+  bool periodic;
+  bool sparse;
+  string stream_name;
+  uint nthreads;
 };
-// @endcond
 
 
+// Writes each frame's contacts as they are found
 
+struct ContactStream {
+  ContactStream(ostream& o) : os(o) { }
 
-void accumulateFrameUsingCenters(DoubleMatrix& M, const vGroup& residues, const double threshold) {
-  
-  for (uint j=1; j<residues.size(); ++j) {
-    GCoord v(residues[j].centerOfMass());
-
-    for (uint i=0; i<j; ++i)
-      if (v.distance2(residues[i].centerOfMass()) <= threshold) {
-        M(j, i) += 1;
-        M(i, j) += 1;
-      }
+  void operator()(const uint frame, const ResidueContactMap::Contacts& contacts) {
+    for (ResidueContactMap::Contacts::const_iterator i = contacts.begin(); i != contacts.end(); ++i)
+      os << frame << '\t' << i->first << '\t' << i->second << '\n';
   }
 
-  for (uint i=0; i<residues.size(); ++i)
-    M(i, i) += 1;
-}
-
+  ostream& os;
+};
+// @endcond
 
-void accumulateFrameUsingAllAtoms(DoubleMatrix& M, const vGroup& residues, const double threshold) {
-  
-  for (uint j=1; j<residues.size(); ++j) {
-    
-    for (uint i=0; i<j; ++i) {
-      bool flag = true;
-      for (AtomicGroup::const_iterator a = residues[j].begin(); a != residues[j].end() && flag; ++a)
-        for (AtomicGroup::const_iterator b = residues[i].begin(); b != residues[i].end(); ++b)
-          if ((*a)->coords().distance2((*b)->coords()) <= threshold) {
-            flag = false;
-            break;
-          }
-      if (!flag) {
-        M(j, i) += 1;
-        M(i, j) += 1;
-      }
-    }
-  }
 
-  for (uint i=0; i<residues.size(); ++i)
-    M(i, i) += 1;
-}
 
 
 
@@ -169,23 +173,33 @@ int main(int argc, char *argv[]) {
   vector<uint> indices = tropts->frameList();
 
   double thresh = parseStringAs<double>(ropts->value("threshold"));
-  thresh *= thresh;
 
   AtomicGroup subset = selectAtoms(model, sopts->selection);
   vGroup residues = subset.splitByResidue();
 
-  DoubleMatrix M(residues.size(), residues.size());
-  for (vector<uint>::iterator i = indices.begin(); i != indices.end(); ++i) {
-    traj->readFrame(*i);
-    traj->updateGroupCoords(model);
-    if (topts->use_centers)
-      accumulateFrameUsingCenters(M, residues, thresh);
-    else
-      accumulateFrameUsingAllAtoms(M, residues, thresh);
-  }
+  ResidueContactMap contacts(residues, thresh, topts->use_centers, topts->periodic);
+  contacts.threads(topts->nthreads);
 
-  for (ulong i=0; i<residues.size() * residues.size(); ++i)
-    M[i] /= indices.size();
+  if (topts->stream_name.empty())
+    contacts.accumulate(model, traj, indices);
+  else {
+    ofstream ofs(topts->stream_name.c_str());
+    if (!ofs) {
+      cerr << "Error- cannot open " << topts->stream_name << " for writing\n";
+      exit(-1);
+    }
+    ofs << "# " << hdr << endl;
+    ofs << "# frame\tresidue-i\tresidue-j\n";
+    ContactStream stream(ofs);
+    contacts.accumulate(model, traj, indices, stream);
+  }
 
-  writeAsciiMatrix(cout, M, hdr);
+  if (topts->sparse) {
+    cout << "# " << hdr << endl;
+    cout << "# residue-i\tresidue-j\tfraction\n";
+    vector<ResidueContactMap::ContactCount> counts = contacts.counts();
+    for (vector<ResidueContactMap::ContactCount>::const_iterator i = counts.begin(); i != counts.end(); ++i)
+      cout << i->first.first << '\t' << i->first.second << '\t' << static_cast<double>(i->second) / contacts.frames() << endl;
+  } else
+    writeAsciiMatrix(cout, contacts.fractions(), hdr);
 }
@@ -85,6 +85,20 @@ string fullHelpMessage(void) {
     "selected and in the sequence of atoms (i.e. the first atom in the --align selection is\n"
     "matched with the first atom in the --talign selection.)\n"
     "\n"
+    "MULTIPLE REFERENCES\n"
+    "\tGiving one or more --reference options computes the RMSD between every frame and\n"
+    "each reference structure in a single pass through the trajectory.  Each frame is\n"
+    "superimposed onto each reference using the --rmsd atoms (--trmsd for the references),\n"
+    "so --align and --talign are not used.  The output has one row per frame and one column\n"
+    "per reference, in the order given.  With --binary, the matrix is written to a binary\n"
+    "matrix file as it is computed instead of as text to stdout.  The --threads option sets\n"
+    "how many threads are used (0 uses all available).\n"
+    "\n"
+    "\trmsd2ref --rmsd 'name == \"CA\"' --reference closed.pdb --reference open.pdb \\\n"
+    "\t  --threads 4 --binary rmsds.bin model.pdb simulation.dcd\n"
+    "Writes a two-column binary matrix with the CA RMSD of each frame to the closed and\n"
+    "open structures.\n"
+    "\n"
     "SEE ALSO\n"
     "\trmsds\n";
 
@@ -101,19 +115,25 @@ public:
       ("target", po::value<string>(&target_name), "Compute RMSD against this reference target (must have coordinates)")
       ("talign", po::value<string>(&target_align)->default_value(""), "Selection for target to use to align (default is to use --align)")
       ("trmsd", po::value<string>(&target_selection)->default_value(""), "Compute the RMSD over this selection for the target (default is to use --rmsd)")
-      ("tolerance", po::value<double>(&tol)->default_value(1e-6), "Tolerance to use for iterative alignment");
+      ("tolerance", po::value<double>(&tol)->default_value(1e-6), "Tolerance to use for iterative alignment")
+      ("reference", po::value< vector<string> >(&references), "Compute RMSD against each of these structures (may be repeated)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use with --reference (0=all available)")
+      ("binary", po::value<string>(&binary_name), "Write the --reference RMSDs in binary format to this file");
   }
 
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("align='%s', iterative=%d, target='%s', talign='%s', trmsd='%s', tolerance=%f, rmsd='%s'")
+    oss << boost::format("align='%s', target='%s', talign='%s', trmsd='%s', tolerance=%f, rmsd='%s', reference='%s', threads=%d, binary='%s'")
       % alignment
       % target_name
       % target_align
       % target_selection
       % tol
-      % selection;
+      % selection
+      % vectorAsStringWithCommas(references)
+      % nthreads
+      % binary_name;
 
     return(oss.str());
   }
@@ -121,6 +141,18 @@ public:
 
   bool postConditions(po::variables_map& map) {
 
+    if (!references.empty()) {
+      if (!target_name.empty()) {
+        cerr << "Error- cannot use both --target and --reference\n";
+        return(false);
+      }
+      if (target_selection.empty())
+        target_selection = selection;
+    } else if (!binary_name.empty()) {
+      cerr << "Error- --binary requires --reference\n";
+      return(false);
+    }
+
     if (!target_name.empty()) {
       if (target_align.empty()) {
         target_align = alignment;
@@ -141,6 +173,61 @@ public:
   string target_align, target_selection;
   double tol;
   string selection;
+  vector<string> references;
+  uint nthreads;
+  string binary_name;
+};
+
+
+// Receives the multi-reference RMSDs a block of frames at a time,
+// writing them out and keeping per-reference statistics
+
+class RMSDSink {
+public:
+  RMSDSink(const uint nframes, const uint nrefs, const string& binary_name, const string& header)
+    : _nrefs(nrefs), _row(0), _sum(nrefs, 0.0), _sumsq(nrefs, 0.0), _buf(nrefs)
+  {
+    if (!binary_name.empty())
+      _writer = boost::shared_ptr< BinaryMatrixWriter<float, Math::RowMajor> >(new BinaryMatrixWriter<float, Math::RowMajor>(binary_name, nframes, nrefs, header));
+  }
+
+  void operator()(const double* rows, const uint n) {
+    for (uint i=0; i<n; ++i, ++_row) {
+      const double* r = rows + static_cast<ulong>(i) * _nrefs;
+      for (uint k=0; k<_nrefs; ++k) {
+        _sum[k] += r[k];
+        _sumsq[k] += r[k] * r[k];
+      }
+
+      if (_writer) {
+        std::copy(r, r + _nrefs, _buf.begin());
+        _writer->write(&(_buf[0]), _nrefs);
+      } else {
+        cout << _row;
+        for (uint k=0; k<_nrefs; ++k)
+          cout << "\t" << r[k];
+        cout << '\n';
+      }
+    }
+  }
+
+  void close() {
+    if (_writer)
+      _writer->close();
+  }
+
+  uint rows() const { return(_row); }
+  double average(const uint k) const { return(_sum[k] / _row); }
+  double stddev(const uint k) const {
+    double avg = average(k);
+    return(_row > 1 ? sqrt((_sumsq[k] - _row * avg * avg) / (_row - 1)) : 0.0);
+  }
+
+private:
+  uint _nrefs, _row;
+  vector<double> _sum, _sumsq;
+  vector<float> _buf;
+  boost::shared_ptr< BinaryMatrixWriter<float, Math::RowMajor> > _writer;
 };
 
 
@@ -148,6 +235,33 @@ public:
 
 
 
+void multiReference(const string& hdr, ToolOptions* topts, AtomicGroup& subset, pTraj& ptraj, const vector<uint>& indices) {
+  vector<AtomicGroup> references;
+  for (uint i=0; i<topts->references.size(); ++i) {
+    AtomicGroup ref = createSystem(topts->references[i]);
+    AtomicGroup ref_subset = selectAtoms(ref, topts->target_selection);
+    if (ref_subset.size() != subset.size()) {
+      cerr << boost::format("Error- reference %s selection has %u atoms while trajectory selection has %u.\n") % topts->references[i] % ref_subset.size() % subset.size();
+      exit(-1);
+    }
+    references.push_back(ref_subset);
+  }
+
+  cerr << boost::format("Computing RMSD vs %d references using %d atoms from \"%s\".\n") % references.size() % subset.size() % topts->selection;
+
+  MultiReferenceRMSD engine(references);
+  engine.threads(topts->nthreads);
+  ptraj->setSelectionHint(subset);
+
+  RMSDSink sink(indices.size(), references.size(), topts->binary_name, hdr);
+  engine.stream(subset, ptraj, indices, sink);
+  sink.close();
+
+  for (uint k=0; k<references.size(); ++k)
+    cerr << boost::format("Reference %s: average RMSD was %.3lf, std RMSD was %.3lf\n") % topts->references[k] % sink.average(k) % sink.stddev(k);
+}
+
+
 
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
@@ -161,13 +275,19 @@ int main(int argc, char *argv[]) {
   if (!options.parse(argc, argv))
     exit(-1);
 
-  cout << "# " << hdr << endl;
+  if (topts->binary_name.empty())
+    cout << "# " << hdr << endl;
 
   AtomicGroup molecule = tropts->model;
   pTraj ptraj = tropts->trajectory;
   AtomicGroup subset = selectAtoms(molecule, topts->selection);
   vector<uint> indices = tropts->frameList();
 
+  if (!topts->references.empty()) {
+    multiReference(hdr, topts, subset, ptraj, indices);
+    return(0);
+  }
+
   AtomicGroup target;
   AtomicGroup target_subset;
 
@@ -113,6 +113,10 @@ string fullHelpMessage(void) {
     "This example compares two trajectories, active and inactive, and uses different selections\n"
     "for both: the first 50 residues from the inactive and residues 20-69 from the active.\n"
     "\n"
+    "\trmsds --binary=rmsd.bin model.pdb simulation.dcd\n"
+    "This example writes the matrix in binary format, which is much faster to write and read\n"
+    "for large trajectories.  Tools that read matrices accept either format.\n"
+    "\n"
     "NOTES\n"
     "\tWhen using two trajectories, the selections must match both in number of atoms selected\n"
     "and in the sequence of atoms (i.e. the first atom in the --sel2 selection is\n" 
@@ -142,7 +146,8 @@ public:
       ("skip2", po::value<uint>(&skip2)->default_value(0), "Skip n-frames of second trajectory")
       ("range2", po::value<string>(&range2), "Matlab-style range of frames to use from second trajectory")
       ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix")
-      ("precision,p", po::value<uint>(&matrix_precision)->default_value(2), "Write out matrix coefficients with this many digits.");
+      ("precision,p", po::value<uint>(&matrix_precision)->default_value(2), "Write out matrix coefficients with this many digits.")
+      ("binary", po::value<string>(&binary_name), "Write the matrix in binary format to this file (instead of ASCII to stdout)");
   }
 
   void addHidden(po::options_description& o) {
@@ -173,12 +178,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("stats=%d,matrix_precision=%d,noout=%d,nthreads=%d,sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
+    oss << boost::format("stats=%d,matrix_precision=%d,noout=%d,nthreads=%d,binary='%s',sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
       % stats
       % matrix_precision
       % noop
       % nthreads
-      % matrix_precision
+      % binary_name
       % sel1
       % skip1
       % range1
@@ -200,6 +205,7 @@ public:
   uint nthreads;
   uint matrix_precision;
   string range1, range2;
+  string binary_name;
   string model1, traj1, model2, traj2;
   string sel1, sel2;
 };
@@ -563,8 +569,12 @@ int main(int argc, char *argv[]) {
   }
 
   if (!topts->noop) {
-    cout << "# " << header << endl;
-    cout << setprecision(topts->matrix_precision) << M;
+    if (!topts->binary_name.empty())
+      writeBinaryMatrix(topts->binary_name, M, header);
+    else {
+      cout << "# " << header << endl;
+      cout << setprecision(topts->matrix_precision) << M;
+    }
   }
 
 }
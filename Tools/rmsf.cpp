@@ -90,6 +90,7 @@ int main(int argc, char *argv[]) {
   pTraj traj = tropts->trajectory;
 
   AtomicGroup subset = selectAtoms(model, sopts->selection);
+  traj->setSelectionHint(subset);
   vector<uint> indices = tropts->frameList();
 
 
@@ -41,7 +41,11 @@
 #include <loos.hpp>
 #include <boost/regex.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <sstream>
+#include <map>
 
 #include <cstdlib>
 
@@ -88,6 +92,9 @@ string center_selection;
 bool center_flag = false;
 string post_center_selection;
 
+uint nthreads = 1;               // Frame-parallel processing
+uint chunk_size = 32;            // Frames handed to a thread at a time
+
 
 
 // Code required for parsing trajectory filenames...
@@ -300,6 +307,14 @@ string fullHelpMessage(void) {
     "example above, to match the second set of digits, use a regular\n"
     "expression like \"run_\\d+_(\\d+).dcd\".\n"
     "\n"
+    "\t* threads *\n"
+    "\tWith --threads greater than 1, frames after the first are split into\n"
+    "chunks (see --chunk) that are read, centered, and reimaged in parallel.\n"
+    "Each thread opens its own copy of the input trajectories.  When writing\n"
+    "XTC, each chunk is also compressed by its thread and then appended to the\n"
+    "output in order.  Other formats are written by the main thread, in\n"
+    "order.  The output is the same as with a single thread.\n"
+    "\n"
     "SEE ALSO\n"
     "\tmerge-traj, reimage-by-molecule, recenter-trj\n"
     "\n";
@@ -326,7 +341,9 @@ public:
       ("postcenter,P", po::value<string>(&post_center_selection)->default_value(""), "Recenter using this selection after reimaging")
       ("sort", po::value<bool>(&sort_flag)->default_value(false), "Sort (numerically) the input DCD files.")
       ("scanf", po::value<string>(&scanf_spec)->default_value(""), "Sort using a scanf-style format string")
-      ("regex", po::value<string>(&regex_spec)->default_value("(\\d+)\\D*$"), "Sort using a regular expression");
+      ("regex", po::value<string>(&regex_spec)->default_value("(\\d+)\\D*$"), "Sort using a regular expression")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
+      ("chunk", po::value<uint>(&chunk_size)->default_value(32), "Number of frames each thread processes at a time");
   }
 
   void addHidden(po::options_description& o) {
@@ -371,6 +388,13 @@ public:
     center_flag = !center_selection.empty();
 
 
+    if (nthreads == 0)
+      nthreads = boost::thread::hardware_concurrency();
+    if (chunk_size == 0) {
+      cerr << "Error- chunk size must be greater than 0\n";
+      return(false);
+    }
+
     if (boost::iequals(reimage, "none"))
       reimage_mode = NONE;
     else if (boost::iequals(reimage, "normal"))
@@ -401,7 +425,7 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("updates=%d, stride=%s, skip=%d, range='%s', box='%s', reimage='%s', center='%s', sort=%d, postcenter='%s'")
+    oss << boost::format("updates=%d, stride=%s, skip=%d, range='%s', box='%s', reimage='%s', center='%s', sort=%d, postcenter='%s', threads=%d, chunk=%d")
       % verbose_updates
       % stride
       % skip
@@ -410,7 +434,9 @@ public:
       % reimage
       % center_selection
       % sort_flag
-      % post_center_selection;
+      % post_center_selection
+      % nthreads
+      % chunk_size;
     if (sort_flag) {
       if (!scanf_spec.empty())
         oss << boost::format("scanf='%s'") % scanf_spec;
@@ -476,109 +502,35 @@ void showTrajectoryTable(MultiTrajectory& traj) {
 }
 
 
-// @endcond
-
-
-
-int main(int argc, char *argv[]) {
-  string hdr = invocationHeader(argc, argv);
-
-  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
-  opts::BasicSelection* sopts = new opts::BasicSelection("all");
-  opts::OutputTrajectoryTypeOptions* otopts = new opts::OutputTrajectoryTypeOptions();
-  ToolOptions* topts = new ToolOptions;
-
-  opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(otopts).add(topts);
-  if (!options.parse(argc, argv)) {
-    cerr << "Note- available model file formats (filename suffix) are:\n";
-    cerr << availableSystemFileTypes("\t");
-    cerr << "Note- available trajectory file formats (filename suffix) are:\n";
-    cerr << availableTrajectoryFileTypes("\t");
-    exit(-1);
-  }
-
-
-  verbose = bopts->verbosity;
-  if (verbose)
-    cout << "# " << hdr << endl;
-
-  AtomicGroup model = createSystem(model_name);
-  selection = sopts->selection;
-  AtomicGroup subset = selectAtoms(model, selection);
-  if (subset.empty()) {
-    cerr << "Error- no atoms selected in subset\n";
-    exit(-10);
-  }
-
-  AtomicGroup centered;
-  if (!center_selection.empty()) {
-    centered = selectAtoms(subset, center_selection);
-    if (centered.empty()) {
-      cerr << "Error- no atoms selected for centering\n";
-      exit(-10);
-    }
-  }
-
-  AtomicGroup postcentered;
-  if (!post_center_selection.empty()) {
-    postcentered = selectAtoms(subset, post_center_selection);
-    if (postcentered.empty()) {
-      cerr << "Error- no atoms selected for post-centering\n";
-      exit(-10);
-    }
-  }
-
-  MultiTrajectory mtraj(traj_names, model, skip, stride);
-  if (verbose)
-    showTrajectoryTable(mtraj);
-
-  // Wrap since some LOOS tools will expect a pTraj rather than a traj...
-  pTraj ptraj(&mtraj, boost::lambda::_1);
-
-  indices = assignTrajectoryFrames(ptraj, topts->range_spec, 0, 1);
 
-  pTrajectoryWriter trajout = otopts->createTrajectory(out_name);
-  if (trajout->hasComments())
-    trajout->setComments(hdr);
+// Transforms the model for the current frame (box override,
+// centering, and reimaging).  Each thread has its own model, and
+// so its own processor...
 
-  bool first = true;  // Flag to pick off the first frame for a
-                      // reference structure
+struct FrameProcessor {
+  FrameProcessor(AtomicGroup& m, const bool quiet = false) : model(m), iters(0), delta(0.0), warned(quiet) {
+    subset = selectAtoms(model, selection);
+    if (center_flag)
+      centered = selectAtoms(subset, center_selection);
+    if (!post_center_selection.empty())
+      postcentered = selectAtoms(subset, post_center_selection);
 
-  // If reimaging, break out the subsets to iterate over...
-  vector<AtomicGroup> molecules;
-  if (reimage_mode != NONE ) {
-    if (!model.hasBonds()) {
-      cerr << "WARNING- the model has no connectivity.  Assigning bonds based on distance.\n";
-      model.findBonds();
+    if (reimage_mode != NONE) {
+      if (model.hasBonds())
+        molecules = model.splitByMolecule();
+      else
+        molecules = model.splitByUniqueSegid();
     }
-
-    if (model.hasBonds())
-      molecules = model.splitByMolecule();
-    else
-      molecules = model.splitByUniqueSegid();
-
-    if (verbose)
-      cout << boost::format("Reimaging %d molecules\n") % molecules.size();
   }
 
-  // Setup for progress output...
-  PercentProgressWithTime watcher;
-  ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.25), EstimatingCounter(indices.size()));
-  slayer.attach(&watcher);
-  if (verbose)
-    slayer.start();
-
-  // Iterate over all requested global-frames...
-  for (vector<uint>::const_iterator vi = indices.begin(); vi != indices.end(); ++vi) {
 
-    mtraj.readFrame(*vi);
-    mtraj.updateGroupCoords(model);
+  void operator()() {
 
     // Handle Periodic boundary conditions...
     if (box_override) {
-      if (first && subset.isPeriodic())
+      if (!warned && subset.isPeriodic())
         cerr << "WARNING - overriding existing periodic box.\n";
+      warned = true;
       model.periodicBox(box);
     }
 
@@ -633,10 +585,10 @@ int main(int argc, char *argv[]) {
             mol->reimage();
         }
 
-        extreme_delta += (last_c.distance(centered.centroid()));
+        delta += (last_c.distance(centered.centroid()));
         GCoord c = centered.centroid();
         model.translate(-c);
-        extreme_iters += si;
+        iters += si;
 
       } else if (reimage_mode == NORMAL){
         for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
@@ -652,12 +604,321 @@ int main(int argc, char *argv[]) {
       }
 
     }
+  }
+
+
+  AtomicGroup model;
+  AtomicGroup subset, centered, postcentered;
+  vGroup molecules;
+
+  ulong iters;           // Stats for extreme reimaging
+  double delta;
+  bool warned;
+};
+
+
+
+// A run of consecutive output frames.  XTC output is encoded by the
+// worker, otherwise the subset coordinates are kept for the main
+// thread to write...
+
+struct Chunk {
+  Chunk() : count(0) { }
+
+  uint count;
+  string encoded;
+  vector<GCoord> crds;
+  vector<GCoord> boxes;
+  vector<bool> periodic;
+};
+
+
+
+// Hands out chunks to the workers and collects the finished ones.
+// Workers wait when too many chunks are waiting to be written, so
+// memory use stays bounded...
+
+struct ChunkQueue {
+  ChunkQueue(const uint first, const uint n, const uint inflight)
+    : next(0), written(0), nchunks(n), max_inflight(inflight), first_frame(first), first_step(0),
+      iters(0), delta(0.0), failed(false)
+  { }
+
+  boost::mutex mtx;
+  boost::condition_variable cond;
+
+  uint next, written, nchunks, max_inflight;
+  uint first_frame;                  // Position in indices of chunk 0
+  uint first_step;                   // XTC step for chunk 0
+  map<uint, Chunk*> done;
+
+  ulong iters;
+  double delta;
+
+  bool failed;
+  string error;
+};
+
+
+
+struct ChunkWorker {
+  ChunkWorker(ChunkQueue* q, const AtomicGroup& m, const XTCWriter* x)
+    : queue(q), model(m.copy()), xtc(x), dt(1.0), steps_per_frame(1)
+  {
+    if (xtc) {
+      dt = xtc->timePerStep();
+      steps_per_frame = xtc->stepsPerFrame();
+    }
+  }
+
+  void operator()() {
+    try {
+      FrameProcessor processor(model, true);
+      MultiTrajectory mtraj(traj_names, model, skip, stride);
+
+      while (true) {
+        uint c;
+        {
+          boost::unique_lock<boost::mutex> lock(queue->mtx);
+          while (!queue->failed && queue->next < queue->nchunks && queue->next >= queue->written + queue->max_inflight)
+            queue->cond.wait(lock);
+          if (queue->failed || queue->next >= queue->nchunks)
+            break;
+          c = queue->next++;
+        }
+
+        uint start = queue->first_frame + c * chunk_size;
+        uint end = min(static_cast<uint>(indices.size()), start + chunk_size);
 
-    trajout->writeFrame(subset);
+        Chunk* chunk = new Chunk;
+        chunk->count = end - start;
+        stringstream ss;
+        boost::shared_ptr<XTCWriter> encoder;
+        if (xtc) {
+          encoder = boost::shared_ptr<XTCWriter>(new XTCWriter(ss, dt, steps_per_frame));
+          encoder->currentStep(queue->first_step + (start - queue->first_frame) * steps_per_frame);
+        }
+
+        for (uint i=start; i<end; ++i) {
+          mtraj.readFrame(indices[i]);
+          mtraj.updateGroupCoords(model);
+          processor();
+
+          if (encoder)
+            encoder->writeFrame(processor.subset);
+          else {
+            for (AtomicGroup::const_iterator j = processor.subset.begin(); j != processor.subset.end(); ++j)
+              chunk->crds.push_back((*j)->coords());
+            chunk->periodic.push_back(processor.subset.isPeriodic());
+            chunk->boxes.push_back(processor.subset.periodicBox());
+          }
+        }
+        if (encoder)
+          chunk->encoded = ss.str();
+
+        boost::lock_guard<boost::mutex> lock(queue->mtx);
+        queue->done[c] = chunk;
+        queue->cond.notify_all();
+      }
+
+      boost::lock_guard<boost::mutex> lock(queue->mtx);
+      queue->iters += processor.iters;
+      queue->delta += processor.delta;
+    }
+    catch (exception& e) {
+      boost::lock_guard<boost::mutex> lock(queue->mtx);
+      queue->failed = true;
+      queue->error = e.what();
+      queue->cond.notify_all();
+    }
+  }
+
+  ChunkQueue* queue;
+  AtomicGroup model;
+  const XTCWriter* xtc;      // Only used to tell if the output is XTC
+  double dt;
+  uint steps_per_frame;
+};
+
+
+
+// Processes the frames from indices[first] on with nthreads workers,
+// writing the chunks in order as they finish...
+
+template<class Progress>
+void processInParallel(const AtomicGroup& model, const AtomicGroup& subset, pTrajectoryWriter& trajout, const uint first, Progress& progress) {
+  uint nchunks = (indices.size() - first + chunk_size - 1) / chunk_size;
+  ChunkQueue queue(first, nchunks, 2 * nthreads);
+
+  XTCWriter* xtc = dynamic_cast<XTCWriter*>(trajout.get());
+  if (xtc)
+    queue.first_step = xtc->currentStep();
+  AtomicGroup outgroup = subset.copy();
+
+  boost::thread_group threads;
+  for (uint i=0; i<nthreads; ++i)
+    threads.create_thread(ChunkWorker(&queue, model, xtc));
+
+  // If writing fails, the workers must still be stopped and joined
+  // before the queue goes away
+  Chunk* chunk = 0;
+  try {
+    for (uint c=0; c<nchunks; ++c) {
+      {
+        boost::unique_lock<boost::mutex> lock(queue.mtx);
+        while (!queue.failed && queue.done.find(c) == queue.done.end())
+          queue.cond.wait(lock);
+        if (queue.failed)
+          break;
+        chunk = queue.done[c];
+        queue.done.erase(c);
+      }
+
+      if (xtc)
+        xtc->writeEncodedFrames(chunk->encoded, chunk->count);
+      else {
+        uint n = outgroup.size();
+        for (uint i=0; i<chunk->count; ++i) {
+          for (uint j=0; j<n; ++j)
+            outgroup[j]->coords(chunk->crds[i*n + j]);
+          if (chunk->periodic[i])
+            outgroup.periodicBox(chunk->boxes[i]);
+          else
+            outgroup.removePeriodicBox();
+          trajout->writeFrame(outgroup);
+        }
+      }
+
+      if (verbose)
+        for (uint i=0; i<chunk->count; ++i)
+          progress.update();
+      delete chunk;
+      chunk = 0;
+
+      boost::lock_guard<boost::mutex> lock(queue.mtx);
+      ++queue.written;
+      queue.cond.notify_all();
+    }
+  }
+  catch (exception& e) {
+    delete chunk;
+    boost::lock_guard<boost::mutex> lock(queue.mtx);
+    queue.failed = true;
+    queue.error = e.what();
+    queue.cond.notify_all();
+  }
+
+  threads.join_all();
+  for (map<uint, Chunk*>::iterator i = queue.done.begin(); i != queue.done.end(); ++i)
+    delete i->second;
+
+  if (queue.failed) {
+    cerr << "Error- " << queue.error << endl;
+    exit(-10);
+  }
+
+  extreme_iters += queue.iters;
+  extreme_delta += queue.delta;
+}
+
+
+
+// @endcond
+
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
+  opts::BasicSelection* sopts = new opts::BasicSelection("all");
+  opts::OutputTrajectoryTypeOptions* otopts = new opts::OutputTrajectoryTypeOptions();
+  ToolOptions* topts = new ToolOptions;
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(sopts).add(otopts).add(topts);
+  if (!options.parse(argc, argv)) {
+    cerr << "Note- available model file formats (filename suffix) are:\n";
+    cerr << availableSystemFileTypes("\t");
+    cerr << "Note- available trajectory file formats (filename suffix) are:\n";
+    cerr << availableTrajectoryFileTypes("\t");
+    exit(-1);
+  }
+
+
+  verbose = bopts->verbosity;
+  if (verbose)
+    cout << "# " << hdr << endl;
+
+  AtomicGroup model = createSystem(model_name);
+  selection = sopts->selection;
+  AtomicGroup subset = selectAtoms(model, selection);
+  if (subset.empty()) {
+    cerr << "Error- no atoms selected in subset\n";
+    exit(-10);
+  }
+
+  if (!center_selection.empty()) {
+    AtomicGroup centered = selectAtoms(subset, center_selection);
+    if (centered.empty()) {
+      cerr << "Error- no atoms selected for centering\n";
+      exit(-10);
+    }
+  }
+
+  if (!post_center_selection.empty()) {
+    AtomicGroup postcentered = selectAtoms(subset, post_center_selection);
+    if (postcentered.empty()) {
+      cerr << "Error- no atoms selected for post-centering\n";
+      exit(-10);
+    }
+  }
+
+  MultiTrajectory mtraj(traj_names, model, skip, stride);
+  if (verbose)
+    showTrajectoryTable(mtraj);
+
+  // Wrap since some LOOS tools will expect a pTraj rather than a traj...
+  pTraj ptraj(&mtraj, boost::lambda::_1);
+
+  indices = assignTrajectoryFrames(ptraj, topts->range_spec, 0, 1);
+
+  pTrajectoryWriter trajout = otopts->createTrajectory(out_name);
+  if (trajout->hasComments())
+    trajout->setComments(hdr);
+
+  // If reimaging, the molecules need connectivity...
+  if (reimage_mode != NONE && !model.hasBonds()) {
+    cerr << "WARNING- the model has no connectivity.  Assigning bonds based on distance.\n";
+    model.findBonds();
+  }
+
+  FrameProcessor processor(model);
+  if (reimage_mode != NONE && verbose)
+    cout << boost::format("Reimaging %d molecules\n") % processor.molecules.size();
+
+  // Setup for progress output...
+  PercentProgressWithTime watcher;
+  ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.25), EstimatingCounter(indices.size()));
+  slayer.attach(&watcher);
+  if (verbose)
+    slayer.start();
+
+  // The first frame is always handled here, since it is also written
+  // out as the reference structure.  With threads, the rest are
+  // handed out in chunks...
+  uint serial_frames = (nthreads > 1) ? min(static_cast<uint>(indices.size()), 1u) : indices.size();
+  for (uint i=0; i<serial_frames; ++i) {
+
+    mtraj.readFrame(indices[i]);
+    mtraj.updateGroupCoords(model);
+    processor();
+
+    trajout->writeFrame(processor.subset);
 
     // Pick off the first frame for the reference structure...
-    if (first) {
-      PDB pdb = PDB::fromAtomicGroup(subset.copy());
+    if (i == 0) {
+      PDB pdb = PDB::fromAtomicGroup(processor.subset.copy());
       pdb.remarks().add(hdr);
 
       if (selection != "all")
@@ -667,16 +928,20 @@ int main(int argc, char *argv[]) {
       ofstream ofs(out_pdb_name.c_str());
       ofs << pdb;
       ofs.close();
-      first = false;
     }
 
     if (verbose)
       slayer.update();
   }
 
+  if (serial_frames < indices.size())
+    processInParallel(model, processor.subset, trajout, serial_frames, slayer);
+
   if (verbose)
     slayer.finish();
 
+  extreme_iters += processor.iters;
+  extreme_delta += processor.delta;
   if (reimage_mode == EXTREME && verbose > 2) {
     double avg = static_cast<double>(extreme_iters) / indices.size();
     cerr << boost::format("Average extreme reimage iters = %f\n") % avg;
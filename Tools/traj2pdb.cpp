@@ -39,6 +39,7 @@
 #include <sstream>
 #include <loos.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace std;
 using namespace loos;
@@ -63,9 +64,13 @@ string fullHelpMessage(void) {
     "\ttraj2pdb model.psf simulation.dcd sim%d.pdb\n"
     "This creates sim0.pdb, sim1.pdb, ..., sim10.pdb, sim11.pdb ...\n"
     "\n"
+    "\ttraj2pdb model.psf simulation.dcd frame%03d.pdb 4\n"
+    "This does the same, formatting the PDBs with 4 threads\n"
+    "\n"
     "NOTES\n"
     "\tThere is no facility for extracting ranges of frames.  Use subsetter to pre-process\n"
     "the trajectory, then use traj2pdb to convert to PDB files.\n"
+    "\tThe optional last argument is the number of threads to use (0 = all available).\n"
     "\n";
 
   return(msg);
@@ -74,37 +79,55 @@ string fullHelpMessage(void) {
 
 
 int main(int argc, char *argv[]) {
-  if (argc != 4) {
-    cerr << "Usage - traj2pdb model trajectory output-name-template\n";
+  if (argc < 4 || argc > 5) {
+    cerr << "Usage - traj2pdb model trajectory output-name-template [nthreads]\n";
     cerr << fullHelpMessage();
+    exit(-1);
   }
 
   AtomicGroup model = createSystem(argv[1]);
   pTraj traj = createTrajectory(argv[2], model);
   string pdb_core = string(argv[3]);
+  uint nthreads = (argc == 5) ? parseStringAs<uint>(argv[4]) : 1;
+  if (nthreads == 0)
+    nthreads = boost::thread::hardware_concurrency();
+  if (nthreads < 1)
+    nthreads = 1;
 
   uint n = traj->nframes();
   PDB pdb = PDB::fromAtomicGroup(model);
   pdb.remarks().add(invocationHeader(argc, argv));
 
+  // Frames are read in blocks, then formatted in parallel and written
+  PDBWriter writer(pdb);
+  vector<PDBWriter::Frame> frames(nthreads > 1 ? 16 * nthreads : 1);
+
   cout << boost::format("There are %d atoms and %d frames.\n") % model.size() % n;
 
   cout << "Processing - ";
   cout.flush();
 
-  for (uint i=0; i<n; ++i) {
-    if (i % 250 == 0) {
-      cout << '.';
-      cout.flush();
+  for (uint i=0; i<n; i += frames.size()) {
+    uint m = min(static_cast<uint>(frames.size()), n - i);
+    frames.resize(m);
+    for (uint j=0; j<m; ++j) {
+      if ((i+j) % 250 == 0) {
+        cout << '.';
+        cout.flush();
+      }
+      traj->readFrame(i+j);
+      traj->updateGroupCoords(model);
+      writer.capture(frames[j]);
     }
-    traj->readFrame(i);
-    traj->updateGroupCoords(model);
 
-    ostringstream s;
-    s << boost::format(pdb_core) % i;
+    writer.format(frames, nthreads);
+
+    for (uint j=0; j<m; ++j) {
+      ostringstream s;
+      s << boost::format(pdb_core) % (i+j);
 
-    ofstream pdbout(s.str().c_str());
-    if (pdbout.fail())
+      ofstream pdbout(s.str().c_str());
+      if (pdbout.fail())
         {
         cerr << "Error writing file " 
              << s.str()
@@ -113,10 +136,10 @@ int main(int argc, char *argv[]) {
         exit(-1);
         }
 
-    pdbout << pdb;
-    pdbout.close();
+      pdbout << frames[j].text;
+      pdbout.close();
+    }
   }
   
   cout << " done\n";
 }
-
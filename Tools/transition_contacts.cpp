@@ -45,7 +45,8 @@ public:
       ("sink-selection", po::value<string>(&sink_sel)->default_value(""), "Selection specific to sink model")
       ("timeseries", po::value<string>(&timeseries)->default_value(""), "Report contacts as a timeseries")
       ("include-heavy", po::value<bool>(&leave_heavy)->default_value(false), "Include backbone and hydrogen atoms")
-      ("smoothed-transition", po::value<bool>(&smoothed_transition)->default_value(true), "Use tanh smoothing of the transition ");
+      ("smoothed-transition", po::value<bool>(&smoothed_transition)->default_value(true), "Use tanh smoothing of the transition ")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   void addHidden(po::options_description& o) {
@@ -91,6 +92,64 @@ public:
   string sink_sel, source_sel;
   string timeseries;
   bool leave_heavy, smoothed_transition;
+  uint nthreads;
+};
+
+
+// Tallies the broken and formed contacts for each frame.  The first
+// nbroken pairs are the broken contacts, followed by the formed ones.
+
+struct TransitionWriter {
+  TransitionWriter(const uint b, const uint f, const double c, const bool s, ofstream* o, const int start)
+    : nbroken(b), nformed(f), cutoff(c), cut2(c*c), smoothed(s), ofs(o), frame(start) { }
+
+  void operator()(const double* d2, const uint) {
+    double number_broken = 0.0;
+    double number_formed = 0.0;
+
+    for (uint i = 0; i < nbroken + nformed; ++i) {
+      bool is_broken = (i < nbroken);
+      double current_dist = sqrt(d2[i]);
+
+      if (smoothed) {
+        double value = 0.5 * tanh(current_dist-cutoff)+0.5;
+        if (is_broken)
+          number_broken += value;
+        else
+          number_formed += value;
+        if (ofs)
+          *ofs << value << '\t';
+      } else if (is_broken) {
+        bool broken = d2[i] > cut2;
+        if (broken)
+          ++number_broken;
+        if (ofs)
+          *ofs << (broken ? '0' : '1') << '\t';
+      } else {
+        bool formed = d2[i] < cut2;
+        if (formed)
+          ++number_formed;
+        if (ofs)
+          *ofs << (formed ? '1' : '0') << '\t';
+      }
+    }
+
+    if (ofs)
+      *ofs << endl;
+
+    // Format and output the data
+    float num_transition = (number_broken + number_formed) / (nbroken + nformed);
+    float percent_broken = number_broken / nbroken;
+    float percent_formed = number_formed / nformed;
+    cout << frame << "\t" << percent_broken << "\t" << percent_formed << "\t" << num_transition << endl;
+    frame++;
+  }
+
+  uint nbroken, nformed;
+  double cutoff, cut2;
+  bool smoothed;
+  ofstream* ofs;
+  int frame;
 };
 
 // @endcond
@@ -135,6 +194,10 @@ string fullHelpMessage(void) {
     "for broken contacts.  Additionally, a list of all changed\n"
     "contacts is output for reference.\n"
     "\n"
+    "Frames are processed in blocks, and the work for each block\n"
+    "may be split across several threads with the \"--threads\"\n"
+    "option (0 uses all available cores).\n"
+    "\n"
     "\n"
     "\n"
     //
@@ -261,13 +324,10 @@ int main (int argc, char *argv[]){
   //######################################################################
   //### Build the master list of unique contacts
   //######################################################################
-  vector<AtomicGroup> reslist;
   vector<pair<uint, uint> > formed_connection_list;
   vector<pair<uint, uint> > broken_connection_list;
 
   for (uint j = 0; j < residues.size()-1; ++j) {
-    uint jk;
-    bool any_connection_flag = false;
     GCoord cj = start_residues[j].centerOfMass();
     for (uint i = j+1; i < residues.size(); ++i) {
       GCoord ci = start_residues[i].centerOfMass();
@@ -280,17 +340,7 @@ int main (int argc, char *argv[]){
         GCoord final_diff = fcj - fci;
         // ...and if broken in ending structure
         if (final_diff.length2() > cut2){
-          // Check if residue[j]'s first connection
-          // (we only want [j] listed once)
-          if (!any_connection_flag){
-            jk = reslist.size();
-            reslist.push_back(residues[j]);
-            any_connection_flag = true;
-          }
-          uint ik = reslist.size();
-          reslist.push_back(residues[i]);
-
-          pair<uint,uint> conn_ptr(jk, ik);
+          pair<uint,uint> conn_ptr(j, i);
           // Add these to the broken pair list
           broken_connection_list.push_back(conn_ptr);
           // Document the residues in the broken list
@@ -306,15 +356,7 @@ int main (int argc, char *argv[]){
         GCoord final_diff = fcj - fci;
         // ...and if formed in ending structure
         if (final_diff.length2() <= cut2){
-          if (!any_connection_flag){
-            jk = reslist.size();
-            reslist.push_back(residues[j]);
-            any_connection_flag = true;
-          }
-          uint ik = reslist.size();
-          reslist.push_back(residues[i]);
-          
-          pair<uint,uint> conn_ptr(jk, ik);
+          pair<uint,uint> conn_ptr(j, i);
           // Add to the formed pair master list
           formed_connection_list.push_back(conn_ptr);
           // Document the residues in the formed list
@@ -344,71 +386,16 @@ int main (int argc, char *argv[]){
   //### Iterate over trajectory frames 
   //### Calc the number of unique contacts broken/formed
   //######################################################################
-  int frame = tropts->skip;
-  while (traj->readFrame()){
-    traj->updateGroupCoords(system);
-    double number_broken = 0.0;
-    double number_formed = 0.0;
-    
-    // Build a GCoord vector of CoM's 
-    // with indices corresponding to reslist
-    vector<GCoord> centers;
-    for (uint gi = 0; gi < reslist.size(); ++gi){
-      GCoord temp_com = reslist[gi].centerOfMass();
-      centers.push_back(temp_com);
-    }
-
-    // Do the actual calculation
-    // For broken list
-    for (uint i = 0; i < broken_connection_list.size(); ++i){
-
-      GCoord first_current  = centers[broken_connection_list[i].first];
-      GCoord second_current = centers[broken_connection_list[i].second]; 
-      bool broken = first_current.distance2(second_current) > cut2;
-      double current_dist = sqrt(first_current.distance2(second_current));
-      
-      if (smoothed_transition){
-        double value = 0.5 * tanh(current_dist-cutoff)+0.5;
-        number_broken += value;
-        if (!timeseries_outfile.empty())
-          ofs << value << '\t';
-      }else{
-        if (broken)
-          ++number_broken;
-        if (!timeseries_outfile.empty())
-          ofs << (broken ? '0' : '1') << '\t';
-      }          
-    }
-
-    // For formed list
-    for (uint i = 0; i < formed_connection_list.size(); ++i){
-      GCoord first_current  = centers[formed_connection_list[i].first];
-      GCoord second_current = centers[formed_connection_list[i].second]; 
-      bool formed = first_current.distance2(second_current) < cut2;
-      double current_dist = sqrt(first_current.distance2(second_current));
-    
-      if (smoothed_transition){
-        double value = 0.5 * tanh(current_dist-cutoff)+0.5;
-        number_formed += value;
-        if (!timeseries_outfile.empty())
-          ofs << value << '\t';
-      }else{
-        if (formed)
-          ++number_formed;
-        if (!timeseries_outfile.empty())
-          ofs << (formed ? '1' : '0') << '\t';
-      }          
-    }
-
-    if (!timeseries_outfile.empty())
-      ofs << endl;
-
-  
-    // Format and output the data
-    float num_transition = (number_broken + number_formed) / (total_broken_contacts + total_formed_contacts);
-    float percent_broken = number_broken / total_broken_contacts;
-    float percent_formed = number_formed / total_formed_contacts;
-    cout << frame << "\t" << percent_broken << "\t" << percent_formed << "\t" << num_transition << endl;
-    frame++;
-  }
+  // The residue centers are computed once per frame, and all of the
+  // changed contacts are evaluated together (broken ones first)
+  ContactFractionEngine engine(residues, cutoff);
+  engine.threads(topts->nthreads);
+  for (uint i = 0; i < broken_connection_list.size(); ++i)
+    engine.addPair(broken_connection_list[i].first, broken_connection_list[i].second);
+  for (uint i = 0; i < formed_connection_list.size(); ++i)
+    engine.addPair(formed_connection_list[i].first, formed_connection_list[i].second);
+
+  TransitionWriter writer(total_broken_contacts, total_formed_contacts, cutoff, smoothed_transition,
+                          timeseries_outfile.empty() ? 0 : &ofs, tropts->skip);
+  engine.process(system, traj, writer);
 }
@@ -51,6 +51,13 @@ import copy
 # traj = loos.pyloos.Trajectory('foo.dcd', model.copy())
 # \endcode
 #
+# Process the subset's coordinates as NumPy arrays, 100 frames at a time
+# \code
+# traj = loos.pyloos.Trajectory('foo.dcd', model, subset='name == "CA"')
+# for block in traj.chunks(100):
+#     print block.mean(axis=1)
+# \endcode
+#
 
 class Trajectory(object):
     """
@@ -182,6 +189,20 @@ class Trajectory(object):
         """Return the current frame (subset)"""
         return(self._subset)
 
+    def chunks(self, size=100):
+        """
+        Iterate over the frames in blocks of up to size frames, returning
+        the subset's coordinates as a numpy array of shape (frames, atoms, 3).
+        The array is a view of a buffer that is overwritten by the next
+        block, so copy it if its contents need to be kept.  (The view
+        itself keeps the buffer alive, so it is always safe to use.)
+        """
+        if self._stale:
+            self._initFrameList()
+        reader = loos.CoordinateChunkReader(self._traj, self._subset, self._framelist, size)
+        while reader.readChunk():
+            yield reader.view()
+
     def realIndex(self):
         """The 'real' frame in the trajectory for this index"""
         if self._stale:
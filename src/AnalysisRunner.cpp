@@ -0,0 +1,232 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <AnalysisRunner.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Shared between the driver and the worker threads.  Each frame,
+    // the driver and all workers meet at the barrier twice: once to
+    // start processing the frame, and once when it is done.
+    struct FrameState {
+      FrameState(const uint nworkers) : start(nworkers + 1), done(nworkers + 1), index(0), finished(false) { }
+
+      boost::barrier start, done;
+      uint index;
+      bool finished;
+    };
+
+
+    struct ModuleWorker {
+      ModuleWorker(FrameState* s, const std::vector<AnalysisModule*>& m, std::string* e)
+        : state(s), modules(m), error(e) { }
+
+      void operator()() {
+        while (true) {
+          state->start.wait();
+          if (state->finished)
+            break;
+
+          // Once a module has failed, the rest of the run is skipped,
+          // but we still have to show up at the barrier...
+          if (error->empty()) {
+            try {
+              for (std::vector<AnalysisModule*>::iterator i = modules.begin(); i != modules.end(); ++i)
+                (*i)->frame(state->index);
+            }
+            catch (std::exception& e) {
+              *error = e.what();
+            }
+          }
+
+          state->done.wait();
+        }
+      }
+
+      FrameState* state;
+      std::vector<AnalysisModule*> modules;
+      std::string* error;
+    };
+
+  }
+
+
+
+  AnalysisRunner::~AnalysisRunner() {
+    for (std::vector<AnalysisModule*>::iterator i = _modules.begin(); i != _modules.end(); ++i)
+      delete *i;
+  }
+
+
+  void AnalysisRunner::addOptions(OptionsFramework::AggregateOptions& options) {
+    for (std::vector<AnalysisModule*>::iterator i = _modules.begin(); i != _modules.end(); ++i) {
+      OptionsFramework::OptionsPackage* p = (*i)->options();
+      if (p)
+        options.add(p);
+    }
+  }
+
+
+  AtomicGroup AnalysisRunner::neededAtoms(AtomicGroup& model) const {
+    std::vector<bool> used(model.size(), false);
+    bool any = false;
+
+    for (std::vector<AnalysisModule*>::const_iterator i = _modules.begin(); i != _modules.end(); ++i) {
+      AtomicGroup g = (*i)->atoms();
+      for (AtomicGroup::const_iterator j = g.begin(); j != g.end(); ++j) {
+        uint idx = (*j)->index();
+        if (idx >= used.size())
+          throw(LOOSError(**j, "Atom used by analysis module is not part of the model"));
+        used[idx] = true;
+        any = true;
+      }
+    }
+
+    if (!any)
+      return(model);
+
+    AtomicGroup needed;
+    needed.periodicBox(model.periodicBox());
+    for (uint i=0; i<model.size(); ++i)
+      if (used[model[i]->index()])
+        needed.append(model[i]);
+
+    return(needed);
+  }
+
+
+
+  namespace {
+
+    // Restores the trajectory's selection hint however run() exits
+    struct SelectionHintGuard {
+      SelectionHintGuard(pTraj& t) : traj(t), saved(t->selectionHint()) { }
+      ~SelectionHintGuard() { traj->setSelectionHint(saved); }
+
+      pTraj& traj;
+      Trajectory::IndexRuns saved;
+    };
+
+  }
+
+
+  void AnalysisRunner::run(AtomicGroup& model, pTraj& traj, const std::vector<uint>& indices) {
+    if (_modules.empty())
+      throw(LOOSError("No analysis modules were registered"));
+
+    for (std::vector<AnalysisModule*>::iterator i = _modules.begin(); i != _modules.end(); ++i)
+      (*i)->setup(model);
+
+    AtomicGroup needed = neededAtoms(model);
+    SelectionHintGuard hint(traj);
+    traj->setSelectionHint(needed);
+
+    // Distribute modules round-robin over the workers
+    uint nworkers = (_nthreads == 0 || _nthreads > _modules.size()) ? _modules.size() : _nthreads;
+    if (_verbosity > 0)
+      std::cerr << "Running " << _modules.size() << " analyses over " << needed.size()
+                << " atoms with " << nworkers << " thread(s)\n";
+
+    FrameState state(nworkers > 1 ? nworkers : 0);
+    std::vector<std::string> errors(nworkers);
+    boost::thread_group threads;
+    if (nworkers > 1) {
+      std::vector< std::vector<AnalysisModule*> > assigned(nworkers);
+      for (uint i=0; i<_modules.size(); ++i)
+        assigned[i % nworkers].push_back(_modules[i]);
+      for (uint i=0; i<nworkers; ++i)
+        threads.create_thread(ModuleWorker(&state, assigned[i], &(errors[i])));
+    }
+
+    std::string failure;
+    uint k = 0;
+    while (true) {
+
+      // Reading can throw too, and with workers running the loop must
+      // still exit through the shutdown below
+      try {
+        if (indices.empty()) {
+          if (!traj->readFrame())
+            break;
+        } else {
+          if (k >= indices.size())
+            break;
+          state.index = indices[k];
+          traj->readFrame(indices[k]);
+        }
+        ++k;
+
+        traj->updateGroupCoords(needed);
+        if (traj->hasPeriodicBox())
+          model.periodicBox(traj->periodicBox());
+      }
+      catch (std::exception& e) {
+        failure = std::string("reading the trajectory: ") + e.what();
+        break;
+      }
+
+      state.index = indices.empty() ? traj->currentFrame() : indices[k-1];
+      if (nworkers > 1) {
+        state.start.wait();
+        state.done.wait();
+        for (uint i=0; i<nworkers && failure.empty(); ++i)
+          failure = errors[i];
+      } else {
+        try {
+          for (std::vector<AnalysisModule*>::iterator i = _modules.begin(); i != _modules.end(); ++i)
+            (*i)->frame(state.index);
+        }
+        catch (std::exception& e) {
+          failure = e.what();
+        }
+      }
+
+      if (!failure.empty())
+        break;
+    }
+
+    if (nworkers > 1) {
+      state.finished = true;
+      state.start.wait();
+      threads.join_all();
+    }
+
+    if (!failure.empty())
+      throw(LOOSError("Analysis failed at frame " + boost::lexical_cast<std::string>(state.index) + ": " + failure));
+
+    for (std::vector<AnalysisModule*>::iterator i = _modules.begin(); i != _modules.end(); ++i)
+      (*i)->finish();
+  }
+
+}
@@ -0,0 +1,145 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_ANALYSISRUNNER_HPP)
+#define LOOS_ANALYSISRUNNER_HPP
+
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <OptionsFramework.hpp>
+
+
+namespace loos {
+
+
+  //! Interface for one analysis driven by an AnalysisRunner
+  /**
+   * A module selects the atoms it needs from the model in setup(),
+   * is handed each frame in turn via frame(), and reduces/writes its
+   * results in finish().  The runner only updates the coordinates of
+   * the atoms that some module asks for (via atoms()), and the
+   * periodic box of the model, so modules should select their atoms
+   * from the model passed to setup() rather than making deep copies.
+   *
+   * When the runner uses multiple threads, frame() for different
+   * modules may be called concurrently, so a module must not modify
+   * the shared atoms (e.g. by aligning them in place).  Copy the
+   * group first if it needs to be transformed.
+   */
+  class AnalysisModule {
+  public:
+    virtual ~AnalysisModule() { }
+
+    //! Name used in log messages
+    virtual std::string name() const =0;
+
+    //! Command-line options for this module (or 0 if there are none)
+    /**
+     * Since several modules share one command-line, option names
+     * should be prefixed with the module name (e.g. --rgyr-selection).
+     * The runner does not own the returned package.
+     */
+    virtual OptionsFramework::OptionsPackage* options() { return(0); }
+
+    //! Called once, after options are parsed and before the first frame
+    virtual void setup(AtomicGroup& model) =0;
+
+    //! Atoms whose coordinates are needed each frame
+    virtual AtomicGroup atoms() const =0;
+
+    //! Process a frame (\a index is the frame number in the trajectory)
+    virtual void frame(const uint index) =0;
+
+    //! Called once after the last frame
+    virtual void finish() { }
+  };
+
+
+
+  //! Reads a trajectory once and fans each frame out to many analyses
+  /**
+   * Running several analysis tools back-to-back over a large
+   * trajectory decodes every frame once per tool.  The AnalysisRunner
+   * reads each frame once, updates only the atoms the registered
+   * modules need (passing that set on as a selection hint to the
+   * trajectory), then calls each module.  With more than one thread,
+   * the modules are spread over a pool of worker threads that process
+   * the same frame concurrently.  The trajectory's original selection
+   * hint is restored when run() returns (or throws).
+   *
+   * Example:
+   *\code
+   * AnalysisRunner runner;
+   * runner.add(new RgyrModule).add(new RmsdModule);
+   * ... parse options, including each module's options() ...
+   * runner.threads(2);
+   * runner.run(model, traj, indices);
+   *\endcode
+   */
+  class AnalysisRunner {
+  public:
+    AnalysisRunner() : _nthreads(1), _verbosity(0) { }
+
+    //! Deletes all registered modules
+    ~AnalysisRunner();
+
+    //! Register a module (the runner takes ownership)
+    AnalysisRunner& add(AnalysisModule* module) { _modules.push_back(module); return(*this); }
+
+    uint size() const { return(_modules.size()); }
+    AnalysisModule* module(const uint i) const { return(_modules[i]); }
+
+    //! Adds the options for all registered modules to \a options
+    void addOptions(OptionsFramework::AggregateOptions& options);
+
+    //! Number of threads used to run modules (0 = one per module)
+    void threads(const uint n) { _nthreads = n; }
+    uint threads() const { return(_nthreads); }
+
+    void verbosity(const int v) { _verbosity = v; }
+
+    //! Set up the modules, process the listed frames, then finish
+    /**
+     * If \a indices is empty, the trajectory is read from its current
+     * position to the end.
+     */
+    void run(AtomicGroup& model, pTraj& traj, const std::vector<uint>& indices = std::vector<uint>());
+
+  private:
+    AnalysisRunner(const AnalysisRunner&);
+    AnalysisRunner& operator=(const AnalysisRunner&);
+
+    AtomicGroup neededAtoms(AtomicGroup& model) const;
+
+    std::vector<AnalysisModule*> _modules;
+    uint _nthreads;
+    int _verbosity;
+  };
+
+
+}
+
+#endif
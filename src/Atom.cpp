@@ -50,26 +50,26 @@ namespace loos {
     setPropertyBit(anumbit);
   }
 
-  std::string Atom::name(void) const { return(_name); }
-  void Atom::name(const std::string s) { _name = s; }
+  std::string Atom::name(void) const { return(StringPool::lookup(_name)); }
+  void Atom::name(const std::string s) { _name = StringPool::intern(s); }
 
-  std::string Atom::altLoc(void) const { return(_altloc); }
-  void Atom::altLoc(const std::string s) { _altloc = s; }
+  std::string Atom::altLoc(void) const { return(StringPool::lookup(_altloc)); }
+  void Atom::altLoc(const std::string s) { _altloc = StringPool::intern(s); }
 
-  std::string Atom::chainId(void) const { return(_chainid); }
-  void Atom::chainId(const std::string s) { _chainid = s; }
+  std::string Atom::chainId(void) const { return(StringPool::lookup(_chainid)); }
+  void Atom::chainId(const std::string s) { _chainid = StringPool::intern(s); }
 
-  std::string Atom::resname(void) const { return(_resname); }
-  void Atom::resname(const std::string s) { _resname = s; }
+  std::string Atom::resname(void) const { return(StringPool::lookup(_resname)); }
+  void Atom::resname(const std::string s) { _resname = StringPool::intern(s); }
 
-  std::string Atom::segid(void) const { return(_segid); }
-  void Atom::segid(const std::string s) { _segid = s; }
+  std::string Atom::segid(void) const { return(StringPool::lookup(_segid)); }
+  void Atom::segid(const std::string s) { _segid = StringPool::intern(s); }
 
-  std::string Atom::iCode(void) const { return(_icode); }
-  void Atom::iCode(const std::string s) { _icode = s; }
+  std::string Atom::iCode(void) const { return(StringPool::lookup(_icode)); }
+  void Atom::iCode(const std::string s) { _icode = StringPool::intern(s); }
 
-  std::string Atom::PDBelement(void) const { return(_pdbelement); }
-  void Atom::PDBelement(const std::string s) { _pdbelement = s; }
+  std::string Atom::PDBelement(void) const { return(StringPool::lookup(_pdbelement)); }
+  void Atom::PDBelement(const std::string s) { _pdbelement = StringPool::intern(s); }
 
   const GCoord& Atom::coords(void) const { return(_coords); }
   GCoord& Atom::coords(void) { setPropertyBit(coordsbit); return(_coords); }
@@ -102,8 +102,8 @@ namespace loos {
     //! Recordname imported from the PDB for this Atom
     //! This is mainly for atoms that come from a PDB, i.e. whether or
     //! not they were an ATOM or a HETATM
-  std::string Atom::recordName(void) const { return(_record); }
-  void Atom::recordName(const std::string s) { _record = s; }
+  std::string Atom::recordName(void) const { return(StringPool::lookup(_record)); }
+  void Atom::recordName(const std::string s) { _record = StringPool::intern(s); }
 
     //! Clear all stored bonds
   void Atom::clearBonds(void) { bonds.clear(); clearPropertyBit(bondsbit); }
@@ -114,10 +114,8 @@ namespace loos {
 
     //! Deletes the specified bond.
   void Atom::deleteBond(const int b) {
-    std::vector<int>::iterator i = find(bonds.begin(), bonds.end(), b);
-    if (i == bonds.end())
+    if (!bonds.erase(b))
       throw(LOOSError(*this, "Attempting to delete a non-existent bond"));
-    bonds.erase(i);
     if (bonds.size() == 0)
       clearPropertyBit(bondsbit);
   }
@@ -129,11 +127,11 @@ namespace loos {
   std::vector<int> Atom::getBonds(void) const {
     if (!(mask & bondsbit))
       throw(loos::UnsetProperty("Atom has no connectivity"));
-    return(bonds);
+    return(std::vector<int>(bonds.begin(), bonds.end()));
   }
 
   void Atom::setBonds(const std::vector<int>& list) {
-    bonds = list;
+    bonds.assign(list.empty() ? 0 : &(list[0]), list.empty() ? 0 : &(list[0]) + list.size());
     setPropertyBit(bondsbit);
   }
 
@@ -141,7 +139,7 @@ namespace loos {
 
     //! Checks to see if this atom is bound to another atom
   bool Atom::isBoundTo(const int i) {
-    std::vector<int>::iterator found = find(bonds.begin(), bonds.end(), i);
+    const int* found = std::find(bonds.begin(), bonds.end(), i);
     return(found != bonds.end());
   }
 
@@ -195,13 +193,21 @@ namespace loos {
     _q = 1.0;
     _charge = 0.0;
     _mass = 1.0;
-    _name = "    ";
-    _altloc = " ";
-    _resname = "   ";
-    _chainid = " ";
-    _segid = "    ";
-    _pdbelement = "";
-    _record = "ATOM";
+    // The defaults are interned once, rather than for every atom
+    static const StringPool::Handle blank1 = StringPool::intern(" ");
+    static const StringPool::Handle blank3 = StringPool::intern("   ");
+    static const StringPool::Handle blank4 = StringPool::intern("    ");
+    static const StringPool::Handle empty = StringPool::intern("");
+    static const StringPool::Handle atom = StringPool::intern("ATOM");
+
+    _name = blank4;
+    _altloc = blank1;
+    _resname = blank3;
+    _chainid = blank1;
+    _segid = blank4;
+    _icode = empty;
+    _pdbelement = empty;
+    _record = atom;
     _atom_type = -1;
     mask = nullbit;   // Nullbit means nothing was set...
   }
@@ -212,16 +218,16 @@ namespace loos {
 
 
   std::ostream& operator<<(std::ostream& os, const loos::Atom& a) {
-    os << "<ATOM INDEX='" << a._index << "' ID='" << a._id << "' NAME='" << a._name << "' ";
-    os << "RESID='" << a._resid << "' RESNAME='" << a._resname << "' ";
+    os << "<ATOM INDEX='" << a._index << "' ID='" << a._id << "' NAME='" << a.name() << "' ";
+    os << "RESID='" << a._resid << "' RESNAME='" << a.resname() << "' ";
     os << "COORDS='" << a._coords << "' ";
     os << "VELOCITIES='" << a._velocities << "' ";
-    os << "ALTLOC='" << a._altloc << "' CHAINID='" << a._chainid << "' ICODE='" << a._icode << "' SEGID='" << a._segid << "' ";
+    os << "ALTLOC='" << a.altLoc() << "' CHAINID='" << a.chainId() << "' ICODE='" << a.iCode() << "' SEGID='" << a.segid() << "' ";
     os << "B='" << a._b << "' Q='" << a._q << "' CHARGE='" << a._charge << "' MASS='" << a._mass << "'";
     os << " ATOMICNUMBER='" << a._atomic_number <<"'";
     os << " MASK='" << boost::format("%x") % a.mask << "'";
     if (a.hasBonds() > 0) {
-      std::vector<int>::const_iterator i;
+      const int* i;
       os << ">\n";
       for (i=a.bonds.begin(); i != a.bonds.end(); i++)
         os << "  <BOND>" << *i << "</BOND>\n";
@@ -232,20 +238,22 @@ namespace loos {
   }
 
 
+  // Interned strings are equal exactly when their handles are
+
   bool AtomEquals::operator()(const pAtom& a, const pAtom& b) const {
-    return(a->name() == b->name()
-           && a->id() == b->id()
-           && a->resname() == b->resname()
-           && a->resid() == b->resid()
-           && a->segid() == b->segid());
+    return(a->_name == b->_name
+           && a->_id == b->_id
+           && a->_resname == b->_resname
+           && a->_resid == b->_resid
+           && a->_segid == b->_segid);
   }
 
   bool AtomCoordsEquals::operator()(const pAtom& a, const pAtom& b) const {
-    bool bb = (a->name() == b->name()
-               && a->id() == b->id()
-               && a->resname() == b->resname()
-               && a->resid() == b->resid()
-               && a->segid() == b->segid());
+    bool bb = (a->_name == b->_name
+               && a->_id == b->_id
+               && a->_resname == b->_resname
+               && a->_resid == b->_resid
+               && a->_segid == b->_segid);
     if (!bb)
       return(false);
 
@@ -253,5 +261,46 @@ namespace loos {
     return( d <= threshold );
   }
 
+
+
+  bool Atom::BondList::erase(const int i) {
+    int* p = data();
+    int* found = std::find(p, p + _n, i);
+    if (found == p + _n)
+      return(false);
+    std::copy(found + 1, p + _n, found);
+    --_n;
+    return(true);
+  }
+
+
+  void Atom::BondList::assign(const int* b, const int* e) {
+    uint n = e - b;
+    if (n > _cap)
+      grow(n);
+    std::copy(b, e, data());
+    _n = n;
+  }
+
+
+  void Atom::BondList::grow(const uint n) {
+    int* p = new int[n];
+    std::copy(data(), data() + _n, p);
+    if (_cap > inline_size)
+      delete[] _u.heap;
+    _u.heap = p;
+    _cap = n;
+  }
+
+
+
+  std::vector<pAtom> allocateAtoms(const uint n) {
+    boost::shared_ptr< std::vector<Atom> > block(new std::vector<Atom>(n));
+    std::vector<pAtom> atoms(n);
+    for (uint i=0; i<n; ++i)
+      atoms[i] = pAtom(block, &((*block)[i]));
+    return(atoms);
+  }
+
 }
 
@@ -32,6 +32,7 @@
 #include <loos_defs.hpp>
 #include <exceptions.hpp>
 #include <Coord.hpp>
+#include <StringPool.hpp>
 
 namespace loos {
 
@@ -44,6 +45,11 @@ namespace loos {
    * Most properties are derived from the PDB file specification.
    * Exceptions are noted below.  Accessors for each property are
    * provided and should be self-explanatory...
+   *
+   * To keep large systems small, the string properties are stored as
+   * handles into the StringPool, and up to four bonds are stored
+   * without a separate allocation.  The accessors still take and
+   * return std::strings.
    */
 
   
@@ -91,7 +97,7 @@ namespace loos {
       init();
       _index = 0;
       _id = i;
-      _name = s;
+      _name = StringPool::intern(s);
       _coords = c;
     }
 
@@ -132,6 +138,11 @@ namespace loos {
     std::string PDBelement(void) const;
     void PDBelement(const std::string);
 
+    //! Set string properties from handles already in the StringPool
+    void nameHandle(const StringPool::Handle h) { _name = h; }
+    void resnameHandle(const StringPool::Handle h) { _resname = h; }
+    void segidHandle(const StringPool::Handle h) { _segid = h; }
+
 
 #if !defined(SWIG)
     //! Returns a const ref to internally stored coordinates.
@@ -251,6 +262,8 @@ namespace loos {
 #if !defined(SWIG)
     //! Outputs an atom in pseudo-XML
     friend std::ostream& operator<<(std::ostream&, const Atom&);
+    friend struct AtomEquals;
+    friend struct AtomCoordsEquals;
 #endif
 
   private:
@@ -263,23 +276,82 @@ namespace loos {
     void checkUserBits(const bits bitmask);
 
   private:
+
+    // Holds up to inline_size bonds in place, only allocating for
+    // atoms with more
+    class BondList {
+    public:
+      BondList() : _n(0), _cap(inline_size) { }
+      BondList(const BondList& b) : _n(0), _cap(inline_size) { assign(b.begin(), b.end()); }
+      ~BondList() { if (_cap > inline_size) delete[] _u.heap; }
+
+      BondList& operator=(const BondList& b) {
+        if (this != &b)
+          assign(b.begin(), b.end());
+        return(*this);
+      }
+
+      const int* begin() const { return(data()); }
+      const int* end() const { return(data() + _n); }
+      uint size() const { return(_n); }
+
+      void clear() { _n = 0; }
+
+      void push_back(const int i) {
+        if (_n == _cap)
+          grow(2 * _cap);
+        data()[_n++] = i;
+      }
+
+      //! Removes the first bond to \a i, returning false if there is none
+      bool erase(const int i);
+
+      void assign(const int* b, const int* e);
+
+    private:
+      static const uint inline_size = 4;
+
+      int* data() { return(_cap > inline_size ? _u.heap : _u.local); }
+      const int* data() const { return(_cap > inline_size ? _u.heap : _u.local); }
+      void grow(const uint n);
+
+      union {
+        int local[inline_size];
+        int* heap;
+      } _u;
+      uint _n, _cap;
+    };
+
+
     int _id;
     uint _index;
-    std::string _record, _name, _altloc, _resname, _chainid;
+    StringPool::Handle _record, _name, _altloc, _resname, _chainid;
     int _resid;
     int _atomic_number;
-    std::string _icode;
+    StringPool::Handle _icode;
     double _b, _q, _charge, _mass;
-    std::string _segid, _pdbelement;
+    StringPool::Handle _segid, _pdbelement;
     int _atom_type;
     GCoord _coords;
     GCoord _velocities;
     unsigned long mask;
 
-    std::vector<int> bonds;
+    BondList bonds;
   };
 
 
+#if !defined(SWIG)
+  //! Allocates \a n default atoms in a single block
+  /**
+   * Parsers and deep copies create many atoms at once.  Rather than a
+   * separate allocation (and shared_ptr control block) for each, the
+   * atoms are created together and each pAtom shares ownership of the
+   * whole block, which is freed when the last of its atoms is.
+   */
+  std::vector<pAtom> allocateAtoms(const uint n);
+#endif
+
+
 #if !defined(SWIG)
   //! Compares two atoms based solely on name, id, resid, resname, and segid
   struct AtomEquals : public std::binary_function<pAtom, pAtom, bool> {
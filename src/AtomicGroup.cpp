@@ -36,6 +36,7 @@
 #include <AtomicNumberDeducer.hpp>
 #include <Selectors.hpp>
 #include <Parser.hpp>
+#include <UniqueStrings.hpp>
 
 #include <boost/unordered_map.hpp>
 
@@ -55,13 +56,11 @@ namespace loos {
 
 
   AtomicGroup AtomicGroup::copy(void) const {
-    const_iterator i;
     AtomicGroup res;
 
-    for (i = atoms.begin(); i != atoms.end(); i++) {
-      pAtom pa(new Atom(**i));
-      res.append(pa);
-    }
+    res.atoms = allocateAtoms(atoms.size());
+    for (uint i=0; i<atoms.size(); ++i)
+      *(res.atoms[i]) = *(atoms[i]);
     res._sorted = _sorted;
     res.box = box.copy();
 
@@ -316,53 +315,42 @@ namespace loos {
 
 
   // Split up a group into a vector of groups based on unique segids...
+  // The UniqueStrings index of a segid is the position of its group, so
+  // the groups come out in the order the segids first appear
   std::vector<AtomicGroup> AtomicGroup::splitByUniqueSegid(void) const {
-    const_iterator i;
-    std::list<std::string> segids;
-
-    for (i = atoms.begin(); i != atoms.end(); i++)
-      if (find(segids.begin(), segids.end(), (*i)->segid()) == segids.end())
-        segids.push_front((*i)->segid());
-
-    // Reverse the order so that the chunks are in the same order they appear
-    // in the file...
-    uint n = segids.size();
-    std::vector<AtomicGroup> results(n);
-    uint j = n-1;
-    for (std::list<std::string>::const_iterator i = segids.begin(); i != segids.end(); ++i) {
-      SegidSelector segid(*i);
-      results[j--] = select(segid);
-    }
-
-    std::vector<AtomicGroup>::iterator g;
-    for (g=results.begin(); g!=results.end(); g++) {
-      g->box = box;
+    UniqueStrings segids;
+    std::vector<AtomicGroup> results;
+
+    for (const_iterator i = atoms.begin(); i != atoms.end(); ++i) {
+      uint j = segids.add((*i)->segid());
+      if (j == results.size()) {
+        results.push_back(AtomicGroup());
+        results.back().box = box;
+      }
+      results[j].addAtom(*i);
     }
 
     return(results);
   }
 
   std::map<std::string, AtomicGroup> AtomicGroup::splitByName(void) const {
-    const_iterator i;
-    std::map<std::string, AtomicGroup> groups;
-
-    // Loop over atoms, adding them to groups based on their name, creating the
-    // map entry for each new name as we find it
-    std::map<std::string, AtomicGroup>::iterator g;
-    for (i = atoms.begin(); i != atoms.end(); ++i) {
-        g = groups.find((*i)->name());
-        if (g == groups.end()) { // not found, need to create a new AG
-            AtomicGroup ag;
-            ag.append(*i);
-            ag.box = box; // copy the current groups periodic box
-            groups[(*i)->name()] = ag;
-        }  else {              // found group for that atom name,
-                               // so add the atom to it
-            g->second.append(*i);
-        }
-
+    UniqueStrings names;
+    std::vector<AtomicGroup> parts;
+
+    // Bin the atoms by name in one pass, then build the map once at the end
+    for (const_iterator i = atoms.begin(); i != atoms.end(); ++i) {
+      uint j = names.add((*i)->name());
+      if (j == parts.size()) {
+        parts.push_back(AtomicGroup());
+        parts.back().box = box; // copy the current groups periodic box
+      }
+      parts[j].addAtom(*i);
     }
 
+    std::map<std::string, AtomicGroup> groups;
+    for (uint j=0; j<parts.size(); ++j)
+      groups[names[j]] = parts[j];
+
     return(groups);
   }
 
@@ -754,21 +742,12 @@ namespace loos {
 
 
   int AtomicGroup::numberOfSegids(void) const {
+    UniqueStrings segids;
 
-    if (atoms.size() == 0)
-      return(0);
-
-    const_iterator i;
-    int n = 1;
-    std::string curr_segid = atoms[0]->segid();
+    for (const_iterator i = atoms.begin(); i != atoms.end(); ++i)
+      segids.add((*i)->segid());
 
-    for (i=atoms.begin()+1; i !=atoms.end(); i++)
-      if ((*i)->segid() != curr_segid) {
-        ++n;
-        curr_segid = (*i)->segid();
-      }
-
-    return(n);
+    return(segids.size());
   }
 
 
@@ -381,6 +381,8 @@ namespace loos {
     int minResid(void) const;
     int maxResid(void) const;
     int numberOfResidues(void) const;
+
+    //! Number of distinct segids in the group
     int numberOfSegids(void) const;
 
     //! True if all atoms in the group have the passed property(ies)
@@ -0,0 +1,136 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <CachedTraj.hpp>
+
+namespace loos {
+
+	const ulong CachedTrajectory::default_budget = 256 * megabytes;
+
+
+	CachedTrajectory::CachedTrajectory(const pTraj& traj, const AtomicGroup& subset, const ulong budget)
+		: _traj(traj),
+		  _subset(subset.copy()),   // Deep copy so reading never touches the caller's atoms
+		  _slots(traj->natoms(), -1),
+		  _capacity(1),
+		  _hits(0), _misses(0), _evictions(0)
+	{
+		_filename = _traj->filename();
+
+		for (uint i=0; i<_subset.size(); ++i) {
+			uint idx = _subset[i]->index();
+			if (idx >= _slots.size())
+				throw(LOOSError(*(_subset[i]), "Atom index into the trajectory frame is out of bounds"));
+			_slots[idx] = i;
+		}
+
+		// Only the subset is ever needed from the wrapped trajectory
+		_traj->setSelectionHint(_subset);
+
+		ulong frame_size = sizeof(CachedFrame) + _subset.size() * sizeof(GCoord);
+		if (budget / frame_size > 1)
+			_capacity = budget / frame_size;
+
+		if (_traj->nframes() == 0)
+			throw(LOOSError("Cannot cache an empty trajectory"));
+
+		_current = fetchFrame(0);
+		cached_first = true;
+	}
+
+
+
+	CachedTrajectory::pCachedFrame CachedTrajectory::fetchFrame(const uint i) {
+		FrameMap::iterator mi = _map.find(i);
+		if (mi != _map.end()) {
+			++_hits;
+			_lru.splice(_lru.begin(), _lru, mi->second);
+			return(_lru.front());
+		}
+
+		++_misses;
+		if (!_traj->readFrame(i))
+			throw(FileReadError(_traj->filename(), "Could not read frame for cache"));
+		_traj->updateGroupCoords(_subset);
+
+		pCachedFrame frame(new CachedFrame);
+		frame->index = i;
+		if (_traj->hasPeriodicBox())
+			frame->box = _traj->periodicBox();
+		frame->crds.reserve(_subset.size());
+		for (AtomicGroup::const_iterator ci = _subset.begin(); ci != _subset.end(); ++ci)
+			frame->crds.push_back((*ci)->coords());
+
+		_lru.push_front(frame);
+		_map[i] = _lru.begin();
+
+		while (_lru.size() > _capacity) {
+			_map.erase(_lru.back()->index);
+			_lru.pop_back();
+			++_evictions;
+		}
+
+		return(frame);
+	}
+
+
+	bool CachedTrajectory::parseFrame() {
+		if (atEnd())
+			return(false);
+
+		_current = fetchFrame(_current_frame);
+		return(true);
+	}
+
+
+	void CachedTrajectory::updateGroupCoordsImpl(AtomicGroup& g) {
+		for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+			uint idx = (*i)->index();
+			if (idx >= _slots.size() || _slots[idx] < 0)
+				throw(LOOSError(**i, "Atom is not part of the subset held by the trajectory cache"));
+			(*i)->coords(_current->crds[_slots[idx]]);
+		}
+
+		if (hasPeriodicBox())
+			g.periodicBox(_current->box);
+	}
+
+
+	std::vector<GCoord> CachedTrajectory::coords() const {
+		std::vector<GCoord> crds(_slots.size());
+		for (uint i=0; i<_subset.size(); ++i)
+			crds[_subset[i]->index()] = _current->crds[i];
+		return(crds);
+	}
+
+
+	void CachedTrajectory::clearCache() {
+		_lru.clear();
+		_map.clear();
+		if (_current) {
+			_lru.push_front(_current);
+			_map[_current->index] = _lru.begin();
+		}
+	}
+
+}
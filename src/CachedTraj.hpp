@@ -0,0 +1,151 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_CACHEDTRAJ_HPP)
+#define LOOS_CACHEDTRAJ_HPP
+
+#include <list>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+
+
+namespace loos {
+
+	//! Random-access frame cache wrapped around an existing trajectory
+	/**
+	 * Tools that visit frames out of order (fiducial picking, bootstrapping,
+	 * alignment over a frame list, etc) pay for a seek and a full decode of the
+	 * frame every time readFrame(i) is called.  CachedTrajectory wraps a pTraj
+	 * and keeps the decoded coordinates for a subset of atoms (the atoms the
+	 * tool actually uses) in a least-recently-used cache, bounded by a memory
+	 * budget given in bytes.
+	 *
+	 * Only the atoms in the subset passed at construction are cached, so
+	 * updateGroupCoords() will throw if asked to update an atom that is not
+	 * part of that subset.  coords() returns a vector sized to the
+	 * underlying trajectory, but only the cached atoms will have valid
+	 * coordinates.
+	 *
+	 * Usage:
+	 *\code
+	 * pTraj traj = createTrajectory(trajname, model);
+	 * pTraj cached(new CachedTrajectory(traj, subset, 512 * megabytes));
+	 *\endcode
+	 */
+	class CachedTrajectory : public Trajectory {
+	public:
+
+		//! Wrap \a traj, caching coordinates for the atoms in \a subset
+		CachedTrajectory(const pTraj& traj, const AtomicGroup& subset, const ulong budget = default_budget);
+
+		virtual std::string description() const { return("cached-" + _traj->description()); }
+		virtual std::string filename() const { return(_traj->filename()); }
+
+		virtual uint natoms() const { return(_traj->natoms()); }
+		virtual float timestep() const { return(_traj->timestep()); }
+		virtual uint nframes() const { return(_traj->nframes()); }
+
+		virtual bool hasPeriodicBox() const { return(_traj->hasPeriodicBox()); }
+		//! Periodic box for the most recently read frame
+		virtual GCoord periodicBox() const { return(_current->box); }
+
+		//! Coordinates for the most recently read frame (only cached atoms are valid)
+		virtual std::vector<GCoord> coords() const;
+
+		virtual bool parseFrame();
+
+		//! The wrapped trajectory
+		pTraj trajectory() const { return(_traj); }
+
+		//! Maximum number of frames that will be held in the cache
+		uint capacity() const { return(_capacity); }
+		//! Number of frames currently held in the cache
+		uint cachedFrames() const { return(_lru.size()); }
+
+		//! Number of frame reads satisfied from the cache
+		ulong hits() const { return(_hits); }
+		//! Number of frame reads that had to go to the wrapped trajectory
+		ulong misses() const { return(_misses); }
+		//! Number of frames dropped from the cache to stay within budget
+		ulong evictions() const { return(_evictions); }
+		//! Fraction of reads satisfied from the cache
+		double hitRate() const {
+			ulong n = _hits + _misses;
+			return(n ? static_cast<double>(_hits) / n : 0.0);
+		}
+
+		void resetStatistics() { _hits = _misses = _evictions = 0; }
+
+		//! Drops all cached frames (except the current one)
+		void clearCache();
+
+		static const ulong default_budget;
+
+	private:
+
+		struct CachedFrame {
+			CachedFrame() : index(0) { }
+			uint index;
+			GCoord box;
+			std::vector<GCoord> crds;
+		};
+
+		typedef boost::shared_ptr<CachedFrame>                       pCachedFrame;
+		typedef std::list<pCachedFrame>                              FrameList;
+		typedef boost::unordered_map<uint, FrameList::iterator>     FrameMap;
+
+
+		virtual void rewindImpl() { }
+		virtual void seekNextFrameImpl() { }
+		virtual void seekFrameImpl(const uint i) {
+			if (i >= nframes())
+				throw(FileReadError(_traj->filename(), "Cannot seek past end of cached trajectory"));
+		}
+		virtual void updateGroupCoordsImpl(AtomicGroup& g);
+
+		pCachedFrame fetchFrame(const uint i);
+
+
+		pTraj _traj;
+		AtomicGroup _subset;
+		std::vector<int> _slots;     // Atom index -> position in a CachedFrame
+
+		uint _capacity;
+		FrameList _lru;
+		FrameMap _map;
+		pCachedFrame _current;
+
+		ulong _hits, _misses, _evictions;
+	};
+
+
+}
+
+
+
+#endif // !defined(LOOS_CACHEDTRAJ_HPP)
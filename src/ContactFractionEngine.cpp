@@ -0,0 +1,243 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <ContactFractionEngine.hpp>
+
+#include <cmath>
+#include <boost/thread/thread.hpp>
+
+
+namespace loos {
+
+
+  ContactFractionEngine::ContactFractionEngine(const std::vector<AtomicGroup>& residues, const double cutoff, const bool periodic)
+    : _cutoff(cutoff), _periodic(periodic), _nthreads(1), _nframes(0)
+  {
+    _offsets.push_back(0);
+    for (uint i=0; i<residues.size(); ++i) {
+      if (residues[i].empty())
+        throw(LOOSError("ContactFractionEngine residues cannot be empty"));
+      for (AtomicGroup::const_iterator a = residues[i].begin(); a != residues[i].end(); ++a) {
+        _atoms.push_back(*a);
+        _masses.push_back((*a)->mass());
+      }
+      _offsets.push_back(_atoms.size());
+    }
+    _natoms = _atoms.size();
+  }
+
+
+  uint ContactFractionEngine::addPair(const uint i, const uint j) {
+    if (i >= residues() || j >= residues())
+      throw(LOOSError("Residue index out of range in ContactFractionEngine"));
+
+    _first.push_back(i);
+    _second.push_back(j);
+    _counts.push_back(0);
+    return(_first.size() - 1);
+  }
+
+
+  void ContactFractionEngine::threads(const uint n) {
+    _nthreads = n ? n : boost::thread::hardware_concurrency();
+    if (_nthreads < 1)
+      _nthreads = 1;
+  }
+
+
+  std::vector<ulong> ContactFractionEngine::residueCounts() const {
+    std::vector<ulong> counts(residues(), 0);
+    for (uint p=0; p<pairs(); ++p) {
+      counts[_first[p]] += _counts[p];
+      counts[_second[p]] += _counts[p];
+    }
+    return(counts);
+  }
+
+
+  // Same arithmetic as AtomicGroup::centerOfMass()
+  void ContactFractionEngine::centers(const double* crds, Centers& c) const {
+    uint n = residues();
+    c.x.resize(n);
+    c.y.resize(n);
+    c.z.resize(n);
+
+    for (uint r=0; r<n; ++r) {
+      uint b = _offsets[r], e = _offsets[r+1];
+      const double* p = crds + 3 * b;
+      if (e - b == 1) {
+        c.x[r] = p[0];
+        c.y[r] = p[1];
+        c.z[r] = p[2];
+        continue;
+      }
+
+      double x = 0.0, y = 0.0, z = 0.0, mass = 0.0;
+      for (uint a=b; a<e; ++a, p += 3) {
+        double m = _masses[a];
+        x += m * p[0];
+        y += m * p[1];
+        z += m * p[2];
+        mass += m;
+      }
+      c.x[r] = x / mass;
+      c.y[r] = y / mass;
+      c.z[r] = z / mass;
+    }
+  }
+
+
+  // Minimum image is the same as GCoord::reimage()
+  uint ContactFractionEngine::pairDistances(const Centers& c, const GCoord& box, double* d2) const {
+    uint np = pairs();
+    const uint* first = np ? &(_first[0]) : 0;
+    const uint* second = np ? &(_second[0]) : 0;
+    const double* x = &(c.x[0]);
+    const double* y = &(c.y[0]);
+    const double* z = &(c.z[0]);
+
+    if (_periodic) {
+      double bx = box[0], by = box[1], bz = box[2];
+      for (uint p=0; p<np; ++p) {
+        double dx = x[second[p]] - x[first[p]];
+        double dy = y[second[p]] - y[first[p]];
+        double dz = z[second[p]] - z[first[p]];
+        double nx = static_cast<int>(std::fabs(dx) / bx + 0.5);
+        double ny = static_cast<int>(std::fabs(dy) / by + 0.5);
+        double nz = static_cast<int>(std::fabs(dz) / bz + 0.5);
+        dx = (dx >= 0) ? dx - nx * bx : dx + nx * bx;
+        dy = (dy >= 0) ? dy - ny * by : dy + ny * by;
+        dz = (dz >= 0) ? dz - nz * bz : dz + nz * bz;
+        d2[p] = dx * dx + dy * dy + dz * dz;
+      }
+    } else
+      for (uint p=0; p<np; ++p) {
+        double dx = x[second[p]] - x[first[p]];
+        double dy = y[second[p]] - y[first[p]];
+        double dz = z[second[p]] - z[first[p]];
+        d2[p] = dx * dx + dy * dy + dz * dz;
+      }
+
+    double cut2 = _cutoff * _cutoff;
+    uint n = 0;
+    for (uint p=0; p<np; ++p)
+      n += (d2[p] <= cut2);
+    return(n);
+  }
+
+
+  std::vector<double> ContactFractionEngine::distances(const AtomicGroup& model) const {
+    std::vector<double> crds(static_cast<ulong>(_natoms) * 3);
+    for (uint i=0; i<_natoms; ++i)
+      for (uint k=0; k<3; ++k)
+        crds[3*i+k] = _atoms[i]->coords()[k];
+
+    GCoord box;
+    if (_periodic) {
+      if (!model.isPeriodic())
+        throw(LOOSError("ContactFractionEngine requires a periodic box when periodic"));
+      box = model.periodicBox();
+    }
+
+    Centers c;
+    centers(crds.empty() ? 0 : &(crds[0]), c);
+    std::vector<double> d2(pairs());
+    if (!d2.empty())
+      pairDistances(c, box, &(d2[0]));
+    return(d2);
+  }
+
+
+  void ContactFractionEngine::loadFrame(const uint slot, const AtomicGroup& model) {
+    ulong stride = static_cast<ulong>(_natoms) * 3;
+    if (_block.size() < (slot + 1) * stride) {
+      _block.resize((slot + 1) * stride);
+      _boxes.resize(slot + 1);
+    }
+
+    double* x = &(_block[slot * stride]);
+    for (uint i=0; i<_natoms; ++i) {
+      const GCoord& c = _atoms[i]->coords();
+      *(x++) = c[0];
+      *(x++) = c[1];
+      *(x++) = c[2];
+    }
+
+    if (_periodic) {
+      if (!model.isPeriodic())
+        throw(LOOSError("ContactFractionEngine requires a periodic box when periodic"));
+      _boxes[slot] = model.periodicBox();
+    }
+  }
+
+
+  void ContactFractionEngine::Worker::operator()() {
+    ulong stride = static_cast<ulong>(engine->_natoms) * 3;
+    uint np = engine->pairs();
+    Centers& c = engine->_scratch[thread];
+    c.counts.resize(np);
+    double cut2 = engine->_cutoff * engine->_cutoff;
+
+    for (uint f=begin; f<end; ++f) {
+      const double* crds = engine->_block.empty() ? 0 : &(engine->_block[f * stride]);
+      engine->centers(crds, c);
+      double* d2 = np ? &(engine->_d2[static_cast<ulong>(f) * np]) : 0;
+      engine->_ncontacts[f] = engine->pairDistances(c, engine->_periodic ? engine->_boxes[f] : GCoord(), d2);
+      for (uint p=0; p<np; ++p)
+        c.counts[p] += (d2[p] <= cut2);
+    }
+  }
+
+
+  void ContactFractionEngine::processBlock(const uint n) {
+    uint np = pairs();
+    _d2.resize(static_cast<ulong>(n) * np);
+    _ncontacts.resize(n);
+    if (_scratch.size() < _nthreads)
+      _scratch.resize(_nthreads);
+
+    uint nthreads = std::min(_nthreads, n);
+    if (nthreads <= 1) {
+      Worker worker(this, 0, 0, n);
+      worker();
+    } else {
+      uint chunk = (n + nthreads - 1) / nthreads;
+      boost::thread_group threads;
+      for (uint t=0; t<nthreads; ++t)
+        threads.create_thread(Worker(this, t, t * chunk, std::min(n, (t+1) * chunk)));
+      threads.join_all();
+    }
+
+    // Fold the per-thread counts into the totals
+    for (uint t=0; t<_scratch.size(); ++t) {
+      std::vector<ulong>& counts = _scratch[t].counts;
+      for (uint p=0; p<counts.size(); ++p) {
+        _counts[p] += counts[p];
+        counts[p] = 0;
+      }
+    }
+
+    _nframes += n;
+  }
+
+
+}
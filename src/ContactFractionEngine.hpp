@@ -0,0 +1,161 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_CONTACTFRACTIONENGINE_HPP)
+#define LOOS_CONTACTFRACTIONENGINE_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! Distances between the centers of a fixed list of residue pairs
+  /**
+   * This is the kernel behind native_contacts and transition_contacts.
+   * For each frame, the center of mass of every residue is computed
+   * once into packed x, y, and z arrays.  The pair list is stored as
+   * two flat index arrays, so the squared distance (using the minimum
+   * image, if periodic) for every pair is a single loop the compiler
+   * can vectorize.  The centers and the minimum image use the same
+   * arithmetic as AtomicGroup::centerOfMass() and GCoord::reimage(),
+   * so the distances match those computed directly from the groups.
+   *
+   * process() reads the rest of a trajectory, in blocks of frames that
+   * are split across threads(), and passes the squared distances for
+   * each frame, in frame order, to a sink as
+   *\code
+   * sink(const double* d2, const uint ncontacts);
+   *\endcode
+   * where d2 has one entry per pair and ncontacts is the number of
+   * pairs within the cutoff.  The number of frames each pair was in
+   * contact is also kept, for per-pair or per-residue averages.
+   */
+  class ContactFractionEngine {
+  public:
+    ContactFractionEngine(const std::vector<AtomicGroup>& residues, const double cutoff, const bool periodic = false);
+
+    //! Adds the pair of residues (i, j), returning its index
+    uint addPair(const uint i, const uint j);
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n);
+    uint threads() const { return(_nthreads); }
+
+    uint residues() const { return(_offsets.size() - 1); }
+    uint pairs() const { return(_first.size()); }
+    uint frames() const { return(_nframes); }
+    double cutoff() const { return(_cutoff); }
+
+    uint first(const uint p) const { return(_first[p]); }
+    uint second(const uint p) const { return(_second[p]); }
+
+    //! Number of frames in which pair p was within the cutoff
+    ulong count(const uint p) const { return(_counts[p]); }
+
+    //! Number of frames in contact for each residue, summed over its pairs
+    std::vector<ulong> residueCounts() const;
+
+    //! Squared pair distances for the current coordinates (periodic maps use the box of \a model)
+    std::vector<double> distances(const AtomicGroup& model) const;
+
+
+    //! Reads frames until the end of \a traj, passing each frame's distances to \a sink
+    /**
+     * Frames are read into \a model, which should contain all of the
+     * residue atoms (and supplies the periodic box).  Returns the
+     * number of frames read.  If there are no pairs, the sink is still
+     * called for each frame, with a null distance pointer.
+     */
+    template<class Sink>
+    uint process(AtomicGroup& model, pTraj& traj, Sink& sink) {
+      uint blocksize = 16 * _nthreads;
+      uint total = 0;
+
+      bool more = true;
+      while (more) {
+        uint n = 0;
+        while (n < blocksize && (more = traj->readFrame())) {
+          traj->updateGroupCoords(model);
+          loadFrame(n++, model);
+        }
+        if (!n)
+          break;
+
+        processBlock(n);
+        // With no pairs, _d2 is empty and the sink gets a null pointer
+        uint np = pairs();
+        for (uint j=0; j<n; ++j)
+          sink(np ? static_cast<const double*>(&(_d2[static_cast<ulong>(j) * np])) : static_cast<const double*>(0), _ncontacts[j]);
+        total += n;
+      }
+
+      return(total);
+    }
+
+  private:
+    struct Worker {
+      Worker(ContactFractionEngine* c, const uint t, const uint b, const uint e)
+        : engine(c), thread(t), begin(b), end(e) { }
+      void operator()();
+
+      ContactFractionEngine* engine;
+      uint thread, begin, end;
+    };
+
+    struct Centers {
+      std::vector<double> x, y, z;
+      std::vector<ulong> counts;
+    };
+
+    void loadFrame(const uint slot, const AtomicGroup& model);
+    void processBlock(const uint n);
+    void centers(const double* crds, Centers& c) const;
+    uint pairDistances(const Centers& c, const GCoord& box, double* d2) const;
+
+    double _cutoff;
+    bool _periodic;
+    uint _nthreads, _natoms, _nframes;
+
+    std::vector<pAtom> _atoms;
+    std::vector<double> _masses;
+    std::vector<uint> _offsets;
+    std::vector<uint> _first, _second;
+    std::vector<ulong> _counts;
+
+    std::vector<double> _block;
+    std::vector<GCoord> _boxes;
+    std::vector<double> _d2;
+    std::vector<uint> _ncontacts;
+    std::vector<Centers> _scratch;
+  };
+
+
+}
+
+
+#endif
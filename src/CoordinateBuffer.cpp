@@ -0,0 +1,151 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <CoordinateBuffer.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  void CoordinateBuffer::bind(const AtomicGroup& group) {
+    _group = group;
+    _crds.resize(3 * group.size());
+  }
+
+
+  void CoordinateBuffer::gather() {
+    uint n = _group.size();
+    if (_crds.size() != 3 * n)
+      _crds.resize(3 * n);
+
+    double* p = data();
+    for (uint i=0; i<n; ++i) {
+      const GCoord& c = _group[i]->coords();
+      *(p++) = c[0];
+      *(p++) = c[1];
+      *(p++) = c[2];
+    }
+  }
+
+
+  void CoordinateBuffer::scatter() const {
+    uint n = _group.size();
+    if (_crds.size() != 3 * n)
+      throw(LOOSError("CoordinateBuffer size does not match its group"));
+
+    const double* p = data();
+    for (uint i=0; i<n; ++i, p += 3)
+      _group[i]->coords(GCoord(p[0], p[1], p[2]));
+  }
+
+
+  void CoordinateBuffer::view(double** view_data, int* view_rows, int* view_cols) {
+    *view_data = data();
+    *view_rows = size();
+    *view_cols = 3;
+  }
+
+
+
+  CoordinateChunkReader::CoordinateChunkReader(const pTraj& traj, const AtomicGroup& subset, const std::vector<uint>& frames, const uint chunk_size)
+    : _traj(traj), _subset(subset), _frames(frames), _chunk_size(chunk_size)
+  {
+    init();
+  }
+
+
+  CoordinateChunkReader::CoordinateChunkReader(const pTraj& traj, const AtomicGroup& subset, const uint chunk_size)
+    : _traj(traj), _subset(subset), _chunk_size(chunk_size)
+  {
+    for (uint i=0; i<traj->nframes(); ++i)
+      _frames.push_back(i);
+    init();
+  }
+
+
+  void CoordinateChunkReader::init() {
+    if (_chunk_size == 0)
+      throw(LOOSError("CoordinateChunkReader chunk size must be greater than 0"));
+    for (std::vector<uint>::const_iterator i = _frames.begin(); i != _frames.end(); ++i)
+      if (*i >= _traj->nframes())
+        throw(LOOSError("CoordinateChunkReader frame index is out of range"));
+
+    _next = 0;
+    _count = 0;
+    _crds.resize(static_cast<ulong>(_chunk_size) * _subset.size() * 3);
+    _boxes.resize(_chunk_size);
+  }
+
+
+  bool CoordinateChunkReader::readChunk() {
+    if (_next >= _frames.size()) {
+      _count = 0;
+      return(false);
+    }
+
+    // Only hint while reading the chunk, so other users of the
+    // trajectory still get every atom
+    Trajectory::IndexRuns previous = _traj->selectionHint();
+    _traj->setSelectionHint(_subset);
+
+    _count = std::min(_chunk_size, static_cast<uint>(_frames.size()) - _next);
+    uint n = _subset.size();
+    double* p = _crds.empty() ? 0 : &(_crds[0]);
+
+    for (uint k=0; k<_count; ++k) {
+      _traj->readFrame(_frames[_next + k]);
+      _traj->updateGroupCoords(_subset);
+      for (uint i=0; i<n; ++i) {
+        const GCoord& c = _subset[i]->coords();
+        *(p++) = c[0];
+        *(p++) = c[1];
+        *(p++) = c[2];
+      }
+      _boxes[k] = _traj->hasPeriodicBox() ? _traj->periodicBox() : GCoord(0, 0, 0);
+    }
+
+    _traj->setSelectionHint(previous);
+    _next += _count;
+    return(true);
+  }
+
+
+  std::vector<uint> CoordinateChunkReader::chunkFrames() const {
+    uint start = _next - _count;
+    return(std::vector<uint>(_frames.begin() + start, _frames.begin() + _next));
+  }
+
+
+  std::vector<GCoord> CoordinateChunkReader::chunkBoxes() const {
+    return(std::vector<GCoord>(_boxes.begin(), _boxes.begin() + _count));
+  }
+
+
+  void CoordinateChunkReader::view(double** view_data, int* view_frames, int* view_rows, int* view_cols) {
+    *view_data = _crds.empty() ? 0 : &(_crds[0]);
+    *view_frames = _count;
+    *view_rows = _subset.size();
+    *view_cols = 3;
+  }
+
+}
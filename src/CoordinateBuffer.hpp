@@ -0,0 +1,161 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_COORDINATEBUFFER_HPP)
+#define LOOS_COORDINATEBUFFER_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! Contiguous N x 3 copy of the coordinates of a group
+  /**
+   * Atoms each hold their own coordinates, so there is no array to
+   * hand out directly.  A CoordinateBuffer keeps one row-major array
+   * for a group that is reused from frame to frame: gather() copies
+   * the atoms' coordinates in, and scatter() copies them back out.
+   *
+   * From Python, view() returns a writable NumPy array that refers to
+   * the buffer without copying it.  The array holds a reference to the
+   * buffer, so it stays valid until bind() (or a change in the
+   * group's size) reallocates the buffer.
+   *
+   *\code
+   * buf = loos.CoordinateBuffer(calphas)
+   * for frame in traj:
+   *     buf.gather()
+   *     x = buf.view()          # (N, 3), no copy
+   *     x -= x.mean(axis=0)
+   *     buf.scatter()
+   *\endcode
+   */
+  class CoordinateBuffer {
+  public:
+    CoordinateBuffer() { }
+    explicit CoordinateBuffer(const AtomicGroup& group) { bind(group); }
+
+    //! Use \a group for the buffer (and resize it)
+    void bind(const AtomicGroup& group);
+
+    //! The group the buffer copies to and from
+    AtomicGroup group() const { return(_group); }
+
+    //! Number of atoms
+    uint size() const { return(_group.size()); }
+
+    //! Copy the group's coordinates into the buffer
+    void gather();
+
+    //! Copy the buffer back into the group's coordinates
+    void scatter() const;
+
+    double* data() { return(_crds.empty() ? 0 : &(_crds[0])); }
+    const double* data() const { return(_crds.empty() ? 0 : &(_crds[0])); }
+
+    //! View of the buffer as an N x 3 array (for Python)
+    void view(double** view_data, int* view_rows, int* view_cols);
+
+  private:
+    AtomicGroup _group;
+    std::vector<double> _crds;
+  };
+
+
+
+  //! Reads blocks of frames into one contiguous (frames x N x 3) array
+  /**
+   * Frames from a list are read a chunk at a time.  For each chunk,
+   * the coordinates of the subset are packed into a single row-major
+   * array, with the frame indices and periodic boxes alongside.  The
+   * subset is passed as a selection hint to the trajectory, so formats
+   * that support it only decode the atoms needed.
+   *
+   * The subset must be part of the model the trajectory was created
+   * with.  Its atoms are updated as frames are read, and hold the last
+   * frame of the chunk afterwards.
+   *
+   * From Python, view() returns the current chunk as a NumPy array
+   * without copying it.  The array holds a reference to the reader,
+   * so it remains valid, but the next call to readChunk() overwrites
+   * its contents.
+   *
+   *\code
+   * CoordinateChunkReader reader(traj, subset, frames, 100);
+   * while (reader.readChunk()) {
+   *   const double* p = reader.data();
+   *   for (uint i=0; i<reader.framesInChunk(); ++i, p += 3 * reader.atoms())
+   *     ...
+   * }
+   *\endcode
+   */
+  class CoordinateChunkReader {
+  public:
+    CoordinateChunkReader(const pTraj& traj, const AtomicGroup& subset, const std::vector<uint>& frames, const uint chunk_size = 100);
+
+    //! All frames of the trajectory
+    CoordinateChunkReader(const pTraj& traj, const AtomicGroup& subset, const uint chunk_size = 100);
+
+    //! Reads the next chunk, returning false when there are no more frames
+    bool readChunk();
+
+    //! Start again from the first frame
+    void rewind() { _next = 0; _count = 0; }
+
+    uint atoms() const { return(_subset.size()); }
+    uint chunkSize() const { return(_chunk_size); }
+    uint framesInChunk() const { return(_count); }
+    uint totalFrames() const { return(_frames.size()); }
+
+    //! Trajectory frame indices for the current chunk
+    std::vector<uint> chunkFrames() const;
+
+    //! Periodic boxes for the current chunk (if the trajectory has them)
+    std::vector<GCoord> chunkBoxes() const;
+
+    const double* data() const { return(_crds.empty() ? 0 : &(_crds[0])); }
+
+    //! View of the current chunk as a frames x N x 3 array (for Python)
+    void view(double** view_data, int* view_frames, int* view_rows, int* view_cols);
+
+  private:
+    void init();
+
+    pTraj _traj;
+    AtomicGroup _subset;
+    std::vector<uint> _frames;
+    uint _chunk_size, _next, _count;
+
+    std::vector<double> _crds;
+    std::vector<GCoord> _boxes;
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+%header %{
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <CoordinateBuffer.hpp>
+%}
+
+
+// view() hands NumPy the C++ object's memory without copying it.  The
+// array's base is set to the Python proxy that owns the memory, so the
+// owner stays alive as long as any view of it does.
+%{
+  namespace {
+    PyObject* ownedView(const int nd, npy_intp* dims, double* data, PyObject* owner) {
+      PyObject* obj = PyArray_SimpleNewFromData(nd, dims, NPY_DOUBLE, static_cast<void*>(data));
+      if (!obj)
+        return(0);
+      Py_INCREF(owner);
+      if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(obj), owner) < 0) {
+        Py_DECREF(obj);
+        return(0);
+      }
+      return(obj);
+    }
+  }
+%}
+
+%ignore loos::CoordinateBuffer::data;
+%ignore loos::CoordinateBuffer::view;
+%ignore loos::CoordinateChunkReader::data;
+%ignore loos::CoordinateChunkReader::view;
+
+%include "CoordinateBuffer.hpp"
+
+
+namespace loos {
+
+  %extend CoordinateBuffer {
+    PyObject* _view(PyObject* owner) {
+      double* data;
+      int rows, cols;
+      $self->view(&data, &rows, &cols);
+      npy_intp dims[2] = { rows, cols };
+      return(ownedView(2, dims, data, owner));
+    }
+
+%pythoncode %{
+    def view(self):
+        """(N, 3) NumPy view of the buffer (keeps the buffer alive)"""
+        return(self._view(self))
+%}
+  };
+
+
+  %extend CoordinateChunkReader {
+    PyObject* _view(PyObject* owner) {
+      double* data;
+      int frames, rows, cols;
+      $self->view(&data, &frames, &rows, &cols);
+      npy_intp dims[3] = { frames, rows, cols };
+      return(ownedView(3, dims, data, owner));
+    }
+
+%pythoncode %{
+    def view(self):
+        """(frames, N, 3) NumPy view of the current chunk (keeps the reader alive)"""
+        return(self._view(self))
+%}
+  };
+
+}
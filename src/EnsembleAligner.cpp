@@ -0,0 +1,307 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <EnsembleAligner.hpp>
+#include <alignment.hpp>
+#include <exceptions.hpp>
+
+#include <cmath>
+#include <boost/thread/thread.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Eigenvector for the largest eigenvalue of a symmetric 4x4
+    // matrix, by cyclic Jacobi rotations
+    void largestEigenvector(double A[4][4], double q[4]) {
+      double V[4][4] = { {1,0,0,0}, {0,1,0,0}, {0,0,1,0}, {0,0,0,1} };
+
+      for (uint sweep = 0; sweep < 50; ++sweep) {
+        double off = 0.0, diag = 0.0;
+        for (uint i=0; i<4; ++i) {
+          diag += A[i][i] * A[i][i];
+          for (uint j=i+1; j<4; ++j)
+            off += A[i][j] * A[i][j];
+        }
+        if (off <= 1e-30 * diag || off == 0.0)
+          break;
+
+        for (uint p=0; p<3; ++p)
+          for (uint r=p+1; r<4; ++r) {
+            if (A[p][r] == 0.0)
+              continue;
+
+            double theta = (A[r][r] - A[p][p]) / (2.0 * A[p][r]);
+            double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+            double c = 1.0 / std::sqrt(t * t + 1.0);
+            double s = t * c;
+
+            for (uint k=0; k<4; ++k) {
+              double akp = A[k][p];
+              double akr = A[k][r];
+              A[k][p] = c * akp - s * akr;
+              A[k][r] = s * akp + c * akr;
+            }
+            for (uint k=0; k<4; ++k) {
+              double apk = A[p][k];
+              double ark = A[r][k];
+              A[p][k] = c * apk - s * ark;
+              A[r][k] = s * apk + c * ark;
+            }
+            for (uint k=0; k<4; ++k) {
+              double vkp = V[k][p];
+              double vkr = V[k][r];
+              V[k][p] = c * vkp - s * vkr;
+              V[k][r] = s * vkp + c * vkr;
+            }
+          }
+      }
+
+      uint best = 0;
+      for (uint i=1; i<4; ++i)
+        if (A[i][i] > A[best][best])
+          best = i;
+      for (uint i=0; i<4; ++i)
+        q[i] = V[i][best];
+    }
+
+  }
+
+
+
+  EnsembleAligner::EnsembleAligner(const std::vector<AtomicGroup>& ensemble) : _nthreads(1) {
+    if (ensemble.empty())
+      throw(LOOSError("Cannot align an empty ensemble"));
+
+    _nframes = ensemble.size();
+    _natoms = ensemble[0].size();
+    _crds.resize(static_cast<ulong>(_nframes) * _natoms * 3);
+
+    double* p = &(_crds[0]);
+    for (uint i=0; i<_nframes; ++i) {
+      if (ensemble[i].size() != _natoms)
+        throw(LOOSError("Ensemble structures must all be the same size"));
+      for (uint j=0; j<_natoms; ++j) {
+        const GCoord& c = ensemble[i][j]->coords();
+        *(p++) = c[0];
+        *(p++) = c[1];
+        *(p++) = c[2];
+      }
+    }
+  }
+
+
+  EnsembleAligner::EnsembleAligner(const std::vector< std::vector<double> >& ensemble) : _nthreads(1) {
+    if (ensemble.empty())
+      throw(LOOSError("Cannot align an empty ensemble"));
+
+    _nframes = ensemble.size();
+    _natoms = ensemble[0].size() / 3;
+    _crds.resize(static_cast<ulong>(_nframes) * _natoms * 3);
+
+    double* p = &(_crds[0]);
+    for (uint i=0; i<_nframes; ++i) {
+      if (ensemble[i].size() != _natoms * 3)
+        throw(LOOSError("Ensemble structures must all be the same size"));
+      std::copy(ensemble[i].begin(), ensemble[i].end(), p);
+      p += ensemble[i].size();
+    }
+  }
+
+
+  void EnsembleAligner::threads(const uint n) {
+    _nthreads = n ? n : boost::thread::hardware_concurrency();
+    if (_nthreads < 1)
+      _nthreads = 1;
+  }
+
+
+  // Transform superimposing the frame at x onto the current target,
+  // built the same way as alignment::kabsch()
+  GMatrix EnsembleAligner::superposition(const double* x) const {
+    double cx = 0.0, cy = 0.0, cz = 0.0;
+    for (uint j=0; j<_natoms; ++j) {
+      cx += x[3*j];
+      cy += x[3*j+1];
+      cz += x[3*j+2];
+    }
+    cx /= _natoms;
+    cy /= _natoms;
+    cz /= _natoms;
+
+    // Correlation between the centered frame and centered target
+    const double* y = &(_target[0]);
+    double S[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+    for (uint j=0; j<_natoms; ++j) {
+      double u[3] = { x[3*j] - cx, x[3*j+1] - cy, x[3*j+2] - cz };
+      double v[3] = { y[3*j] - _target_center[0], y[3*j+1] - _target_center[1], y[3*j+2] - _target_center[2] };
+      for (uint a=0; a<3; ++a)
+        for (uint b=0; b<3; ++b)
+          S[a][b] += u[a] * v[b];
+    }
+
+    double N[4][4];
+    N[0][0] = S[0][0] + S[1][1] + S[2][2];
+    N[1][1] = S[0][0] - S[1][1] - S[2][2];
+    N[2][2] = -S[0][0] + S[1][1] - S[2][2];
+    N[3][3] = -S[0][0] - S[1][1] + S[2][2];
+    N[0][1] = N[1][0] = S[1][2] - S[2][1];
+    N[0][2] = N[2][0] = S[2][0] - S[0][2];
+    N[0][3] = N[3][0] = S[0][1] - S[1][0];
+    N[1][2] = N[2][1] = S[0][1] + S[1][0];
+    N[1][3] = N[3][1] = S[2][0] + S[0][2];
+    N[2][3] = N[3][2] = S[1][2] + S[2][1];
+
+    double q[4];
+    largestEigenvector(N, q);
+
+    GMatrix R;
+    R(0,0) = q[0]*q[0] + q[1]*q[1] - q[2]*q[2] - q[3]*q[3];
+    R(0,1) = 2.0 * (q[1]*q[2] - q[0]*q[3]);
+    R(0,2) = 2.0 * (q[1]*q[3] + q[0]*q[2]);
+    R(1,0) = 2.0 * (q[1]*q[2] + q[0]*q[3]);
+    R(1,1) = q[0]*q[0] - q[1]*q[1] + q[2]*q[2] - q[3]*q[3];
+    R(1,2) = 2.0 * (q[2]*q[3] - q[0]*q[1]);
+    R(2,0) = 2.0 * (q[1]*q[3] - q[0]*q[2]);
+    R(2,1) = 2.0 * (q[2]*q[3] + q[0]*q[1]);
+    R(2,2) = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+
+    XForm W;
+    W.identity();
+    W.translate(_target_center);
+    W.concat(R);
+    W.translate(-GCoord(cx, cy, cz));
+
+    return(W.current());
+  }
+
+
+  void EnsembleAligner::FrameAligner::operator()() {
+    uint natoms = aligner->_natoms;
+    for (uint i=begin; i<end; ++i) {
+      double* x = &(aligner->_crds[static_cast<ulong>(i) * natoms * 3]);
+      GMatrix M = aligner->superposition(x);
+
+      for (uint j=0; j<natoms; ++j, x += 3) {
+        double a = x[0], b = x[1], c = x[2];
+        x[0] = M(0,0)*a + M(0,1)*b + M(0,2)*c + M(0,3);
+        x[1] = M(1,0)*a + M(1,1)*b + M(1,2)*c + M(1,3);
+        x[2] = M(2,0)*a + M(2,1)*b + M(2,2)*c + M(2,3);
+      }
+      aligner->_xforms[i].premult(M);
+    }
+  }
+
+
+  // Each thread averages a range of coordinates over all frames, so
+  // the sums are always taken in frame order.  The average is
+  // recomputed in full each iteration rather than updated as frames
+  // are superimposed: every frame moves every iteration, so an update
+  // still touches all coordinates, and folding it into FrameAligner
+  // would either need a lock on the shared average or per-thread
+  // partial sums whose rounding depends on the thread count.
+  void EnsembleAligner::Averager::operator()() {
+    ulong stride = static_cast<ulong>(aligner->_natoms) * 3;
+    const double* crds = &(aligner->_crds[0]);
+    double* avg = &(aligner->_avg[0]);
+
+    for (uint k=begin; k<end; ++k)
+      avg[k] = 0.0;
+    for (uint i=0; i<aligner->_nframes; ++i) {
+      const double* x = crds + i * stride;
+      for (uint k=begin; k<end; ++k)
+        avg[k] += x[k];
+    }
+    for (uint k=begin; k<end; ++k)
+      avg[k] /= aligner->_nframes;
+  }
+
+
+  template<class Worker>
+  void EnsembleAligner::run(const uint n) {
+    uint nthreads = std::min(_nthreads, n);
+    if (nthreads <= 1) {
+      Worker worker(this, 0, n);
+      worker();
+      return;
+    }
+
+    uint chunk = (n + nthreads - 1) / nthreads;
+    boost::thread_group threads;
+    for (uint t=0; t<nthreads; ++t)
+      threads.create_thread(Worker(this, t * chunk, std::min(n, (t+1) * chunk)));
+    threads.join_all();
+  }
+
+
+  EnsembleAligner::Result EnsembleAligner::align(const greal threshold, const int maxiter) {
+    _xforms.assign(_nframes, XForm());
+    _avg.resize(_natoms * 3);
+
+    // Start by aligning against the first structure in the ensemble
+    _target.assign(_crds.begin(), _crds.begin() + _natoms * 3);
+    alignment::centerAtOrigin(_target);
+
+    double rms;
+    int iter = 0;
+    do {
+      _target_center = GCoord(0,0,0);
+      for (uint j=0; j<_natoms; ++j)
+        for (uint k=0; k<3; ++k)
+          _target_center[k] += _target[3*j+k];
+      _target_center /= _natoms;
+
+      run<FrameAligner>(_nframes);
+      run<Averager>(_natoms * 3);
+
+      rms = alignment::rmsd(_target, _avg);
+      _target.swap(_avg);
+      ++iter;
+    } while (rms > threshold && iter <= maxiter);
+
+    return(Result(_xforms, rms, iter));
+  }
+
+
+  void EnsembleAligner::copyCoordinatesTo(std::vector<AtomicGroup>& ensemble) const {
+    if (ensemble.size() != _nframes)
+      throw(LOOSError("Ensemble does not match the EnsembleAligner"));
+
+    const double* p = &(_crds[0]);
+    for (uint i=0; i<_nframes; ++i)
+      for (uint j=0; j<_natoms; ++j, p += 3)
+        ensemble[i][j]->coords() = GCoord(p[0], p[1], p[2]);
+  }
+
+
+  void EnsembleAligner::copyCoordinatesTo(std::vector< std::vector<double> >& ensemble) const {
+    if (ensemble.size() != _nframes)
+      throw(LOOSError("Ensemble does not match the EnsembleAligner"));
+
+    for (uint i=0; i<_nframes; ++i)
+      std::copy(frame(i), frame(i) + _natoms * 3, ensemble[i].begin());
+  }
+
+
+}
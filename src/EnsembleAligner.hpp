@@ -0,0 +1,107 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_ENSEMBLEALIGNER_HPP)
+#define LOOS_ENSEMBLEALIGNER_HPP
+
+#include <vector>
+#include <boost/tuple/tuple.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <XForm.hpp>
+
+
+namespace loos {
+
+
+  //! Iterative superposition of an ensemble held in memory
+  /**
+   * The coordinates are copied once into a single frames x atoms x 3
+   * array.  Each iteration then superimposes every frame onto the
+   * current average and recomputes the average, in place, splitting
+   * the frames (and then the atoms, for the average) across threads().
+   *
+   * The rotation for each frame is found with Horn's quaternion method
+   * (the largest eigenvector of a 4x4 symmetric matrix, found by Jacobi
+   * rotations), so no LAPACK calls or temporary vectors are needed per
+   * frame.  The transforms and the convergence test are the same as
+   * for iterativeAlignment(), and the average is accumulated in frame
+   * order, so the results do not depend on the number of threads.
+   */
+  class EnsembleAligner {
+  public:
+    typedef boost::tuple<std::vector<XForm>, greal, int>    Result;
+
+    explicit EnsembleAligner(const std::vector<AtomicGroup>& ensemble);
+    explicit EnsembleAligner(const std::vector< std::vector<double> >& ensemble);
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n);
+    uint threads() const { return(_nthreads); }
+
+    uint frames() const { return(_nframes); }
+    uint atoms() const { return(_natoms); }
+
+    //! Coordinates of a frame (x, y, z for each atom)
+    const double* frame(const uint i) const { return(&(_crds[static_cast<ulong>(i) * _natoms * 3])); }
+
+    //! Aligns the ensemble, returning the transforms, final RMSD and iterations
+    Result align(const greal threshold = 1e-6, const int maxiter = 1000);
+
+    //! Copies the (aligned) coordinates back into an ensemble
+    void copyCoordinatesTo(std::vector<AtomicGroup>& ensemble) const;
+    void copyCoordinatesTo(std::vector< std::vector<double> >& ensemble) const;
+
+  private:
+    struct FrameAligner {
+      FrameAligner(EnsembleAligner* a, const uint b, const uint e) : aligner(a), begin(b), end(e) { }
+      void operator()();
+
+      EnsembleAligner* aligner;
+      uint begin, end;
+    };
+
+    struct Averager {
+      Averager(EnsembleAligner* a, const uint b, const uint e) : aligner(a), begin(b), end(e) { }
+      void operator()();
+
+      EnsembleAligner* aligner;
+      uint begin, end;
+    };
+
+    template<class Worker> void run(const uint n);
+
+    GMatrix superposition(const double* x) const;
+
+    uint _nframes, _natoms, _nthreads;
+    std::vector<double> _crds;
+    std::vector<double> _target, _avg;
+    GCoord _target_center;
+    std::vector<XForm> _xforms;
+  };
+
+
+}
+
+
+#endif
@@ -0,0 +1,84 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <MappedTextFile.hpp>
+#include <exceptions.hpp>
+
+#include <fstream>
+#include <iterator>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace loos {
+
+
+  MappedTextFile::MappedTextFile(const std::string& fname) : _begin(0), _size(0), _map(0) {
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw(FileOpenError(fname));
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void* base = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (base != MAP_FAILED) {
+        madvise(base, st.st_size, MADV_SEQUENTIAL);
+        _map = base;
+        _begin = static_cast<const char*>(base);
+        _size = st.st_size;
+      }
+    }
+    close(fd);
+
+    // Fall back to regular I/O (e.g. for a pipe or an empty file)
+    if (!_map) {
+      std::ifstream ifs(fname.c_str(), std::ios::binary);
+      if (!ifs)
+        throw(FileOpenError(fname));
+      slurp(ifs);
+    }
+  }
+
+
+  MappedTextFile::MappedTextFile(std::istream& is) : _begin(0), _size(0), _map(0) {
+    slurp(is);
+  }
+
+
+  MappedTextFile::~MappedTextFile() {
+    if (_map)
+      munmap(_map, _size);
+  }
+
+
+  void MappedTextFile::slurp(std::istream& is) {
+    _buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    _begin = _buffer.data();
+    _size = _buffer.size();
+  }
+
+
+}
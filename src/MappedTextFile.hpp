@@ -0,0 +1,208 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_MAPPEDTEXTFILE_HPP)
+#define LOOS_MAPPEDTEXTFILE_HPP
+
+#include <string>
+#include <istream>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/utility.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! Read-only access to the whole contents of a text file
+  /**
+   * Files are memory-mapped when possible, otherwise (or when built
+   * from a stream) the contents are read into memory.  Either way, the
+   * text is available as one contiguous [begin(), end()) range for the
+   * parsers in TextScan.
+   */
+  class MappedTextFile : public boost::noncopyable {
+  public:
+    //! Map the named file (throws FileOpenError if it can't be opened)
+    explicit MappedTextFile(const std::string& fname);
+
+    //! Read the rest of a stream into memory
+    explicit MappedTextFile(std::istream& is);
+
+    ~MappedTextFile();
+
+    const char* begin() const { return(_begin); }
+    const char* end() const { return(_begin + _size); }
+    ulong size() const { return(_size); }
+
+  private:
+    void slurp(std::istream& is);
+
+    const char* _begin;
+    ulong _size;
+    void* _map;
+    std::string _buffer;
+  };
+
+
+
+  //! Hand-written scanners for parsing text in memory
+  /**
+   * These work on [p, end) ranges and advance p past what they read.
+   * Whitespace within a line is space, tab, carriage return, vertical
+   * tab, or form-feed, so files from Windows are handled.
+   */
+  namespace TextScan {
+
+    inline bool isBlank(const char c) {
+      return(c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
+    }
+
+    //! Finds the end of the line starting at p (the newline, or end)
+    inline const char* lineEnd(const char* p, const char* end) {
+      const char* q = static_cast<const char*>(memchr(p, '\n', end - p));
+      return(q ? q : end);
+    }
+
+    //! Advances p past any blanks
+    inline void skipBlanks(const char*& p, const char* end) {
+      while (p < end && isBlank(*p))
+        ++p;
+    }
+
+    //! Finds the next blank-separated token, of at most \a width characters if non-zero
+    inline bool token(const char*& p, const char* end, const char*& tb, const char*& te, const uint width = 0) {
+      skipBlanks(p, end);
+      if (p >= end)
+        return(false);
+      tb = p;
+      const char* limit = (width && static_cast<ulong>(end - p) > width) ? p + width : end;
+      while (p < limit && !isBlank(*p))
+        ++p;
+      te = p;
+      return(true);
+    }
+
+    //! Parses an optionally signed decimal integer filling all of [b, e)
+    inline bool parseInt(const char* b, const char* e, long& val) {
+      bool negative = false;
+      if (b < e && (*b == '-' || *b == '+')) {
+        negative = (*b == '-');
+        ++b;
+      }
+      if (b >= e)
+        return(false);
+
+      long v = 0;
+      for (; b < e; ++b) {
+        unsigned int d = static_cast<unsigned char>(*b) - '0';
+        if (d > 9)
+          return(false);
+        v = v * 10 + d;
+      }
+      val = negative ? -v : v;
+      return(true);
+    }
+
+
+    //! Parses a floating point number filling all of [b, e)
+    /**
+     * Plain decimals (with an optional exponent) that fit in a double's
+     * mantissa are converted directly, which gives the same correctly
+     * rounded result as strtod().  Anything else is passed to strtod().
+     */
+    inline bool parseDouble(const char* b, const char* e, double& val) {
+      static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                      1e20, 1e21, 1e22 };
+      const char* p = b;
+      bool negative = false;
+      if (p < e && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+      }
+
+      unsigned long long mantissa = 0;
+      int digits = 0, scale = 0;
+      bool any = false;
+      for (; p < e && *p >= '0' && *p <= '9'; ++p, any = true)
+        if (mantissa || *p != '0') {
+          mantissa = mantissa * 10 + (*p - '0');
+          ++digits;
+        }
+      if (p < e && *p == '.')
+        for (++p; p < e && *p >= '0' && *p <= '9'; ++p, any = true) {
+          if (mantissa || *p != '0') {
+            mantissa = mantissa * 10 + (*p - '0');
+            ++digits;
+          }
+          --scale;
+        }
+
+      int exponent = 0;
+      bool ok = any && digits <= 15;
+      if (ok && p < e && (*p == 'e' || *p == 'E')) {
+        long x;
+        ok = parseInt(p + 1, e, x) && x > -400 && x < 400;
+        exponent = x;
+        p = e;
+      }
+      scale += exponent;
+
+      if (ok && p == e && scale >= -22 && scale <= 22) {
+        double v = static_cast<double>(mantissa);
+        v = (scale < 0) ? v / pow10[-scale] : v * pow10[scale];
+        val = negative ? -v : v;
+        return(true);
+      }
+
+      // Slow path...
+      char buf[64];
+      ulong n = e - b;
+      if (n == 0 || n >= sizeof(buf))
+        return(false);
+      memcpy(buf, b, n);
+      buf[n] = '\0';
+      char* q;
+      val = strtod(buf, &q);
+      return(*q == '\0');
+    }
+
+
+    //! Parses a number in a fixed-width field [b, e), ignoring surrounding blanks
+    inline bool parseField(const char* b, const char* e, double& val) {
+      while (b < e && isBlank(*b))
+        ++b;
+      while (e > b && isBlank(*(e-1)))
+        --e;
+      return(parseDouble(b, e, val));
+    }
+
+  }
+
+
+}
+
+#endif
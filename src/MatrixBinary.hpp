@@ -0,0 +1,561 @@
+/*
+  MatrixBinary.hpp
+
+  Binary reading and writing of Matrix objects...
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_MATRIXBINARY_HPP)
+#define LOOS_MATRIXBINARY_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/shared_array.hpp>
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+#include <MatrixImpl.hpp>
+#include <MatrixRead.hpp>
+
+
+namespace loos {
+
+
+  //! Layout of the binary matrix format
+  /**
+   * A binary matrix file is a fixed 64-byte header, followed by the
+   * metadata string, followed by the raw matrix data (as stored in
+   * memory by the Matrix order policy).  The data always starts on a
+   * 64-byte boundary so the file can be memory-mapped and used in
+   * place.
+   *
+   * The header is:
+   *\verbatim
+   *   8 bytes    magic ("\x89LOOSMAT")
+   *   uint32     version
+   *   uint32     endian tag (0x01020304 in the writer's byte order)
+   *   uint32     element type code
+   *   uint32     order code (0 = col-major, 1 = row-major, 2 = triangular)
+   *   uint64     rows
+   *   uint64     cols
+   *   uint64     number of stored elements
+   *   uint64     length of metadata string
+   *   uint64     offset of the data from the start of the file
+   *\endverbatim
+   */
+  struct BinaryMatrixHeader {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t endian;
+    boost::uint32_t type;
+    boost::uint32_t order;
+    boost::uint64_t rows;
+    boost::uint64_t cols;
+    boost::uint64_t elements;
+    boost::uint64_t metalen;
+    boost::uint64_t offset;
+  };
+
+
+  namespace internal {
+
+    static const char binary_matrix_magic[8] = { '\x89', 'L', 'O', 'O', 'S', 'M', 'A', 'T' };
+    static const boost::uint32_t binary_matrix_version = 1;
+    static const boost::uint32_t binary_matrix_endian = 0x01020304;
+    static const ulong binary_matrix_alignment = 64;
+
+    enum BinaryMatrixTypeCode { BinaryInt32 = 1, BinaryUInt32, BinaryInt64, BinaryUInt64, BinaryFloat32, BinaryFloat64 };
+
+    //! Maps an element type onto the code stored in the file
+    template<typename T> struct BinaryMatrixType;
+
+    template<> struct BinaryMatrixType<float> { static const boost::uint32_t code = BinaryFloat32; };
+    template<> struct BinaryMatrixType<double> { static const boost::uint32_t code = BinaryFloat64; };
+    template<> struct BinaryMatrixType<int> { static const boost::uint32_t code = BinaryInt32; };
+    template<> struct BinaryMatrixType<uint> { static const boost::uint32_t code = BinaryUInt32; };
+    template<> struct BinaryMatrixType<long> { static const boost::uint32_t code = sizeof(long) == 8 ? BinaryInt64 : BinaryInt32; };
+    template<> struct BinaryMatrixType<ulong> { static const boost::uint32_t code = sizeof(ulong) == 8 ? BinaryUInt64 : BinaryUInt32; };
+
+
+    //! Maps an order policy onto the code stored in the file
+    template<class P> struct BinaryMatrixOrder;
+
+    template<> struct BinaryMatrixOrder<Math::ColMajor> { static const boost::uint32_t code = 0; };
+    template<> struct BinaryMatrixOrder<Math::RowMajor> { static const boost::uint32_t code = 1; };
+    template<> struct BinaryMatrixOrder<Math::Triangular> { static const boost::uint32_t code = 2; };
+
+
+    inline uint binaryMatrixElementSize(const boost::uint32_t code) {
+      switch(code) {
+      case BinaryInt32:
+      case BinaryUInt32:
+      case BinaryFloat32: return(4);
+      case BinaryInt64:
+      case BinaryUInt64:
+      case BinaryFloat64: return(8);
+      }
+      throw(MatrixReadError("Unknown element type in binary matrix"));
+    }
+
+
+    inline void swabBytes(char* p, const uint n) {
+      std::reverse(p, p + n);
+    }
+
+    template<typename T>
+    inline void swabValue(T& t) {
+      swabBytes(reinterpret_cast<char*>(&t), sizeof(T));
+    }
+
+
+    inline void swabHeader(BinaryMatrixHeader& h) {
+      swabValue(h.version);
+      swabValue(h.endian);
+      swabValue(h.type);
+      swabValue(h.order);
+      swabValue(h.rows);
+      swabValue(h.cols);
+      swabValue(h.elements);
+      swabValue(h.metalen);
+      swabValue(h.offset);
+    }
+
+
+    //! Validates a header read from a file, byte-swapping it if necessary
+    /**
+     * Returns true if the data itself will need byte-swapping
+     */
+    inline bool checkBinaryMatrixHeader(BinaryMatrixHeader& h) {
+      if (memcmp(h.magic, binary_matrix_magic, sizeof(h.magic)) != 0)
+        throw(MatrixReadError("Not a binary matrix (bad magic)"));
+
+      bool swapped = false;
+      if (h.endian != binary_matrix_endian) {
+        swabHeader(h);
+        if (h.endian != binary_matrix_endian)
+          throw(MatrixReadError("Cannot determine byte order of binary matrix"));
+        swapped = true;
+      }
+
+      if (h.version > binary_matrix_version)
+        throw(MatrixReadError("Binary matrix was written by a newer version of LOOS"));
+      if (h.order > 2)
+        throw(MatrixReadError("Unknown order in binary matrix"));
+      binaryMatrixElementSize(h.type);
+
+      // Dimensions are stored as 64 bits, but a Matrix uses uint
+      if (h.rows > std::numeric_limits<uint>::max() || h.cols > std::numeric_limits<uint>::max())
+        throw(MatrixReadError("Binary matrix is too large to read"));
+
+      ulong expected = (h.order == 2) ? (h.rows * (h.rows + 1)) / 2 : h.rows * h.cols;
+      if (h.elements != expected)
+        throw(MatrixReadError("Binary matrix header has an inconsistent size"));
+
+      return(swapped);
+    }
+
+
+    // Convert raw file data into elements of type T
+    template<typename S, typename T>
+    void convertElements(const char* src, const ulong n, const bool swapped, T* dst) {
+      S datum;
+      for (ulong i=0; i<n; ++i) {
+        memcpy(&datum, src + i * sizeof(S), sizeof(S));
+        if (swapped)
+          swabValue(datum);
+        dst[i] = static_cast<T>(datum);
+      }
+    }
+
+    template<typename T>
+    void convertBinaryData(const char* src, const BinaryMatrixHeader& h, const bool swapped, T* dst) {
+      switch(h.type) {
+      case BinaryInt32: convertElements<boost::int32_t, T>(src, h.elements, swapped, dst); break;
+      case BinaryUInt32: convertElements<boost::uint32_t, T>(src, h.elements, swapped, dst); break;
+      case BinaryInt64: convertElements<boost::int64_t, T>(src, h.elements, swapped, dst); break;
+      case BinaryUInt64: convertElements<boost::uint64_t, T>(src, h.elements, swapped, dst); break;
+      case BinaryFloat32: convertElements<float, T>(src, h.elements, swapped, dst); break;
+      case BinaryFloat64: convertElements<double, T>(src, h.elements, swapped, dst); break;
+      }
+    }
+
+
+    // Copy from a dense matrix of one order into an arbitrary matrix,
+    // leaving zeros unset (so sparse matrices stay sparse)
+    template<class T, class P1, class P2, template<typename> class S>
+    void copyMatrixElements(const Math::Matrix<T,P1>& A, Math::Matrix<T,P2,S>& B) {
+      for (uint i=0; i<A.cols(); ++i)
+        for (uint j=0; j<A.rows(); ++j) {
+          const T& t = A(j, i);
+          if (t != 0)
+            B(j, i) = t;
+        }
+    }
+
+    template<class T, class P, template<typename> class S>
+    Math::Matrix<T,P,S> reorderBinaryData(const boost::shared_array<T>& data, const BinaryMatrixHeader& h) {
+      Math::Matrix<T,P,S> M(h.rows, h.cols);
+      switch(h.order) {
+      case 0: copyMatrixElements(Math::Matrix<T,Math::ColMajor>(data, h.rows, h.cols), M); break;
+      case 1: copyMatrixElements(Math::Matrix<T,Math::RowMajor>(data, h.rows, h.cols), M); break;
+      case 2: copyMatrixElements(Math::Matrix<T,Math::Triangular>(data, h.rows, h.cols), M); break;
+      }
+      return(M);
+    }
+
+
+    // Owns a memory-mapped file and releases it when the last
+    // shared_array referencing it goes away
+    struct MappedRegion {
+      MappedRegion(void* p, const size_t n) : base(p), length(n) { }
+      template<typename T> void operator()(T*) { munmap(base, length); }
+
+      void* base;
+      size_t length;
+    };
+
+
+    // Use the data block directly when it is already in the right
+    // order.  This is only possible for dense storage.
+    template<class T, class P, template<typename> class S>
+    struct BinaryMatrixAdopt {
+      static bool adopt(const boost::shared_array<T>&, const BinaryMatrixHeader&, Math::Matrix<T,P,S>&) { return(false); }
+    };
+
+    template<class T, class P>
+    struct BinaryMatrixAdopt<T,P,Math::SharedArray> {
+      static bool adopt(const boost::shared_array<T>& data, const BinaryMatrixHeader& h, Math::Matrix<T,P,Math::SharedArray>& M) {
+        if (h.order != BinaryMatrixOrder<P>::code)
+          return(false);
+        M = Math::Matrix<T,P,Math::SharedArray>(data, h.rows, h.cols);
+        return(true);
+      }
+    };
+
+
+    // Writes the header, metadata, and padding, returning the offset of the data
+    template<typename T, class P>
+    ulong writeBinaryMatrixHeader(std::ostream& os, const uint rows, const uint cols, const std::string& meta) {
+      BinaryMatrixHeader h;
+      memcpy(h.magic, binary_matrix_magic, sizeof(h.magic));
+      h.version = binary_matrix_version;
+      h.endian = binary_matrix_endian;
+      h.type = BinaryMatrixType<T>::code;
+      h.order = BinaryMatrixOrder<P>::code;
+      h.rows = rows;
+      h.cols = cols;
+      h.elements = P(rows, cols).size();
+      h.metalen = meta.size();
+
+      ulong a = binary_matrix_alignment;
+      h.offset = ((sizeof(h) + meta.size() + a - 1) / a) * a;
+
+      os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      os.write(meta.data(), meta.size());
+      std::vector<char> pad(h.offset - sizeof(h) - meta.size(), '\0');
+      if (!pad.empty())
+        os.write(&pad[0], pad.size());
+
+      return(h.offset);
+    }
+
+  }
+
+
+  // Forward declaration...
+  template<class T, class P, template<typename> class S>
+  struct MatrixBinaryReadImpl;
+
+
+  //! Returns true if the stream is positioned at a binary matrix
+  inline bool isBinaryMatrix(std::istream& is) {
+    return(is.peek() == static_cast<unsigned char>(internal::binary_matrix_magic[0]));
+  }
+
+  //! Returns true if the named file contains a binary matrix
+  inline bool isBinaryMatrix(const std::string& fname) {
+    std::ifstream ifs(fname.c_str(), std::ios::binary);
+    if (!ifs)
+      throw(MatrixReadError("Cannot open " + fname + " for reading."));
+    char buf[sizeof(internal::binary_matrix_magic)];
+    if (!ifs.read(buf, sizeof(buf)))
+      return(false);
+    return(memcmp(buf, internal::binary_matrix_magic, sizeof(buf)) == 0);
+  }
+
+
+  //! Read a binary matrix from a stream
+  template<class T, class P, template<typename> class S>
+  Math::Matrix<T,P,S> readBinaryMatrix(std::istream& is) {
+    return(MatrixBinaryReadImpl<T,P,S>::read(is));
+  }
+
+  //! Read a binary matrix from a file, memory-mapping it if possible
+  /**
+   * If the element type and order in the file match the requested
+   * matrix (and the byte order is native), the returned matrix refers
+   * directly to a private memory-map of the file, so no data is copied
+   * until it is touched.  Changes to the matrix are never written back
+   * to the file.  Otherwise, the data is converted into a newly
+   * allocated matrix.
+   */
+  template<class T, class P, template<typename> class S>
+  Math::Matrix<T,P,S> readBinaryMatrix(const std::string& fname) {
+    return(MatrixBinaryReadImpl<T,P,S>::read(fname));
+  }
+
+  //! Read a binary matrix from a file storing it in the specified matrix
+  template<class T, class P, template<typename> class S>
+  void readBinaryMatrix(const std::string& fname, Math::Matrix<T,P,S>& M) {
+    M = MatrixBinaryReadImpl<T,P,S>::read(fname);
+  }
+
+
+
+  template<class T, class P, template<typename> class S>
+  struct MatrixBinaryReadImpl {
+
+    static Math::Matrix<T,P,S> read(std::istream& is) {
+      BinaryMatrixHeader h;
+      if (!is.read(reinterpret_cast<char*>(&h), sizeof(h)))
+        throw(MatrixReadError("Cannot read binary matrix header"));
+      bool swapped = internal::checkBinaryMatrixHeader(h);
+
+      std::string meta(h.metalen, '\0');
+      if (h.metalen && !is.read(&meta[0], h.metalen))
+        throw(MatrixReadError("Cannot read binary matrix metadata"));
+      is.ignore(h.offset - sizeof(h) - h.metalen);
+
+      ulong bytes = h.elements * internal::binaryMatrixElementSize(h.type);
+      std::vector<char> raw(bytes);
+      if (bytes && !is.read(&raw[0], bytes))
+        throw(MatrixReadError("Cannot read binary matrix data"));
+
+      Math::Matrix<T,P,S> M = fromRaw(bytes ? &raw[0] : 0, h, swapped);
+      M.metaData(meta);
+      return(M);
+    }
+
+
+    static Math::Matrix<T,P,S> read(const std::string& fname) {
+      int fd = open(fname.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw(MatrixReadError("Cannot open " + fname + " for reading."));
+
+      struct stat st;
+      if (fstat(fd, &st) < 0 || static_cast<ulong>(st.st_size) < sizeof(BinaryMatrixHeader)) {
+        close(fd);
+        throw(MatrixReadError("Cannot read binary matrix header from " + fname));
+      }
+
+      size_t length = st.st_size;
+      void* base = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (base == MAP_FAILED) {
+        // Fall back to regular I/O (e.g. for a pipe or special file)
+        std::ifstream ifs(fname.c_str(), std::ios::binary);
+        if (!ifs)
+          throw(MatrixReadError("Cannot open " + fname + " for reading."));
+        return(read(ifs));
+      }
+
+      BinaryMatrixHeader h;
+      bool swapped;
+      std::string meta;
+      try {
+        memcpy(&h, base, sizeof(h));
+        swapped = internal::checkBinaryMatrixHeader(h);
+        ulong bytes = h.elements * internal::binaryMatrixElementSize(h.type);
+        if (h.offset < sizeof(h) + h.metalen || h.offset + bytes > length)
+          throw(MatrixReadError("Binary matrix " + fname + " is truncated"));
+        meta = std::string(static_cast<char*>(base) + sizeof(h), h.metalen);
+      }
+      catch (...) {
+        munmap(base, length);
+        throw;
+      }
+
+      Math::Matrix<T,P,S> M;
+      if (!swapped && h.type == internal::BinaryMatrixType<T>::code) {
+        // The mapping now belongs to the shared_array, and is released
+        // when the last matrix referring to it goes away...
+        T* data = reinterpret_cast<T*>(static_cast<char*>(base) + h.offset);
+        boost::shared_array<T> p(data, internal::MappedRegion(base, length));
+        if (!internal::BinaryMatrixAdopt<T,P,S>::adopt(p, h, M))
+          M = internal::reorderBinaryData<T,P,S>(p, h);
+      } else {
+        try {
+          M = fromRaw(static_cast<char*>(base) + h.offset, h, swapped);
+        }
+        catch (...) {
+          munmap(base, length);
+          throw;
+        }
+        munmap(base, length);
+      }
+
+      M.metaData(meta);
+      return(M);
+    }
+
+
+  private:
+
+    static Math::Matrix<T,P,S> fromRaw(const char* raw, const BinaryMatrixHeader& h, const bool swapped) {
+      boost::shared_array<T> data(new T[h.elements]);
+      internal::convertBinaryData(raw, h, swapped, data.get());
+
+      Math::Matrix<T,P,S> M;
+      if (!internal::BinaryMatrixAdopt<T,P,S>::adopt(data, h, M))
+        M = internal::reorderBinaryData<T,P,S>(data, h);
+      return(M);
+    }
+  };
+
+
+
+  //! Write a matrix to a binary stream
+  /**
+   * The matrix is written in its in-memory order along with its
+   * dimensions, element type, and the \a meta string.  This is much
+   * faster to write (and read back) than writeAsciiMatrix(), and
+   * readAsciiMatrix() will automatically recognize the binary format.
+   */
+  template<class T, class P, template<typename> class S>
+  std::ostream& writeBinaryMatrix(std::ostream& os, const Math::Matrix<T,P,S>& M, const std::string& meta) {
+    internal::writeBinaryMatrixHeader<T,P>(os, M.rows(), M.cols(), meta);
+
+    // Go through operator[] in blocks so this works for any storage policy
+    static const ulong block = 65536;
+    std::vector<T> buf;
+    buf.reserve(block);
+    ulong n = M.size();
+    for (ulong i=0; i<n; ) {
+      buf.clear();
+      for (ulong k=0; k<block && i<n; ++k, ++i)
+        buf.push_back(M[i]);
+      os.write(reinterpret_cast<const char*>(&buf[0]), buf.size() * sizeof(T));
+    }
+
+    return(os);
+  }
+
+
+  //! Write a matrix to a binary file
+  template<class T, class P, template<typename> class S>
+  void writeBinaryMatrix(const std::string& fname, const Math::Matrix<T,P,S>& M, const std::string& meta) {
+    std::ofstream ofs(fname.c_str(), std::ios::binary);
+    if (!ofs.is_open())
+      throw(std::runtime_error("Cannot open " + fname + " for writing."));
+    writeBinaryMatrix(ofs, M, meta);
+    if (!ofs)
+      throw(std::runtime_error("Error while writing binary matrix to " + fname));
+  }
+
+
+
+  //! Write a binary matrix incrementally
+  /**
+   * For matrices that are too large to hold in memory (or that are
+   * computed a piece at a time), BinaryMatrixWriter writes the header
+   * up front and then accepts elements in the storage order of \a P
+   * (i.e. a column at a time for ColMajor, a row at a time for RowMajor,
+   * or the lower triangle by rows for Triangular).
+   *
+   * Example:
+   *\code
+   * BinaryMatrixWriter<float, Math::RowMajor> writer("rmsds.bin", n, n, header);
+   * for (uint j=0; j<n; ++j) {
+   *   computeRow(j, row);
+   *   writer.write(&row[0], n);
+   * }
+   * writer.close();
+   *\endcode
+   */
+  template<typename T, class P = Math::ColMajor>
+  class BinaryMatrixWriter {
+  public:
+    BinaryMatrixWriter(const std::string& fname, const uint rows, const uint cols, const std::string& meta)
+      : ofs_(fname.c_str(), std::ios::binary), fname_(fname), written_(0)
+    {
+      if (!ofs_.is_open())
+        throw(std::runtime_error("Cannot open " + fname + " for writing."));
+
+      expected_ = P(rows, cols).size();
+      internal::writeBinaryMatrixHeader<T,P>(ofs_, rows, cols, meta);
+    }
+
+    ~BinaryMatrixWriter() {
+      if (ofs_.is_open())
+        ofs_.close();
+    }
+
+    //! Append \a n elements
+    void write(const T* p, const ulong n) {
+      if (written_ + n > expected_)
+        throw(std::runtime_error("Too many elements written to binary matrix " + fname_));
+      ofs_.write(reinterpret_cast<const char*>(p), n * sizeof(T));
+      written_ += n;
+    }
+
+    //! Append a single element
+    void write(const T& t) { write(&t, 1); }
+
+    ulong written() const { return(written_); }
+    ulong expected() const { return(expected_); }
+
+    //! Finish the file, checking that the whole matrix was written
+    void close() {
+      ofs_.close();
+      if (!ofs_)
+        throw(std::runtime_error("Error while writing binary matrix to " + fname_));
+      if (written_ != expected_)
+        throw(std::runtime_error("Binary matrix " + fname_ + " is incomplete"));
+    }
+
+  private:
+    std::ofstream ofs_;
+    std::string fname_;
+    ulong written_, expected_;
+  };
+
+
+}
+
+#endif
@@ -161,6 +161,14 @@ writeAsciiMatrix(filename, M, "My matrix");
                                                  StoragePolicy<T>(p, OrderPolicy::size()),
                                                  meta("") { }
 
+      //! Share an existing block of data (e.g. a memory-mapped file)
+      /**
+       * Only makes sense for dense storage
+       */
+      Matrix(const boost::shared_array<T>& p, const uint b, const uint a) : OrderPolicy(b, a),
+                                                                           StoragePolicy<T>(p, OrderPolicy::size()),
+                                                                           meta("") { }
+
       //! Create a new block of data for the requested Matrix
       Matrix(const uint b, const uint a) : OrderPolicy(b, a),
                                            StoragePolicy<T>(OrderPolicy::size()),
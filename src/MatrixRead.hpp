@@ -60,6 +60,12 @@ namespace loos {
   template<class T, class P, template<typename> class S>
   struct MatrixReadImpl;
 
+  // Binary matrices (see MatrixBinary.hpp) are recognized automatically
+  template<class T, class P, template<typename> class S>
+  struct MatrixBinaryReadImpl;
+
+  inline bool isBinaryMatrix(std::istream&);
+
 
 
   // The following are the templated global functions.  Do not
@@ -68,33 +74,44 @@ namespace loos {
 
 
   //! Read in a matrix from a stream returning a newly created matrix
+  /**
+   * All of the readAsciiMatrix() functions will also accept a matrix
+   * written by writeBinaryMatrix(), so tools do not need to know which
+   * format they were given.
+   */
   template<class T, class P, template<typename> class S>
   Math::Matrix<T,P,S> readAsciiMatrix(std::istream& is) {
+    if (isBinaryMatrix(is))
+      return(MatrixBinaryReadImpl<T,P,S>::read(is));
     return(MatrixReadImpl<T,P,S>::read(is));
   }
 
   //! Read in a matrix from a stream storing it in the specified matrix
   template<class T, class P, template<typename> class S>
   void readAsciiMatrix(std::istream& is, Math::Matrix<T,P,S>& M) {
-    M = MatrixReadImpl<T,P,S>::read(is);
+    M = readAsciiMatrix<T,P,S>(is);
   }
 
   //! Read in a matrix from a file returning a newly created matrix
+  /**
+   * Binary matrix files are memory-mapped rather than read
+   */
   template<class T, class P, template<typename> class S>
   Math::Matrix<T,P,S> readAsciiMatrix(const std::string& fname) {
     std::ifstream ifs(fname.c_str());
     if (!ifs)
       throw(MatrixReadError("Cannot open " + fname + " for reading."));
+    if (isBinaryMatrix(ifs)) {
+      ifs.close();
+      return(MatrixBinaryReadImpl<T,P,S>::read(fname));
+    }
     return(MatrixReadImpl<T,P,S>::read(ifs));
   }
 
   //! Read in a matrix from a file storing it in the specified matrix
   template<class T, class P, template<typename> class S>
   void readAsciiMatrix(const std::string& fname, Math::Matrix<T,P,S>& M) {
-    std::ifstream ifs(fname.c_str());
-    if (!ifs)
-      throw(MatrixReadError("Cannot open " + fname + " for reading."));
-    M = MatrixReadImpl<T,P,S>::read(ifs);
+    M = readAsciiMatrix<T,P,S>(fname);
   }
 
   // Implementations and specializations...
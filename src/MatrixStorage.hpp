@@ -63,6 +63,8 @@ namespace loos {
 
       SharedArray(const ulong n) : dim_(n) { allocate(n); }
       SharedArray(T* p, const ulong n) : dim_(n), dptr(p) { }
+      //! Share an existing block (which may have its own deleter, e.g. for a memory-map)
+      SharedArray(const boost::shared_array<T>& p, const ulong n) : dim_(n), dptr(p) { }
 
       // In some cases, BOOST makes dptr(0) a shared_array<int> which
       // will cause subsequent type problems.  So, we force it to be a NULL
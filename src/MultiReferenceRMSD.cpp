@@ -0,0 +1,231 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <MultiReferenceRMSD.hpp>
+#include <exceptions.hpp>
+
+#include <cmath>
+#include <boost/thread/thread.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Largest eigenvalue of Horn's quaternion matrix for the correlation
+    // S between two centered structures, with E0 = (Ga + Gb) / 2 as the
+    // starting guess (it is an upper bound).  The coefficients of the
+    // characteristic polynomial are from Theobald, Acta Cryst. A61,
+    // 478-480 (2005).
+    double largestEigenvalue(const double S[3][3], const double E0) {
+      double Sxx = S[0][0], Sxy = S[0][1], Sxz = S[0][2];
+      double Syx = S[1][0], Syy = S[1][1], Syz = S[1][2];
+      double Szx = S[2][0], Szy = S[2][1], Szz = S[2][2];
+
+      double Sxx2 = Sxx * Sxx, Syy2 = Syy * Syy, Szz2 = Szz * Szz;
+      double Sxy2 = Sxy * Sxy, Syz2 = Syz * Syz, Sxz2 = Sxz * Sxz;
+      double Syx2 = Syx * Syx, Szy2 = Szy * Szy, Szx2 = Szx * Szx;
+
+      double SyzSzymSyySzz2 = 2.0 * (Syz * Szy - Syy * Szz);
+      double Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+      double Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+      double C2 = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+      double C1 = 8.0 * (Sxx * Syz * Szy + Syy * Szx * Sxz + Szz * Sxy * Syx
+                         - Sxx * Syy * Szz - Syz * Szx * Sxy - Szy * Syx * Sxz);
+
+      double SxzpSzx = Sxz + Szx, SyzpSzy = Syz + Szy, SxypSyx = Sxy + Syx;
+      double SyzmSzy = Syz - Szy, SxzmSzx = Sxz - Szx, SxymSyx = Sxy - Syx;
+      double SxxpSyy = Sxx + Syy, SxxmSyy = Sxx - Syy;
+
+      double C0 = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2
+        + (Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2)
+        + (-SxzpSzx * SyzmSzy + SxymSyx * (SxxmSyy - Szz)) * (-SxzmSzx * SyzpSzy + SxymSyx * (SxxmSyy + Szz))
+        + (-SxzpSzx * SyzpSzy - SxypSyx * (SxxpSyy - Szz)) * (-SxzmSzx * SyzmSzy - SxypSyx * (SxxpSyy + Szz))
+        + (SxypSyx * SyzpSzy + SxzpSzx * (SxxmSyy + Szz)) * (-SxymSyx * SyzmSzy + SxzpSzx * (SxxpSyy + Szz))
+        + (SxypSyx * SyzmSzy + SxzmSzx * (SxxmSyy - Szz)) * (-SxymSyx * SyzpSzy + SxzmSzx * (SxxpSyy - Szz));
+
+      double lambda = E0;
+      for (uint i=0; i<50; ++i) {
+        double old = lambda;
+        double x2 = lambda * lambda;
+        double b = (x2 + C2) * lambda;
+        double a = b + C1;
+        double denom = 2.0 * x2 * lambda + b + a;
+        if (denom == 0.0)
+          break;
+        lambda -= (a * lambda + C0) / denom;
+        if (std::fabs(lambda - old) < std::fabs(1e-11 * lambda))
+          break;
+      }
+
+      return(lambda);
+    }
+
+  }
+
+
+
+  MultiReferenceRMSD::MultiReferenceRMSD(const std::vector<AtomicGroup>& references) : _nthreads(1) {
+    if (references.empty())
+      throw(LOOSError("MultiReferenceRMSD needs at least one reference"));
+
+    _nrefs = references.size();
+    _natoms = references[0].size();
+    if (!_natoms)
+      throw(LOOSError("MultiReferenceRMSD references cannot be empty"));
+    _refs.resize(static_cast<ulong>(_nrefs) * _natoms * 3);
+
+    double* p = &(_refs[0]);
+    for (uint i=0; i<_nrefs; ++i) {
+      if (references[i].size() != _natoms)
+        throw(LOOSError("References must all be the same size in MultiReferenceRMSD"));
+      for (uint j=0; j<_natoms; ++j) {
+        const GCoord& c = references[i][j]->coords();
+        *(p++) = c[0];
+        *(p++) = c[1];
+        *(p++) = c[2];
+      }
+    }
+    center();
+  }
+
+
+  MultiReferenceRMSD::MultiReferenceRMSD(const std::vector< std::vector<double> >& references) : _nthreads(1) {
+    if (references.empty())
+      throw(LOOSError("MultiReferenceRMSD needs at least one reference"));
+
+    _nrefs = references.size();
+    _natoms = references[0].size() / 3;
+    if (!_natoms)
+      throw(LOOSError("MultiReferenceRMSD references cannot be empty"));
+    _refs.resize(static_cast<ulong>(_nrefs) * _natoms * 3);
+
+    double* p = &(_refs[0]);
+    for (uint i=0; i<_nrefs; ++i) {
+      if (references[i].size() != _natoms * 3)
+        throw(LOOSError("References must all be the same size in MultiReferenceRMSD"));
+      std::copy(references[i].begin(), references[i].end(), p);
+      p += references[i].size();
+    }
+    center();
+  }
+
+
+  // Centers each reference at the origin and caches its inner product
+  void MultiReferenceRMSD::center() {
+    _inner.resize(_nrefs);
+    for (uint i=0; i<_nrefs; ++i) {
+      double* x = &(_refs[static_cast<ulong>(i) * _natoms * 3]);
+      double c[3] = {0.0, 0.0, 0.0};
+      for (uint j=0; j<_natoms; ++j)
+        for (uint k=0; k<3; ++k)
+          c[k] += x[3*j+k];
+      for (uint k=0; k<3; ++k)
+        c[k] /= _natoms;
+
+      double g = 0.0;
+      for (uint j=0; j<_natoms; ++j)
+        for (uint k=0; k<3; ++k) {
+          double d = (x[3*j+k] -= c[k]);
+          g += d * d;
+        }
+      _inner[i] = g;
+    }
+  }
+
+
+  void MultiReferenceRMSD::threads(const uint n) {
+    _nthreads = n ? n : boost::thread::hardware_concurrency();
+    if (_nthreads < 1)
+      _nthreads = 1;
+  }
+
+
+  void MultiReferenceRMSD::rmsds(const double* frame, double* out, std::vector<double>& y) const {
+    uint nrows = _natoms * 3;
+    y.resize(nrows);
+
+    double c[3] = {0.0, 0.0, 0.0};
+    for (uint j=0; j<_natoms; ++j)
+      for (uint k=0; k<3; ++k)
+        c[k] += frame[3*j+k];
+    for (uint k=0; k<3; ++k)
+      c[k] /= _natoms;
+
+    double g = 0.0;
+    for (uint j=0; j<_natoms; ++j)
+      for (uint k=0; k<3; ++k) {
+        double d = frame[3*j+k] - c[k];
+        y[3*j+k] = d;
+        g += d * d;
+      }
+
+    for (uint i=0; i<_nrefs; ++i) {
+      const double* x = &(_refs[static_cast<ulong>(i) * nrows]);
+      double S[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+      for (uint j=0; j<nrows; j += 3) {
+        double y0 = y[j], y1 = y[j+1], y2 = y[j+2];
+        double x0 = x[j], x1 = x[j+1], x2 = x[j+2];
+        S[0][0] += x0 * y0;  S[0][1] += x0 * y1;  S[0][2] += x0 * y2;
+        S[1][0] += x1 * y0;  S[1][1] += x1 * y1;  S[1][2] += x1 * y2;
+        S[2][0] += x2 * y0;  S[2][1] += x2 * y1;  S[2][2] += x2 * y2;
+      }
+
+      double E0 = (g + _inner[i]) / 2.0;
+      double lambda = largestEigenvalue(S, E0);
+      out[i] = std::sqrt(std::fabs(2.0 * (E0 - lambda) / _natoms));
+    }
+  }
+
+
+  void MultiReferenceRMSD::rmsds(const double* frame, double* out) const {
+    std::vector<double> scratch;
+    rmsds(frame, out, scratch);
+  }
+
+
+  void MultiReferenceRMSD::Worker::operator()() {
+    std::vector<double> scratch;
+    ulong nrows = engine->_natoms * 3;
+    for (uint i=begin; i<end; ++i)
+      engine->rmsds(frames + i * nrows, out + static_cast<ulong>(i) * engine->_nrefs, scratch);
+  }
+
+
+  void MultiReferenceRMSD::rmsds(const double* frames, const uint n, double* out) const {
+    uint nthreads = std::min(_nthreads, n);
+    if (nthreads <= 1) {
+      Worker worker(this, frames, out, 0, n);
+      worker();
+      return;
+    }
+
+    uint chunk = (n + nthreads - 1) / nthreads;
+    boost::thread_group threads;
+    for (uint t=0; t<nthreads; ++t)
+      threads.create_thread(Worker(this, frames, out, t * chunk, std::min(n, (t+1) * chunk)));
+    threads.join_all();
+  }
+
+
+}
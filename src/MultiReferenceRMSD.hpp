@@ -0,0 +1,141 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_MULTIREFERENCERMSD_HPP)
+#define LOOS_MULTIREFERENCERMSD_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! RMSD time-series of a trajectory against several references at once
+  /**
+   * The references are copied into a single array and centered once,
+   * up front.  For each frame, rmsds() finds the minimum (superposition)
+   * RMSD to every reference, giving one row of an F x K matrix for F
+   * frames and K references.
+   *
+   * The RMSD comes from the largest eigenvalue of Horn's 4x4 quaternion
+   * matrix, found by Newton iteration on its characteristic polynomial
+   * (Theobald's QCP method), so no rotation is ever built or applied
+   * and no LAPACK calls are made.  The frames in a block are split
+   * across threads(), and each row depends only on its own frame, so
+   * the results do not depend on the number of threads.
+   *
+   * stream() reads the frames of a trajectory a block at a time and
+   * passes each block of rows on to a sink, so the trajectory is only
+   * read once and never held in memory.
+   */
+  class MultiReferenceRMSD {
+  public:
+    explicit MultiReferenceRMSD(const std::vector<AtomicGroup>& references);
+    explicit MultiReferenceRMSD(const std::vector< std::vector<double> >& references);
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n);
+    uint threads() const { return(_nthreads); }
+
+    uint references() const { return(_nrefs); }
+    uint atoms() const { return(_natoms); }
+
+    //! RMSD between a (not necessarily centered) frame and each reference
+    void rmsds(const double* frame, double* out) const;
+
+    //! RMSDs for \a n contiguous frames, giving \a n rows of references() values
+    void rmsds(const double* frames, const uint n, double* out) const;
+
+
+    //! Computes the RMSDs for the given frames of a trajectory
+    /**
+     * Frames are read into \a subset (which must match the references)
+     * \a blocksize at a time, and the RMSDs for each block are passed
+     * to \a sink as
+     *\code
+     * sink(const double* rows, const uint nframes);
+     *\endcode
+     * in frame order.  A blocksize of 0 picks one based on threads().
+     * Returns the number of frames processed.
+     */
+    template<class Sink>
+    uint stream(AtomicGroup& subset, pTraj& traj, const std::vector<uint>& indices, Sink& sink, uint blocksize = 0) const {
+      if (subset.size() != _natoms)
+        throw(LOOSError("Subset does not match the references in MultiReferenceRMSD"));
+
+      if (!blocksize)
+        blocksize = 64 * _nthreads;
+      uint nrows = _natoms * 3;
+      std::vector<double> frames(static_cast<ulong>(blocksize) * nrows);
+      std::vector<double> out(static_cast<ulong>(blocksize) * _nrefs);
+
+      for (uint i=0; i<indices.size(); i += blocksize) {
+        uint n = std::min(blocksize, static_cast<uint>(indices.size() - i));
+        for (uint j=0; j<n; ++j) {
+          traj->readFrame(indices[i+j]);
+          traj->updateGroupCoords(subset);
+          double* p = &(frames[static_cast<ulong>(j) * nrows]);
+          for (uint k=0; k<_natoms; ++k) {
+            const GCoord& c = subset[k]->coords();
+            *(p++) = c[0];
+            *(p++) = c[1];
+            *(p++) = c[2];
+          }
+        }
+        rmsds(&(frames[0]), n, &(out[0]));
+        sink(static_cast<const double*>(&(out[0])), n);
+      }
+
+      return(indices.size());
+    }
+
+  private:
+    struct Worker {
+      Worker(const MultiReferenceRMSD* m, const double* f, double* o, const uint b, const uint e)
+        : engine(m), frames(f), out(o), begin(b), end(e) { }
+      void operator()();
+
+      const MultiReferenceRMSD* engine;
+      const double* frames;
+      double* out;
+      uint begin, end;
+    };
+
+    void center();
+    void rmsds(const double* frame, double* out, std::vector<double>& scratch) const;
+
+    uint _nrefs, _natoms, _nthreads;
+    std::vector<double> _refs;
+    std::vector<double> _inner;
+  };
+
+
+}
+
+
+#endif
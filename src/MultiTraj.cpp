@@ -87,6 +87,13 @@ namespace loos {
 	}
 
 
+	//! Passes the selection hint along to all contained trajectories
+	void MultiTrajectory::selectionHintChanged() {
+		for (uint i=0; i<_trajectories.size(); ++i)
+			_trajectories[i]->setSelectionHint(_hint_runs);
+	}
+
+
 	void MultiTrajectory::initWithList(const std::vector<std::string>& filenames, const AtomicGroup& model) {
 		for (uint i=0; i<filenames.size(); ++i) {
 			pTraj traj = createTrajectory(filenames[i], model);
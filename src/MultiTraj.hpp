@@ -81,6 +81,8 @@ namespace loos {
 		//! Add a trajectory (by filename)
 		void addTrajectory(const std::string& filename) {
 			pTraj traj = createTrajectory(filename, _model);
+			if (hasSelectionHint())
+				traj->setSelectionHint(_hint_runs);
 			_trajectories.push_back(traj);
 			if (traj->nframes() > _skip)
 				_nframes += (traj->nframes() - _skip) / _stride;
@@ -164,6 +166,7 @@ namespace loos {
 		virtual bool parseFrame();
 		virtual void updateGroupCoordsImpl(AtomicGroup& g);
 		virtual void updateGroupVelocitiesImpl(AtomicGroup& g);
+		virtual void selectionHintChanged();
 
 		void findNextUsableTraj();
 
@@ -0,0 +1,133 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <NeighborGrid.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    struct Counter {
+      Counter() : n(0) { }
+      void operator()(const uint, const double) { ++n; }
+      uint n;
+    };
+
+    struct Collector {
+      Collector(std::vector<uint>& l) : list(l) { }
+      void operator()(const uint i, const double) { list.push_back(i); }
+      std::vector<uint>& list;
+    };
+
+  }
+
+
+  void NeighborGrid::update(const AtomicGroup& atoms) {
+    if (_cutoff <= 0.0)
+      throw(LOOSError("NeighborGrid cutoff must be positive"));
+
+    uint n = atoms.size();
+    std::vector<GCoord> crds(n);
+
+    if (_periodic) {
+      if (!atoms.isPeriodic())
+        throw(LOOSError("NeighborGrid requires a periodic box when built as periodic"));
+      _box = atoms.periodicBox();
+      _min = GCoord(0, 0, 0);
+      for (uint k=0; k<3; ++k) {
+        _dims[k] = static_cast<uint>(floor(_box[k] / _cutoff));
+        if (_dims[k] == 0)
+          _dims[k] = 1;
+        _cell[k] = _box[k] / _dims[k];
+      }
+      for (uint i=0; i<n; ++i)
+        crds[i] = wrap(atoms[i]->coords());
+
+    } else {
+      for (uint i=0; i<n; ++i)
+        crds[i] = atoms[i]->coords();
+
+      GCoord extent(0, 0, 0);
+      if (n) {
+        std::vector<GCoord> bdd = atoms.boundingBox();
+        _min = bdd[0];
+        extent = bdd[1] - bdd[0];
+      }
+
+      // Keep the number of cells reasonable for very sparse systems
+      double cell = _cutoff;
+      while (true) {
+        ulong total = 1;
+        for (uint k=0; k<3; ++k) {
+          _dims[k] = static_cast<uint>(floor(extent[k] / cell)) + 1;
+          total *= _dims[k];
+        }
+        if (total <= 8ul * n + 27)
+          break;
+        cell *= 1.5;
+      }
+      _cell = GCoord(cell, cell, cell);
+    }
+
+
+    // Counting sort of the atoms by cell
+    uint ncells = _dims[0] * _dims[1] * _dims[2];
+    std::vector<uint> which(n);
+    _start.assign(ncells + 1, 0);
+    for (uint i=0; i<n; ++i) {
+      int c[3];
+      cellCoords(crds[i], c);
+      for (uint k=0; k<3; ++k)
+        if (c[k] < 0)
+          c[k] = 0;
+      which[i] = (c[2] * _dims[1] + c[1]) * _dims[0] + c[0];
+      ++_start[which[i] + 1];
+    }
+    for (uint c=0; c<ncells; ++c)
+      _start[c+1] += _start[c];
+
+    std::vector<uint> fill(_start.begin(), _start.end() - 1);
+    _crds.resize(n);
+    _index.resize(n);
+    for (uint i=0; i<n; ++i) {
+      uint k = fill[which[i]]++;
+      _crds[k] = crds[i];
+      _index[k] = i;
+    }
+  }
+
+
+  uint NeighborGrid::count(const GCoord& u, const double inner, const double outer) const {
+    Counter c;
+    forEachNeighbor(u, inner, outer, c);
+    return(c.n);
+  }
+
+
+  void NeighborGrid::neighbors(const GCoord& u, const double inner, const double outer, std::vector<uint>& list) const {
+    Collector c(list);
+    forEachNeighbor(u, inner, outer, c);
+  }
+
+}
@@ -0,0 +1,208 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_NEIGHBORGRID_HPP)
+#define LOOS_NEIGHBORGRID_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+
+  //! Cell list for finding atoms within a distance of a point
+  /**
+   * The atoms of a group are binned into cubic-ish cells at least as
+   * large as the cutoff, so all atoms within the cutoff of a point lie
+   * in the 27 cells around it.  Finding the neighbors of N points is
+   * then O(N) rather than a scan over every atom for each point.
+   *
+   * When built as periodic, coordinates are wrapped into the box, the
+   * cells tile the whole box, and distances use the minimum image
+   * (as GCoord::distance2(u, box) does).  Otherwise, the cells cover
+   * the bounding box of the atoms.
+   *
+   * The grid holds a snapshot of the coordinates, so call update()
+   * after reading each frame.  Neighbors are reported by their index
+   * in the group used to build the grid.  Queries are const and may be
+   * made from multiple threads at once.
+   *
+   *\code
+   * NeighborGrid grid(target, outer, true);
+   * while (traj->readFrame()) {
+   *   traj->updateGroupCoords(model);
+   *   grid.update(target);
+   *   for (uint i=0; i<probe.size(); ++i)
+   *     n += grid.count(probe[i]->coords(), inner, outer);
+   * }
+   *\endcode
+   */
+  class NeighborGrid {
+  public:
+    NeighborGrid() : _cutoff(0.0), _periodic(false) { }
+
+    //! Build a grid for \a atoms with neighbors out to \a cutoff
+    /**
+     * If \a periodic is true, \a atoms must have a periodic box.  The
+     * cutoff should be no more than half the smallest box length for
+     * the minimum image to be unambiguous.
+     */
+    NeighborGrid(const AtomicGroup& atoms, const double cutoff, const bool periodic = false)
+      : _cutoff(cutoff), _periodic(periodic)
+    {
+      update(atoms);
+    }
+
+    //! Re-bin using the current coordinates of \a atoms
+    /**
+     * \a atoms should be the same group (in the same order) the grid
+     * was built from.  For periodic grids, the box is re-read as well.
+     */
+    void update(const AtomicGroup& atoms);
+
+    uint size() const { return(_index.size()); }
+    double cutoff() const { return(_cutoff); }
+    bool periodic() const { return(_periodic); }
+
+
+    //! Calls \a f(i, d2) for each atom i with inner^2 <= d2 <= outer^2 from \a u
+    /**
+     * \a outer must not exceed the cutoff the grid was built with.
+     * \a f is a functor taking (uint index, double distance-squared).
+     */
+    template<class Visitor>
+    void forEachNeighbor(const GCoord& u, const double inner, const double outer, Visitor& f) const {
+      if (_index.empty())
+        return;
+
+      double ir2 = inner * inner;
+      double or2 = outer * outer;
+      GCoord v = _periodic ? wrap(u) : u;
+      int c[3];
+      cellCoords(v, c);
+
+      // In a periodic dimension with fewer than 3 cells, the +/- 1
+      // neighborhood would visit some cells twice, so visit every
+      // cell in that dimension once instead
+      int lo[3], hi[3];
+      for (uint k=0; k<3; ++k) {
+        if (_periodic && _dims[k] < 3) {
+          lo[k] = 0;
+          hi[k] = _dims[k] - 1;
+        } else {
+          lo[k] = c[k] - 1;
+          hi[k] = c[k] + 1;
+        }
+      }
+
+      for (int z = lo[2]; z <= hi[2]; ++z) {
+        int cz = cellIndex1(z, 2);
+        if (cz < 0)
+          continue;
+        for (int y = lo[1]; y <= hi[1]; ++y) {
+          int cy = cellIndex1(y, 1);
+          if (cy < 0)
+            continue;
+          for (int x = lo[0]; x <= hi[0]; ++x) {
+            int cx = cellIndex1(x, 0);
+            if (cx < 0)
+              continue;
+
+            uint cell = (cz * _dims[1] + cy) * _dims[0] + cx;
+            for (uint k = _start[cell]; k < _start[cell+1]; ++k) {
+              double d2 = distance2(v, _crds[k]);
+              if (d2 >= ir2 && d2 <= or2)
+                f(_index[k], d2);
+            }
+          }
+        }
+      }
+    }
+
+
+    //! Number of atoms with inner <= d <= outer from \a u
+    uint count(const GCoord& u, const double inner, const double outer) const;
+
+    //! Appends the indices of atoms with inner <= d <= outer from \a u to \a list
+    void neighbors(const GCoord& u, const double inner, const double outer, std::vector<uint>& list) const;
+
+
+  private:
+    GCoord wrap(const GCoord& u) const {
+      GCoord v;
+      for (uint k=0; k<3; ++k) {
+        v[k] = u[k] - _box[k] * floor(u[k] / _box[k]);
+        if (v[k] >= _box[k])
+          v[k] = 0.0;
+      }
+      return(v);
+    }
+
+    double distance2(const GCoord& u, const GCoord& v) const {
+      double d2 = 0.0;
+      for (uint k=0; k<3; ++k) {
+        double d = u[k] - v[k];
+        if (_periodic)
+          d -= _box[k] * floor(d / _box[k] + 0.5);
+        d2 += d*d;
+      }
+      return(d2);
+    }
+
+    void cellCoords(const GCoord& u, int* c) const {
+      for (uint k=0; k<3; ++k) {
+        c[k] = static_cast<int>(floor((u[k] - _min[k]) / _cell[k]));
+        if (c[k] >= static_cast<int>(_dims[k]) && (_periodic || c[k] == static_cast<int>(_dims[k])))
+          c[k] = _dims[k] - 1;
+      }
+    }
+
+    // Map a cell coordinate along one axis into the grid (or -1 if
+    // it falls outside a non-periodic grid)
+    int cellIndex1(const int c, const uint k) const {
+      int n = _dims[k];
+      if (_periodic)
+        return(((c % n) + n) % n);
+      return((c < 0 || c >= n) ? -1 : c);
+    }
+
+
+    double _cutoff;
+    bool _periodic;
+    GCoord _box, _min, _cell;
+    uint _dims[3];
+
+    // Coordinates and group indices sorted by cell, with the atoms in
+    // cell c at [_start[c], _start[c+1])
+    std::vector<GCoord> _crds;
+    std::vector<uint> _index;
+    std::vector<uint> _start;
+  };
+
+
+}
+
+#endif
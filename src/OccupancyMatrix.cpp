@@ -0,0 +1,240 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <OccupancyMatrix.hpp>
+
+#include <cmath>
+
+
+namespace loos {
+
+  namespace {
+
+    typedef OccupancyMatrix::Word   Word;
+
+    inline uint popcount(Word w) {
+#if defined(__GNUC__)
+      return(__builtin_popcountll(w));
+#else
+      uint n = 0;
+      for (; w; ++n)
+        w &= w - 1;
+      return(n);
+#endif
+    }
+
+    // Mask for the first n bits of a word (n < 64)
+    inline Word lowBits(const uint n) {
+      return((static_cast<Word>(1) << n) - 1);
+    }
+
+    // Number of on-bits in frames [0, n) of a packed row
+    ulong onesBefore(const Word* w, const uint n) {
+      ulong c = 0;
+      uint k = n >> 6;
+      for (uint i=0; i<k; ++i)
+        c += popcount(w[i]);
+      if (n & 63)
+        c += popcount(w[k] & lowBits(n & 63));
+      return(c);
+    }
+
+    // Number of frames t in [0, n) with both x[t] and x[t+dt] on,
+    // where words beyond nwords are treated as zero
+    ulong onesShifted(const Word* w, const uint nwords, const uint n, const uint dt) {
+      uint q = dt >> 6;
+      uint r = dt & 63;
+      uint full = n >> 6;
+      ulong c = 0;
+
+      for (uint k=0; k<=full; ++k) {
+        if (k == full && (n & 63) == 0)
+          break;
+
+        uint a = k + q;
+        Word y = (a < nwords) ? (w[a] >> r) : 0;
+        if (r && a + 1 < nwords)
+          y |= w[a+1] << (64 - r);
+
+        Word x = w[k] & y;
+        if (k == full)
+          x &= lowBits(n & 63);
+        c += popcount(x);
+      }
+
+      return(c);
+    }
+
+
+    void checkSizes(const OccupancyMatrix& M, const uint row, const uint maxdt,
+                    std::vector<ulong>& survived, std::vector<ulong>& total) {
+      if (row >= M.rows())
+        throw(std::out_of_range("Row out of range in occupancy matrix"));
+      if (maxdt > M.frames())
+        throw(std::runtime_error("Can't compute survival for a dt longer than the time series"));
+      if (survived.size() < maxdt)
+        survived.resize(maxdt, 0);
+      if (total.size() < maxdt)
+        total.resize(maxdt, 0);
+    }
+
+  }
+
+
+
+  void OccupancyMatrix::addFrame() {
+    uint needed = wordsFor(_frames + 1);
+
+    // Grow the row capacity geometrically so repeated appends don't
+    // re-layout the whole matrix each time
+    if (needed > _stride) {
+      uint stride = _stride ? 2 * _stride : 16;
+      std::vector<Word> bits(static_cast<ulong>(_rows) * stride, 0);
+      for (uint j=0; j<_rows; ++j)
+        for (uint k=0; k<_stride; ++k)
+          bits[static_cast<ulong>(j) * stride + k] = _bits[static_cast<ulong>(j) * _stride + k];
+      _bits.swap(bits);
+      _stride = stride;
+    }
+
+    ++_frames;
+  }
+
+
+  ulong OccupancyMatrix::count(const uint j) const {
+    return(onesBefore(row(j), _frames));
+  }
+
+
+  std::vector<uint> OccupancyMatrix::runLengths(const uint j) const {
+    std::vector<uint> runs;
+    const Word* w = row(j);
+    uint nwords = wordsFor(_frames);
+    uint length = 0;
+
+    for (uint k=0; k<nwords; ++k) {
+      Word x = w[k];
+      uint nbits = (k == nwords - 1 && (_frames & 63)) ? (_frames & 63) : 64;
+
+      // Skip through words that are all on or all off
+      if (nbits == 64 && x == ~static_cast<Word>(0)) {
+        length += 64;
+        continue;
+      }
+      if (x == 0) {
+        if (length) {
+          runs.push_back(length);
+          length = 0;
+        }
+        continue;
+      }
+
+      for (uint b=0; b<nbits; ++b)
+        if ((x >> b) & 1u)
+          ++length;
+        else if (length) {
+          runs.push_back(length);
+          length = 0;
+        }
+    }
+
+    if (length)
+      runs.push_back(length);
+
+    return(runs);
+  }
+
+
+
+  void intermittentSurvival(const OccupancyMatrix& M, const uint row, const uint maxdt,
+                            std::vector<ulong>& survived, std::vector<ulong>& total) {
+    checkSizes(M, row, maxdt, survived, total);
+
+    const Word* w = M.row(row);
+    uint n = M.frames();
+    uint nwords = OccupancyMatrix::wordsFor(n);
+    if (onesBefore(w, n) == 0)
+      return;
+
+    for (uint dt=0; dt<maxdt; ++dt) {
+      total[dt] += onesBefore(w, n - dt);
+      survived[dt] += onesShifted(w, nwords, n - dt, dt);
+    }
+  }
+
+
+
+  void continuousSurvival(const OccupancyMatrix& M, const uint row, const uint maxdt,
+                          std::vector<ulong>& survived, std::vector<ulong>& total) {
+    checkSizes(M, row, maxdt, survived, total);
+
+    const Word* w = M.row(row);
+    uint n = M.frames();
+    if (onesBefore(w, n) == 0)
+      return;
+
+    for (uint dt=0; dt<maxdt; ++dt)
+      total[dt] += onesBefore(w, n - dt);
+
+    // A run of length L has L - dt frames that stay on through t+dt
+    std::vector<uint> runs = M.runLengths(row);
+    for (std::vector<uint>::const_iterator i = runs.begin(); i != runs.end(); ++i) {
+      uint m = (*i < maxdt) ? *i : maxdt;
+      for (uint dt=0; dt<m; ++dt)
+        survived[dt] += *i - dt;
+    }
+  }
+
+
+
+  std::vector<double> occupancyCorrelation(const OccupancyMatrix& M, const uint row, const uint maxdt) {
+    if (row >= M.rows())
+      throw(std::out_of_range("Row out of range in occupancy matrix"));
+    if (maxdt > M.frames())
+      throw(std::runtime_error("Can't take correlation time longer than time series"));
+
+    const Word* w = M.row(row);
+    uint n = M.frames();
+    uint nwords = OccupancyMatrix::wordsFor(n);
+    double count = onesBefore(w, n);
+    double p = count / n;
+    double var = p - p * p;
+
+    std::vector<double> c(maxdt, 1.0);
+    if (sqrt(var) < 1e-8)
+      return(c);
+
+    // With x in {0,1} and mean p, sum (x_t - p)(x_{t+dt} - p) over the
+    // n - dt pairs expands into the shifted popcount and the number of
+    // on-frames in each window
+    for (uint dt=0; dt<maxdt; ++dt) {
+      double pairs = n - dt;
+      double both = onesShifted(w, nwords, n - dt, dt);
+      double head = onesBefore(w, n - dt);
+      double tail = count - onesBefore(w, dt);
+      c[dt] = (both - p * (head + tail) + p * p * pairs) / (pairs * var);
+    }
+
+    return(c);
+  }
+
+}
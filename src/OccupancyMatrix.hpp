@@ -0,0 +1,177 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_OCCUPANCYMATRIX_HPP)
+#define LOOS_OCCUPANCYMATRIX_HPP
+
+#include <vector>
+#include <stdexcept>
+
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! Bit-packed on/off time-series for a set of entities
+  /**
+   * Survival and lifetime analyses (lipid contacts, water occupancy,
+   * hydrogen bonds) reduce each entity (lipid, water, donor-acceptor
+   * pair) to a boolean per frame.  OccupancyMatrix stores these as one
+   * bit per frame, with each entity's time-series packed into 64-bit
+   * words, so a 10k x 100k matrix takes ~120MB rather than ~8GB as
+   * nested vectors of doubles.
+   *
+   * Rows are entities and columns are frames.  The matrix can be grown
+   * a frame at a time with appendFrame() when the number of frames is
+   * not known in advance.
+   *
+   * The free functions below (intermittentSurvival(),
+   * continuousSurvival(), occupancyCorrelation()) work directly on the
+   * packed words, using popcounts of shifted words or run lengths,
+   * rather than looping over every pair of frames.
+   */
+  class OccupancyMatrix {
+  public:
+    typedef boost::uint64_t    Word;
+
+    OccupancyMatrix() : _rows(0), _frames(0), _stride(0) { }
+
+    //! Create an empty (all off) matrix of \a rows entities by \a frames frames
+    OccupancyMatrix(const uint rows, const uint frames)
+      : _rows(rows), _frames(frames), _stride(wordsFor(frames)), _bits(static_cast<ulong>(rows) * _stride, 0) { }
+
+    uint rows() const { return(_rows); }
+    uint frames() const { return(_frames); }
+
+    //! Number of words used per row
+    uint stride() const { return(_stride); }
+
+    bool operator()(const uint j, const uint t) const {
+      return((_bits[index(j, t)] >> (t & 63)) & 1u);
+    }
+
+    void set(const uint j, const uint t, const bool b = true) {
+      Word mask = static_cast<Word>(1) << (t & 63);
+      if (b)
+        _bits[index(j, t)] |= mask;
+      else
+        _bits[index(j, t)] &= ~mask;
+    }
+
+    //! Add a frame, taking the state of each row from \a states
+    /**
+     * \a states must have rows() elements, and any non-zero value
+     * marks the row as on in the new frame.
+     */
+    template<typename T>
+    void appendFrame(const std::vector<T>& states) {
+      if (states.size() != _rows)
+        throw(std::logic_error("Frame has the wrong number of rows for the occupancy matrix"));
+      addFrame();
+      for (uint j=0; j<_rows; ++j)
+        if (states[j])
+          set(j, _frames - 1);
+    }
+
+    //! Add an empty (all off) frame
+    void addFrame();
+
+    //! Pointer to the packed words for row \a j
+    const Word* row(const uint j) const { return(&(_bits[static_cast<ulong>(j) * _stride])); }
+
+    //! Number of frames where row \a j is on
+    ulong count(const uint j) const;
+
+    //! Lengths of each contiguous on-stretch for row \a j
+    std::vector<uint> runLengths(const uint j) const;
+
+    //! True if row \a j is never on
+    bool empty(const uint j) const { return(count(j) == 0); }
+
+
+    //! Build from any matrix-like object with rows(), cols(), and operator()(j,i)
+    template<class M>
+    static OccupancyMatrix fromMatrix(const M& A) {
+      OccupancyMatrix O(A.rows(), A.cols());
+      for (uint j=0; j<A.rows(); ++j)
+        for (uint t=0; t<A.cols(); ++t)
+          if (A(j, t))
+            O.set(j, t);
+      return(O);
+    }
+
+    static uint wordsFor(const uint frames) { return((frames + 63) / 64); }
+
+  private:
+    ulong index(const uint j, const uint t) const {
+#if defined(DEBUG)
+      if (j >= _rows || t >= _frames)
+        throw(std::out_of_range("Occupancy matrix index out of range"));
+#endif
+      return(static_cast<ulong>(j) * _stride + (t >> 6));
+    }
+
+    uint _rows, _frames, _stride;
+    std::vector<Word> _bits;
+  };
+
+
+
+  //! Accumulate intermittent survival counts for one row
+  /**
+   * For each dt in [0, maxdt), \a total[dt] is incremented by the
+   * number of frames t (with t + dt < frames) where the row is on, and
+   * \a survived[dt] by the number of those where it is also on at
+   * t + dt (regardless of what happens in between).  The ratio is the
+   * survival probability P(on at t+dt | on at t).  The vectors are
+   * resized to maxdt if necessary, but not cleared, so counts may be
+   * accumulated over many rows.
+   */
+  void intermittentSurvival(const OccupancyMatrix& M, const uint row, const uint maxdt,
+                            std::vector<ulong>& survived, std::vector<ulong>& total);
+
+  //! Accumulate continuous survival counts for one row
+  /**
+   * As intermittentSurvival(), except \a survived only counts frames
+   * where the row stays on for every frame from t to t+dt.  This is
+   * computed from the run lengths: a run of length L contributes
+   * max(0, L - dt) to survived[dt].
+   */
+  void continuousSurvival(const OccupancyMatrix& M, const uint row, const uint maxdt,
+                          std::vector<ulong>& survived, std::vector<ulong>& total);
+
+  //! Normalized autocorrelation of one row, treating on as 1 and off as 0
+  /**
+   * Gives the same result as TimeSeries<double>::correl(maxdt) on the
+   * row as a series of 0's and 1's (mean-subtracted and scaled by the
+   * variance, averaging over the available pairs for each lag).  A
+   * constant row gives all 1's.
+   */
+  std::vector<double> occupancyCorrelation(const OccupancyMatrix& M, const uint row, const uint maxdt);
+
+}
+
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <utils_structural.hpp>
 #include <OptionsFramework.hpp>
+#include <asynctrajwriter.hpp>
 
 #include <boost/lambda/lambda.hpp>
 
@@ -504,7 +505,8 @@ namespace loos {
 
       opts.add_options()
 	("outtrajtype,t", po::value<std::string>(&type), types.c_str())
-	("append", po::value<bool>(&append)->default_value(append), "Append if trajectory exists, otherwise overwrite");
+	("append", po::value<bool>(&append)->default_value(append), "Append if trajectory exists, otherwise overwrite")
+	("async-write", po::value<bool>(&async)->default_value(async), "Write the trajectory on a background thread");
     }
 
     void OutputTrajectoryOptions::addHidden(po::options_description& opts) {
@@ -528,6 +530,8 @@ namespace loos {
 	type = boost::get<1>(names);
 
       outraj = createOutputTrajectory(name, type, append);
+      if (async)
+	outraj = AsyncTrajectoryWriter::create(outraj);
       return(true);
     }
 
@@ -538,10 +542,11 @@ namespace loos {
 
     std::string OutputTrajectoryOptions::print() const {
       std::ostringstream oss;
-      oss << boost::format("outraj='%s',outraj_type='%s',append=%d")
+      oss << boost::format("outraj='%s',outraj_type='%s',append=%d,async=%d")
 	% name
 	% type
-	% append;
+	% append
+	% async;
       return(oss.str());
     }
 
@@ -552,15 +557,17 @@ namespace loos {
 
       opts.add_options()
 	("outtrajtype,t", po::value<std::string>(&type)->default_value("dcd"), types.c_str())
-	("append", po::value<bool>(&append)->default_value(append), "Append if trajectory exists, otherwise overwrite");
+	("append", po::value<bool>(&append)->default_value(append), "Append if trajectory exists, otherwise overwrite")
+	("async-write", po::value<bool>(&async)->default_value(async), "Write the trajectory on a background thread");
     }
 
 
     std::string OutputTrajectoryTypeOptions::print() const {
       std::ostringstream oss;
-      oss << boost::format("outraj_type='%s',append=%d")
+      oss << boost::format("outraj_type='%s',append=%d,async=%d")
 	% type
-	% append;
+	% append
+	% async;
       return(oss.str());
     }
 
@@ -568,7 +575,10 @@ namespace loos {
     pTrajectoryWriter OutputTrajectoryTypeOptions::createTrajectory(const std::string& prefix) {
 
       std::string fname = prefix + "." + type;
-      return(createOutputTrajectory(fname, type, append));
+      pTrajectoryWriter writer = createOutputTrajectory(fname, type, append);
+      if (async)
+	writer = AsyncTrajectoryWriter::create(writer);
+      return(writer);
     }
 
     // -------------------------------------------------------
@@ -717,14 +717,15 @@ namespace loos {
     // ----------------------------------------------------------------------
     class OutputTrajectoryOptions : public OptionsPackage {
     public:
-      OutputTrajectoryOptions() : name("output.dcd"), label("Output Trajectory"), append(false) {}
-      OutputTrajectoryOptions(const std::string& s) : name(s), label("Output Trajectory"), append(false) {}
-      OutputTrajectoryOptions(const std::string& s, const bool appending) : name(s), label("Output Trajectory"), append(appending) {}
+      OutputTrajectoryOptions() : name("output.dcd"), label("Output Trajectory"), append(false), async(false) {}
+      OutputTrajectoryOptions(const std::string& s) : name(s), label("Output Trajectory"), append(false), async(false) {}
+      OutputTrajectoryOptions(const std::string& s, const bool appending) : name(s), label("Output Trajectory"), append(appending), async(false) {}
 
 
       std::string name;
       std::string label;
       bool append;
+      bool async;              ///< Write frames on a background thread
       std::string type;
       std::string basename;
       pTrajectoryWriter outraj;
@@ -752,22 +753,25 @@ namespace loos {
       OutputTrajectoryTypeOptions() :
 	label("Output Trajectory Type"),
 	append(false),
+	async(false),
 	type("dcd") {}
 
       OutputTrajectoryTypeOptions(const std::string& s) :
 	label("Output Trajectory Type"),
 	append(false),
+	async(false),
 	type(s) {}
 
       OutputTrajectoryTypeOptions(const std::string& s, const bool appending) :
 	label("Output Trajectory Type"),
-	append(appending), type(s) {}
+	append(appending), async(false), type(s) {}
 
       pTrajectoryWriter createTrajectory(const std::string& prefix);
 
 
       std::string label;
       bool append;
+      bool async;              ///< Write frames on a background thread
       std::string type;
 
     private:
@@ -0,0 +1,287 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <OrderParameters.hpp>
+
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  namespace {
+
+    // An exception can't leave a worker thread, so it is recorded
+    // here and rethrown by the main thread once the workers finish
+    struct WorkerError {
+      WorkerError() : failed(false), numerical(false) { }
+
+      void rethrow() const {
+        if (numerical)
+          throw(NumericalError(message));
+        throw(LOOSError(message));
+      }
+
+      bool failed, numerical;
+      std::string message;
+    };
+
+  }
+
+
+  // Computes a contiguous range of the frames in the current block.
+  // Each worker has its own scratch space.
+  struct OrderParameterEngine::Worker {
+    Worker(const OrderParameterEngine* e, std::vector<FrameOrder>* r, const uint b, const uint n, WorkerError* err)
+      : engine(e), results(r), begin(b), end(n), error(err) { }
+
+    void operator()() {
+      try {
+        std::vector<double> scratch;
+        for (uint i=begin; i<end; ++i)
+          engine->computeFrame(i, (*results)[i], scratch);
+      }
+      catch (NumericalError& e) {
+        error->failed = error->numerical = true;
+        error->message = e.what();
+      }
+      catch (std::exception& e) {
+        error->failed = true;
+        error->message = e.what();
+      }
+    }
+
+    const OrderParameterEngine* engine;
+    std::vector<FrameOrder>* results;
+    uint begin, end;
+    WorkerError* error;
+  };
+
+
+
+  uint OrderParameterEngine::slot(const pAtom& a) {
+    uint idx = a->index();
+    if (idx >= _slots.size())
+      _slots.resize(idx + 1, -1);
+    if (_slots[idx] < 0) {
+      _slots[idx] = _atoms.size();
+      _atoms.append(a);
+    }
+    return(_slots[idx]);
+  }
+
+
+  void OrderParameterEngine::addBond(const pAtom& a, const pAtom& b, const uint group) {
+    _bond_from.push_back(slot(a));
+    _bond_to.push_back(slot(b));
+    _bond_group.push_back(group);
+    if (group >= _group_sizes.size())
+      _group_sizes.resize(group + 1, 0);
+    ++_group_sizes[group];
+  }
+
+
+  void OrderParameterEngine::addMolecule(const AtomicGroup& molecule) {
+    if (molecule.empty())
+      throw(LOOSError("Cannot compute the order parameter of an empty molecule"));
+
+    if (_mol_start.empty())
+      _mol_start.push_back(0);
+    for (AtomicGroup::const_iterator i = molecule.begin(); i != molecule.end(); ++i)
+      _mol_atoms.push_back(slot(*i));
+    _mol_start.push_back(_mol_atoms.size());
+  }
+
+
+
+  uint OrderParameterEngine::readBlock(pTraj& traj, const std::vector<uint>& frames, const uint start) {
+    uint n = frames.size() - start;
+    if (n > _blocksize)
+      n = _blocksize;
+
+    uint natoms = _atoms.size();
+    _crds.resize(static_cast<ulong>(n) * natoms * 3);
+    _boxes.resize(n);
+    _frames.resize(n);
+
+    for (uint i=0; i<n; ++i) {
+      traj->readFrame(frames[start + i]);
+      traj->updateGroupCoords(_atoms);
+
+      double* p = &(_crds[static_cast<ulong>(i) * natoms * 3]);
+      for (uint j=0; j<natoms; ++j) {
+        const GCoord& c = _atoms[j]->coords();
+        *(p++) = c[0];
+        *(p++) = c[1];
+        *(p++) = c[2];
+      }
+
+      if (traj->hasPeriodicBox())
+        _boxes[i] = traj->periodicBox();
+      else if (_reimage && molecules() > 0)
+        throw(LOOSError("The trajectory must be periodic to reimage molecules for the order parameter"));
+      _frames[i] = frames[start + i];
+    }
+
+    return(n);
+  }
+
+
+
+  void OrderParameterEngine::computeBlock(const uint n, std::vector<FrameOrder>& results) const {
+    if (results.size() < n)
+      results.resize(n);
+
+    uint nthreads = _nthreads ? _nthreads : boost::thread::hardware_concurrency();
+    if (nthreads > n)
+      nthreads = n;
+
+    if (nthreads <= 1) {
+      std::vector<double> scratch;
+      for (uint i=0; i<n; ++i)
+        computeFrame(i, results[i], scratch);
+      return;
+    }
+
+    uint chunk = (n + nthreads - 1) / nthreads;
+    std::vector<WorkerError> errors((n + chunk - 1) / chunk);
+    boost::thread_group threads;
+    for (uint b=0, t=0; b<n; b += chunk, ++t)
+      threads.create_thread(Worker(this, &results, b, (b + chunk > n) ? n : b + chunk, &(errors[t])));
+    threads.join_all();
+
+    for (uint t=0; t<errors.size(); ++t)
+      if (errors[t].failed)
+        errors[t].rethrow();
+  }
+
+
+
+  void OrderParameterEngine::computeFrame(const uint i, FrameOrder& result, std::vector<double>& scratch) const {
+    const double* crds = &(_crds[static_cast<ulong>(i) * _atoms.size() * 3]);
+    result.frame = _frames[i];
+
+    // Bonds: gather the bond vectors into separate x, y, z arrays, then
+    // compute the order parameter for all of them in one pass
+    uint nbonds = _bond_from.size();
+    result.bonds.assign(_group_sizes.size(), 0.0);
+    if (nbonds) {
+      scratch.resize(nbonds * 4);
+      double* dx = &(scratch[0]);
+      double* dy = dx + nbonds;
+      double* dz = dy + nbonds;
+      double* s = dz + nbonds;
+
+      for (uint k=0; k<nbonds; ++k) {
+        const double* a = crds + 3 * _bond_from[k];
+        const double* b = crds + 3 * _bond_to[k];
+        dx[k] = a[0] - b[0];
+        dy[k] = a[1] - b[1];
+        dz[k] = a[2] - b[2];
+      }
+
+      const double* da = (_axis == 0) ? dx : ((_axis == 1) ? dy : dz);
+      for (uint k=0; k<nbonds; ++k) {
+        double l2 = dx[k] * dx[k] + dy[k] * dy[k] + dz[k] * dz[k];
+        s[k] = 0.5 - 1.5 * da[k] * da[k] / l2;
+      }
+
+      for (uint k=0; k<nbonds; ++k)
+        result.bonds[_bond_group[k]] += s[k];
+      for (uint g=0; g<_group_sizes.size(); ++g)
+        if (_group_sizes[g])
+          result.bonds[g] /= _group_sizes[g];
+    }
+
+
+    // Molecules: principal axes from the eigenvectors of the 3x3
+    // covariance of each molecule's coordinates
+    uint nmols = molecules();
+    result.molecules.resize(nmols);
+    const GCoord& box = _boxes[i];
+
+    for (uint m=0; m<nmols; ++m) {
+      MoleculeOrder& mo = result.molecules[m];
+      uint b = _mol_start[m];
+      uint n = _mol_start[m+1] - b;
+
+      const double* r0 = crds + 3 * _mol_atoms[b];
+      double centroid[3] = {0.0, 0.0, 0.0};
+      double mean[3] = {0.0, 0.0, 0.0};
+      double C[9] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+      // Positions relative to the first atom (with the minimum image, if
+      // reimaging) so the molecule is whole
+      scratch.resize(3 * n);
+      for (uint j=0; j<n; ++j) {
+        const double* r = crds + 3 * _mol_atoms[b + j];
+        for (uint k=0; k<3; ++k) {
+          centroid[k] += r[k];
+          double d = r[k] - r0[k];
+          if (_reimage) {
+            int w = static_cast<int>(fabs(d) / box[k] + 0.5);
+            d = (d >= 0) ? d - w * box[k] : d + w * box[k];
+          }
+          scratch[3*j + k] = d;
+          mean[k] += d;
+        }
+      }
+      for (uint k=0; k<3; ++k) {
+        centroid[k] /= n;
+        mean[k] /= n;
+      }
+
+      for (uint j=0; j<n; ++j) {
+        double x = scratch[3*j] - mean[0];
+        double y = scratch[3*j+1] - mean[1];
+        double z = scratch[3*j+2] - mean[2];
+        C[0] += x*x;  C[3] += x*y;  C[6] += x*z;
+                      C[4] += y*y;  C[7] += y*z;
+                                    C[8] += z*z;
+      }
+      C[1] = C[3];
+      C[2] = C[6];
+      C[5] = C[7];
+
+      char jobz = 'V', uplo = 'U';
+      f77int nn = 3, lda = 3, lwork = 128, info;
+      double W[3], work[128];
+      dsyev_(&jobz, &uplo, &nn, C, &lda, W, work, &lwork, &info);
+      if (info != 0)
+        throw(NumericalError("dsyev_ failed computing the principal axes of a molecule", info));
+
+      // Eigenvalues are in ascending order, so the 1st principal axis
+      // is the last column
+      mo.first_axis = fabs(C[6 + _axis]);
+      mo.order[0] = 0.5 - 1.5 * C[3 + _axis] * C[3 + _axis];
+      mo.order[1] = 0.5 - 1.5 * C[_axis] * C[_axis];
+      mo.smallest = W[0] / n;
+      mo.centroid = GCoord(centroid[0], centroid[1], centroid[2]);
+    }
+  }
+
+
+}
@@ -0,0 +1,163 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_ORDERPARAMETERS_HPP)
+#define LOOS_ORDERPARAMETERS_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! Computes lipid order parameters over a trajectory
+  /**
+   * Two kinds of order parameter are supported:
+   *
+   * - Bond order parameters, S = 1/2 - 3/2 cos^2(theta), where theta is
+   *   the angle between a bond vector (e.g. C-H) and the field axis.
+   *   Bonds are assigned to groups (e.g. carbon positions) and the
+   *   average over each group is reported for every frame.
+   *
+   * - Molecular order parameters, where the 2nd and 3rd principal axes
+   *   of a whole molecule are treated as faux C-H bonds.  The 1st axis
+   *   component along the field, the smallest principal moment, and
+   *   the centroid are reported as well, so tools can check for planar
+   *   molecules or bin by position.
+   *
+   * The bonds and molecules are flattened into index arrays into a
+   * list of the unique atoms involved once, when they are added.  The
+   * trajectory is then read in blocks of frames, with the coordinates
+   * of just those atoms gathered into one contiguous buffer, and the
+   * frames in a block are divided among threads.  The bond kernel
+   * works on separate x, y, and z arrays so the compiler can vectorize
+   * it.
+   *
+   * Results are handed back one frame at a time, in order, via a
+   * functor called as visitor(const OrderParameterEngine::FrameOrder&).
+   *
+   *\code
+   * OrderParameterEngine engine;
+   * engine.addBond(carbon, hydrogen, 0);
+   * engine.threads(4);
+   * engine.process(traj, frames, visitor);
+   *\endcode
+   */
+  class OrderParameterEngine {
+  public:
+
+    //! Order parameters from the principal axes of one molecule
+    struct MoleculeOrder {
+      double order[2];      ///< Using the 2nd and 3rd principal axes
+      double first_axis;    ///< |Component of the 1st principal axis along the field axis|
+      double smallest;      ///< Smallest principal moment (divided by the number of atoms)
+      GCoord centroid;      ///< Centroid (without reimaging)
+    };
+
+    //! All order parameters for one frame
+    struct FrameOrder {
+      uint frame;                           ///< Index of the frame in the trajectory
+      std::vector<double> bonds;            ///< Average over each bond group
+      std::vector<MoleculeOrder> molecules; ///< In the order the molecules were added
+    };
+
+
+    OrderParameterEngine() : _axis(2), _nthreads(1), _blocksize(64), _reimage(true) { }
+
+    //! Adds the bond vector from \a a to \a b to bond group \a group
+    void addBond(const pAtom& a, const pAtom& b, const uint group);
+
+    //! Adds a molecule for the molecular order parameter
+    void addMolecule(const AtomicGroup& molecule);
+
+    uint bondGroups() const { return(_group_sizes.size()); }
+    uint bonds() const { return(_bond_from.size()); }
+    uint molecules() const { return(_mol_start.empty() ? 0 : _mol_start.size() - 1); }
+
+    //! Axis for the magnetic field (0 = x, 1 = y, 2 = z)
+    void axis(const uint i) { _axis = i; }
+    uint axis() const { return(_axis); }
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n) { _nthreads = n; }
+
+    //! Number of frames read at a time
+    void blockSize(const uint n) { _blocksize = n ? n : 1; }
+
+    //! Make molecules whole with the periodic box before computing their principal axes
+    void reimageMolecules(const bool b) { _reimage = b; }
+
+    //! All atoms used by the bonds and molecules
+    AtomicGroup atoms() const { return(_atoms); }
+
+
+    //! Computes the order parameters for the listed frames
+    template<class Visitor>
+    void process(pTraj& traj, const std::vector<uint>& frames, Visitor& visitor) {
+      traj->setSelectionHint(_atoms);
+
+      std::vector<FrameOrder> results;
+      for (uint k=0; k<frames.size(); k += _blocksize) {
+        uint n = readBlock(traj, frames, k);
+        computeBlock(n, results);
+        for (uint i=0; i<n; ++i)
+          visitor(results[i]);
+      }
+    }
+
+
+  private:
+    uint slot(const pAtom& a);
+    uint readBlock(pTraj& traj, const std::vector<uint>& frames, const uint start);
+    void computeBlock(const uint n, std::vector<FrameOrder>& results) const;
+    void computeFrame(const uint i, FrameOrder& result, std::vector<double>& scratch) const;
+
+    struct Worker;
+
+    uint _axis, _nthreads, _blocksize;
+    bool _reimage;
+
+    AtomicGroup _atoms;
+    std::vector<int> _slots;            // Atom index -> position in _atoms
+
+    // Bonds as pairs of positions in _atoms
+    std::vector<uint> _bond_from, _bond_to, _bond_group;
+    std::vector<uint> _group_sizes;
+
+    // Molecules as ranges of _mol_atoms
+    std::vector<uint> _mol_atoms, _mol_start;
+
+    // Coordinates for the current block, frame-major then x,y,z by atom
+    std::vector<double> _crds;
+    std::vector<GCoord> _boxes;
+    std::vector<uint> _frames;
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <PDBWriter.hpp>
+
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+
+
+namespace loos {
+
+  // Declared in pdb.cpp
+  std::ostream& FormattedUnitCell(std::ostream& os, const UnitCell& u);
+  std::ostream& XTALLine(std::ostream& os, const GCoord& box);
+  std::ostream& FormatConectRecords(std::ostream& os, const PDB& p);
+
+
+  // Everything but the coordinates is formatted here, in the same
+  // order as operator<<(std::ostream&, const PDB&).  The atom records
+  // have blanks where the coordinates go, and _offsets marks where each
+  // atom's coordinates start.
+  PDBWriter::PDBWriter(const PDB& pdb) : _pdb(pdb) {
+    std::ostringstream header;
+    header << _pdb._remarks;
+    _header = header.str();
+
+    if (_pdb._has_cryst) {
+      std::ostringstream cryst;
+      FormattedUnitCell(cryst, _pdb.cell) << std::endl;
+      _cryst = cryst.str();
+    }
+
+    _offsets.reserve(_pdb.size());
+    for (AtomicGroup::const_iterator i = _pdb.atoms.begin(); i != _pdb.atoms.end(); ++i) {
+      _atoms += _pdb.atomPrefix(*i);
+      _offsets.push_back(_atoms.size());
+      _atoms.append(24, ' ');
+      _atoms += _pdb.atomSuffix(*i);
+      _atoms += '\n';
+    }
+
+    std::ostringstream trailer;
+    if (_pdb.hasBonds())
+      FormatConectRecords(trailer, _pdb);
+    if (_pdb._auto_ter)
+      trailer << "TER     \n";
+    _trailer = trailer.str();
+  }
+
+
+  // Same result as Fmt(3) with width(8), right(), trailingZeros(true)
+  // and fixed(), i.e. "%.3f" right-justified in 8 columns, keeping
+  // only the last 8 characters if it's wider.  Values close to a
+  // rounding tie, negative values that round to zero, and anything
+  // too wide (or not finite) are handed to snprintf().
+  void PDBWriter::formatCoord(char* out, const double x) {
+    double v = x * 1000.0;
+    if (v > -999999.0 && v < 9999999.0) {
+      double frac = v - std::floor(v);
+      long n = static_cast<long>(std::floor(v + 0.5));
+      bool negative_zero = (n == 0 && (x < 0.0 || (x == 0.0 && 1.0 / x < 0.0)));
+      if (std::fabs(frac - 0.5) > 1e-6 && !negative_zero) {
+        bool negative = n < 0;
+        ulong u = negative ? -n : n;
+        char* p = out + 8;
+        *(--p) = '0' + u % 10;
+        u /= 10;
+        *(--p) = '0' + u % 10;
+        u /= 10;
+        *(--p) = '0' + u % 10;
+        u /= 10;
+        *(--p) = '.';
+        do {
+          *(--p) = '0' + u % 10;
+          u /= 10;
+        } while (u);
+        if (negative)
+          *(--p) = '-';
+        while (p > out)
+          *(--p) = ' ';
+        return;
+      }
+    }
+
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "%.3f", x);
+    if (n < 0 || n >= static_cast<int>(sizeof(buf)))
+      n = strlen(buf);
+    if (n >= 8)
+      memcpy(out, buf + n - 8, 8);
+    else {
+      memset(out, ' ', 8 - n);
+      memcpy(out + 8 - n, buf, n);
+    }
+  }
+
+
+  void PDBWriter::capture(Frame& frame) const {
+    uint n = _pdb.size();
+    frame.coords.resize(n);
+    for (uint i=0; i<n; ++i)
+      frame.coords[i] = _pdb[i]->coords();
+    frame.box = _pdb.periodicBox();
+    frame.periodic = _pdb.isPeriodic();
+  }
+
+
+  void PDBWriter::format(Frame& frame) const {
+    if (frame.coords.size() != _offsets.size())
+      throw(LOOSError("Frame does not match the structure in PDBWriter"));
+
+    std::string xtal;
+    if (frame.periodic) {
+      std::ostringstream oss;
+      XTALLine(oss, frame.box) << std::endl;
+      xtal = oss.str();
+    }
+
+    std::string& text = frame.text;
+    text.clear();
+    text.reserve(_header.size() + xtal.size() + _cryst.size() + _atoms.size() + _trailer.size());
+    text += _header;
+    text += xtal;
+    text += _cryst;
+
+    ulong start = text.size();
+    text += _atoms;
+    char* base = &(text[start]);
+    for (uint i=0; i<_offsets.size(); ++i) {
+      char* p = base + _offsets[i];
+      formatCoord(p, frame.coords[i].x());
+      formatCoord(p + 8, frame.coords[i].y());
+      formatCoord(p + 16, frame.coords[i].z());
+    }
+
+    text += _trailer;
+  }
+
+
+  void PDBWriter::format(std::vector<Frame>& frames, const uint nthreads) const {
+    uint n = frames.size();
+    uint m = nthreads ? nthreads : boost::thread::hardware_concurrency();
+    m = std::min(std::max(m, 1u), n);
+    if (m <= 1) {
+      for (uint i=0; i<n; ++i)
+        format(frames[i]);
+      return;
+    }
+
+    // Check up front so the workers can't throw
+    for (uint i=0; i<n; ++i)
+      if (frames[i].coords.size() != _offsets.size())
+        throw(LOOSError("Frame does not match the structure in PDBWriter"));
+
+    uint chunk = (n + m - 1) / m;
+    boost::thread_group threads;
+    for (uint t=0; t<m; ++t)
+      threads.create_thread(Worker(this, &frames, std::min(n, t * chunk), std::min(n, (t+1) * chunk)));
+    threads.join_all();
+  }
+
+
+  void PDBWriter::write(std::ostream& os) const {
+    Frame frame;
+    capture(frame);
+    format(frame);
+    os << frame.text;
+  }
+
+
+}
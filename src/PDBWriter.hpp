@@ -0,0 +1,123 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_PDBWRITER_HPP)
+#define LOOS_PDBWRITER_HPP
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <pdb.hpp>
+
+
+namespace loos {
+
+
+  //! Fast PDB output for writing many frames of the same structure
+  /**
+   * Writing a PDB with operator<<() formats every field of every atom
+   * through a stream.  PDBWriter formats everything except the
+   * coordinates (remarks, the non-coordinate atom fields, CRYST1,
+   * CONECT records) once, when it is created, and then only fills in
+   * the coordinates (and the REMARK XTAL box) for each frame.  The
+   * output is the same as operator<<() would give.
+   *
+   * The writer shares the atoms of the PDB it was made from, so
+   * write() and capture() use whatever coordinates those atoms
+   * currently have.  Only the coordinates and box should change
+   * between frames.
+   *
+   * Frames can also be formatted in parallel into separate buffers:
+   \code
+   PDBWriter writer(pdb);
+   std::vector<PDBWriter::Frame> frames(n);
+   for (uint i=0; i<n; ++i) {
+     traj->readFrame(i);
+     traj->updateGroupCoords(model);   // model shares atoms with pdb
+     writer.capture(frames[i]);
+   }
+   writer.format(frames, nthreads);   // frames[i].text is now the PDB
+   \endcode
+   */
+  class PDBWriter {
+  public:
+
+    //! The coordinates and resulting text for one frame
+    struct Frame {
+      Frame() : periodic(false) { }
+
+      std::vector<GCoord> coords;
+      GCoord box;
+      bool periodic;
+      std::string text;
+    };
+
+
+    explicit PDBWriter(const PDB& pdb);
+
+    uint size() const { return(_offsets.size()); }
+
+    //! Writes the PDB (with its current coordinates) to a stream
+    void write(std::ostream& os) const;
+
+    //! Copies the current coordinates and box into a frame
+    void capture(Frame& frame) const;
+
+    //! Formats a frame into frame.text
+    void format(Frame& frame) const;
+
+    //! Formats all frames, using \a nthreads threads (0 = all available)
+    void format(std::vector<Frame>& frames, const uint nthreads) const;
+
+    //! Formats a coordinate exactly as operator<<() does, into 8 characters at \a out
+    static void formatCoord(char* out, const double x);
+
+  private:
+
+    // Formats frames [begin, end) in a separate thread
+    struct Worker {
+      Worker(const PDBWriter* w, std::vector<Frame>* f, const uint b, const uint e)
+        : writer(w), frames(f), begin(b), end(e) { }
+
+      void operator()() {
+        for (uint i=begin; i<end; ++i)
+          writer->format((*frames)[i]);
+      }
+
+      const PDBWriter* writer;
+      std::vector<Frame>* frames;
+      uint begin, end;
+    };
+
+
+    PDB _pdb;
+    std::string _header, _cryst, _atoms, _trailer;
+    std::vector<ulong> _offsets;
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,383 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <ResidueContactMap.hpp>
+#include <NeighborGrid.hpp>
+
+#include <cmath>
+#include <boost/thread/thread.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Collects the residues whose spheres may come within the
+    // threshold of residue i (only those after i, so each pair is
+    // considered once)
+    struct SphereVisitor {
+      SphereVisitor(const uint i_, const double r, const double t, const std::vector<double>& radii_, std::vector<uint>& list_)
+        : i(i_), ri(r), thresh(t), radii(radii_), list(list_) { }
+
+      void operator()(const uint j, const double d2) {
+        if (j <= i)
+          return;
+        double reach = ri + radii[j] + thresh;
+        if (d2 <= reach * reach)
+          list.push_back(j);
+      }
+
+      uint i;
+      double ri, thresh;
+      const std::vector<double>& radii;
+      std::vector<uint>& list;
+    };
+
+
+    // Lattice translation taking v to its minimum image
+    GCoord imageShift(const GCoord& v, const GCoord& box) {
+      GCoord s;
+      for (uint k=0; k<3; ++k)
+        s[k] = -box[k] * floor(v[k] / box[k] + 0.5);
+      return(s);
+    }
+
+  }
+
+
+
+  ResidueContactMap::ResidueContactMap(const std::vector<AtomicGroup>& residues, const double threshold,
+                                       const bool use_centers, const bool periodic)
+    : _threshold(threshold), _use_centers(use_centers), _periodic(periodic), _nthreads(1), _nframes(0)
+  {
+    if (threshold <= 0.0)
+      throw(LOOSError("ResidueContactMap threshold must be positive"));
+    if (residues.empty())
+      throw(LOOSError("ResidueContactMap needs at least one residue"));
+
+    _offsets.push_back(0);
+    for (uint i=0; i<residues.size(); ++i) {
+      if (residues[i].empty())
+        throw(LOOSError("ResidueContactMap residues cannot be empty"));
+      for (AtomicGroup::const_iterator a = residues[i].begin(); a != residues[i].end(); ++a) {
+        _atoms.push_back(*a);
+        _masses.push_back(use_centers ? (*a)->mass() : 1.0);
+      }
+      _offsets.push_back(_atoms.size());
+    }
+    _natoms = _atoms.size();
+  }
+
+
+  void ResidueContactMap::threads(const uint n) {
+    _nthreads = n ? n : boost::thread::hardware_concurrency();
+    if (_nthreads < 1)
+      _nthreads = 1;
+  }
+
+
+  void ResidueContactMap::loadFrame(const uint slot, const AtomicGroup& model) {
+    ulong stride = static_cast<ulong>(_natoms) * 3;
+    if (_block.size() < (slot + 1) * stride) {
+      _block.resize((slot + 1) * stride);
+      _boxes.resize(slot + 1);
+    }
+
+    double* x = &(_block[slot * stride]);
+    for (uint i=0; i<_natoms; ++i) {
+      const GCoord& c = _atoms[i]->coords();
+      *(x++) = c[0];
+      *(x++) = c[1];
+      *(x++) = c[2];
+    }
+
+    if (_periodic) {
+      if (!model.isPeriodic())
+        throw(LOOSError("ResidueContactMap requires a periodic box when periodic"));
+      _boxes[slot] = model.periodicBox();
+    }
+  }
+
+
+  // Bounding spheres (or centers of mass) for each residue, followed
+  // by the candidate pairs and the atom-level checks
+  void ResidueContactMap::findContacts(const double* x0, const GCoord& box, Scratch& s, Contacts& out) const {
+    uint nres = residues();
+    s.crds.assign(x0, x0 + static_cast<ulong>(_natoms) * 3);
+    s.centers.resize(nres);
+    s.radii.resize(nres);
+
+    if (s.points.size() != nres) {
+      s.points = AtomicGroup();
+      for (uint i=0; i<nres; ++i)
+        s.points.append(pAtom(new Atom(i+1, "C", GCoord())));
+    }
+
+    double* x = &(s.crds[0]);
+    double maxr = 0.0;
+    for (uint r=0; r<nres; ++r) {
+      uint b = _offsets[r], e = _offsets[r+1];
+
+      // Make the residue whole about its first atom
+      if (_periodic)
+        for (uint a=b+1; a<e; ++a) {
+          GCoord d(x[3*a] - x[3*b], x[3*a+1] - x[3*b+1], x[3*a+2] - x[3*b+2]);
+          GCoord sh = imageShift(d, box);
+          for (uint k=0; k<3; ++k)
+            x[3*a+k] += sh[k];
+        }
+
+      // Same arithmetic as AtomicGroup::centerOfMass()
+      GCoord c(x[3*b], x[3*b+1], x[3*b+2]);
+      if (e - b > 1) {
+        c = GCoord(0, 0, 0);
+        double mass = 0.0;
+        for (uint a=b; a<e; ++a) {
+          c += _masses[a] * GCoord(x[3*a], x[3*a+1], x[3*a+2]);
+          mass += _masses[a];
+        }
+        c /= mass;
+      }
+      s.centers[r] = c;
+
+      double r2 = 0.0;
+      if (!_use_centers)
+        for (uint a=b; a<e; ++a) {
+          double d2 = c.distance2(GCoord(x[3*a], x[3*a+1], x[3*a+2]));
+          if (d2 > r2)
+            r2 = d2;
+        }
+
+      // Pad the radius so rounding never prunes a real contact
+      s.radii[r] = _use_centers ? 0.0 : sqrt(r2) * (1.0 + 1e-9) + 1e-6;
+      if (s.radii[r] > maxr)
+        maxr = s.radii[r];
+      s.points[r]->coords(c);
+    }
+
+    // If residues are large compared with the box, the nearest images
+    // of two residues' centers don't say which atom images are
+    // nearest, so every pair is checked using the minimum image for
+    // each pair of atoms
+    double reach = 2.0 * maxr + _threshold;
+    bool use_grid = true;
+    if (_periodic) {
+      s.points.periodicBox(box);
+      for (uint k=0; k<3; ++k)
+        if (reach > box[k] / 2.0)
+          use_grid = false;
+    }
+
+    NeighborGrid grid;
+    if (use_grid)
+      grid = NeighborGrid(s.points, reach, _periodic);
+
+    for (uint i=0; i<nres; ++i) {
+      s.candidates.clear();
+      SphereVisitor visitor(i, s.radii[i], _threshold, s.radii, s.candidates);
+
+      if (use_grid)
+        grid.forEachNeighbor(s.centers[i], 0.0, s.radii[i] + maxr + _threshold, visitor);
+      else if (_use_centers)
+        for (uint j=i+1; j<nres; ++j)
+          visitor(j, s.centers[i].distance2(s.centers[j], box));
+      else
+        for (uint j=i+1; j<nres; ++j)
+          s.candidates.push_back(j);
+
+      for (std::vector<uint>::const_iterator j = s.candidates.begin(); j != s.candidates.end(); ++j) {
+        if (_use_centers) {
+          // With no radii, the sphere test is the center-of-mass test
+          out.push_back(Contact(i, *j));
+          continue;
+        }
+
+        bool found;
+        if (use_grid) {
+          GCoord shift(0, 0, 0);
+          if (_periodic)
+            shift = imageShift(s.centers[*j] - s.centers[i], box);
+          found = atomsInContact(i, *j, x, shift, s);
+        } else
+          found = atomsInContact(i, *j, x, box);
+        if (found)
+          out.push_back(Contact(i, *j));
+      }
+    }
+
+    std::sort(out.begin(), out.end());
+  }
+
+
+  // Any atom of residue j within the threshold of any atom of residue
+  // i, where shift takes j to the image nearest i
+  bool ResidueContactMap::atomsInContact(const uint i, const uint j, const double* x, const GCoord& shift, const Scratch& s) const {
+    double t2 = _threshold * _threshold;
+    double reach = s.radii[i] + _threshold;
+    double reach2 = reach * reach;
+    const GCoord& ci = s.centers[i];
+
+    for (uint a=_offsets[j]; a<_offsets[j+1]; ++a) {
+      GCoord u(x[3*a] + shift[0], x[3*a+1] + shift[1], x[3*a+2] + shift[2]);
+      if (ci.distance2(u) > reach2)
+        continue;
+      for (uint b=_offsets[i]; b<_offsets[i+1]; ++b) {
+        GCoord v(x[3*b], x[3*b+1], x[3*b+2]);
+        if (u.distance2(v) <= t2)
+          return(true);
+      }
+    }
+
+    return(false);
+  }
+
+
+  // Brute-force check using the minimum image between every pair of atoms
+  bool ResidueContactMap::atomsInContact(const uint i, const uint j, const double* x, const GCoord& box) const {
+    double t2 = _threshold * _threshold;
+
+    for (uint a=_offsets[j]; a<_offsets[j+1]; ++a) {
+      GCoord u(x[3*a], x[3*a+1], x[3*a+2]);
+      for (uint b=_offsets[i]; b<_offsets[i+1]; ++b)
+        if (u.distance2(GCoord(x[3*b], x[3*b+1], x[3*b+2]), box) <= t2)
+          return(true);
+    }
+
+    return(false);
+  }
+
+
+  void ResidueContactMap::Worker::operator()() {
+    ulong stride = static_cast<ulong>(map->_natoms) * 3;
+    Scratch& s = map->_scratch[thread];
+    CountMap& counts = map->_partial[thread];
+
+    for (uint f=begin; f<end; ++f) {
+      Contacts& out = (*found)[f];
+      out.clear();
+      map->findContacts(&(map->_block[f * stride]), map->_periodic ? map->_boxes[f] : GCoord(), s, out);
+      for (Contacts::const_iterator c = out.begin(); c != out.end(); ++c)
+        ++counts[map->key(c->first, c->second)];
+    }
+  }
+
+
+  void ResidueContactMap::processBlock(const uint n, std::vector<Contacts>& found) {
+    if (found.size() < n)
+      found.resize(n);
+    if (_scratch.size() < _nthreads) {
+      _scratch.resize(_nthreads);
+      _partial.resize(_nthreads);
+    }
+
+    uint nthreads = std::min(_nthreads, n);
+    if (nthreads <= 1) {
+      Worker worker(this, &found, 0, 0, n);
+      worker();
+    } else {
+      uint chunk = (n + nthreads - 1) / nthreads;
+      boost::thread_group threads;
+      for (uint t=0; t<nthreads; ++t)
+        threads.create_thread(Worker(this, &found, t, t * chunk, std::min(n, (t+1) * chunk)));
+      threads.join_all();
+    }
+
+    _nframes += n;
+  }
+
+
+  void ResidueContactMap::merge() {
+    for (std::vector<CountMap>::iterator p = _partial.begin(); p != _partial.end(); ++p) {
+      for (CountMap::const_iterator i = p->begin(); i != p->end(); ++i)
+        _counts[i->first] += i->second;
+      p->clear();
+    }
+  }
+
+
+  ResidueContactMap::Contacts ResidueContactMap::contacts(const AtomicGroup& model) const {
+    std::vector<double> x(static_cast<ulong>(_natoms) * 3);
+    for (uint i=0; i<_natoms; ++i)
+      for (uint k=0; k<3; ++k)
+        x[3*i+k] = _atoms[i]->coords()[k];
+
+    GCoord box;
+    if (_periodic) {
+      if (!model.isPeriodic())
+        throw(LOOSError("ResidueContactMap requires a periodic box when periodic"));
+      box = model.periodicBox();
+    }
+
+    Scratch s;
+    Contacts out;
+    if (_natoms)
+      findContacts(&(x[0]), box, s, out);
+    return(out);
+  }
+
+
+  ulong ResidueContactMap::count(const uint i, const uint j) const {
+    if (i == j)
+      return(_nframes);
+    CountMap::const_iterator k = _counts.find(i < j ? key(i, j) : key(j, i));
+    return(k == _counts.end() ? 0 : k->second);
+  }
+
+
+  std::vector<ResidueContactMap::ContactCount> ResidueContactMap::counts() const {
+    std::vector<ContactCount> result;
+    result.reserve(_counts.size());
+    uint n = residues();
+    for (CountMap::const_iterator i = _counts.begin(); i != _counts.end(); ++i)
+      result.push_back(ContactCount(Contact(i->first / n, i->first % n), i->second));
+    std::sort(result.begin(), result.end());
+    return(result);
+  }
+
+
+  DoubleMatrix ResidueContactMap::fractions() const {
+    uint n = residues();
+    DoubleMatrix M(n, n);
+    if (!_nframes)
+      return(M);
+
+    for (CountMap::const_iterator i = _counts.begin(); i != _counts.end(); ++i) {
+      uint a = i->first / n;
+      uint b = i->first % n;
+      M(a, b) = M(b, a) = static_cast<double>(i->second) / _nframes;
+    }
+    for (uint i=0; i<n; ++i)
+      M(i, i) = 1.0;
+
+    return(M);
+  }
+
+
+  void ResidueContactMap::clear() {
+    _counts.clear();
+    for (std::vector<CountMap>::iterator p = _partial.begin(); p != _partial.end(); ++p)
+      p->clear();
+    _nframes = 0;
+  }
+
+
+}
@@ -0,0 +1,197 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_RESIDUECONTACTMAP_HPP)
+#define LOOS_RESIDUECONTACTMAP_HPP
+
+#include <vector>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <MatrixOps.hpp>
+
+
+namespace loos {
+
+
+  //! Residue-residue contacts over a trajectory, stored sparsely
+  /**
+   * Two residues are in contact when any pair of their atoms is within
+   * the threshold, or (when using centers) when their centers of mass
+   * are.  For each frame, every residue gets a bounding sphere, and
+   * candidate pairs are found from a NeighborGrid of the sphere
+   * centers, so only residues whose spheres come within the threshold
+   * are checked atom by atom.  Within a candidate pair, atoms of one
+   * residue that are too far from the other's sphere are skipped.
+   *
+   * With periodic set, each residue is made whole and the minimum
+   * image is used between residues.  If residues are too large for
+   * this to be unambiguous in the current box, every pair of residues
+   * is checked using the minimum image between each pair of atoms.
+   * Without periodic, distances are plain Cartesian ones, as with
+   * GCoord::distance2().
+   *
+   * accumulate() reads frames a block at a time, and splits each block
+   * across threads().  Each thread counts contacts in its own sparse
+   * table, and the tables are merged when the trajectory is done.  The
+   * contacts in each frame may also be passed on to a sink, in frame
+   * order, as
+   *\code
+   * sink(const uint frame, const ResidueContactMap::Contacts& contacts);
+   *\endcode
+   * where frame is the trajectory frame index and each contact is a
+   * pair of residue indices (i < j), sorted.
+   */
+  class ResidueContactMap {
+  public:
+    typedef std::pair<uint, uint>           Contact;
+    typedef std::vector<Contact>            Contacts;
+    typedef std::pair<Contact, ulong>       ContactCount;
+
+    ResidueContactMap(const std::vector<AtomicGroup>& residues, const double threshold,
+                      const bool use_centers = false, const bool periodic = false);
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n);
+    uint threads() const { return(_nthreads); }
+
+    uint residues() const { return(_offsets.size() - 1); }
+    double threshold() const { return(_threshold); }
+
+    //! Number of frames accumulated so far
+    uint frames() const { return(_nframes); }
+
+    //! Contacts using the current coordinates of the residues
+    /**
+     * For periodic maps, the box is taken from \a model.
+     */
+    Contacts contacts(const AtomicGroup& model) const;
+
+
+    //! Accumulates contacts for the given frames of a trajectory
+    /**
+     * Each frame is read into \a model, which should contain all of
+     * the residue atoms (and supplies the periodic box).
+     */
+    template<class Sink>
+    void accumulate(AtomicGroup& model, pTraj& traj, const std::vector<uint>& indices, Sink& sink) {
+      uint blocksize = 4 * _nthreads;
+      std::vector<Contacts> found(blocksize);
+
+      for (uint i=0; i<indices.size(); i += blocksize) {
+        uint n = std::min(blocksize, static_cast<uint>(indices.size() - i));
+        for (uint j=0; j<n; ++j) {
+          traj->readFrame(indices[i+j]);
+          traj->updateGroupCoords(model);
+          loadFrame(j, model);
+        }
+        processBlock(n, found);
+        for (uint j=0; j<n; ++j)
+          sink(indices[i+j], static_cast<const Contacts&>(found[j]));
+      }
+
+      merge();
+    }
+
+    //! Accumulates contacts without keeping the per-frame contacts
+    void accumulate(AtomicGroup& model, pTraj& traj, const std::vector<uint>& indices) {
+      NullSink sink;
+      accumulate(model, traj, indices, sink);
+    }
+
+
+    //! Number of frames in which residues i and j were in contact
+    ulong count(const uint i, const uint j) const;
+
+    //! All pairs (i < j) that were ever in contact, with their counts, sorted by pair
+    std::vector<ContactCount> counts() const;
+
+    //! Dense matrix of the fraction of frames each pair was in contact
+    /**
+     * The matrix is symmetric, and the diagonal is 1 (a residue is
+     * always in contact with itself).
+     */
+    DoubleMatrix fractions() const;
+
+    //! Forget all accumulated contacts
+    void clear();
+
+
+  private:
+    typedef boost::unordered_map<ulong, ulong>   CountMap;
+
+    struct NullSink {
+      void operator()(const uint, const Contacts&) { }
+    };
+
+    // Per-thread working space
+    struct Scratch {
+      std::vector<double> crds;
+      std::vector<GCoord> centers;
+      std::vector<double> radii;
+      AtomicGroup points;
+      std::vector<uint> candidates;
+    };
+
+    struct Worker {
+      Worker(ResidueContactMap* m, std::vector<Contacts>* f, const uint t, const uint b, const uint e)
+        : map(m), found(f), thread(t), begin(b), end(e) { }
+      void operator()();
+
+      ResidueContactMap* map;
+      std::vector<Contacts>* found;
+      uint thread, begin, end;
+    };
+
+    ulong key(const uint i, const uint j) const { return(static_cast<ulong>(i) * residues() + j); }
+
+    void loadFrame(const uint slot, const AtomicGroup& model);
+    void processBlock(const uint n, std::vector<Contacts>& found);
+    void findContacts(const double* x, const GCoord& box, Scratch& s, Contacts& out) const;
+    bool atomsInContact(const uint i, const uint j, const double* x, const GCoord& shift, const Scratch& s) const;
+    bool atomsInContact(const uint i, const uint j, const double* x, const GCoord& box) const;
+    void merge();
+
+    double _threshold;
+    bool _use_centers, _periodic;
+    uint _nthreads, _natoms, _nframes;
+
+    std::vector<pAtom> _atoms;
+    std::vector<double> _masses;
+    std::vector<uint> _offsets;
+
+    std::vector<double> _block;
+    std::vector<GCoord> _boxes;
+    std::vector<Scratch> _scratch;
+    std::vector<CountMap> _partial;
+    CountMap _counts;
+  };
+
+
+}
+
+
+#endif
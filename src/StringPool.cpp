@@ -0,0 +1,81 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <StringPool.hpp>
+#include <exceptions.hpp>
+
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+namespace loos {
+
+  std::string* StringPool::_chunks[StringPool::max_chunks];
+
+
+  namespace {
+
+    typedef boost::unordered_map<std::string, StringPool::Handle> HandleMap;
+
+    // Function-local statics, so the pool is usable during static
+    // initialization of other translation units
+    HandleMap& handleMap() {
+      static HandleMap map;
+      return(map);
+    }
+
+    boost::mutex& poolMutex() {
+      static boost::mutex mtx;
+      return(mtx);
+    }
+
+  }
+
+
+  StringPool::Handle StringPool::intern(const std::string& s) {
+    boost::mutex::scoped_lock lock(poolMutex());
+
+    HandleMap& map = handleMap();
+    HandleMap::const_iterator i = map.find(s);
+    if (i != map.end())
+      return(i->second);
+
+    Handle h = map.size();
+    uint chunk = h >> chunk_bits;
+    if (chunk >= max_chunks)
+      throw(LOOSError("Too many distinct strings in the StringPool"));
+    if (_chunks[chunk] == 0)
+      _chunks[chunk] = new std::string[chunk_mask + 1];
+
+    _chunks[chunk][h & chunk_mask] = s;
+    map[s] = h;
+    return(h);
+  }
+
+
+  uint StringPool::size() {
+    boost::mutex::scoped_lock lock(poolMutex());
+    return(handleMap().size());
+  }
+
+
+}
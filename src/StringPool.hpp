@@ -0,0 +1,108 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_STRINGPOOL_HPP)
+#define LOOS_STRINGPOOL_HPP
+
+#include <string>
+
+#include <boost/unordered_map.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! Process-wide table of interned strings
+  /**
+   * Atom metadata (names, residue names, segids, ...) is highly
+   * repetitive, so each distinct string is stored once here and atoms
+   * keep a small integer handle to it.  Two handles are equal exactly
+   * when their strings are equal.
+   *
+   * Strings are never removed, and a reference returned by lookup()
+   * stays valid for the life of the program.  intern() may be called
+   * from several threads at once, but it takes a lock, so code that
+   * interns many strings from several threads should give each thread
+   * its own Cache.
+   */
+  class StringPool {
+  public:
+    typedef uint Handle;
+
+    //! Handle for \a s, adding it to the pool if necessary
+    static Handle intern(const std::string& s);
+
+    //! The string for a handle
+    static const std::string& lookup(const Handle h) {
+      return(_chunks[h >> chunk_bits][h & chunk_mask]);
+    }
+
+    //! Number of distinct strings in the pool
+    static uint size();
+
+
+    //! Unlocked, per-thread front end to the pool
+    /**
+     * Remembers the handles of the strings it has seen, so only the
+     * first occurrence of each string goes to the (locked) pool.  A
+     * Cache must only be used by one thread at a time.
+     */
+    class Cache {
+    public:
+      Handle intern(const std::string& s) {
+        Map::const_iterator i = _map.find(s);
+        if (i != _map.end())
+          return(i->second);
+        Handle h = StringPool::intern(s);
+        _map[s] = h;
+        return(h);
+      }
+
+      Handle intern(const char* begin, const char* end) {
+        _key.assign(begin, end);
+        return(intern(_key));
+      }
+
+    private:
+      typedef boost::unordered_map<std::string, Handle> Map;
+      Map _map;
+      std::string _key;
+    };
+
+  private:
+    StringPool();
+
+    static const uint chunk_bits = 12;
+    static const uint chunk_mask = (1u << chunk_bits) - 1;
+    static const uint max_chunks = 1u << 16;
+
+    // Strings are stored in fixed-size chunks that never move, so
+    // lookups need no locking while other threads add new strings
+    static std::string* _chunks[max_chunks];
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TextFrameIndex.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace loos {
+
+
+  namespace {
+
+    const char index_magic[8] = { 'L', 'O', 'O', 'S', 'I', 'D', 'X', '1' };
+
+    template<typename T>
+    void writeValue(std::ostream& os, const T& t) {
+      os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::istream& is, T& t) {
+      is.read(reinterpret_cast<char*>(&t), sizeof(T));
+      return(!is.fail());
+    }
+
+  }
+
+
+  TextFrameIndex::TextFrameIndex(const std::string& fname, const std::string& tag)
+    : _index_name(fname + ".loosidx"), _tag(tag), _valid(false), _size(0), _mtime(0)
+  {
+    struct stat st;
+    if (stat(fname.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      _valid = true;
+      _size = st.st_size;
+      _mtime = st.st_mtime;
+    }
+  }
+
+
+  bool TextFrameIndex::load(Offsets& offsets) const {
+    if (!_valid || _size < min_cached_size)
+      return(false);
+
+    std::ifstream ifs(_index_name.c_str(), std::ios::binary);
+    if (!ifs)
+      return(false);
+
+    char magic[sizeof(index_magic)];
+    if (!ifs.read(magic, sizeof(magic)) || memcmp(magic, index_magic, sizeof(magic)) != 0)
+      return(false);
+
+    ulong size, count;
+    long mtime;
+    uint taglen;
+    if (!(readValue(ifs, size) && readValue(ifs, mtime) && readValue(ifs, taglen)))
+      return(false);
+    if (size != _size || mtime != _mtime || taglen != _tag.size())
+      return(false);
+
+    std::string tag(taglen, ' ');
+    if (!ifs.read(&(tag[0]), taglen) || tag != _tag)
+      return(false);
+
+    if (!readValue(ifs, count) || count < 1 || count > _size + 1)
+      return(false);
+    Offsets cached(count);
+    if (!ifs.read(reinterpret_cast<char*>(&(cached[0])), count * sizeof(ulong)))
+      return(false);
+
+    // Sanity check the offsets themselves...
+    for (ulong i=1; i<count; ++i)
+      if (cached[i] < cached[i-1])
+        return(false);
+    if (cached.back() > _size)
+      return(false);
+
+    offsets.swap(cached);
+    return(true);
+  }
+
+
+  // Written to a temporary file first so a reader never sees a
+  // partial index
+  void TextFrameIndex::save(const Offsets& offsets) const {
+    if (!_valid || _size < min_cached_size || offsets.empty())
+      return;
+
+    std::string tmpname = _index_name + ".tmp";
+    {
+      std::ofstream ofs(tmpname.c_str(), std::ios::binary);
+      if (!ofs)
+        return;
+
+      ofs.write(index_magic, sizeof(index_magic));
+      writeValue(ofs, _size);
+      writeValue(ofs, _mtime);
+      writeValue(ofs, static_cast<uint>(_tag.size()));
+      ofs.write(_tag.data(), _tag.size());
+      writeValue(ofs, static_cast<ulong>(offsets.size()));
+      ofs.write(reinterpret_cast<const char*>(&(offsets[0])), offsets.size() * sizeof(ulong));
+
+      if (!ofs) {
+        ofs.close();
+        unlink(tmpname.c_str());
+        return;
+      }
+    }
+
+    if (std::rename(tmpname.c_str(), _index_name.c_str()) != 0)
+      unlink(tmpname.c_str());
+  }
+
+
+}
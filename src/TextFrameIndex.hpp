@@ -0,0 +1,82 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_TEXTFRAMEINDEX_HPP)
+#define LOOS_TEXTFRAMEINDEX_HPP
+
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! On-disk cache of frame offsets for a text trajectory
+  /**
+   * Text trajectories (Tinker ARC, concatenated PDB) have frames of
+   * varying size, so they must be scanned from beginning to end to
+   * find where each frame starts.  The offsets found by that scan are
+   * saved alongside the trajectory (as "<trajectory>.loosidx") and
+   * reused as long as the trajectory's size and modification time are
+   * unchanged.
+   *
+   * The cache is strictly best-effort.  An index that is missing,
+   * stale, or unreadable is ignored, and failing to write one (e.g. in
+   * a read-only directory) is silently ignored too.  Small files are
+   * never cached since scanning them is cheaper than the extra file.
+   */
+  class TextFrameIndex {
+  public:
+    typedef std::vector<ulong>     Offsets;
+
+    //! Trajectories smaller than this are not cached
+    static const ulong min_cached_size = 16ul << 20;
+
+    //! Index for the trajectory \a fname
+    /**
+     * The \a tag identifies how the offsets were built (format and
+     * number of atoms), so an index made by a different reader (or
+     * with a different model) is never used.
+     */
+    TextFrameIndex(const std::string& fname, const std::string& tag);
+
+    //! Reads cached offsets, returning false if there is no usable cache
+    bool load(Offsets& offsets) const;
+
+    //! Saves the offsets (if the trajectory is large enough)
+    void save(const Offsets& offsets) const;
+
+    std::string indexName() const { return(_index_name); }
+
+  private:
+    std::string _index_name, _tag;
+    bool _valid;
+    ulong _size;
+    long _mtime;
+  };
+
+
+}
+
+#endif
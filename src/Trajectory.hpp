@@ -26,6 +26,7 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
 
 #include <boost/utility.hpp>
 #include <boost/lambda/lambda.hpp>
@@ -66,6 +67,10 @@ namespace loos {
 	public:
 		typedef boost::shared_ptr<std::istream>      pStream;
 
+		//! A contiguous run of atom indices (first index, number of atoms)
+		typedef std::pair<uint, uint>                IndexRun;
+		typedef std::vector<IndexRun>                IndexRuns;
+
 
 		Trajectory() : cached_first(false), _filename("unset"), _current_frame(0) { }
 
@@ -83,7 +88,8 @@ namespace loos {
 		}
 
 
-		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame)
+		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame),
+						  _hint_runs(t._hint_runs)
 		{
 		}
 
@@ -174,6 +180,62 @@ namespace loos {
 
 
 
+		//! Tell the reader which atoms will actually be used from each frame
+		/** Formats that store each frame's coordinates in a way that
+		 * allows parts of it to be read independently (DCD, TRR, Amber
+		 * NetCDF) will then only read the coordinates for the atoms in
+		 * \a g (plus any small gaps between them), which can be a
+		 * substantial savings when analyzing a small subset of a large
+		 * system.  Formats that must decode the entire frame (e.g. XTC)
+		 * ignore the hint.
+		 *
+		 * The hint takes effect with the next frame read.  After that,
+		 * the coordinates for any atom outside the hint are undefined,
+		 * so only groups drawn from \a g should be passed to
+		 * updateGroupCoords().  If the hint would cover most of the
+		 * frame anyway, it is dropped and full frames are read.
+		 */
+		void setSelectionHint(const AtomicGroup& g) {
+			std::vector<uint> indices;
+			indices.reserve(g.size());
+			for (AtomicGroup::const_iterator i = g.begin(); i != g.end(); ++i)
+				indices.push_back((*i)->index());
+			std::sort(indices.begin(), indices.end());
+			indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+			IndexRuns runs;
+			ulong covered = 0;
+			for (std::vector<uint>::const_iterator i = indices.begin(); i != indices.end(); ++i) {
+				if (!runs.empty() && *i - (runs.back().first + runs.back().second) <= hint_gap) {
+					covered += *i + 1 - (runs.back().first + runs.back().second);
+					runs.back().second = *i - runs.back().first + 1;
+				} else {
+					runs.push_back(IndexRun(*i, 1));
+					++covered;
+				}
+			}
+
+			if (covered * 2 > natoms())
+				runs.clear();
+			setSelectionHint(runs);
+		}
+
+		//! Set the selection hint directly as runs of atom indices
+		void setSelectionHint(const IndexRuns& runs) {
+			_hint_runs = runs;
+			selectionHintChanged();
+		}
+
+		//! Go back to reading full frames
+		void clearSelectionHint() { setSelectionHint(IndexRuns()); }
+
+		bool hasSelectionHint() const { return(!_hint_runs.empty()); }
+
+		//! Runs of atom indices the reader has been asked to read
+		const IndexRuns& selectionHint() const { return(_hint_runs); }
+
+
+
 		//! Returns the current frame's velocities as a vector of GCoords
 		/**
 		 * If the trajectory format supports velocities "natively", then those will
@@ -302,6 +364,12 @@ namespace loos {
 		std::string _filename;   // Remember filename (if passed)
 		uint _current_frame;
 
+		IndexRuns _hint_runs;    // Atoms to read when a selection hint is set
+
+		// Runs of hinted atoms separated by this many atoms or fewer
+		// are merged so readers don't seek over tiny gaps
+		static const uint hint_gap = 64;
+
 	private:
 
 		//! NVI implementation for seeking next frame
@@ -322,6 +390,9 @@ namespace loos {
 
 		virtual std::vector<GCoord> velocitiesImpl() const { return(std::vector<GCoord>()); }
 
+		//! Called whenever the selection hint changes (for decorators that must pass it along)
+		virtual void selectionHintChanged() { }
+
 	};
 
 }
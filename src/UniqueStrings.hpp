@@ -21,59 +21,63 @@
 
 
 
-/*
-   ***WARNING******WARNING******WARNING******WARNING******WARNING******WARNING***
-
-   THIS CLASS IS NOW DEPRECATED AND WILL BE REMOVED IN A FUTURE RELEASE OF LOOS
-
-   ***WARNING******WARNING******WARNING******WARNING******WARNING******WARNING***
-*/
-
 #if !defined(LOOS_UNIQUESTRINGS_HPP)
 #define LOOS_UNIQUESTRINGS_HPP
 
 
 #include <string>
-#include <ext/slist>
+#include <vector>
+#include <boost/unordered_map.hpp>
 
 
 namespace loos {
 
   //! Class for uniquifying strings...
-  /**  This class uses an slist and just does a linear search to see if
-   *   we've already encountered the passed string before.  This probably
-   *   should be updated to use a faster method in the future...
+  /**  Each distinct string is given a small integer index, in the
+   *   order the strings are first added.  The index of a string never
+   *   changes once it has been added.  Lookups go through a hash
+   *   table, so adding or finding a string takes constant time no
+   *   matter how many unique strings have been seen.
    */
   class UniqueStrings {
   public:
 
-    //! Adds a string to the unique string list
-    void add(const std::string& s) {
-      if (find(s) < 0)
-        uniques.push_front(s);
+    //! Adds a string to the unique string list, returning its index
+    int add(const std::string& s) {
+      std::pair<IndexMap::iterator, bool> r = indices.insert(IndexMap::value_type(s, uniques.size()));
+      if (r.second)
+        uniques.push_back(s);
+      return(r.first->second);
     }
 
     //! Number of unique strings found...
     int size(void) const { return(uniques.size()); }
 
-    //! Returns the raw slist of strings...
-    __gnu_cxx::slist<std::string> strings(void) const { return(uniques); }
+    //! Returns the unique strings, in the order they were first added
+    const std::vector<std::string>& strings(void) const { return(uniques); }
+
+    //! The string with the given index
+    const std::string& operator[](const int i) const { return(uniques[i]); }
 
     //! Checks to see if we've encountered this string before...
-    /** Returns an index (a unique int) representing this string.
+    /** Returns the index (a unique int) representing this string.
      *  If the string is not found, returns -1.
      */
-    int find(const std::string& s) {
-      int j = 0;
-      __gnu_cxx::slist<std::string>::const_iterator i;
-      for (i = uniques.begin(); i != uniques.end(); i++, j++)
-        if (*i == s)
-          return(j);
-      return(-1); 
+    int find(const std::string& s) const {
+      IndexMap::const_iterator i = indices.find(s);
+      return(i == indices.end() ? -1 : i->second);
+    }
+
+    void clear(void) {
+      uniques.clear();
+      indices.clear();
     }
 
   private:
-    __gnu_cxx::slist<std::string> uniques;
+    typedef boost::unordered_map<std::string, int> IndexMap;
+
+    std::vector<std::string> uniques;
+    IndexMap indices;
   };
 
 }
@@ -0,0 +1,327 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <Voronoi2D.hpp>
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  // Builds the cells for a contiguous range of sites.  Each cell only
+  // writes its own results, so workers don't need to lock.  The first
+  // error encountered by any worker is kept and rethrown by compute().
+  struct Voronoi2D::Worker {
+    Worker(Voronoi2D* v, const uint b, const uint e, boost::mutex* m, std::string* err)
+      : voronoi(v), begin(b), end(e), mtx(m), error(err) { }
+
+    void operator()() {
+      std::vector<Vertex> poly, scratch;
+      try {
+        for (uint i=begin; i<end; ++i)
+          voronoi->computeCell(i, poly, scratch);
+      }
+      catch (std::exception& e) {
+        boost::lock_guard<boost::mutex> lock(*mtx);
+        if (error->empty())
+          *error = e.what();
+      }
+    }
+
+    Voronoi2D* voronoi;
+    uint begin, end;
+    boost::mutex* mtx;
+    std::string* error;
+  };
+
+
+
+  void Voronoi2D::compute(const AtomicGroup& atoms) {
+    if (!atoms.isPeriodic())
+      throw(LOOSError("Voronoi2D requires a periodic box"));
+
+    GCoord box = atoms.periodicBox();
+    _lx = box[0];
+    _ly = box[1];
+    if (_lx <= 0.0 || _ly <= 0.0)
+      throw(LOOSError("Voronoi2D requires a positive box size"));
+
+    uint n = atoms.size();
+    _x.resize(n);
+    _y.resize(n);
+    _crds.resize(n);
+    _sites.clear();
+    for (uint i=0; i<n; ++i) {
+      const GCoord& c = atoms[i]->coords();
+      _crds[i] = c;
+      _x[i] = c[0] - _lx * floor(c[0] / _lx);
+      _y[i] = c[1] - _ly * floor(c[1] / _ly);
+      if (_x[i] >= _lx)
+        _x[i] = 0.0;
+      if (_y[i] >= _ly)
+        _y[i] = 0.0;
+      _sites[atoms[i].get()] = i;
+    }
+
+
+    // Aim for about two sites per grid cell
+    double spacing = n ? sqrt(2.0 * _lx * _ly / n) : _lx;
+    _nx = static_cast<uint>(floor(_lx / spacing));
+    _ny = static_cast<uint>(floor(_ly / spacing));
+    if (_nx == 0)
+      _nx = 1;
+    if (_ny == 0)
+      _ny = 1;
+    _cx = _lx / _nx;
+    _cy = _ly / _ny;
+
+    uint ncells = _nx * _ny;
+    std::vector<uint> which(n);
+    _start.assign(ncells + 1, 0);
+    for (uint i=0; i<n; ++i) {
+      uint a = std::min(static_cast<uint>(_x[i] / _cx), _nx - 1);
+      uint b = std::min(static_cast<uint>(_y[i] / _cy), _ny - 1);
+      which[i] = b * _nx + a;
+      ++_start[which[i] + 1];
+    }
+    for (uint c=0; c<ncells; ++c)
+      _start[c+1] += _start[c];
+    std::vector<uint> fill(_start.begin(), _start.end() - 1);
+    _binned.resize(n);
+    for (uint i=0; i<n; ++i)
+      _binned[fill[which[i]]++] = i;
+
+
+    _areas.assign(n, 0.0);
+    _neighbors.assign(n, std::vector<uint>());
+    _vertices.assign(n, std::vector<GCoord>());
+
+    uint nthreads = _nthreads ? _nthreads : boost::thread::hardware_concurrency();
+    if (nthreads > n)
+      nthreads = n;
+
+    boost::mutex mtx;
+    std::string error;
+    if (nthreads <= 1) {
+      Worker w(this, 0, n, &mtx, &error);
+      w();
+    } else {
+      boost::thread_group threads;
+      uint chunk = (n + nthreads - 1) / nthreads;
+      for (uint b=0; b<n; b += chunk)
+        threads.create_thread(Worker(this, b, std::min(n, b + chunk), &mtx, &error));
+      threads.join_all();
+    }
+
+    if (!error.empty())
+      throw(LOOSError(error));
+  }
+
+
+
+  // Clips the polygon (relative to the site) by the half-plane closer
+  // to the site than to the point (dx, dy).  Returns false if the
+  // polygon was unchanged.
+  bool Voronoi2D::clip(std::vector<Vertex>& poly, std::vector<Vertex>& scratch, const double dx, const double dy, const int label) const {
+    double h = 0.5 * (dx*dx + dy*dy);
+    uint m = poly.size();
+
+    bool outside = false;
+    for (uint k=0; k<m && !outside; ++k)
+      outside = (poly[k].x * dx + poly[k].y * dy > h);
+    if (!outside)
+      return(false);
+
+    scratch.clear();
+    for (uint k=0; k<m; ++k) {
+      const Vertex& a = poly[k];
+      const Vertex& b = poly[(k+1) % m];
+      double fa = a.x * dx + a.y * dy - h;
+      double fb = b.x * dx + b.y * dy - h;
+
+      if (fa <= 0.0)
+        scratch.push_back(a);
+      if ((fa <= 0.0) != (fb <= 0.0)) {
+        double t = fa / (fa - fb);
+        // Leaving the half-plane, the new edge runs along the bisector.
+        // Entering, it is the rest of the edge from a to b.
+        scratch.push_back(Vertex(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), (fa <= 0.0) ? label : a.label));
+      }
+    }
+
+    poly.swap(scratch);
+    return(true);
+  }
+
+
+
+  void Voronoi2D::computeCell(const uint i, std::vector<Vertex>& poly, std::vector<Vertex>& scratch) {
+    double px = _x[i];
+    double py = _y[i];
+    int ci = std::min(static_cast<uint>(px / _cx), _nx - 1);
+    int cj = std::min(static_cast<uint>(py / _cy), _ny - 1);
+
+    // Start with a square that the site's own images will cut down to
+    // (at most) the box
+    poly.clear();
+    poly.push_back(Vertex(-_lx, -_ly, -1));
+    poly.push_back(Vertex(_lx, -_ly, -1));
+    poly.push_back(Vertex(_lx, _ly, -1));
+    poly.push_back(Vertex(-_lx, _ly, -1));
+    double rmax2 = 2.0 * (_lx * _lx + _ly * _ly);
+
+    double cmin = std::min(_cx, _cy);
+    int nx = _nx;
+    int ny = _ny;
+
+    // Search rings of grid cells outward.  Sites in ring r are at
+    // least (r-1) cells away, and a site more than twice the distance
+    // to the farthest vertex cannot cut the cell.
+    for (int r=0; ; ++r) {
+      if (r > 1) {
+        double lb = (r - 1) * cmin;
+        if (lb * lb >= 4.0 * rmax2)
+          break;
+      }
+
+      for (int b = cj - r; b <= cj + r; ++b) {
+        bool edge_row = (b == cj - r || b == cj + r);
+        int step = edge_row ? 1 : 2 * r;
+        for (int a = ci - r; a <= ci + r; a += step) {
+
+          // Map the (unwrapped) grid cell into the box, remembering
+          // which image it came from
+          int wa = ((a % nx) + nx) % nx;
+          int wb = ((b % ny) + ny) % ny;
+          double sx = _lx * ((a - wa) / nx);
+          double sy = _ly * ((b - wb) / ny);
+          uint cell = wb * _nx + wa;
+
+          for (uint k = _start[cell]; k < _start[cell+1]; ++k) {
+            uint j = _binned[k];
+            if (j == i && a == wa && b == wb)
+              continue;
+
+            double dx = _x[j] + sx - px;
+            double dy = _y[j] + sy - py;
+            double d2 = dx*dx + dy*dy;
+            if (d2 == 0.0)
+              throw(LOOSError("Voronoi2D found two sites at the same x-y position"));
+            if (0.25 * d2 >= rmax2)
+              continue;
+
+            if (clip(poly, scratch, dx, dy, j)) {
+              rmax2 = 0.0;
+              for (uint v=0; v<poly.size(); ++v) {
+                double q = poly[v].x * poly[v].x + poly[v].y * poly[v].y;
+                if (q > rmax2)
+                  rmax2 = q;
+              }
+            }
+          }
+        }
+      }
+    }
+
+
+    // Area, neighbors, and vertices in the original frame
+    double area = 0.0;
+    uint m = poly.size();
+    std::vector<uint>& nbrs = _neighbors[i];
+    std::vector<GCoord>& verts = _vertices[i];
+    nbrs.clear();
+    verts.resize(m);
+
+    for (uint k=0; k<m; ++k) {
+      const Vertex& a = poly[k];
+      const Vertex& b = poly[(k+1) % m];
+      area += a.x * b.y - b.x * a.y;
+      if (a.label >= 0 && static_cast<uint>(a.label) != i)
+        nbrs.push_back(a.label);
+      verts[k] = GCoord(_crds[i][0] + a.x, _crds[i][1] + a.y, 0.0);
+    }
+
+    std::sort(nbrs.begin(), nbrs.end());
+    nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+    _areas[i] = 0.5 * fabs(area);
+  }
+
+
+
+  uint Voronoi2D::site(const pAtom& a) const {
+    std::map<const Atom*, uint>::const_iterator i = _sites.find(a.get());
+    if (i == _sites.end())
+      throw(LOOSError(*a, "Atom is not one of the Voronoi sites"));
+    return(i->second);
+  }
+
+
+  int Voronoi2D::siteIndex(const pAtom& a) const {
+    std::map<const Atom*, uint>::const_iterator i = _sites.find(a.get());
+    return(i == _sites.end() ? -1 : static_cast<int>(i->second));
+  }
+
+
+  double Voronoi2D::area(const AtomicGroup& group) const {
+    double a = 0.0;
+    for (AtomicGroup::const_iterator i = group.begin(); i != group.end(); ++i)
+      a += _areas[site(*i)];
+    return(a);
+  }
+
+
+  bool Voronoi2D::areNeighbors(const uint i, const uint j) const {
+    const std::vector<uint>& n = _neighbors.at(i);
+    return(std::binary_search(n.begin(), n.end(), j));
+  }
+
+
+  bool Voronoi2D::areNeighbors(const AtomicGroup& a, const AtomicGroup& b) const {
+    std::vector<uint> sb;
+    for (AtomicGroup::const_iterator i = b.begin(); i != b.end(); ++i)
+      sb.push_back(site(*i));
+
+    for (AtomicGroup::const_iterator i = a.begin(); i != a.end(); ++i) {
+      uint s = site(*i);
+      for (std::vector<uint>::const_iterator j = sb.begin(); j != sb.end(); ++j)
+        if (areNeighbors(s, *j))
+          return(true);
+    }
+    return(false);
+  }
+
+
+  double Voronoi2D::totalArea() const {
+    double a = 0.0;
+    for (std::vector<double>::const_iterator i = _areas.begin(); i != _areas.end(); ++i)
+      a += *i;
+    return(a);
+  }
+
+}
@@ -0,0 +1,169 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_VORONOI2D_HPP)
+#define LOOS_VORONOI2D_HPP
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+
+  //! Periodic 2D Voronoi decomposition of a group of atoms in the x-y plane
+  /**
+   * Each atom is a site, and its Voronoi cell is the region of the
+   * periodic x-y plane closer to it than to any other site (or any
+   * periodic image of a site).  The z coordinates are ignored, so
+   * slice a membrane into leaflets (or thinner slabs) first.
+   *
+   * Periodicity is handled directly, so there are no padding atoms
+   * to choose.  Sites are binned into a 2D grid, and each cell is
+   * built by clipping a polygon with the bisectors of nearby sites,
+   * searching outward until no further site could change it.  Cells
+   * are independent, so they are divided among threads.  The
+   * neighbors of a site (its Delaunay neighbors) are the sites that
+   * contribute an edge to its cell.
+   *
+   * Sites are referred to by their index in the group passed to
+   * compute().  The areas of the cells sum to the area of the box.
+   *
+   * This is independent of the scipy-based Python tools in
+   * Packages/Voronoi (VoronoiWrapper, SuperRegion), which are
+   * unchanged and still pad the box with image atoms.
+   *
+   *\code
+   * Voronoi2D voronoi;
+   * voronoi.threads(4);
+   * while (traj->readFrame()) {
+   *   traj->updateGroupCoords(model);
+   *   voronoi.compute(slice);
+   *   for (uint i=0; i<lipids.size(); ++i)
+   *     cout << voronoi.area(lipids[i]) << endl;
+   * }
+   *\endcode
+   */
+  class Voronoi2D {
+  public:
+    Voronoi2D() : _nthreads(1), _lx(0.0), _ly(0.0) { }
+
+    //! Decompose \a atoms immediately
+    explicit Voronoi2D(const AtomicGroup& atoms, const uint nthreads = 1)
+      : _nthreads(nthreads), _lx(0.0), _ly(0.0)
+    {
+      compute(atoms);
+    }
+
+    //! Number of threads to use (0 = all available)
+    void threads(const uint n) { _nthreads = n; }
+
+    //! Builds the Voronoi cells for the current coordinates of \a atoms
+    /**
+     * \a atoms must be periodic.  Throws a LOOSError if two sites
+     * share the same x-y position.
+     */
+    void compute(const AtomicGroup& atoms);
+
+
+    //! Number of sites
+    uint size() const { return(_areas.size()); }
+
+    //! Area of the cell for site \a i
+    double area(const uint i) const { return(_areas.at(i)); }
+
+    //! Total area of the cells for the atoms in \a group
+    /**
+     * Every atom in \a group must be one of the sites, otherwise a
+     * LOOSError is thrown.
+     */
+    double area(const AtomicGroup& group) const;
+
+    //! Areas of all cells
+    std::vector<double> areas() const { return(_areas); }
+
+    //! Sites sharing an edge with site \a i (sorted)
+    std::vector<uint> neighbors(const uint i) const { return(_neighbors.at(i)); }
+
+    //! True if sites \a i and \a j share an edge
+    bool areNeighbors(const uint i, const uint j) const;
+
+    //! True if any cell of \a a shares an edge with any cell of \a b
+    bool areNeighbors(const AtomicGroup& a, const AtomicGroup& b) const;
+
+    //! Vertices of the cell for site \a i, in counter-clockwise order
+    /**
+     * The polygon surrounds the site's own (unwrapped) x-y position,
+     * and the z-coordinates are zero.
+     */
+    std::vector<GCoord> vertices(const uint i) const { return(_vertices.at(i)); }
+
+    //! Index of the site for atom \a a, or -1 if it is not a site
+    int siteIndex(const pAtom& a) const;
+
+    //! Sum of all cell areas (the box area, less roundoff)
+    double totalArea() const;
+
+
+  private:
+    struct Worker;
+
+    struct Vertex {
+      Vertex() : x(0.0), y(0.0), label(-1) { }
+      Vertex(const double a, const double b, const int l) : x(a), y(b), label(l) { }
+      double x, y;
+      int label;      // Site generating the edge from this vertex to the next
+    };
+
+    void computeCell(const uint i, std::vector<Vertex>& poly, std::vector<Vertex>& scratch);
+    bool clip(std::vector<Vertex>& poly, std::vector<Vertex>& scratch, const double dx, const double dy, const int label) const;
+    uint site(const pAtom& a) const;
+
+
+    uint _nthreads;
+    double _lx, _ly;
+
+    // Wrapped site coordinates, and the original ones for output
+    std::vector<double> _x, _y;
+    std::vector<GCoord> _crds;
+    std::map<const Atom*, uint> _sites;
+
+    // Sites binned into a periodic grid, with the sites in cell c at
+    // [_start[c], _start[c+1]) of _binned
+    uint _nx, _ny;
+    double _cx, _cy;
+    std::vector<uint> _start, _binned;
+
+    std::vector<double> _areas;
+    std::vector< std::vector<uint> > _neighbors;
+    std::vector< std::vector<GCoord> > _vertices;
+  };
+
+
+}
+
+#endif
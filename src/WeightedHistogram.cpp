@@ -0,0 +1,160 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <WeightedHistogram.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  WeightedHistogram::WeightedHistogram(const double min, const double max, const uint nbins)
+    : _ndim(1), _total(0.0)
+  {
+    _min[0] = min;
+    _max[0] = max;
+    _nbins[0] = nbins;
+    init();
+  }
+
+
+  WeightedHistogram::WeightedHistogram(const double xmin, const double xmax, const uint nx,
+                                       const double ymin, const double ymax, const uint ny)
+    : _ndim(2), _total(0.0)
+  {
+    _min[0] = xmin;
+    _max[0] = xmax;
+    _nbins[0] = nx;
+    _min[1] = ymin;
+    _max[1] = ymax;
+    _nbins[1] = ny;
+    init();
+  }
+
+
+  WeightedHistogram::WeightedHistogram(const GCoord& min, const GCoord& max, const uint nx, const uint ny, const uint nz)
+    : _ndim(3), _total(0.0)
+  {
+    _nbins[0] = nx;
+    _nbins[1] = ny;
+    _nbins[2] = nz;
+    for (uint d=0; d<3; ++d) {
+      _min[d] = min[d];
+      _max[d] = max[d];
+    }
+    init();
+  }
+
+
+  // Unused dimensions have a single bin so the flat indexing in add()
+  // works for any number of dimensions
+  void WeightedHistogram::init() {
+    ulong n = 1;
+    for (uint d=0; d<3; ++d) {
+      if (d >= _ndim) {
+        _min[d] = 0.0;
+        _max[d] = 1.0;
+        _nbins[d] = 1;
+      }
+      if (_nbins[d] < 1)
+        throw(LOOSError("WeightedHistogram must have at least one bin in each dimension"));
+      if (!(_max[d] > _min[d]))
+        throw(LOOSError("WeightedHistogram maximum must be greater than its minimum"));
+      _width[d] = (_max[d] - _min[d]) / _nbins[d];
+      n *= _nbins[d];
+    }
+    _bins.assign(n, 0.0);
+  }
+
+
+  double WeightedHistogram::binnedWeight() const {
+    double sum = 0.0;
+    for (std::vector<double>::const_iterator i = _bins.begin(); i != _bins.end(); ++i)
+      sum += *i;
+    return(sum);
+  }
+
+
+  WeightedHistogram WeightedHistogram::emptyCopy() const {
+    WeightedHistogram h(*this);
+    h.clear();
+    return(h);
+  }
+
+
+  bool WeightedHistogram::sameShape(const WeightedHistogram& h) const {
+    if (_ndim != h._ndim)
+      return(false);
+    for (uint d=0; d<3; ++d)
+      if (_nbins[d] != h._nbins[d] || _min[d] != h._min[d] || _max[d] != h._max[d])
+        return(false);
+    return(true);
+  }
+
+
+  void WeightedHistogram::merge(const WeightedHistogram& h) {
+    if (!sameShape(h))
+      throw(LOOSError("Cannot merge histograms with different shapes"));
+
+    for (ulong i=0; i<_bins.size(); ++i)
+      _bins[i] += h._bins[i];
+    _total += h._total;
+  }
+
+
+  void WeightedHistogram::clear() {
+    _bins.assign(_bins.size(), 0.0);
+    _total = 0.0;
+  }
+
+
+
+  HistogramAccumulator::HistogramAccumulator(const WeightedHistogram& shape, const uint nslots)
+    : _slots(nslots < 1 ? 1 : nslots, shape.emptyCopy())
+  { }
+
+
+  std::pair<uint, uint> HistogramAccumulator::slotRange(const uint i, const uint n) const {
+    uint m = _slots.size();
+    uint per = n / m;
+    uint extra = n % m;
+    uint begin = i * per + (i < extra ? i : extra);
+    uint end = begin + per + (i < extra ? 1 : 0);
+    return(std::pair<uint, uint>(begin, end));
+  }
+
+
+  WeightedHistogram HistogramAccumulator::reduce() const {
+    WeightedHistogram h(_slots[0]);
+    for (uint i=1; i<_slots.size(); ++i)
+      h.merge(_slots[i]);
+    return(h);
+  }
+
+
+  void HistogramAccumulator::clear() {
+    for (std::vector<WeightedHistogram>::iterator i = _slots.begin(); i != _slots.end(); ++i)
+      i->clear();
+  }
+
+
+}
@@ -0,0 +1,201 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_WEIGHTEDHISTOGRAM_HPP)
+#define LOOS_WEIGHTEDHISTOGRAM_HPP
+
+#include <vector>
+#include <utility>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+
+
+namespace loos {
+
+
+  //! Regular 1, 2, or 3 dimensional histogram of weighted values
+  /**
+   * Each dimension covers [min, max) with a fixed number of equal
+   * bins, and the bins are stored in one row-major array (the last
+   * dimension varies fastest).  Values outside the range are not
+   * binned, but their weight still counts towards totalWeight().
+   *
+   * A histogram is not itself thread-safe.  For frame-parallel
+   * analyses, give each thread its own copy through a
+   * HistogramAccumulator.
+   */
+  class WeightedHistogram {
+  public:
+    WeightedHistogram() : _ndim(0), _total(0.0) { }
+
+    //! 1D histogram
+    WeightedHistogram(const double min, const double max, const uint nbins);
+
+    //! 2D histogram
+    WeightedHistogram(const double xmin, const double xmax, const uint nx,
+                      const double ymin, const double ymax, const uint ny);
+
+    //! 3D histogram
+    WeightedHistogram(const GCoord& min, const GCoord& max, const uint nx, const uint ny, const uint nz);
+
+    uint dimensions() const { return(_ndim); }
+
+    //! Number of bins along dimension \a d
+    uint bins(const uint d = 0) const { return(_nbins[d]); }
+    double minimum(const uint d = 0) const { return(_min[d]); }
+    double maximum(const uint d = 0) const { return(_max[d]); }
+    double binWidth(const uint d = 0) const { return(_width[d]); }
+
+    //! Total number of bins
+    ulong size() const { return(_bins.size()); }
+
+    //! Bin along dimension \a d that holds \a x, or -1 if out of range
+    long binIndex(const double x, const uint d = 0) const {
+      if (!(x >= _min[d] && x < _max[d]))
+        return(-1);
+      long i = static_cast<long>((x - _min[d]) / _width[d]);
+      return(i < _nbins[d] ? i : _nbins[d] - 1);
+    }
+
+    //! Bins the weight, returning false if the value was out of range
+    bool add(const double x, const double w = 1.0) {
+      _total += w;
+      long i = binIndex(x);
+      if (i < 0)
+        return(false);
+      _bins[i] += w;
+      return(true);
+    }
+
+    bool add(const double x, const double y, const double w) {
+      _total += w;
+      long i = binIndex(x, 0);
+      long j = binIndex(y, 1);
+      if (i < 0 || j < 0)
+        return(false);
+      _bins[i * _nbins[1] + j] += w;
+      return(true);
+    }
+
+    bool add(const GCoord& c, const double w = 1.0) {
+      _total += w;
+      long i = binIndex(c[0], 0);
+      long j = binIndex(c[1], 1);
+      long k = binIndex(c[2], 2);
+      if (i < 0 || j < 0 || k < 0)
+        return(false);
+      _bins[(i * _nbins[1] + j) * _nbins[2] + k] += w;
+      return(true);
+    }
+
+    //! Adds directly to a bin (using the flat index)
+    void addToBin(const ulong i, const double w = 1.0) {
+      _total += w;
+      _bins[i] += w;
+    }
+
+    double operator[](const ulong i) const { return(_bins[i]); }
+    double operator()(const uint i) const { return(_bins[i]); }
+    double operator()(const uint i, const uint j) const { return(_bins[i * _nbins[1] + j]); }
+    double operator()(const uint i, const uint j, const uint k) const { return(_bins[(i * _nbins[1] + j) * _nbins[2] + k]); }
+
+    //! Center of bin \a i along dimension \a d
+    double binCenter(const uint i, const uint d = 0) const { return(_min[d] + (i + 0.5) * _width[d]); }
+
+    //! Sum of all weights added, including those out of range
+    double totalWeight() const { return(_total); }
+
+    //! Sum of the weights in the bins
+    double binnedWeight() const;
+
+    const std::vector<double>& values() const { return(_bins); }
+
+    //! Same shape, with all bins zeroed
+    WeightedHistogram emptyCopy() const;
+
+    //! True if \a h has the same dimensions, ranges, and bins
+    bool sameShape(const WeightedHistogram& h) const;
+
+    //! Adds the bins (and total weight) of \a h (which must be the same shape)
+    void merge(const WeightedHistogram& h);
+
+    void clear();
+
+  private:
+    void init();
+
+    uint _ndim;
+    double _min[3], _max[3], _width[3];
+    long _nbins[3];
+    std::vector<double> _bins;
+    double _total;
+  };
+
+
+
+  //! Per-thread histograms with a deterministic reduction
+  /**
+   * Holds one histogram for each worker slot, all the same shape as
+   * the template histogram.  Each thread only adds to its own slot, so
+   * no locking is needed.  reduce() sums the slots in slot order, and
+   * slotRange() splits a block of frames into contiguous pieces, so
+   * for a given number of slots the result does not depend on how the
+   * threads happen to be scheduled.  With one slot, values are added
+   * in exactly the same order as a serial loop.
+   *
+   *\code
+   * HistogramAccumulator acc(WeightedHistogram(0.0, 15.0, 150), nthreads);
+   * // in thread t...
+   * std::pair<uint, uint> r = acc.slotRange(t, frames.size());
+   * for (uint i=r.first; i<r.second; ++i)
+   *   acc.slot(t).add(d, weights.frameWeight(frames[i]));
+   * // after joining...
+   * WeightedHistogram hist = acc.reduce();
+   *\endcode
+   */
+  class HistogramAccumulator {
+  public:
+    HistogramAccumulator(const WeightedHistogram& shape, const uint nslots);
+
+    uint slots() const { return(_slots.size()); }
+
+    WeightedHistogram& slot(const uint i) { return(_slots[i]); }
+    const WeightedHistogram& slot(const uint i) const { return(_slots[i]); }
+
+    //! Half-open range of the \a n items that slot \a i should handle
+    std::pair<uint, uint> slotRange(const uint i, const uint n) const;
+
+    //! Sum of all slots
+    WeightedHistogram reduce() const;
+
+    //! Zero all slots
+    void clear();
+
+  private:
+    std::vector<WeightedHistogram> _slots;
+  };
+
+
+}
+
+#endif
@@ -122,10 +122,10 @@ namespace loos {
         // # of weights must match number of frames in the associated traj
         if (_num_weights != _traj->nframes()) {
             throw(LOOSError(std::string("Number of weights must match the length of the trajectory")));
+        }
 
         // Zero out the weight of the trajectory
         _totalTraj = 0.0;
-        }
     }
 
 
@@ -140,6 +140,21 @@ namespace loos {
         return _weights.at(index);
     }
 
+    //! Return the weight for frame index without touching the current frame
+    double Weights::frameWeight(const uint index) const {
+        if (index >= _weights.size())
+            throw(LOOSError("Frame index is out of range for the weights"));
+        return _weights[index];
+    }
+
+    //! Sum the weights for a list of frames (in list order)
+    double Weights::totalWeight(const std::vector<uint>& frames) const {
+        double sum = 0.0;
+        for (std::vector<uint>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+            sum += frameWeight(*i);
+        return sum;
+    }
+
     //! calling nomenclature wraps get
     const double Weights::operator()() {
         return get();
@@ -29,6 +29,7 @@
 #include <string>
 #include <stdexcept>
 #include <map>
+#include <vector>
 
 namespace loos {
 
@@ -54,6 +55,17 @@ namespace loos {
         const double operator()();
         const double operator()(const uint index);
 
+        //! Weight for frame \a index, independent of the current frame
+        /**
+         * Unlike get() and accumulate(), this does not depend on (or
+         * change) any state, so it is safe to call from several
+         * threads processing frames out of order.
+         */
+        double frameWeight(const uint index) const;
+
+        //! Sum of the weights for the listed frames
+        double totalWeight(const std::vector<uint>& frames) const;
+
         std::vector<double> weights();
 
     private:
@@ -69,7 +81,9 @@ namespace loos {
                                         current_frame(0),
                                         _total(0.0),
                                         _filename(filename),
-                                        _has_list(false)
+                                        _has_list(false),
+                                        _num_weights(0),
+                                        _totalTraj(0.0)
                                        {
             add_traj(traj);
         };
@@ -77,13 +91,17 @@ namespace loos {
         Weights(const std::string &filename): current_frame(0),
                                               _total(0.0),
                                              _filename(filename),
-                                             _has_list(false) {
+                                             _has_list(false),
+                                             _num_weights(0),
+                                             _totalTraj(0.0) {
 
         };
 
         Weights() : current_frame(0),
                     _total(0.0),
-                    _has_list(false)
+                    _has_list(false),
+                    _num_weights(0),
+                    _totalTraj(0.0)
                     {
 
         };
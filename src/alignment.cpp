@@ -5,6 +5,7 @@
 
 #include <ensembles.hpp>
 #include <alignment.hpp>
+#include <EnsembleAligner.hpp>
 
 #include <cmath>
 
@@ -286,66 +287,23 @@ namespace loos {
 
 
   boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(alignment::vecMatrix& ensemble,
-                                                                greal threshold, int maxiter) {
-    using namespace alignment;
-
-    int n = ensemble.size();
-    std::vector<XForm> xforms(n);
-
-    // Start by aligning against the first structure in the ensemble
-
-    vecDouble target(ensemble[0]);
-    centerAtOrigin(target);
-
-    double rms;
-    int iter = 0;
-
-    do {
-      for (int i = 0; i<n; i++) {
-        XForm M(kabsch(ensemble[i], target));
-        applyTransform(M.current(), ensemble[i]);
-        xforms[i].premult(M.current());
-      }
-
-      vecDouble avg = averageCoords(ensemble);
-      rms = rmsd(target, avg);
-      target = avg;
-      ++iter;
-    } while (rms > threshold && iter <= maxiter );
+                                                                greal threshold, int maxiter, uint nthreads) {
+    EnsembleAligner aligner(ensemble);
+    aligner.threads(nthreads);
+    EnsembleAligner::Result res = aligner.align(threshold, maxiter);
+    aligner.copyCoordinatesTo(ensemble);
 
-    boost::tuple<std::vector<XForm>, greal, int> res(xforms, rms, iter);
     return(res);
   }
 
 
   boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(std::vector<AtomicGroup>& ensemble,
-                                                                greal threshold, int maxiter) {
-    using namespace alignment;
-
-    int n = ensemble.size();
-    std::vector<XForm> xforms(n);
+                                                                greal threshold, int maxiter, uint nthreads) {
+    EnsembleAligner aligner(ensemble);
+    aligner.threads(nthreads);
+    EnsembleAligner::Result res = aligner.align(threshold, maxiter);
+    aligner.copyCoordinatesTo(ensemble);
 
-    // Start by aligning against the first structure in the ensemble
-    vecDouble target(ensemble[0].coordsAsVector());
-    centerAtOrigin(target);
-
-    double rms;
-    int iter = 0;
-    do {
-      for (int i = 0; i<n; i++) {
-        XForm M(kabsch(ensemble[i].coordsAsVector(), target));
-        ensemble[i].applyTransform(M);
-        xforms[i].premult(M.current());
-      }
-
-      AtomicGroup avg_structure = averageStructure(ensemble);
-      vecDouble avg = avg_structure.coordsAsVector();
-      rms = rmsd(target, avg);
-      target = avg;
-      ++iter;
-    } while (rms > threshold && iter <= maxiter );
-
-    boost::tuple<std::vector<XForm>, greal, int> res(xforms, rms, iter);
     return(res);
   }
 
@@ -57,13 +57,20 @@ namespace loos {
         }
 
 #if !defined(SWIG)
+        //! Iterative superposition of an in-memory ensemble (see EnsembleAligner)
+        /**
+         * The ensemble is aligned in place.  \p nthreads is the
+         * number of threads to use (0 = all available).
+         */
         boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(alignment::vecMatrix& ensemble,
                                                                       greal threshold=1e-6,
-                                                                      int maxiter=1000);
+                                                                      int maxiter=1000,
+                                                                      uint nthreads=1);
         
         boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(std::vector<AtomicGroup>& ensemble,
                                                                       greal threshold=1e-6,
-                                                                      int maxiter=1000);
+                                                                      int maxiter=1000,
+                                                                      uint nthreads=1);
 
         //! Compute an iterative superposition by reading in frames from the Trajectory.
         /**
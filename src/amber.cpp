@@ -24,6 +24,7 @@
 #include <exceptions.hpp>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 
 #include <iomanip>
 
@@ -205,11 +206,10 @@ namespace loos {
     mbona = pointers[3];
     nres = pointers[11];
 
+    atoms = allocateAtoms(natoms);
     for (uint i=0; i<natoms; i++) {
-      pAtom pa(new Atom);
-      pa->id(i+1);
-      pa->index(i);
-      atoms.push_back(pa);
+      atoms[i]->id(i+1);
+      atoms[i]->index(i);
     }
 
   }
@@ -276,41 +276,76 @@ namespace loos {
 
 
 
+  bool Amber::AmberLineReader::getNext() {
+    if (_pushed) {
+      _pushed = false;
+      return(true);
+    }
+
+    while (_p < _end) {
+      const char* b = _p;
+      const char* e = TextScan::lineEnd(_p, _end);
+      _p = (e < _end) ? e + 1 : _end;
+      ++_lineno;
+
+      if (e - b >= 8 && strncmp(b, "%COMMENT", 8) == 0)
+        continue;
+      while (b < e && (*b == ' ' || *b == '\t'))
+        ++b;
+      if (b == e)
+        continue;
+
+      _lb = b;
+      _le = e;
+      return(true);
+    }
+
+    return(false);
+  }
+
+
+
   void Amber::read(std::istream& ifs) {
-    reader.stream(ifs);
-    
+    MappedTextFile text(ifs);
+    parse(text.begin(), text.end());
+  }
+
+
+  void Amber::parse(const char* begin, const char* end) {
+    reader.text(begin, end);
+
     while (reader.getNext()) {
+      const char* p = reader.begin();
+      const char *tb, *te;
 
-      boost::char_separator<char> sep(" \t");
-      std::string input_line(reader.line());      // See parseFormat() for explanation...required by Ubuntu 16
-      tokenizer tokens(input_line, sep);
-      tokenizer::iterator toks = tokens.begin();
-      
-      if (*toks != "%FLAG")
+      // Only %FLAG lines matter here, so skip everything else quickly
+      if (!TextScan::token(p, reader.end(), tb, te) || te - tb != 5 || strncmp(tb, "%FLAG", 5) != 0)
+        continue;
+      if (!TextScan::token(p, reader.end(), tb, te))
         continue;
 
-      ++toks;
-      if (*toks == "TITLE")
+      std::string flag(tb, te);
+      if (flag == "TITLE")
         parseTitle();
-      else if (*toks == "POINTERS")
+      else if (flag == "POINTERS")
         parsePointers();
-      else if (*toks == "ATOM_NAME")
+      else if (flag == "ATOM_NAME")
         parseAtomNames();
-      else if (*toks == "CHARGE")
+      else if (flag == "CHARGE")
         parseCharges();
-      else if (*toks == "MASS")
+      else if (flag == "MASS")
         parseMasses();
-      else if (*toks == "RESIDUE_LABEL")
+      else if (flag == "RESIDUE_LABEL")
         parseResidueLabels();
-      else if (*toks == "RESIDUE_POINTER")
+      else if (flag == "RESIDUE_POINTER")
         parseResiduePointers();
-      else if (*toks == "BONDS_INC_HYDROGEN")
+      else if (flag == "BONDS_INC_HYDROGEN")
         parseBonds(nbonh);
-      else if (*toks == "BONDS_WITHOUT_HYDROGEN")
+      else if (flag == "BONDS_WITHOUT_HYDROGEN")
         parseBonds( mbona);
-      else if (*toks == "AMOEBA_REGULAR_BOND_NUM_LIST")
+      else if (flag == "AMOEBA_REGULAR_BOND_NUM_LIST")
         parseAmoebaRegularBondNumList();
-      else if (*toks == "AMOEBA_REGULAR_BOND_LIST")
+      else if (flag == "AMOEBA_REGULAR_BOND_LIST")
         parseAmoebaRegularBondList(_amoeba_regular_bond_num_list);
       
     }
@@ -37,7 +37,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
-#include <LineReader.hpp>
+#include <MappedTextFile.hpp>
 
 
 namespace loos {
@@ -71,15 +71,40 @@ namespace loos {
       int precision;
     };
 
-    struct AmberLineReader : public LineReader {
-      AmberLineReader() : LineReader() { }
-      AmberLineReader(std::istream& is) : LineReader(is) { }
-      AmberLineReader(std::istream& is, std::string& s) : LineReader(is, s) { }
-
-      virtual void stripComment(std::string& s) const {
-        if (s.compare(0, 8, "%COMMENT") == 0)
-          s = "";
+    // Walks the lines of a parmtop in memory.  Leading whitespace is
+    // stripped, and empty lines and %COMMENT lines are skipped.
+    class AmberLineReader {
+    public:
+      AmberLineReader() : _p(0), _end(0), _lb(0), _le(0), _lineno(0), _pushed(false) { }
+
+      void text(const char* begin, const char* end) {
+        _p = begin;
+        _end = end;
+        _lb = _le = 0;
+        _lineno = 0;
+        _pushed = false;
       }
+
+      bool getNext();
+
+      //! Put the current line back, so the next getNext() returns it again
+      void push_back() { _pushed = true; }
+
+      const char* begin() const { return(_lb); }
+      const char* end() const { return(_le); }
+      std::string line() const { return(_lb ? std::string(_lb, _le) : std::string()); }
+
+      uint lineNumber() const { return(_lineno); }
+
+      std::string name() const { return(_name); }
+      void name(const std::string& s) { _name = s; }
+
+    private:
+      const char *_p, *_end;
+      const char *_lb, *_le;
+      uint _lineno;
+      bool _pushed;
+      std::string _name;
     };
 
   public:
@@ -90,16 +115,13 @@ namespace loos {
     //! Read in a parmtop file
     explicit Amber(const std::string& fname)
       : natoms(0), nres(0), nbonh(0), mbona(0) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-	throw(FileOpenError(fname));
-      reader.stream(ifs);
+      MappedTextFile text(fname);
       reader.name(fname);
-      read(ifs);
+      parse(text.begin(), text.end());
     }
 
     explicit Amber(std::istream& ifs)
-      : natoms(0), nres(0), nbonh(0), mbona(0), reader(ifs) {
+      : natoms(0), nres(0), nbonh(0), mbona(0) {
       read(ifs);
     }
 
@@ -131,6 +153,8 @@ namespace loos {
 
     Amber(const AtomicGroup& grp) : AtomicGroup(grp), natoms(0), nres(0), nbonh(0), mbona(0) { }
 
+    void parse(const char* begin, const char* end);
+
     FormatSpec parseFormat(const std::string& expected_types, const std::string& where);
 
     void parseCharges();
@@ -147,26 +171,49 @@ namespace loos {
 
 
     // Reads in a "block" of data.  Reading terminates on the first
-    // line that begins with a '%'.
+    // line that begins with a '%'.  Numbers are separated by
+    // whitespace, and strings are at most field_width characters.
 
     template<typename T>
     std::vector<T> readBlock(const int field_width) {
       std::vector<T> data;
       while (reader.getNext()) {
-        std::string line = reader.line();
-        if (line[0] == '%') {
-          reader.push_back(line);
+        if (*(reader.begin()) == '%') {
+          reader.push_back();
           break;
         }
-        std::istringstream iss(line);
+        const char* p = reader.begin();
         T d;
-        while (iss >> std::setw(field_width) >> d)
+        while (nextField(p, reader.end(), field_width, d))
           data.push_back(d);
       }
 
       return(data);
     }
 
+    static bool nextField(const char*& p, const char* end, const int, double& d) {
+      const char *tb, *te;
+      return(TextScan::token(p, end, tb, te) && TextScan::parseDouble(tb, te, d));
+    }
+
+    template<typename T>
+    static bool nextField(const char*& p, const char* end, const int, T& d) {
+      const char *tb, *te;
+      long l;
+      if (!(TextScan::token(p, end, tb, te) && TextScan::parseInt(tb, te, l)))
+        return(false);
+      d = l;
+      return(true);
+    }
+
+    static bool nextField(const char*& p, const char* end, const int width, std::string& d) {
+      const char *tb, *te;
+      if (!TextScan::token(p, end, tb, te, width > 0 ? width : 0))
+        return(false);
+      d.assign(tb, te);
+      return(true);
+    }
+
   private:
 
     std::string _title;
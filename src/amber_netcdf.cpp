@@ -1,5 +1,7 @@
 // (c) 2012 Tod D. Romo, Grossfield Lab, URMC
 
+#include <algorithm>
+
 #include <amber_netcdf.hpp>
 #include <AtomicGroup.hpp>
 
@@ -95,6 +97,9 @@ namespace loos {
 		}
 
 
+		// Size read-ahead blocks to match the file's chunking...
+		readAhead(0);
+
 		// Now cache the first frame...
 		readRawFrame(0);
 		cached_first = true;
@@ -102,27 +107,137 @@ namespace loos {
 	}
 
 
+	const ulong AmberNetcdf::max_read_ahead_bytes = 64 * megabytes;
+
+
+	// Number of frames per chunk of the coordinates variable, or 1 if
+	// the file isn't chunked (e.g. classic NetCDF3 files)
+	uint AmberNetcdf::chunkedFrames() {
+		int storage;
+		size_t chunks[3] = {1, 1, 1};
+
+		int retval = nc_inq_var_chunking(_ncid, _coord_id, &storage, chunks);
+		if (retval || storage != NC_CHUNKED || chunks[0] < 1)
+			return(1);
+
+		ulong frame_bytes = _natoms * 3 * sizeof(GCoord::element_type) * (_velocities ? 2 : 1);
+		ulong limit = max_read_ahead_bytes / frame_bytes;
+		if (limit < 1)
+			limit = 1;
+
+		return(chunks[0] < limit ? chunks[0] : limit);
+	}
+
+
+	void AmberNetcdf::readAhead(const uint k) {
+		_block_size = k ? k : chunkedFrames();
+		_block_frames = 0;
+		_coord_block.clear();
+		_velocity_block.clear();
+		_box_block.clear();
+	}
+
+
+	// Fetches the block of frames containing frameno, aligned to the
+	// read-ahead block size, with a single read per variable
+	void AmberNetcdf::readBlock(const uint frameno) {
+		_block_start = (frameno / _block_size) * _block_size;
+		_block_frames = _block_size;
+		if (_block_start + _block_frames > _nframes)
+			_block_frames = _nframes - _block_start;
+
+		size_t start[3] = {_block_start, 0, 0};
+		size_t count[3] = {_block_frames, _natoms, 3};
+
+		_coord_block.resize(_block_frames * _natoms * 3);
+		int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _coord_id, start, count, &(_coord_block[0]));
+		if (retval) {
+			_block_frames = 0;
+			throw(FileReadError(_filename, "Cannot read Amber netcdf frame (coords)", retval));
+		}
+
+		if (_velocities) {
+			_velocity_block.resize(_block_frames * _natoms * 3);
+			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _velocities_id, start, count, &(_velocity_block[0]));
+			if (retval) {
+				_block_frames = 0;
+				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (velocities)", retval));
+			}
+		}
+
+		if (_periodic) {
+			count[1] = 3;
+			_box_block.resize(_block_frames * 3);
+			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _cell_lengths_id, start, count, &(_box_block[0]));
+			if (retval) {
+				_block_frames = 0;
+				throw(FileReadError(_filename, "Cannot read Amber netcdf periodic box", retval));
+			}
+		}
+	}
+
+
 	// Given a frame number, read the coord data into the internal array
 	// and retrieve the corresponding periodic box (if present)
 	void AmberNetcdf::readRawFrame(const uint frameno)  {
 		size_t start[3] = {0, 0, 0};
 		size_t count[3] = {1, 1, 3};
 
+		// Serve the frame from the read-ahead block when possible.  A
+		// selection hint means only part of each frame is wanted, so
+		// those reads go straight to the file.
+		if (_block_size > 1 && !hasSelectionHint()) {
+			if (frameno < _block_start || frameno >= _block_start + _block_frames)
+				readBlock(frameno);
+
+			size_t n = _natoms * 3;
+			size_t offset = (frameno - _block_start) * n;
+			std::copy(_coord_block.begin() + offset, _coord_block.begin() + offset + n, _coord_data);
+			if (_velocities)
+				std::copy(_velocity_block.begin() + offset, _velocity_block.begin() + offset + n, _velocity_data);
+			if (_periodic)
+				std::copy(_box_block.begin() + (frameno - _block_start) * 3, _box_block.begin() + (frameno - _block_start + 1) * 3, _box_data);
+			return;
+		}
+
 
 		// Read coordinates first...
 		start[0] = frameno;
 		count[1] = _natoms;
 
+		int retval;
+		if (hasSelectionHint()) {
+
+			// Only read the hyperslabs covering the hinted atoms
+			for (IndexRuns::const_iterator run = _hint_runs.begin(); run != _hint_runs.end(); ++run) {
+				if (run->first + run->second > _natoms)
+					throw(FileReadError(_filename, "Selection hint extends past the end of the Amber netcdf frame"));
+				start[1] = run->first;
+				count[1] = run->second;
 
-		int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _coord_id, start, count, _coord_data);
-		if (retval)
-			throw(FileReadError(_filename, "Cannot read Amber netcdf frame (coords)", retval));
+				retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _coord_id, start, count, _coord_data + 3 * run->first);
+				if (retval)
+					throw(FileReadError(_filename, "Cannot read Amber netcdf frame (coords)", retval));
+
+				if (_velocities) {
+					retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _velocities_id, start, count, _velocity_data + 3 * run->first);
+					if (retval)
+						throw(FileReadError(_filename, "Cannot read Amber netcdf frame (velocities)", retval));
+				}
+			}
 
-		if (_velocities)
-		{
-			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _velocities_id, start, count, _velocity_data);
+		} else {
+
+			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _coord_id, start, count, _coord_data);
 			if (retval)
-				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (velocities)", retval));
+				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (coords)", retval));
+
+			if (_velocities)
+			{
+				retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _velocities_id, start, count, _velocity_data);
+				if (retval)
+					throw(FileReadError(_filename, "Cannot read Amber netcdf frame (velocities)", retval));
+			}
 		}
 
 
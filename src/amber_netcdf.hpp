@@ -79,7 +79,10 @@ namespace loos {
 			  _box_data(new GCoord::element_type[3]),
 			  _periodic(false),
 			  _velocities(false),
-			  _timestep(1e-12)
+			  _timestep(1e-12),
+			  _block_size(1),
+			  _block_start(0),
+			  _block_frames(0)
 		{
 			cached_first = false;
 			init(s.c_str(), na);
@@ -91,6 +94,7 @@ namespace loos {
 			nc_close(_ncid);
 
 			delete[] _coord_data;
+			delete[] _velocity_data;
 			delete[] _box_data;
 		}
 
@@ -113,6 +117,25 @@ namespace loos {
 		virtual double velocityConversionFactor() const { return(1.0); }
 
 
+		//! Number of frames fetched per NetCDF read
+		uint readAhead() const { return(_block_size); }
+
+		//! Set the number of frames fetched per NetCDF read
+		/**
+		 * Chunked (NetCDF4) files perform poorly when read one frame
+		 * at a time, so by default the block size follows the file's
+		 * chunking along the frame dimension (limited to
+		 * max_read_ahead_bytes of buffer).  Frames are then served
+		 * from the block until a frame outside it is requested.
+		 * Setting \a k to 0 restores this automatic choice; 1 turns
+		 * read-ahead off.
+		 */
+		void readAhead(const uint k);
+
+		//! Upper bound on the memory used for automatic read-ahead blocks
+		static const ulong max_read_ahead_bytes;
+
+
 		std::vector<GCoord> coords() const {
 			std::vector<GCoord> res;
 			for (uint i=0; i<_natoms; i += 3)
@@ -130,6 +153,8 @@ namespace loos {
 		void readGlobalAttributes();
 		std::string readGlobalAttribute(const std::string& name);
 		void readRawFrame(const uint frameno);
+		void readBlock(const uint frameno);
+		uint chunkedFrames();
 
 		void updateGroupCoordsImpl(AtomicGroup& g);
 		void updateGroupVelocitiesImpl(AtomicGroup& g);
@@ -156,6 +181,11 @@ namespace loos {
 		int _cell_lengths_id;
 		int _velocities_id;
 		std::string _title, _application, _program, _programVersion, _conventions, _conventionVersion;
+
+		// Read-ahead buffers, holding _block_frames frames starting at _block_start
+		uint _block_size;
+		uint _block_start, _block_frames;
+		std::vector<GCoord::element_type> _coord_block, _velocity_block, _box_block;
 	};
 
 
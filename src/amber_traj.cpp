@@ -23,111 +23,154 @@
 
 #include <amber_traj.hpp>
 #include <AtomicGroup.hpp>
-#include <iomanip>
-#include <sstream>
 
-namespace loos {
-
-  // Scan the trajectory file to determine frame sizes and box
-  void AmberTraj::init(void) {
-    char buf[1024];
 
-    ifs->getline(buf, 1024);
-    frame_offset = ifs->tellg();
-    greal x, y, z;
+namespace loos {
 
-    for (uint i=0; i<_natoms; i++) {
-      *(ifs) >> std::setw(8) >> x >> std::setw(8) >> y >> std::setw(8) >> z;
-      frame.push_back(GCoord(x,y,z));
+  namespace {
+
+    // Parses up to max numbers from the line [p, eol), returning how
+    // many were found (or -1 if the line is not all numbers).  Amber
+    // writes 8 column fields that may run together (e.g. "-100.000-200.000"),
+    // so those are tried first, then blank-separated fields.
+    int parseLine(const char* p, const char* eol, double* vals, const uint max) {
+      while (eol > p && TextScan::isBlank(*(eol-1)))
+        --eol;
+
+      uint n = 0;
+      bool fixed = true;
+      for (const char* f = p; f < eol && n < max; f += 8, ++n) {
+        const char* fe = (eol - f > 8) ? f + 8 : eol;
+        if (!TextScan::parseField(f, fe, vals[n])) {
+          fixed = false;
+          break;
+        }
+      }
+      if (fixed)
+        return(n);
+
+      n = 0;
+      const char *tb, *te;
+      while (n < max && TextScan::token(p, eol, tb, te)) {
+        if (!TextScan::parseDouble(tb, te, vals[n]))
+          return(-1);
+        ++n;
+      }
+      return(n);
     }
 
+  }
 
-    // This is probably not a good way of doing this???
-    ifs->getline(buf, 1024);
-    unsigned long fpos = ifs->tellg();
 
-    ifs->getline(buf, 1024);
-    if (ifs->fail())
+  // Scan the trajectory file to determine frame sizes and box
+  void AmberTraj::init(boost::shared_ptr<MappedTextFile> text) {
+    _text = text;
+    frame.resize(_natoms);
+
+    // Skip the title...
+    const char* b = _text->begin();
+    const char* e = _text->end();
+    const char* p = TextScan::lineEnd(b, e);
+    if (p < e)
+      ++p;
+    frame_offset = p - b;
+
+    const char* q = parseCoords(p);
+    if (!q)
       throw(FileOpenError(_filename, "Problem scanning Amber Trajectory"));
 
-    std::stringstream ss(buf);
-    double a= -1, b= -1, c= -1;
-    ss >> std::setw(8) >> a >> std::setw(8) >> b >> std::setw(8) >> c;
-    if (ss.eof()) {
-      fpos = ifs->tellg();
+    // A line with exactly three numbers after the coordinates is the box
+    GCoord c;
+    if (parseBox(q, c)) {
       periodic = true;
-      box = GCoord(a, b, c);
+      box = c;
+      q = TextScan::lineEnd(q, e);
+      if (q < e)
+        ++q;
     }
 
-    frame_size = fpos - frame_offset;
+    frame_size = q - p;
+    if (frame_size == 0)
+      throw(FileOpenError(_filename, "Cannot determine frame information for Amber trajectory"));
 
-    // Now try to count the number of frames...
-    _nframes = 1;
-    double dummy;
-    while (!ifs->fail()) {
-      ++_nframes;
-      fpos = _nframes * frame_size + frame_offset;
-      ifs->seekg(fpos);
-      *(ifs) >> dummy;
-    }
+    // All frames are the same size, so just count them (including a
+    // final frame that is missing its trailing newline)
+    _nframes = (e - p) / frame_size;
+    for (const char* r = p + _nframes * frame_size; r < e; ++r)
+      if (!(TextScan::isBlank(*r) || *r == '\n')) {
+        ++_nframes;
+        break;
+      }
 
+    cached_first = true;
+  }
 
-    ifs->clear();
-    ifs->seekg(frame_offset + frame_size);
 
-    // Punt our failure check to the end...for now...
-    if (ifs->fail())
-      throw(FileOpenError(_filename, "Cannot determine frame information for Amber trajectory"));
+  // Returns a pointer to the line following the coordinates, or null
+  // if the file ends first
+  const char* AmberTraj::parseCoords(const char* p) {
+    const char* e = _text->end();
+    ulong need = 3ul * _natoms;
+    _values.resize(need);
+
+    ulong have = 0;
+    while (have < need) {
+      if (p >= e)
+        return(0);
+      const char* eol = TextScan::lineEnd(p, e);
+      int n = parseLine(p, eol, &(_values[have]), need - have);
+      if (n < 0) {
+        if (eol == e)    // Truncated final line
+          return(0);
+        throw(FileReadError(_filename, "Problem reading from Amber trajectory"));
+      }
+      have += n;
+      p = (eol < e) ? eol + 1 : e;
+    }
 
-    cached_first = true;
+    for (uint i=0; i<_natoms; ++i)
+      frame[i] = GCoord(_values[3*i], _values[3*i+1], _values[3*i+2]);
+
+    return(p);
   }
 
 
-  bool AmberTraj::parseFrame(void) {
-    greal x, y, z;
+  bool AmberTraj::parseBox(const char* p, GCoord& c) const {
+    const char* e = _text->end();
+    if (p >= e)
+      return(false);
 
-    if (ifs->eof())
+    double vals[4];
+    if (parseLine(p, TextScan::lineEnd(p, e), vals, 4) != 3)
       return(false);
 
-    // It seems that it's possible that, at the end of the trajectory,
-    // we may have read the last datum from the last frame but will not
-    // be physically at the EOF.  So, we also check inside the coord
-    // read loop to see if there is an EOF.  Rather than flag this as an
-    // error condition, just return a false indicating we've read past
-    // the end...
+    c = GCoord(vals[0], vals[1], vals[2]);
+    return(true);
+  }
 
-    for (uint i=0; i<_natoms && !(ifs->eof()); i++) {
-      *(ifs) >> std::setw(8) >> x >> std::setw(8) >> y >> std::setw(8) >> z;
-      frame[i] = GCoord(x, y, z);
-    }
 
-    if (ifs->eof())
+  bool AmberTraj::parseFrame(void) {
+    if (atEnd())
       return(false);
 
-    if (periodic) {
-      greal a, b, c;
-      *(ifs) >> std::setw(8) >> a >> std::setw(8) >> b >> std::setw(8) >> c;
-      box = GCoord(a, b, c);
-    }
+    // A truncated final frame is treated as the end of the trajectory
+    const char* p = _text->begin() + frame_offset + static_cast<ulong>(_current_frame) * frame_size;
+    p = parseCoords(p);
+    if (!p || (periodic && p >= _text->end()))
+      return(false);
 
-    if (ifs->fail())
+    if (periodic && !parseBox(p, box))
       throw(FileReadError(_filename, "Problem reading from Amber trajectory"));
 
     return(true);
   }
 
 
+  // Frames are parsed directly from the mapped file (using the base
+  // class' frame counter), so there's nothing to do but check the range
   void AmberTraj::seekFrameImpl(const uint i) {
-
-    cached_first = false;
-    unsigned long fpos = i * frame_size + frame_offset;
     if (i >= _nframes)
       throw(FileError(_filename, "Attempting seek frame beyond end of trajectory"));
-
-
-    ifs->seekg(fpos);
-    if (ifs->fail())
-      throw(FileError(_filename, "Cannot seek to frame"));
   }
 
 
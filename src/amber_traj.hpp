@@ -25,9 +25,12 @@
 
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 #include <loos_defs.hpp>
 #include <Coord.hpp>
 #include <Trajectory.hpp>
+#include <MappedTextFile.hpp>
 
 
 namespace loos {
@@ -41,6 +44,13 @@ namespace loos {
    * Since the Amber trajectory format does not store the # of atoms
    * present, this must be passed to the AmberTraj constructor.
    *
+   * The whole file is mapped into memory and the coordinates are
+   * parsed directly from it as fixed-width (8 column) fields, falling
+   * back to whitespace-separated fields for lines that are not laid
+   * out that way.  Every frame is assumed to be the same size as the
+   * first, so the start of any frame is computed directly and seeking
+   * is free.
+   *
    * Note that the Amber timestep is (presumably) defined in the parmtop
    * file, not in the trajectory file.  So we return a null-value here...
    */
@@ -48,12 +58,14 @@ namespace loos {
   class AmberTraj : public Trajectory {
   public:
     explicit AmberTraj(const std::string& s, const int na) : Trajectory(s),
-                                                             _natoms(na), frame_offset(0),
-                                                             frame_size(0), periodic(false) { init(); }
+                                                             _natoms(na), _nframes(0), frame_offset(0),
+                                                             frame_size(0), periodic(false)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(s))); }
 
-    explicit AmberTraj(std::istream& is, const int na) : Trajectory(is), _natoms(na),
+    explicit AmberTraj(std::istream& is, const int na) : Trajectory(is), _natoms(na), _nframes(0),
                                                      frame_offset(0), frame_size(0),
-                                                     periodic(false) { init(); }
+                                                     periodic(false)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(is))); }
 
     std::string description() const { return("Amber trajectory"); }
     static pTraj create(const std::string& fname, const AtomicGroup& model) {
@@ -81,8 +93,11 @@ namespace loos {
 
 
   private:
-    void init(void);
-    virtual void rewindImpl(void) { ifs->clear(); ifs->seekg(frame_offset); }
+    void init(boost::shared_ptr<MappedTextFile> text);
+    const char* parseCoords(const char* p);
+    bool parseBox(const char* p, GCoord& c) const;
+
+    virtual void rewindImpl(void) { }
     virtual void seekNextFrameImpl(void) { }
     virtual void seekFrameImpl(const uint);
     virtual void updateGroupCoordsImpl(AtomicGroup&);
@@ -95,6 +110,8 @@ namespace loos {
     GCoord box;
     std::vector<GCoord> frame;
 
+    boost::shared_ptr<MappedTextFile> _text;
+    std::vector<double> _values;
   };
 
 
@@ -0,0 +1,224 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <asynctrajwriter.hpp>
+
+#include <cstdlib>
+#include <set>
+
+
+namespace loos {
+
+  namespace {
+
+    // Live writers, so that queued frames are still written when a
+    // tool never destroys its writer (e.g. one held by a leaked
+    // options package)
+    typedef std::set<AsyncTrajectoryWriter*>   WriterSet;
+
+    WriterSet& liveWriters() {
+      static WriterSet writers;
+      return(writers);
+    }
+
+    boost::mutex& registryMutex() {
+      static boost::mutex mtx;
+      return(mtx);
+    }
+
+    void flushAtExit() {
+      AsyncTrajectoryWriter::flushAll();
+    }
+
+  }
+
+
+  AsyncTrajectoryWriter::AsyncTrajectoryWriter(pTrajectoryWriter writer, const uint nbuffers)
+    : TrajectoryWriter(static_cast<std::iostream*>(0), writer->isAppending()),
+      _writer(writer),
+      _frames(nbuffers < 1 ? 1 : nbuffers),
+      _head(0), _count(0),
+      _initial_frames(writer->framesWritten()), _submitted(0),
+      _done(false)
+  {
+    {
+      boost::mutex::scoped_lock lock(registryMutex());
+      // The registry must exist before the handler is registered so
+      // that it is still around when the handler runs
+      WriterSet& writers = liveWriters();
+      static bool registered = false;
+      if (!registered) {
+        std::atexit(flushAtExit);
+        registered = true;
+      }
+      writers.insert(this);
+    }
+
+    _thread = boost::thread(&AsyncTrajectoryWriter::run, this);
+  }
+
+
+  AsyncTrajectoryWriter::~AsyncTrajectoryWriter() {
+    {
+      boost::mutex::scoped_lock lock(registryMutex());
+      liveWriters().erase(this);
+    }
+
+    {
+      boost::mutex::scoped_lock lock(_mtx);
+      _done = true;
+    }
+    _not_empty.notify_all();
+    _thread.join();
+
+    if (!_error.empty())
+      std::cerr << "Error- " << _error << std::endl;
+  }
+
+
+  void AsyncTrajectoryWriter::flushAll() {
+    boost::mutex::scoped_lock lock(registryMutex());
+    for (WriterSet::iterator i = liveWriters().begin(); i != liveWriters().end(); ++i) {
+      try {
+        (*i)->flush();
+      }
+      catch (std::exception& e) {
+        std::cerr << "Error- " << e.what() << std::endl;
+      }
+    }
+  }
+
+
+  // Background thread: frames are written in the order they were
+  // queued, and a buffer is only released once its frame is written
+  void AsyncTrajectoryWriter::run() {
+    while (true) {
+      uint slot;
+      {
+        boost::mutex::scoped_lock lock(_mtx);
+        while (_count == 0 && !_done)
+          _not_empty.wait(lock);
+        if (_count == 0)
+          return;
+        slot = _head;
+      }
+
+      Frame& frame = _frames[slot];
+      std::string error;
+      try {
+        if (frame.timed)
+          _writer->writeFrame(frame.group, frame.step, frame.time);
+        else
+          _writer->writeFrame(frame.group);
+      }
+      catch (std::exception& e) {
+        error = e.what();
+      }
+
+      {
+        boost::mutex::scoped_lock lock(_mtx);
+        if (!error.empty() && _error.empty())
+          _error = error;
+        _head = (_head + 1) % _frames.size();
+        --_count;
+      }
+      _not_full.notify_all();
+    }
+  }
+
+
+  void AsyncTrajectoryWriter::rethrow() {
+    if (!_error.empty()) {
+      std::string msg = _error;
+      _error.clear();
+      throw(LOOSError(msg));
+    }
+  }
+
+
+  void AsyncTrajectoryWriter::enqueue(const AtomicGroup& model, const uint step, const double time, const bool timed) {
+    uint slot;
+    {
+      boost::mutex::scoped_lock lock(_mtx);
+      rethrow();
+      while (_count == _frames.size())
+        _not_full.wait(lock);
+      rethrow();
+      slot = (_head + _count) % _frames.size();
+    }
+
+    // The background thread never touches a buffer that isn't queued
+    Frame& frame = _frames[slot];
+    if (frame.group.size() != model.size())
+      frame.group = model.copy();
+    else {
+      for (uint i=0; i<model.size(); ++i)
+        frame.group[i]->coords(model[i]->coords());
+      if (model.isPeriodic())
+        frame.group.periodicBox(model.periodicBox());
+      else
+        frame.group.removePeriodicBox();
+    }
+    frame.step = step;
+    frame.time = time;
+    frame.timed = timed;
+
+    {
+      boost::mutex::scoped_lock lock(_mtx);
+      ++_count;
+      ++_submitted;
+    }
+    _not_empty.notify_one();
+  }
+
+
+  void AsyncTrajectoryWriter::writeFrame(const AtomicGroup& model) {
+    enqueue(model, 0, 0.0, false);
+  }
+
+
+  void AsyncTrajectoryWriter::writeFrame(const AtomicGroup& model, const uint step, const double time) {
+    enqueue(model, step, time, true);
+  }
+
+
+  void AsyncTrajectoryWriter::flush() {
+    boost::mutex::scoped_lock lock(_mtx);
+    while (_count != 0)
+      _not_full.wait(lock);
+    rethrow();
+  }
+
+
+  void AsyncTrajectoryWriter::setComments(const std::vector<std::string>& comments) {
+    flush();
+    _writer->setComments(comments);
+  }
+
+
+  uint AsyncTrajectoryWriter::framesWritten() const {
+    boost::mutex::scoped_lock lock(_mtx);
+    return(_initial_frames + _submitted);
+  }
+
+
+}
@@ -0,0 +1,121 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_ASYNCTRAJWRITER_HPP)
+#define LOOS_ASYNCTRAJWRITER_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <loos_defs.hpp>
+#include <trajwriter.hpp>
+
+
+namespace loos {
+
+
+  //! Writes frames through another TrajectoryWriter on a background thread
+  /**
+   * writeFrame() copies the coordinates (and periodic box) of the
+   * group into one of a fixed number of buffered frames and returns
+   * right away.  A background thread then hands the buffered frames,
+   * in order, to the wrapped writer, which does the encoding and I/O.
+   * When every buffer is waiting to be written, writeFrame() blocks
+   * until one is free, so a slow disk limits how far ahead the caller
+   * can get.
+   *
+   * Each buffer holds a deep copy of the group, made the first time
+   * it is used (or when the group size changes).  After that, only
+   * the coordinates and box are copied for each frame.  This is all
+   * the DCD and XTC writers use.
+   *
+   * An error in the background thread is rethrown by the next call to
+   * writeFrame() or flush().  Any frames still queued are written
+   * when the writer is destroyed, or at program exit if it never is.
+   *
+   *\code
+   * pTrajectoryWriter out(new AsyncTrajectoryWriter(createOutputTrajectory("out.dcd")));
+   *\endcode
+   */
+  class AsyncTrajectoryWriter : public TrajectoryWriter {
+  public:
+    explicit AsyncTrajectoryWriter(pTrajectoryWriter writer, const uint nbuffers = 8);
+    ~AsyncTrajectoryWriter();
+
+    static pTrajectoryWriter create(pTrajectoryWriter writer, const uint nbuffers = 8) {
+      return(pTrajectoryWriter(new AsyncTrajectoryWriter(writer, nbuffers)));
+    }
+
+    //! Waits for queued frames, then sets the comments on the wrapped writer
+    void setComments(const std::vector<std::string>& comments);
+
+    void writeFrame(const AtomicGroup& model);
+    void writeFrame(const AtomicGroup& model, const uint step, const double time);
+
+    bool hasFrameStep() const { return(_writer->hasFrameStep()); }
+    bool hasFrameTime() const { return(_writer->hasFrameTime()); }
+    bool hasComments() const { return(_writer->hasComments()); }
+
+    //! Total frames, including those still queued
+    uint framesWritten() const;
+
+    //! Waits until every queued frame has been written
+    void flush();
+
+    //! Flushes every AsyncTrajectoryWriter that still exists
+    static void flushAll();
+
+  private:
+    struct Frame {
+      Frame() : step(0), time(0.0), timed(false) { }
+
+      AtomicGroup group;
+      uint step;
+      double time;
+      bool timed;
+    };
+
+    void enqueue(const AtomicGroup& model, const uint step, const double time, const bool timed);
+    void run();
+    void rethrow();
+
+    pTrajectoryWriter _writer;
+    std::vector<Frame> _frames;
+    uint _head, _count;
+    uint _initial_frames, _submitted;
+    bool _done;
+    std::string _error;
+
+    mutable boost::mutex _mtx;
+    boost::condition_variable _not_full, _not_empty;
+    boost::thread _thread;
+  };
+
+
+}
+
+
+#endif
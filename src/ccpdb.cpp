@@ -21,77 +21,103 @@
 
 
 #include <ccpdb.hpp>
+#include <TextFrameIndex.hpp>
+
+#include <sstream>
+
 
 namespace loos {
 
   // Do some initial parsing to setup the Trajectory object...
 
-  void CCPDB::init(void) {
-    char buf[512];
+  void CCPDB::init(boost::shared_ptr<MappedTextFile> text, const bool cacheable) {
+    _text = text;
+
+    TextFrameIndex index(_filename, "ccpdb");
+    if (!(cacheable && index.load(indices))) {
+      scanFrames();
+      if (cacheable)
+        index.save(indices);
+    }
+    _nframes = indices.size() - 1;
 
     // Read the first frame to get the # of atoms...
-    frame.read(*(ifs));
-    _natoms = frame.size();
+    parseFrame();
+    _natoms = crds.size();
     cached_first = true;
-    indices.push_back(0l);
-    indices.push_back(ifs->tellg());
+  }
 
-    // Now count the # of END statements...
-    while (ifs->getline(buf, sizeof(buf)))
-      if (strncmp("END", buf, 3) == 0)
-        indices.push_back(ifs->tellg());
 
-    _nframes = indices.size() - 1;
-    ifs->clear();
-    ifs->seekg(indices[1]);
+  // Frame i is the text between indices[i] and indices[i+1], i.e. each
+  // frame ends with an END (or ENDMDL) record.  A file with no END
+  // records at all is a single frame.
+  void CCPDB::scanFrames(void) {
+    const char* b = _text->begin();
+    const char* e = _text->end();
+
+    indices.clear();
+    indices.push_back(0);
+    for (const char* p = b; p < e; ) {
+      const char* eol = TextScan::lineEnd(p, e);
+      bool end_record = (eol - p >= 3 && strncmp(p, "END", 3) == 0);
+      p = (eol < e) ? eol + 1 : e;
+      if (end_record)
+        indices.push_back(p - b);
+    }
+
+    if (indices.size() == 1)
+      indices.push_back(e - b);
   }
 
 
   void CCPDB::seekFrameImpl(const uint i) {
     if (i >= _nframes)
       throw(FileError(_filename, "Attempting to seek to frame beyond the end of the trajectory"));
-
-    ifs->clear();
-    ifs->seekg(indices[i]);
-    if (ifs->fail())
-      throw(FileError(_filename, "Cannot seek to requested trajectory"));
   }
 
 
   bool CCPDB::parseFrame(void) {
-    if (ifs->eof())
-      return(false);
-
-    // We cheat here...  Maybe it would be better to have a PDB::clear()
-    // or AtomicGroup::clear() member function???
-    // Note:  For some reason, PDB newframe(*(ifs)) doesn't parse correctly...
-    PDB newframe;
-    newframe.read(*(ifs));
-    frame = newframe;
-    if (frame.size() == 0)
+    if (atEnd())
       return(false);
 
-    return(true);
-  }
+    const char* b = _text->begin();
+    try {
+      PDB::scanCoordinates(b + indices[_current_frame], b + indices[_current_frame+1], crds, box, periodic);
+    }
+    catch(LOOSError& e) {
+      throw(FileReadError(_filename, e.what()));
+    }
 
+    parsed_index = _current_frame;
+    frame_parsed = false;
 
-  std::vector<GCoord> CCPDB::coords(void) const {
-    std::vector<GCoord> result(_natoms);
+    return(!crds.empty());
+  }
 
-    for (uint i=0; i<_natoms; i++)
-      result[i] = frame[i]->coords();
 
-    return(result);
+  PDB CCPDB::currentFrame(void) const {
+    if (!frame_parsed) {
+      std::istringstream iss(std::string(_text->begin() + indices[parsed_index],
+                                         _text->begin() + indices[parsed_index+1]));
+      PDB newframe;
+      newframe.read(iss);
+      frame = newframe;
+      frame_parsed = true;
+    }
+    return(frame);
   }
 
+
   void CCPDB::updateGroupCoordsImpl(AtomicGroup& g) {
 
     for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
-      int idx = (*i)->index();
-      (*i)->coords(frame[idx]->coords());
+      uint idx = (*i)->index();
+      if (idx >= crds.size())
+        throw(LOOSError(**i, "Atom index into trajectory is out of bounds"));
+      (*i)->coords(crds[idx]);
     }
 
-    g.periodicBox(frame.periodicBox());
+    g.periodicBox(box);
   }
 
 
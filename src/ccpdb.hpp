@@ -27,8 +27,11 @@
 #include <string>
 #include <stdexcept>
 
+#include <boost/shared_ptr.hpp>
+
 #include <loos_defs.hpp>
 #include <Trajectory.hpp>
+#include <MappedTextFile.hpp>
 
 #include <pdb.hpp>
 
@@ -38,10 +41,15 @@ namespace loos {
   //! Class for interpreting concatenated PDB files as a Trajectory.
   /** This class reads a concatenated PDB Trajectory file as a LOOS Trajectory.
    * Each frame of the trajectory must be separated by an "END" record.
-   * Since each frame is a fully-parsed PDB object, there is quite a
-   * bit of overhead involved in reading CCPDB trajectories.  In
-   * addition, upon instantiation, the trajectory will be scanned for
-   * "END" records to build a list of seek indices for each frame.
+   * Upon instantiation, the trajectory will be scanned for "END"
+   * records to build a list of seek indices for each frame.  For
+   * large files, these are cached on disk (see TextFrameIndex) so the
+   * scan only happens once.
+   *
+   * The file is mapped into memory and only the coordinates and
+   * periodic box are parsed for each frame (see
+   * PDB::scanCoordinates()).  The full PDB for a frame is only built
+   * if currentFrame() is called.
    *
    * It is possible to get the contained PDB object out of the CCPDB,
    * but be careful of semantics that are slightly inconsistent with the
@@ -50,9 +58,17 @@ namespace loos {
 
   class CCPDB : public Trajectory {
   public:
-    explicit CCPDB(const std::string& s) : Trajectory(s), _natoms(0), _nframes(0) { init(); }
-    explicit CCPDB(const char *p) : Trajectory(p), _natoms(0), _nframes(0) { init(); }
-    explicit CCPDB(std::istream& is) : Trajectory(is), _natoms(0), _nframes(0) { init(); }
+    explicit CCPDB(const std::string& s) : Trajectory(s), _natoms(0), _nframes(0),
+                                           periodic(false), frame_parsed(false), parsed_index(0)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(s)), true); }
+
+    explicit CCPDB(const char *p) : Trajectory(p), _natoms(0), _nframes(0),
+                                    periodic(false), frame_parsed(false), parsed_index(0)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(p)), true); }
+
+    explicit CCPDB(std::istream& is) : Trajectory(is), _natoms(0), _nframes(0),
+                                       periodic(false), frame_parsed(false), parsed_index(0)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(is)), false); }
 
     static pTraj create(const std::string& fname, const AtomicGroup& model) {
       return(pTraj(new CCPDB(fname)));
@@ -62,11 +78,11 @@ namespace loos {
 
     virtual uint nframes(void) const { return(_nframes); }
     virtual uint natoms(void) const { return(_natoms); }
-	virtual std::vector<GCoord> coords(void) const;
+	virtual std::vector<GCoord> coords(void) const { return(crds); }
 
 
-    virtual bool hasPeriodicBox(void) const { return(frame.isPeriodic()); }
-    virtual GCoord periodicBox(void) const { return(frame.periodicBox()); }
+    virtual bool hasPeriodicBox(void) const { return(periodic); }
+    virtual GCoord periodicBox(void) const { return(box); }
 
     //! The timestep is currently meaningless for CCPDB's, so we return
     //! a nominal 1e-3.
@@ -82,24 +98,37 @@ namespace loos {
      *  actually a copy (equivalent to a deep copy) of the previously
      *  read frame.
      *
+     *  The internal PDB is parsed from the frame's text the first time
+     *  it is asked for, so this is considerably more expensive than
+     *  reading the frame itself.
+     *
      *  In general, since currentFrame() is not part of the Trajectory
      *  interface, you should not use it unless you need it...
      */
-    PDB currentFrame(void) const { return(frame); }
+    PDB currentFrame(void) const;
 
     virtual bool parseFrame(void);
 
   private:
-    void init(void);
-    virtual void rewindImpl(void) { ifs->clear(); ifs->seekg(0); }
+    void init(boost::shared_ptr<MappedTextFile> text, const bool cacheable);
+    void scanFrames(void);
+    virtual void rewindImpl(void) { }
     virtual void seekNextFrameImpl(void) { }
     virtual void seekFrameImpl(const uint);
     virtual void updateGroupCoordsImpl(AtomicGroup& g);
 
   private:
     uint _natoms, _nframes;
-    PDB frame;
-    std::vector<long> indices;
+    bool periodic;
+    GCoord box;
+    std::vector<GCoord> crds;
+    std::vector<ulong> indices;
+    boost::shared_ptr<MappedTextFile> _text;
+
+    // The full frame is only built on request
+    mutable PDB frame;
+    mutable bool frame_parsed;
+    uint parsed_index;
   };
 
 
@@ -326,6 +326,40 @@ namespace loos {
   }
 
 
+  // Read only the parts of a line of coordinates covered by the
+  // selection hint, skipping over the rest of the record
+
+  bool DCD::readCoordRuns(std::vector<dcd_real>& v) {
+    unsigned int n = _natoms * sizeof(dcd_real);
+
+    unsigned int len = readRecordLen();
+    if (len == 0)
+      return(false);
+    if (len != n)
+      throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
+
+    std::streampos start = ifs->tellg();
+    for (IndexRuns::const_iterator run = _hint_runs.begin(); run != _hint_runs.end(); ++run) {
+      if (run->first + run->second > _natoms)
+        throw(FileReadError(_filename, "Selection hint extends past the end of the DCD frame"));
+      ifs->seekg(start + static_cast<std::streamoff>(run->first * sizeof(dcd_real)));
+      ifs->read(reinterpret_cast<char*>(&(v[run->first])), run->second * sizeof(dcd_real));
+      if (ifs->fail())
+        throw(FileReadError(_filename, "Error reading data record from DCD"));
+
+      if (swabbing)
+        for (uint i=run->first; i<run->first + run->second; ++i)
+          v[i] = swab(v[i]);
+    }
+
+    ifs->seekg(start + static_cast<std::streamoff>(len));
+    if (readRecordLen() != len)
+      throw(FileReadError(_filename, "Mismatch in record length while reading from DCD"));
+
+    return(true);
+  }
+
+
   void DCD::seekFrameImpl(const uint i) {
   
     if (first_frame_pos == 0)
@@ -359,6 +393,17 @@ namespace loos {
       if (!readCrystalParams())
 	return(false);
 
+    if (hasSelectionHint()) {
+      if (!readCoordRuns(xcrds))
+        return(false);
+
+      if (!readCoordRuns(ycrds))
+        throw(FileReadError(_filename, "Unexpected EOF reading Y-coordinates from DCD"));
+      if (!readCoordRuns(zcrds))
+        throw(FileReadError(_filename, "Unexepcted EOF reading Z-coordinates from DCD"));
+      return(true);
+    }
+
     if (!readCoordLine(xcrds))
       return(false);
     
@@ -175,6 +175,7 @@ namespace loos {
         void allocateSpace(const int n);
         bool readCrystalParams(void);
         bool readCoordLine(std::vector<float>& v);
+        bool readCoordRuns(std::vector<float>& v);
 
         void endianMatch(pStream& fsw);
 
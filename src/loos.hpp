@@ -68,6 +68,7 @@
 #include <Atom.hpp>
 #include <AtomicGroup.hpp>
 #include <pdb.hpp>
+#include <PDBWriter.hpp>
 #include <psf.hpp>
 #include <amber.hpp>
 #include <tinkerxyz.hpp>
@@ -76,10 +77,12 @@
 #include <dcd.hpp>
 #include <dcd_utils.hpp>
 #include <MultiTraj.hpp>
+#include <CachedTraj.hpp>
 
 #include <trajwriter.hpp>
 #include <dcdwriter.hpp>
 #include <xtcwriter.hpp>
+#include <asynctrajwriter.hpp>
 
 #include <amber_traj.hpp>
 
@@ -100,6 +103,16 @@
 #include <Geometry.hpp>
 #include <ensembles.hpp>
 #include <TimeSeries.hpp>
+#include <OccupancyMatrix.hpp>
+#include <NeighborGrid.hpp>
+#include <OrderParameters.hpp>
+#include <Voronoi2D.hpp>
+#include <CoordinateBuffer.hpp>
+#include <WeightedHistogram.hpp>
+#include <EnsembleAligner.hpp>
+#include <MultiReferenceRMSD.hpp>
+#include <ResidueContactMap.hpp>
+#include <ContactFractionEngine.hpp>
 
 #include <Fmt.hpp>
 
@@ -112,6 +125,7 @@
 #include <sorting.hpp>
 
 #include <OptionsFramework.hpp>
+#include <AnalysisRunner.hpp>
 
 #include <alignment.hpp>
 #endif
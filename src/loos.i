@@ -81,3 +81,6 @@ namespace loos {
 %include "gro.i"
 %include "utils_structural.i"
 %include "Weights.i"
+%include "Voronoi2D.i"
+%include "CoordinateBuffer.i"
+%include "WeightedHistogram.i"
@@ -23,6 +23,7 @@
 #include <pdb.hpp>
 #include <utils.hpp>
 #include <Fmt.hpp>
+#include <MappedTextFile.hpp>
 
 #include <iomanip>
 #include <boost/unordered_set.hpp>
@@ -168,12 +169,18 @@ namespace loos {
     crdfmt.trailingZeros(true);
     crdfmt.fixed();
 
-    // Float formatter for B's and Q's...
-    Fmt bqfmt(2);
-    bqfmt.width(6);
-    bqfmt.right();
-    bqfmt.trailingZeros(true);
-    bqfmt.fixed();
+    s << atomPrefix(p);
+    s << crdfmt(p->coords().x());
+    s << crdfmt(p->coords().y());
+    s << crdfmt(p->coords().z());
+    s << atomSuffix(p);
+
+    return(s.str());
+  }
+
+
+  std::string PDB::atomPrefix(const pAtom p) const {
+    std::ostringstream s;
 
     // We don't worry about strings exceeding field-widths (yet),
     // but do check for numeric overflows...
@@ -189,9 +196,20 @@ namespace loos {
     s << std::setw(2) << p->iCode();
     s << "  ";
 
-    s << crdfmt(p->coords().x());
-    s << crdfmt(p->coords().y());
-    s << crdfmt(p->coords().z());
+    return(s.str());
+  }
+
+
+  std::string PDB::atomSuffix(const pAtom p) const {
+    std::ostringstream s;
+
+    // Float formatter for B's and Q's...
+    Fmt bqfmt(2);
+    bqfmt.width(6);
+    bqfmt.right();
+    bqfmt.trailingZeros(true);
+    bqfmt.fixed();
+
     s << bqfmt(p->occupancy());
     s << bqfmt(p->bfactor());
     s << "      ";
@@ -324,6 +342,83 @@ namespace loos {
   }
 
 
+  namespace {
+
+    // Coordinate fields are parsed as floats, as in parseAtomRecord().
+    // Anything the fast scanner can't handle goes through
+    // parseStringAs() so the value (or error) is the same as read()
+    double scanPDBField(const char* line, const char* eol, const uint pos, const uint width) {
+      const char* b = line + pos;
+      if (b < eol) {
+        const char* e = (static_cast<ulong>(eol - b) > width) ? b + width : eol;
+        double val;
+        if (TextScan::parseField(b, e, val))
+          return(static_cast<float>(val));
+      }
+      return(parseStringAs<float>(std::string(line, eol), pos, width));
+    }
+
+  }
+
+
+  const char* PDB::scanCoordinates(const char* b, const char* e, std::vector<GCoord>& crds,
+                                   GCoord& box, bool& periodic) {
+    bool has_xtal = false;
+    bool has_cryst = false;
+    GCoord xtal, cryst;
+
+    crds.clear();
+    const char* p = b;
+    while (p < e) {
+      const char* eol = TextScan::lineEnd(p, e);
+      const char* next = (eol < e) ? eol + 1 : e;
+      ulong n = eol - p;
+
+      if ((n >= 4 && strncmp(p, "ATOM", 4) == 0) || (n >= 6 && strncmp(p, "HETATM", 6) == 0)) {
+        GCoord c;
+        c.x() = scanPDBField(p, eol, 30, 8);
+        c.y() = scanPDBField(p, eol, 38, 8);
+        c.z() = scanPDBField(p, eol, 46, 8);
+        crds.push_back(c);
+
+      } else if (n >= 6 && strncmp(p, "REMARK", 6) == 0) {
+        // Same remark layout as parseRemark() and boxFromRemarks()
+        ulong start = (n > 7 && p[6] == ' ' && isdigit(p[7])) ? 11 : 7;
+        if (!has_xtal && n >= start + 6 && strncmp(p + start, " XTAL ", 6) == 0) {
+          std::string remark(p + start, p + std::min(n, start + 58));
+          std::istringstream iss(remark.substr(5));
+          if (!(iss >> xtal.x() >> xtal.y() >> xtal.z()))
+            throw(ParseError("Unable to parse " + remark));
+          has_xtal = true;
+        }
+
+      } else if (n >= 6 && strncmp(p, "CRYST1", 6) == 0) {
+        cryst.x() = scanPDBField(p, eol, 6, 9);
+        cryst.y() = scanPDBField(p, eol, 15, 9);
+        cryst.z() = scanPDBField(p, eol, 24, 9);
+        has_cryst = true;
+
+      } else if (n >= 3 && strncmp(p, "END", 3) == 0) {
+        p = next;
+        break;
+      }
+
+      p = next;
+    }
+
+    // The box from a REMARK takes precedence over CRYST1, as in read()
+    PeriodicBox pbox;
+    if (has_xtal)
+      pbox.box(xtal);
+    else if (has_cryst)
+      pbox.box(cryst);
+    box = pbox.box();
+    periodic = pbox.isPeriodic();
+
+    return(p);
+  }
+
+
   //! Top level parser...
   //! Reads a PDB from an input stream
   /*
@@ -146,6 +146,19 @@ namespace loos {
         //! Read in PDB from an ifstream
         void read(std::istream& is);
 
+#if !defined(SWIG)
+        //! Scans only the coordinates and periodic box from PDB text in [b, e)
+        /** This is the fast path used by the PDB trajectory readers.
+         *  Only ATOM/HETATM coordinates, CRYST1 and the REMARK XTAL box
+         *  are looked at, and the values are the same as read() would
+         *  give for them.  Scanning stops after the first END (or
+         *  ENDMDL) record, and a pointer to the line after it (or \a e)
+         *  is returned.  Malformed fields throw a ParseError.
+         */
+        static const char* scanCoordinates(const char* b, const char* e, std::vector<GCoord>& crds,
+                                           GCoord& box, bool& periodic);
+#endif
+
     private:
         class ComparePatoms {
             bool operator()(const pAtom& a, const pAtom& b) { return(a->id() < b->id()); }
@@ -172,8 +185,13 @@ namespace loos {
         // Convert an Atom to a string representation in PDB format...
         std::string atomAsString(const pAtom p) const;
 
+        // The parts of an atom record before and after the coordinates
+        std::string atomPrefix(const pAtom p) const;
+        std::string atomSuffix(const pAtom p) const;
+
 #if !defined(SWIG)
         friend std::ostream& FormatConectRecords(std::ostream&, const PDB&);
+        friend class PDBWriter;
 #endif
 
         pAtom findAtom(const int i);
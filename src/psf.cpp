@@ -21,11 +21,20 @@
 
 #include <psf.hpp>
 #include <exceptions.hpp>
+#include <utils.hpp>
+
+#include <cstring>
+#include <algorithm>
+
+#include <boost/thread/thread.hpp>
 
 
 namespace loos {
 
 
+  uint PSF::_nthreads = 1;
+
+
   PSF* PSF::clone(void) const {
     return(new PSF(*this));
   }
@@ -40,99 +49,215 @@ namespace loos {
 
 
 
+  namespace {
+
+    // Steps through the lines of the file in memory
+    struct LineCursor {
+      LineCursor(const char* b, const char* e) : p(b), end(e) { }
+
+      bool next(const char*& lb, const char*& le) {
+        if (p >= end)
+          return(false);
+        lb = p;
+        le = TextScan::lineEnd(p, end);
+        p = (le < end) ? le + 1 : end;
+        return(true);
+      }
+
+      const char* p;
+      const char* end;
+    };
+
+
+    // PSF numbers are plain integers or hybrid-36 (for ids beyond
+    // what fits in a fixed-width field)
+    bool parseNumber(const char* b, const char* e, int& val) {
+      long l;
+      if (TextScan::parseInt(b, e, l)) {
+        val = l;
+        return(true);
+      }
+      if (e - b > 6)
+        return(false);
+      val = parseStringAsHybrid36(std::string(b, e));
+      return(true);
+    }
+
+
+    // Reads the first integer on a line
+    bool leadingInt(const char* b, const char* e, int& val) {
+      const char *tb, *te;
+      long l;
+      if (!TextScan::token(b, e, tb, te) || !TextScan::parseInt(tb, te, l))
+        return(false);
+      val = l;
+      return(true);
+    }
+
+
+    bool parseAtomLine(const char* b, const char* e, Atom& atom, StringPool::Cache& strings) {
+      const char *tb, *te;
+      int num;
+      double val;
+
+      if (!(TextScan::token(b, e, tb, te) && parseNumber(tb, te, num)))
+        return(false);
+      atom.id(num);
+
+      if (!TextScan::token(b, e, tb, te))
+        return(false);
+      atom.segidHandle(strings.intern(tb, te));
+
+      if (!(TextScan::token(b, e, tb, te) && parseNumber(tb, te, num)))
+        return(false);
+      atom.resid(num);
+
+      if (!TextScan::token(b, e, tb, te))
+        return(false);
+      atom.resnameHandle(strings.intern(tb, te));
+
+      if (!TextScan::token(b, e, tb, te))
+        return(false);
+      atom.nameHandle(strings.intern(tb, te));
+
+      // The atom type is a number for CHARMM and a symbol for
+      // NAMD/XPLOR.  The Atom class doesn't use it, so it's
+      // discarded (as is the trailing fixed/mobile flag).
+      if (!TextScan::token(b, e, tb, te))
+        return(false);
+
+      if (!(TextScan::token(b, e, tb, te) && TextScan::parseDouble(tb, te, val)))
+        return(false);
+      atom.charge(val);
+
+      if (!(TextScan::token(b, e, tb, te) && TextScan::parseDouble(tb, te, val)))
+        return(false);
+      atom.mass(val);
+
+      return(true);
+    }
+
+
+    // Parses a contiguous range of atom records into atoms that were
+    // allocated up front.  Each atom is independent, so ranges can be
+    // parsed by separate threads.  Each parser interns its strings
+    // through its own cache so the threads do not contend for the
+    // StringPool lock.
+    struct AtomParser {
+      AtomParser(const std::vector<const char*>* s, const std::vector<const char*>* e,
+                 std::vector<pAtom>* a, const uint o, const uint b, const uint n, uint* f)
+        : starts(s), ends(e), atoms(a), offset(o), begin(b), end(n), failed(f) { }
+
+      void operator()() {
+        for (uint i=begin; i<end; ++i) {
+          Atom& atom = *((*atoms)[i]);
+          atom.index(offset + i);
+          if (!parseAtomLine((*starts)[i], (*ends)[i], atom, strings)) {
+            *failed = i;
+            return;
+          }
+        }
+      }
+
+      const std::vector<const char*>* starts;
+      const std::vector<const char*>* ends;
+      std::vector<pAtom>* atoms;
+      uint offset, begin, end;
+      uint* failed;
+      StringPool::Cache strings;
+    };
+
+  }
+
+
+
   void PSF::read(std::istream& is) {
-    std::string input;
+    MappedTextFile text(is);
+    parse(text.begin(), text.end());
+  }
+
+
+
+  void PSF::parse(const char* begin, const char* end) {
+    LineCursor lines(begin, end);
+    const char *lb, *le;
 
     // first line is the PSF header
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "Failed reading first line of psf"));
-    if (input.substr(0,3) != "PSF")
+    if (le - lb < 3 || strncmp(lb, "PSF", 3) != 0)
       throw(FileReadError(_filename, "PSF detected a non-PSF file"));
 
     // second line is blank
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "PSF failed reading first header blank"));
 
     // third line is title header
-    getline(is, input);
     int num_title_lines;
-    if (!(std::stringstream(input) >> num_title_lines))
+    if (!lines.next(lb, le) || !leadingInt(lb, le, num_title_lines))
       throw(FileReadError(_filename, "PSF has malformed title header"));
 
     // skip the rest of the title
     for (int i=0; i<num_title_lines; i++)
-      getline(is, input);
-
-    // verify nothing went wrong
-    if (!(is.good()))
-      // Yes, I know, I should figure out what went wrong instead
-      // of running home crying.  Sorry, Tod...
-      throw(FileReadError(_filename, "PSF choked reading the header"));
+      if (!lines.next(lb, le))
+        throw(FileReadError(_filename, "PSF choked reading the header"));
 
     // next line is blank
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "PSF failed reading second header blank"));
 
     // next line is the number of atoms
-
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "PSF failed reading natom line"));
     int num_atoms;
-    if (!(std::stringstream(input) >> num_atoms))
+    if (!leadingInt(lb, le, num_atoms) || num_atoms < 0)
       throw(FileReadError(_filename, "PSF has malformed natom line"));
 
+    // Find the atom lines first, then parse them
+    std::vector<const char*> starts(num_atoms), ends(num_atoms);
     for (int i=0; i<num_atoms; i++) {
-      if (!getline(is, input)) {
+      if (!lines.next(starts[i], ends[i])) {
 	std::ostringstream oss;
 	oss << "Failed reading PSF atom line for atom #" << (i+1);
         throw(FileReadError(_filename, oss.str()));
       }
-      parseAtomRecord(input);
     }
+    parseAtomRecords(starts, ends);
 
     // next line is blank
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "PSF failed reading blank after atom lines"));
 
     // next block of lines is the list of bonds
     // Bond title line
-    if (!getline(is, input))
+    if (!lines.next(lb, le))
       throw(FileReadError(_filename, "PSF failed reading nbond line"));
     int num_bonds;
-    if (!(std::stringstream(input) >> num_bonds))
+    if (!leadingInt(lb, le, num_bonds))
       throw(FileReadError(_filename, "PSF has malformed nbond line"));
 
     int bonds_found = 0;
-    getline(is, input);
-    while (input.size() > 1) { // end of the block is marked by a blank line
-                               // Note: >1 to handle \r in files that came from windows...
-      int ind1, ind2;
-      std::string buf1, buf2;
-      std::stringstream s(input);
-
-      while (s.good()) {
-        if (!(s >> buf1 >> buf2))
-          throw(FileReadError(_filename, "PSF error parsing bonds.\n> " + input));
-
-        ind1 = parseStringAsHybrid36(buf1);
-        ind2 = parseStringAsHybrid36(buf2);
-
-        if (ind1 > num_atoms || ind2 > num_atoms)
-          throw(FileReadError(_filename, "PSF bond error: bound atomid exceeds number of atoms.\n> " + input));
-
-        ind1--;  // our indices are 1 off from the numbering in the pdb/psf file
-        ind2--;
-        pAtom pa1 = getAtom(ind1);
-        pAtom pa2 = getAtom(ind2);
+    // end of the block is marked by a blank line
+    // Note: >1 to handle \r in files that came from windows...
+    while (lines.next(lb, le) && le - lb > 1) {
+      const char* p = lb;
+      const char *tb1, *te1, *tb2, *te2;
+
+      while (TextScan::token(p, le, tb1, te1)) {
+        int ind1, ind2;
+        if (!(TextScan::token(p, le, tb2, te2) && parseNumber(tb1, te1, ind1) && parseNumber(tb2, te2, ind2)))
+          throw(FileReadError(_filename, "PSF error parsing bonds.\n> " + std::string(lb, le)));
+
+        if (ind1 > num_atoms || ind2 > num_atoms || ind1 < 1 || ind2 < 1)
+          throw(FileReadError(_filename, "PSF bond error: bound atomid exceeds number of atoms.\n> " + std::string(lb, le)));
+
+        // our indices are 1 off from the numbering in the pdb/psf file
+        pAtom pa1 = atoms[ind1 - 1];
+        pAtom pa2 = atoms[ind2 - 1];
         pa1->addBond(pa2);
         pa2->addBond(pa1);
         bonds_found++;
-
-        // Catch returns in files that came from windows...
-        if (s.peek() == '\r')
-          break;
       }
-      getline(is, input);
     }
     // sanity check
     if (bonds_found != num_bonds)
@@ -144,68 +269,35 @@ namespace loos {
 
 
 
-  void PSF::parseAtomRecord(const std::string s) {
-    gint index;
-    std::string segname;
-    gint resid;
-    std::string resname;
-    std::string atomname;
-    std::string atomtype;
-    greal charge;
-    greal mass;
-    gint fixed;
-    std::string buf;
-
-    pAtom pa(new Atom);
-    pa->index(_max_index++);
-
-    std::stringstream ss(s);
-
-    if (!(ss >> buf))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    index = parseStringAsHybrid36(buf);
-    pa->id(index);
-
-    if (!(ss >> segname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    pa->segid(segname);
-
-
-    if (!(ss >> buf))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    resid = parseStringAsHybrid36(buf);
-    pa->resid(resid);
-
-    if (!(ss >> resname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    pa->resname(resname);
-
-    if (!(ss >> atomname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    pa->name(atomname);
-
-    // If this is a charmm psf, the atomtype will be an integer.
-    // NAMD/XPLOR psfs use the symbolic atomtype, which must start with a letter
-    // At the moment, the Atom class doesn't care about this value (it's mostly
-    // used in charmm and namd as a means to look up parameters), so we're going to
-    // discard it.  However, if we ever decide we're going to use this, we'll need
-    // to keep track of the distinction between charmm and namd usage.
-    if (!(ss >> atomtype))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-
-    if (!(ss >> charge))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    pa->charge(charge);
-
-    if (!(ss >> mass))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
-    pa->mass(mass);
+  void PSF::parseAtomRecords(const std::vector<const char*>& starts, const std::vector<const char*>& ends) {
+    uint n = starts.size();
+    std::vector<pAtom> parsed = allocateAtoms(n);
+
+    // Only bother with threads for large systems
+    uint nthreads = _nthreads ? _nthreads : boost::thread::hardware_concurrency();
+    if (nthreads > n / 25000)
+      nthreads = n / 25000;
+    if (nthreads < 1)
+      nthreads = 1;
+
+    std::vector<uint> failed(nthreads, n);
+    uint chunk = (n + nthreads - 1) / nthreads;
+    if (nthreads == 1) {
+      AtomParser parser(&starts, &ends, &parsed, _max_index, 0, n, &failed[0]);
+      parser();
+    } else {
+      boost::thread_group threads;
+      for (uint t=0; t<nthreads; ++t)
+        threads.create_thread(AtomParser(&starts, &ends, &parsed, _max_index, t * chunk, std::min(n, (t+1) * chunk), &failed[t]));
+      threads.join_all();
+    }
 
-    // Is the atom fixed or mobile?
-    // for now, we're going to silently drop this
-    ss >> fixed;
+    uint bad = *(std::min_element(failed.begin(), failed.end()));
+    if (bad < n)
+      throw(FileReadError(_filename, "PSF parse error.\n> " + std::string(starts[bad], ends[bad])));
 
-    append(pa);
+    append(parsed);
+    _max_index += n;
   }
 
 }
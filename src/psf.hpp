@@ -30,6 +30,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <MappedTextFile.hpp>
 
 
 namespace loos {
@@ -56,6 +57,11 @@ namespace loos {
    *\code
    * bool ok = psf.allHaveProperty(Atom::anumbit);
    *\endcode
+   *
+   * When reading from a file, it is memory-mapped and parsed in
+   * place.  The atom records of large systems can be split among
+   * threads; this is off by default so readers don't compete with
+   * tools that run their own threads (see PSF::threads()).
   */
   class PSF : public AtomicGroup {
   public:
@@ -63,10 +69,8 @@ namespace loos {
     virtual ~PSF() {}
 
     explicit PSF(const std::string& fname) : _max_index(0), _filename(fname) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-        throw(FileOpenError(fname));
-      read(ifs);
+      MappedTextFile text(fname);
+      parse(text.begin(), text.end());
     }
 
     explicit PSF(std::fstream &ifs) : _max_index(0), _filename("stream") {
@@ -85,14 +89,24 @@ namespace loos {
 
     void read(std::istream& is);  
 
+    //! Maximum number of threads used to parse atom records (0 = all available)
+    /**
+     * This applies to every PSF read afterwards.  The default is 1.
+     */
+    static void threads(const uint n) { _nthreads = n; }
+    static uint threads() { return(_nthreads); }
+
 
   private:
 
     PSF(const AtomicGroup& grp) : AtomicGroup(grp) { }
-    void parseAtomRecord(const std::string s);  
+    void parse(const char* begin, const char* end);
+    void parseAtomRecords(const std::vector<const char*>& starts, const std::vector<const char*>& ends);
 
     uint _max_index;
     std::string _filename;
+
+    static uint _nthreads;
   };
 
 
@@ -21,76 +21,174 @@
 
 #include <tinker_arc.hpp>
 #include <AtomicGroup.hpp>
+#include <TextFrameIndex.hpp>
+
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
 
 namespace loos {
 
-  void TinkerArc::init(void) {
-    char buf[512];
+  namespace {
+
+    // Same test (and parsing) as TinkerXYZ::parseBoxRecord()
+    bool parseBoxRecord(const char* p, const char* eol, GCoord& c) {
+      greal x = 0.0, y, z = 0.0;
+      std::string tmp;
+      std::stringstream ss(std::string(p, eol));
+      ss >> x;
+      ss >> tmp;
+      if (isalpha(tmp[0]))
+        return(false);
+      y = atof(tmp.c_str());
+      ss >> z;
+      c = GCoord(x, y, z);
+      return(true);
+    }
+
+    const char* nextLine(const char* p, const char* e) {
+      p = TextScan::lineEnd(p, e);
+      return(p < e ? p + 1 : e);
+    }
+
+    // Skips blank lines, returning false if there's nothing left
+    bool skipBlankLines(const char*& p, const char* e) {
+      while (p < e) {
+        const char* q = p;
+        TextScan::skipBlanks(q, e);
+        if (q < e && *q != '\n')
+          return(true);
+        p = (q < e) ? q + 1 : e;
+      }
+      return(false);
+    }
+
+    bool parseHeader(const char* p, const char* e, long& n) {
+      const char *tb, *te;
+      return(TextScan::token(p, TextScan::lineEnd(p, e), tb, te) && TextScan::parseInt(tb, te, n) && n >= 0);
+    }
+
+  }
 
-    // Read the first frame to get the # of atoms...
-    frame.read(*(ifs));
-    _natoms = frame.size();
-    indices.push_back(0l);
-    cached_first = true;
 
-    // Now determine the # of frames...
-    while (!ifs->eof()) {
-      indices.push_back(ifs->tellg());
-      ifs->getline(buf, sizeof(buf));
-      for (uint i=0; i<_natoms; ++i)
-        ifs->getline(buf, sizeof(buf));
+  void TinkerArc::init(boost::shared_ptr<MappedTextFile> text, const bool cacheable) {
+    _text = text;
+
+    TextFrameIndex index(_filename, "tinker_arc");
+    if (!(cacheable && index.load(indices))) {
+      scanFrames();
+      if (cacheable)
+        index.save(indices);
     }
 
     _nframes = indices.size() - 1;
+    if (_nframes == 0)
+      throw(FileReadError(_filename, "Failed reading first frame of Tinker ARC"));
 
-    ifs->clear();
-    ifs->seekg(indices[1]);
+    // Read the first frame to get the # of atoms...
+    parseFrame();
+    _natoms = crds.size();
+    cached_first = true;
   }
 
 
-  void TinkerArc::seekNextFrameImpl(void) {
-    if (++current_index >= _nframes)
-      at_end = true;
+  // Builds the frame indices, where frame i is the text between
+  // indices[i] and indices[i+1].  A truncated final frame is dropped.
+  void TinkerArc::scanFrames(void) {
+    const char* b = _text->begin();
+    const char* e = _text->end();
+    const char* p = b;
+
+    indices.clear();
+    indices.push_back(0);
+    while (skipBlankLines(p, e)) {
+      long n;
+      if (!parseHeader(p, e, n))
+        throw(FileReadError(_filename, "TinkerXYZ has malformed header"));
+      p = nextLine(p, e);
+
+      // Optional box record...
+      GCoord c;
+      if (p < e && parseBoxRecord(p, TextScan::lineEnd(p, e), c))
+        p = nextLine(p, e);
+
+      for (long i=0; i<n; ++i) {
+        if (p >= e)
+          return;
+        p = nextLine(p, e);
+      }
+      indices.push_back(p - b);
+    }
   }
 
 
   void TinkerArc::seekFrameImpl(const uint i) {
     if (i >= _nframes)
       throw(FileError(_filename, "Requested trajectory frame is out of range"));
-
-    ifs->clear();
-    ifs->seekg(indices[i]);
-    if (ifs->fail())
-      throw(FileError(_filename, "Cannot seek to the requested frame"));
-
-    current_index = i;
-    at_end = false;
   }
 
 
   bool TinkerArc::parseFrame(void) {
-    if (ifs->eof() || at_end)
+    if (atEnd())
       return(false);
 
-    TinkerXYZ newframe;
-    newframe.read(*(ifs));
-    frame = newframe;
-    if (frame.size() == 0) {
-      at_end = true;
-      return(false);
-    }
+    const char* p = _text->begin() + indices[_current_frame];
+    const char* e = _text->begin() + indices[_current_frame+1];
 
-    return(true);
-  }
+    long n;
+    if (!(skipBlankLines(p, e) && parseHeader(p, e, n)))
+      throw(FileReadError(_filename, "TinkerXYZ has malformed header"));
+    p = nextLine(p, e);
 
+    PeriodicBox pbox;
+    GCoord c;
+    if (p < e && parseBoxRecord(p, TextScan::lineEnd(p, e), c)) {
+      pbox.box(c);
+      p = nextLine(p, e);
+    }
+    box = pbox.box();
+    periodic = pbox.isPeriodic();
+
+    // Atom records are "index name x y z type bonds..."
+    crds.resize(n);
+    for (long i=0; i<n; ++i) {
+      const char* eol = TextScan::lineEnd(p, e);
+      const char* q = p;
+      const char *tb, *te;
+      bool ok = TextScan::token(q, eol, tb, te) && TextScan::token(q, eol, tb, te);
+      for (uint k=0; k<3 && ok; ++k)
+        ok = TextScan::token(q, eol, tb, te) && TextScan::parseDouble(tb, te, crds[i][k]);
+
+      // Fall back to parsing the way TinkerXYZ does
+      if (!ok) {
+        gint index;
+        std::string name;
+        greal x = 0.0, y = 0.0, z = 0.0;
+        std::stringstream ss(std::string(p, eol));
+        ss >> index >> name >> x >> y >> z;
+        crds[i] = GCoord(x, y, z);
+      }
+      p = (eol < e) ? eol + 1 : e;
+    }
 
-  std::vector<GCoord> TinkerArc::coords(void) const {
-    std::vector<GCoord> result(_natoms);
+    parsed_index = _current_frame;
+    frame_parsed = false;
+
+    return(n != 0);
+  }
 
-    for (uint i=0; i<_natoms; i++)
-      result[i] = frame[i]->coords();
 
-    return(result);
+  TinkerXYZ TinkerArc::currentFrame(void) const {
+    if (!frame_parsed) {
+      std::istringstream iss(std::string(_text->begin() + indices[parsed_index],
+                                         _text->begin() + indices[parsed_index+1]));
+      TinkerXYZ newframe;
+      newframe.read(iss);
+      frame = newframe;
+      frame_parsed = true;
+    }
+    return(frame);
   }
 
 
@@ -98,9 +196,9 @@ namespace loos {
   {
     for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
       uint idx = (*i)->index();
-      if (idx >= _natoms)
+      if (idx >= crds.size())
 	throw(LOOSError(**i, "Atom index into the trajectory frame is out of bounds"));
-      (*i)->coords(frame[idx]->coords());
+      (*i)->coords(crds[idx]);
     }
     
     // Handle periodic boundary conditions (if present)
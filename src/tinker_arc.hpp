@@ -27,8 +27,11 @@
 #include <string>
 #include <stdexcept>
 
+#include <boost/shared_ptr.hpp>
+
 #include <loos_defs.hpp>
 #include <Trajectory.hpp>
+#include <MappedTextFile.hpp>
 
 #include <tinkerxyz.hpp>
 
@@ -40,17 +43,15 @@ namespace loos {
    *  ARC file).  In order to determine the number of frames present,
    *  the trajectory is scanned from beginning to end upon
    *  instantiation.  A list of seek indices for each frame is also
-   *  built.
+   *  built.  For large files, these are cached on disk (see
+   *  TextFrameIndex) so the scan only happens once.
    *
    *  The first frame is read in by init(), so there is no explicit
    *  readFrame() during initialization.
    *
-   *  There seems to be an issue with some .ARC files where reading the
-   *  end of the contained TinkerXYZ object does not put the input
-   *  stream into an EOF state.  So, we can't depend on checking eof()
-   *  in parseFrame() to flag when we've iterated off the end.
-   *  TinkerArc therefore keeps track of what index into the Trajectory
-   *  it's at and uses that to check to see if it's at the end or not.
+   *  The file is mapped into memory and only the coordinates (and
+   *  box, if present) are parsed for each frame.  The full TinkerXYZ
+   *  for a frame is only built if currentFrame() is called.
    * 
    *  It is possible to get the contained TinkerXYZ object out of a
    *  TinkerArc, but with certain caveats.  See CCPDB::currentFrame()
@@ -60,10 +61,12 @@ namespace loos {
   class TinkerArc : public Trajectory {
   public:
     explicit TinkerArc(const std::string& s) : Trajectory(s), _natoms(0), _nframes(0),
-                                               current_index(0), at_end(false) { init(); }
+                                               periodic(false), frame_parsed(false), parsed_index(0)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(s)), true); }
   
     explicit TinkerArc(std::istream& is) : Trajectory(is), _natoms(0),
-					   _nframes(0), current_index(0), at_end(false) { init(); }
+					   _nframes(0), periodic(false), frame_parsed(false), parsed_index(0)
+    { init(boost::shared_ptr<MappedTextFile>(new MappedTextFile(is)), false); }
 
     std::string description() const { return("Tinker Archive"); }
 
@@ -73,10 +76,10 @@ namespace loos {
 
     virtual uint nframes(void) const { return(_nframes); }
     virtual uint natoms(void) const { return(_natoms); }
-	virtual std::vector<GCoord> coords(void) const;
+	virtual std::vector<GCoord> coords(void) const { return(crds); }
 
-    virtual bool hasPeriodicBox(void) const { return(frame.isPeriodic()); }
-    virtual GCoord periodicBox(void) const { return(frame.periodicBox()); }
+    virtual bool hasPeriodicBox(void) const { return(periodic); }
+    virtual GCoord periodicBox(void) const { return(box); }
 
     virtual float timestep(void) const { return(0.001); }
 
@@ -84,25 +87,32 @@ namespace loos {
     /** See CCPDB::currentFrame() for some important notes about using
      *  this function.
      */
-    TinkerXYZ currentFrame(void) const { return(frame); }
+    TinkerXYZ currentFrame(void) const;
 
     virtual bool parseFrame(void);
 
 
   private:
-    void init(void);
-    virtual void rewindImpl(void) { ifs->clear(); ifs->seekg(0); current_index = 0; at_end = false; }
-    virtual void seekNextFrameImpl(void);
+    void init(boost::shared_ptr<MappedTextFile> text, const bool cacheable);
+    void scanFrames(void);
+    virtual void rewindImpl(void) { }
+    virtual void seekNextFrameImpl(void) { }
     virtual void seekFrameImpl(const uint);
     virtual void updateGroupCoordsImpl(AtomicGroup& g);
 
 
   private:
     uint _natoms, _nframes;
-    uint current_index;
-    bool at_end;
-    TinkerXYZ frame;
-    std::vector<long> indices;
+    bool periodic;
+    GCoord box;
+    std::vector<GCoord> crds;
+    std::vector<ulong> indices;
+    boost::shared_ptr<MappedTextFile> _text;
+
+    // The full frame is only built on request
+    mutable TinkerXYZ frame;
+    mutable bool frame_parsed;
+    uint parsed_index;
   };
 
 
@@ -73,7 +73,7 @@ namespace loos {
      * the TrajectoryWriter object.
      */
     TrajectoryWriter(std::iostream* s, const bool append = false)
-      : _filename("stream"), appending_(append), delete_(false) {}
+      : stream_(s), _filename("stream"), appending_(append), delete_(false) {}
 
 
     virtual ~TrajectoryWriter() {
@@ -203,6 +203,33 @@ namespace loos {
 		}
 
 
+		// As above, but only reads the triplets covered by the
+		// selection hint.  Atoms outside the hint are left zeroed and
+		// the stream is left at the end of the block.
+		template<typename T>
+		void readBlockRuns(std::vector<GCoord>& v, const uint natoms, const std::string& msg) {
+			v.assign(natoms, GCoord(0,0,0));
+
+			std::istream* stream = xdr_file.get();
+			std::streampos start = stream->tellg();
+			std::vector<T> buf;
+
+			for (IndexRuns::const_iterator run = _hint_runs.begin(); run != _hint_runs.end(); ++run) {
+				if (run->first + run->second > natoms)
+					throw(FileReadError(_filename, "Selection hint extends past the end of the TRR frame"));
+				uint n = run->second * DIM;
+				buf.resize(n);
+				stream->seekg(start + static_cast<std::streamoff>(run->first * DIM * sizeof(T)));
+				if (xdr_file.read(&(buf[0]), n) != n)
+					throw(FileReadError(_filename, "Unable to read " + msg));
+				for (uint i=0; i<n; i += DIM)
+					v[run->first + i / DIM] = GCoord(buf[i], buf[i+1], buf[i+2]) * 10.0;
+			}
+
+			stream->seekg(start + static_cast<std::streamoff>(natoms * DIM * sizeof(T)));
+		}
+
+
 		// Note: Assumes that the object Header has already been read...
 		template<typename T>
 		bool readRawFrame() {
@@ -226,14 +253,28 @@ namespace loos {
 			if (hdr_.pres_size)
 				readBlock<T>(pres_, DIM*DIM, "pressure");
 
-			if (hdr_.x_size)
-				readBlock<T>(coords_, hdr_.natoms * DIM, "Coordinates");
+			if (hasSelectionHint()) {
 
-			if (hdr_.v_size)
-				readBlock<T>(velo_, hdr_.natoms * DIM, "Velocities");
+				if (hdr_.x_size)
+					readBlockRuns<T>(coords_, hdr_.natoms, "Coordinates");
 
-			if (hdr_.f_size)
-				readBlock<T>(forc_, hdr_.natoms * DIM, "Forces");
+				if (hdr_.v_size)
+					readBlockRuns<T>(velo_, hdr_.natoms, "Velocities");
+
+				if (hdr_.f_size)
+					readBlockRuns<T>(forc_, hdr_.natoms, "Forces");
+
+			} else {
+
+				if (hdr_.x_size)
+					readBlock<T>(coords_, hdr_.natoms * DIM, "Coordinates");
+
+				if (hdr_.v_size)
+					readBlock<T>(velo_, hdr_.natoms * DIM, "Velocities");
+
+				if (hdr_.f_size)
+					readBlock<T>(forc_, hdr_.natoms * DIM, "Forces");
+			}
 
 
 			return(! ((xdr_file.get())->fail() || (xdr_file.get())->eof()) );
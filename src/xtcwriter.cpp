@@ -733,6 +733,16 @@ Library.
   }
 
 
+  void XTCWriter::writeEncodedFrames(const std::string& data, const uint n) {
+    stream_->write(data.data(), data.size());
+    if (stream_->fail())
+      throw(FileWriteError(_filename, "Error while writing encoded XTC frames"));
+
+    current_ += n;
+    step_ += n * steps_per_frame_;
+  }
+
+
   // Read existing XTC to get frame count...
   void XTCWriter::prepareToAppend() {
     stream_->seekg(0);
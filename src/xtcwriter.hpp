@@ -128,6 +128,30 @@ namespace loos {
 
 
 
+    //! Write to a stream that the caller has already prepared
+    /**
+     * Frames are written at the current put position.  Nothing is
+     * read back, so this is useful for encoding frames into memory
+     * (e.g. a std::stringstream) to be copied into a file later with
+     * writeEncodedFrames().
+     */
+    XTCWriter(std::iostream& s, const double dt = 1.0, const uint steps_per_frame = 1, const float precision = 1e3) :
+      TrajectoryWriter(&s, false),
+      buf1size(0), buf2size(0),
+      buf1(0), buf2(0),
+      natoms_(0),
+      dt_(dt),
+      step_(0),
+      steps_per_frame_(steps_per_frame),
+      current_(0),
+      crds_size_(0),
+      crds_(0),
+      precision_(precision)
+    {
+      xdr.setStream(stream_);
+    }
+
+
     ~XTCWriter() {
       delete[] buf1;
       delete[] buf2;
@@ -160,6 +184,15 @@ namespace loos {
     //! Write a frame to the trajectory with explicit step and time metadata
     void writeFrame(const AtomicGroup& model, const uint step, const double time);
 
+    //! Append \a n frames that were already encoded by another XTCWriter
+    /**
+     * The step counter is advanced as if the frames had been written
+     * with writeFrame(), so the frames should have been encoded
+     * starting at currentStep() with the same time per step and
+     * steps per frame as this writer.
+     */
+    void writeEncodedFrames(const std::string& data, const uint n);
+
     uint framesWritten() const { return(current_); }
 
   private: